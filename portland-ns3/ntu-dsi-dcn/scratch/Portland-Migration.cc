@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// VM migration in a PortLand fat tree.
+//
+// Every host of the first pod streams UDP to one VM, host 0 of edge 0 in
+// pod 1, at a fixed rate; together they load the VM's link to about line
+// rate. Halfway through, the VM is live-migrated next to the last host of
+// the last pod. The new edge switch registers the VM's new PMAC, the
+// Fabric Manager hands it to the senders' edge switches and tells the old
+// edge switch, which traps (and forwards) packets still sent to the old
+// PMAC.
+//
+// Reported: the longest gap between packets arriving at the VM (the
+// blackout), the packets lost, and the packets trapped at the old edge
+// switch.
+
+#include <iostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/portland-module.h"
+#include "ns3/flow-monitor-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PortlandMigration");
+
+static std::vector<Time> g_rxTimes;
+
+static void
+PacketReceived (Ptr<const Packet> packet, const Address& from)
+{
+  g_rxTimes.push_back (Simulator::Now ());
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t k = 4;
+  std::string rate = "1400Mbps";
+  std::string fm_latency = "50us";
+  double migrate_at = 0.05;
+  double duration = 0.1;
+  bool forward = true;
+
+  CommandLine cmd;
+  cmd.AddValue ("k", "Number of ports per switch of the fat tree.", k);
+  cmd.AddValue ("rate", "Total rate of the traffic sent to the VM.", rate);
+  cmd.AddValue ("fmLatency", "One-way latency between a switch and the Fabric Manager.", fm_latency);
+  cmd.AddValue ("migrateAt", "Time in seconds at which the VM moves.", migrate_at);
+  cmd.AddValue ("duration", "Time in seconds the senders send for.", duration);
+  cmd.AddValue ("forward", "Whether the old edge switch forwards trapped packets to the new location of the VM.", forward);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::pld::FabricManager::Latency", StringValue (fm_latency));
+  Config::SetDefault ("ns3::PortlandSwitchNetDevice::ForwardMovedPackets", BooleanValue (forward));
+  // always-on flows outrun address resolution; hold their first packets instead of dropping them
+  Config::SetDefault ("ns3::ArpCache::PendingQueueSize", UintegerValue (1000));
+
+  Ptr<pld::FabricManager> fabricManager = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetChannelAttribute ("DataRate", StringValue ("1536Mbps"));
+  fatTree.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (0)));
+  fatTree.Install (fabricManager);
+
+  Ptr<Node> vm = fatTree.GetHost (1, 0, 0);
+  Ptr<Node> destination = fatTree.GetHost (k - 1, k / 2 - 1, k / 2 - 1);
+  uint16_t port = 9;
+
+  PacketSinkHelper sink ("ns3::UdpSocketFactory", Address (InetSocketAddress (Ipv4Address::GetAny (), port)));
+  ApplicationContainer sinkApp = sink.Install (vm);
+  sinkApp.Start (Seconds (0));
+  sinkApp.Get (0)->TraceConnectWithoutContext ("Rx", MakeCallback (&PacketReceived));
+
+  // the hosts of pod 0 share the rate
+  uint32_t n_senders = k / 2 * k / 2;
+  DataRate sender_rate (DataRate (rate).GetBitRate () / n_senders);
+  OnOffHelper onoff ("ns3::UdpSocketFactory", Address (InetSocketAddress (fatTree.GetHostAddress (1, 0, 0), port)));
+  onoff.SetAttribute ("OnTime", RandomVariableValue (ConstantVariable (1000)));
+  onoff.SetAttribute ("OffTime", RandomVariableValue (ConstantVariable (0)));
+  onoff.SetAttribute ("PacketSize", UintegerValue (1024));
+  onoff.SetAttribute ("DataRate", DataRateValue (sender_rate));
+  ApplicationContainer senders;
+  for (uint32_t e = 0; e < k / 2; e++)
+    {
+      for (uint32_t h = 0; h < k / 2; h++)
+        {
+          senders.Add (onoff.Install (fatTree.GetHost (0, e, h)));
+        }
+    }
+  // the VM announces itself when it boots, so that the senders' first ARP Requests find it at the Fabric Manager
+  Simulator::Schedule (Seconds (0), &PortlandFatTreeHelper::AnnounceHost, vm);
+  senders.Start (Seconds (0.01));
+  senders.Stop (Seconds (duration));
+
+  Simulator::Schedule (Seconds (migrate_at), &PortlandFatTreeHelper::MigrateHost, vm, destination);
+
+  FlowMonitorHelper flowmon;
+  Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
+  Simulator::Stop (Seconds (duration + 0.1));
+  Simulator::Run ();
+
+  monitor->CheckForLostPackets ();
+  uint64_t tx = 0;
+  uint64_t rx = 0;
+  std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator f = stats.begin (); f != stats.end (); f++)
+    {
+      tx += f->second.txPackets;
+      rx += f->second.rxPackets;
+    }
+
+  // the blackout is the longest gap between arrivals at the VM around the migration
+  Time interval = Seconds (1024 * 8.0 / DataRate (rate).GetBitRate ());
+  Time blackout = Seconds (0);
+  Time resumed = Seconds (0);
+  for (uint32_t i = 1; i < g_rxTimes.size (); i++)
+    {
+      if (g_rxTimes[i] > Seconds (migrate_at) && g_rxTimes[i] - g_rxTimes[i - 1] > blackout)
+        {
+          blackout = g_rxTimes[i] - g_rxTimes[i - 1];
+          resumed = g_rxTimes[i];
+        }
+    }
+
+  uint64_t trapped = 0;
+  uint64_t garps = 0;
+  for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); n++)
+    {
+      for (uint32_t d = 0; d < (*n)->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> ((*n)->GetDevice (d));
+          if (sw != 0)
+            {
+              trapped += sw->GetNTrappedPackets ();
+              garps += sw->GetNGratuitousArps ();
+            }
+        }
+    }
+
+  std::cout << "k=" << k << ", rate=" << rate << ", Fabric Manager latency=" << fm_latency
+            << ", forward trapped packets=" << forward << "\n";
+  std::cout << "Migrations: " << fabricManager->GetNMigrations () << "\n";
+  std::cout << "Packets sent: " << tx << ", received: " << rx << ", lost: " << tx - rx << "\n";
+  std::cout << "Blackout: " << blackout.GetMicroSeconds () << " us (packet interval "
+            << interval.GetMicroSeconds () << " us), traffic resumed "
+            << (resumed - Seconds (migrate_at)).GetMicroSeconds () << " us after the migration\n";
+  std::cout << "Packets trapped at the old edge switch: " << trapped << ", gratuitous ARPs: " << garps << "\n";
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -42,6 +42,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -120,6 +122,20 @@ std::string getHostName(int i, int j)
 	ss << i << "-" << j;
 	return ss.str();
 }
+
+void
+AddFabricManagerShard (Ptr<ns3::pld::FabricManagerCluster> cluster)
+{
+	cluster->AddShard ();
+}
+
+// Writes the delay of every scheduled event, in seconds, for utils/bench-simulator
+void
+RecordEventDelay (std::ostream *os, Time delay)
+{
+	*os << delay.GetSeconds () << "\n";
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -136,17 +152,66 @@ main (int argc, char *argv[])
   cmd.AddValue ("t", "Learning Controller Timeout (has no effect if drop controller is specified).", MakeCallback ( &SetTimeout));
   cmd.AddValue ("timeout", "Learning Controller Timeout (has no effect if drop controller is specified).", MakeCallback ( &SetTimeout));
 
+	int k	= 8;
+	std::string uplink = "Hash";
+	uint32_t seed = 0;
+	std::string traffic = "random";
+	std::string rate = "96Mbps";
+	uint32_t max_bytes = 70000;
+	std::string core_delay = "0s";
+	bool full_duplex = false;
+	std::string fm_latency = "50us";
+	std::string fm_service = "10us";
+	uint32_t fm_shards = 1;
+	double fm_add_shard_at = 0;
+	std::string fm_flood = "CoreTree";
+	std::string port_stats = "";
+	uint32_t event_trace = 0;
+	std::string prewarm = "";
+	std::string save_snapshot = "";
+	std::string event_delays = "";
+	uint32_t shared_buffer = 0;
+	double buffer_alpha = 1.0;
+	uint32_t ecn_threshold = 0;
+  cmd.AddValue ("k", "Number of ports per switch of the fat tree.", k);
+  cmd.AddValue ("uplink", "Uplink policy of the switches: Random, Hash, Flowlet or Adaptive.", uplink);
+  cmd.AddValue ("seed", "Seed of the traffic pattern; 0 picks one from the current time.", seed);
+  cmd.AddValue ("traffic", "Traffic pattern: random (on/off to random hosts), permutation or hotspot (always-on flows).", traffic);
+  cmd.AddValue ("rate", "Sending rate of each host.", rate);
+  cmd.AddValue ("maxBytes", "Bytes each host sends; 0 for no limit.", max_bytes);
+  cmd.AddValue ("coreDelay", "Delay added to the links of the core switches per core position, so that paths through different cores have unequal latency; use with --fullDuplex, a half-duplex link carries one frame at a time.", core_delay);
+  cmd.AddValue ("fullDuplex", "Link the tree with full-duplex channels.", full_duplex);
+  cmd.AddValue ("fmLatency", "One-way latency between a switch and the Fabric Manager.", fm_latency);
+  cmd.AddValue ("fmService", "Time the Fabric Manager spends on one message.", fm_service);
+  cmd.AddValue ("fmShards", "Number of Fabric Manager shards the hosts are partitioned over.", fm_shards);
+  cmd.AddValue ("fmFlood", "Switches the Fabric Manager floods ARP Requests for unknown hosts from: AllCores, CoreTree or Edges.", fm_flood);
+  cmd.AddValue ("fmAddShardAt", "Time in seconds at which one more Fabric Manager shard joins; 0 for never.", fm_add_shard_at);
+  cmd.AddValue ("prewarm", "Pre-warm the PMACs, Fabric Manager and host ARP caches: 'topology', or a snapshot file written by --saveSnapshot; empty for a cold start.", prewarm);
+  cmd.AddValue ("saveSnapshot", "File the PMACs of the hosts are written to at the end of the run; empty for none.", save_snapshot);
+  cmd.AddValue ("eventTrace", "Number of control plane events kept and written to statistics/Portland-events.bin; 0 for none.", event_trace);
+  cmd.AddValue ("sharedBuffer", "Bytes of the buffer shared by the egress queues of each switch; 0 for a drop-tail queue per port.", shared_buffer);
+  cmd.AddValue ("bufferAlpha", "Dynamic threshold factor of the shared buffers.", buffer_alpha);
+  cmd.AddValue ("ecnThreshold", "Queue length in bytes from which the shared buffers mark ECN-capable packets; 0 for no marking.", ecn_threshold);
+  cmd.AddValue ("eventDelays", "File the delay of every scheduled event is written to, for utils/bench-simulator; empty for none.", event_delays);
+  cmd.AddValue ("portStats", "Interval at which the counters of every switch port are sampled to statistics/Portland-ports.bin; empty for never.", port_stats);
+
   cmd.Parse (argc, argv);
 
+  Config::SetDefault ("ns3::PortlandSwitchNetDevice::UplinkPolicy", StringValue (uplink));
+  Config::SetDefault ("ns3::pld::FabricManager::Latency", StringValue (fm_latency));
+  Config::SetDefault ("ns3::pld::FabricManager::ServiceTime", StringValue (fm_service));
+  Config::SetDefault ("ns3::pld::FabricManager::FloodMode", StringValue (fm_flood));
+  if (traffic != "random")
+    {
+      // always-on flows outrun address resolution; hold their first packets instead of dropping them
+      Config::SetDefault ("ns3::ArpCache::PendingQueueSize", UintegerValue (1000));
+    }
+
 //=========== Define parameters based on value of k ===========//
 //
-	int k	= 8;
 	int num_pod = k;		// number of pod
 	int num_host = (k/2);		// number of hosts under a switch
 	int num_edge = (k/2);		// number of edge switch in a pod
-	int num_agg = (k/2);		// number of aggregation switch in a pod
-	int num_group = (k/2);		// number of group of core switches
-    int num_core = (k/2);		// number of core switch in a group
 	int total_host = k*k*k/4;	// number of hosts in the entire network	
 	char filename [] = "statistics/Portland.xml";// filename for Flow Monitor xml output file
 
@@ -162,6 +227,7 @@ main (int argc, char *argv[])
 	
 //	
 	std::cout << "Value of k =  "<< k<<"\n";
+	std::cout << "Uplink policy =  "<< uplink<<"\n";
 	std::cout << "Total number of hosts =  "<< total_host<<"\n";
 	std::cout << "Number of hosts under each switch =  "<< num_host<<"\n";
 	std::cout << "Number of edge switch under each pod =  "<< num_edge<<"\n";
@@ -173,6 +239,7 @@ main (int argc, char *argv[])
       LogComponentEnable ("PortlandSetup", LOG_LEVEL_INFO);
       LogComponentEnable ("PortlandInterface", LOG_LEVEL_INFO);
       LogComponentEnable ("PortlandSwitchNetDevice", LOG_LEVEL_INFO);
+      LogComponentEnable ("PortlandFatTreeHelper", LOG_LEVEL_INFO);
     }
 
   //
@@ -180,167 +247,63 @@ main (int argc, char *argv[])
   //
 
 
-  NS_LOG_INFO ("Create nodes.");
-
-	NodeContainer core[num_group];				// NodeContainer for core switches
-	for (i=0; i<num_group;i++){  	
-		core[i].Create (num_core);
-	}
-	NodeContainer agg[num_pod];				// NodeContainer for aggregation switches
-	for (i=0; i<num_pod;i++){  	
-		agg[i].Create (num_agg);
-	}
-	NodeContainer edge[num_pod];				// NodeContainer for edge switches
-  	for (i=0; i<num_pod;i++){  	
-		edge[i].Create (num_edge);
-	}
-	NodeContainer host[num_pod][num_edge];		// NodeContainer for hosts
-  	for (i=0; i<num_pod;i++){
-		for (j=0;j<num_edge;j++){  	
-			host[i][j].Create (num_host);		
-		}
-	}
-
   NS_LOG_INFO ("Build Topology");
-  // Initialize parameters for Csma protocol
-//
-	char dataRate [] = "1536Mbps";	// 1Gbps
-	int delay = 0.001;		// 0.001 ms
-
-
-  CsmaHelper csma;
-  csma.SetChannelAttribute ("DataRate", StringValue (dataRate));
-  csma.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (delay)));
-  // Inintialize Address Helper
-  //	
-  	Ipv4AddressHelper address;
-
-  // Create the csma links, from each terminal to the switch
-
-  NetDeviceContainer hostdev[num_pod][num_edge][num_host];
-  NetDeviceContainer edgedev[num_pod][num_edge][k];
-  NetDeviceContainer aggdev[num_pod][num_agg][k];
-  NetDeviceContainer coredev[num_group][num_core][k];
-  	
-  	for (i=0;i<num_pod;i++){
-		for (j=0;j<num_edge; j++){
-			for (h=0; h< num_host;h++){			
-				NetDeviceContainer link1 = csma.Install (NodeContainer (host[i][j].Get(h), edge[i].Get(j)));
-				hostdev[i][j][h].Add(link1.Get(0));			
-				edgedev[i][j][h].Add(link1.Get(1));	
-	
-			}
-		}
-	}
-	std::cout << "Finished connecting edge switches and hosts  "<< "\n";
-
-  	for (i=0;i<num_pod;i++){
-		for (j=0;j<num_agg; j++){
-			for (h=0; h< num_edge;h++){			
-				NetDeviceContainer link1 = csma.Install (NodeContainer (edge[i].Get(h), agg[i].Get(j)));
-				edgedev[i][h][j+num_host].Add(link1.Get(0));			
-				aggdev[i][j][h].Add(link1.Get(1));						
-			}
-		}
-	}
-	std::cout << "Finished connecting aggregate switches and edge switches  "<< "\n"; 
-
-  	for (i=0;i<num_group;i++){
-		for (j=0;j<num_core; j++){
-			for (h=0; h< num_pod;h++){			
-				NetDeviceContainer link1 = csma.Install (NodeContainer (agg[h].Get(i), core[i].Get(j)));
-				aggdev[h][i][j+num_edge].Add(link1.Get(0));			
-				coredev[i][j][h].Add(link1.Get(1));						
-			}
-		}
-	}
-	std::cout << "Finished connecting core switches and aggregate switches  "<< "\n"; 
-	
-  // Create the switch netdevice, which will do the packet switching
-
-  	Ptr<Node> corenode[num_group][num_core];			
-	for (i=0; i<num_group;i++){  	
-		for (j=0; j<num_core; j++) {
-			corenode[i][j] = core[i].Get(j);
-		}
-	}
-  	Ptr<Node> aggnode[num_pod][num_agg];			
-	for (i=0; i<num_pod;i++){  	
-		for (j=0; j<num_agg; j++) {
-			aggnode[i][j] = agg[i].Get(j);
-		}
-	}
-  	Ptr<Node> edgenode[num_pod][num_edge];			
-	for (i=0; i<num_pod;i++){  	
-		for (j=0; j<num_edge; j++) {
-			edgenode[i][j] = edge[i].Get(j);
-		}
-	}
-
-	PortlandSwitchHelper coresw[num_group][num_core];
-    PortlandSwitchHelper aggsw[num_pod][num_agg];
-	PortlandSwitchHelper edgesw[num_pod][num_edge];	
-
-  NetDeviceContainer WAN;
-  
-  Ptr<ns3::pld::FabricManager> fabricManager = Create<ns3::pld::FabricManager> ();
-
- 	for (i=0;i<num_pod;i++){
-		for (j=0;j<num_edge; j++){
-			NetDeviceContainer low_edge;
-			NetDeviceContainer up_edge;
-			for (h=0; h< num_host;h++){
-				low_edge.Add(edgedev[i][j][h]);
-				up_edge.Add(edgedev[i][j][h+num_host]);			
-			}
-			edgesw[i][j].Install(edgenode[i][j], low_edge, up_edge, fabricManager, EDGE, i, j);
-		}
-	}
-
- 	for (i=0;i<num_pod;i++){
-		for (j=0;j<num_agg; j++){
-			NetDeviceContainer low_agg;
-			NetDeviceContainer up_agg;
-			for (h=0; h< num_edge;h++){
-				low_agg.Add(aggdev[i][j][h]);
-				up_agg.Add(aggdev[i][j][h+num_edge]);			
-			}
-			aggsw[i][j].Install(aggnode[i][j], low_agg, up_agg, fabricManager, AGGREGATION, i, j);
-		}
-	}
-
- 	for (i=0;i<num_group;i++){
-		for (j=0;j<num_core; j++){
-			NetDeviceContainer low_core;
-			for (h=0; h< num_pod;h++){
-				low_core.Add(coredev[i][j][h]);
-			}
-			coresw[i][j].Install(corenode[i][j], low_core, WAN, fabricManager, CORE, 0, 0);
-		}
-	}	
-
-  // Add internet stack to the terminals
-  InternetStackHelper internet;
-  	for (i=0; i<num_pod;i++){
-		for (j=0;j<num_edge;j++){
-			internet.Install (host[i][j]);		
-		}
-	}
-
-  // We've got the "hardware" in place.  Now we need to add IP addresses.
-  NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-	
-	ipv4.SetBase (toString(10, 1, 0, 0), "255.255.0.0");
-
- 	for (i=0;i<num_pod;i++){
-		for (j=0;j<num_edge; j++){
-			//csma.EnablePcap(getHostName(i, j), host[i][j]);
-			for (h=0; h< num_host;h++){
-				ipv4.Assign(hostdev[i][j][h]);
+  Ptr<ns3::pld::FabricManagerCluster> fabricManager = CreateObject<ns3::pld::FabricManagerCluster> ();
+  for (uint32_t s = 0; s < fm_shards; s++){
+	fabricManager->AddShard ();
+  }
+  if (fm_add_shard_at > 0){
+	Simulator::Schedule (Seconds (fm_add_shard_at), &AddFabricManagerShard, fabricManager);
+  }
+
+  // Hosts, switches, csma links, internet stacks and addresses 10.1.0.1 onwards, in pod, edge, host order
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetChannelAttribute ("DataRate", StringValue ("1536Mbps"));
+  fatTree.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (0)));
+  fatTree.SetFullDuplex (full_duplex);
+  if (shared_buffer > 0){
+	fatTree.SetSharedBuffers (true);
+	fatTree.SetSharedBufferAttribute ("Size", UintegerValue (shared_buffer));
+	fatTree.SetSharedBufferAttribute ("Alpha", DoubleValue (buffer_alpha));
+	fatTree.SetSharedBufferAttribute ("EcnThreshold", UintegerValue (ecn_threshold));
+  }
+  fatTree.Install (fabricManager);
+  if (Time (core_delay) > Seconds (0)){
+	// the links of the core switches in position p of every group get p times the extra delay
+	for (int g = 0; g < k/2; g++){
+		for (int p = 1; p < k/2; p++){
+			Ptr<Node> core = fatTree.GetCoreSwitch (g, p)->GetNode ();
+			for (uint32_t d = 0; d < core->GetNDevices (); d++){
+				Ptr<CsmaNetDevice> dev = DynamicCast<CsmaNetDevice> (core->GetDevice (d));
+				if (dev != 0){
+					dev->GetChannel ()->SetAttribute ("Delay", TimeValue (NanoSeconds (Time (core_delay).GetNanoSeconds () * p)));
+				}
 			}
 		}
 	}
+  }
+  std::cout << "Topology setup: " << fatTree.GetSetupTime () << " ms, peak memory: "
+	<< fatTree.GetPeakMemory () / (1024 * 1024) << " MB\n";
+  if (prewarm == "topology"){
+	fatTree.Prewarm ();
+  }
+  else if (!prewarm.empty () && !fatTree.Prewarm (prewarm)){
+	std::cerr << "Cannot pre-warm from " << prewarm << "\n";
+	return 1;
+  }
+  if (event_trace > 0){
+	ns3::pld::EventTrace::Enable (event_trace, "statistics/Portland-events.bin");
+  }
+  std::ofstream event_delays_file;
+  if (!event_delays.empty ()){
+	event_delays_file.open (event_delays.c_str ());
+	event_delays_file.precision (12);
+	Simulator::GetImplementation ()->TraceConnectWithoutContext ("Schedule", MakeBoundCallback (&RecordEventDelay, (std::ostream *) &event_delays_file));
+  }
+  Ptr<ns3::pld::PortStatsSampler> portStats;
+  if (!port_stats.empty ()){
+	portStats = fatTree.EnablePortStats ("statistics/Portland-ports.bin", Time (port_stats));
+  }
 
   // Create an OnOff application to send UDP datagrams from n0 to n1.
   std::cout << "creating On/Off traffic"<<"\n";
@@ -356,13 +319,24 @@ main (int argc, char *argv[])
 //
 	int port = 9;
 	int packetSize = 1024;		// 1024 bytes
-	char dataRate_OnOff [] = "96Mbps";
-	char maxBytes [] = "70000";	// 70,000 bytes
+	std::string dataRate_OnOff = rate;
 	
 // Generate traffics for the simulation
 //	
 	ApplicationContainer app[total_host];
-	srand (time(NULL));
+	srand (seed ? seed : time(NULL));
+
+	// permutation traffic: every host sends to one other host and receives from one other host
+	std::vector<int> perm (total_host);
+	for (i=0;i<total_host;i++){
+		perm[i] = i;
+	}
+	std::random_shuffle (perm.begin (), perm.end ());
+	for (i=0;i<total_host;i++){
+		if (perm[i] == i){
+			std::swap (perm[i], perm[(i+1) % total_host]);
+		}
+	}
 	for (i=0;i<num_pod;i++){
 		for (j=0;j<num_edge; j++){
 			for (h=0; h<num_host; h++){
@@ -377,29 +351,48 @@ main (int argc, char *argv[])
 			rand2 = rand() % num_edge + 0;
 			rand3 = rand() % num_host + 0;
 		} // to make sure that client and server are different
+
+		if (traffic == "permutation"){
+			int dst = perm[(i*num_edge + j)*num_host + h];
+			rand1 = dst / (num_edge*num_host);
+			rand2 = (dst / num_host) % num_edge;
+			rand3 = dst % num_host;
+		}
+		else if (traffic == "hotspot"){
+			// all hosts send to the hosts under the first edge switch, which send to the last pod
+			rand1 = (i == 0 && j == 0) ? num_pod-1 : 0;
+			rand2 = 0;
+			rand3 = rand() % num_host;
+		}
 		
 
-		Ipv4Address dstAddr = host[rand1][rand2].Get(rand3)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
+		Ipv4Address dstAddr = fatTree.GetHostAddress (rand1, rand2, rand3);
 		OnOffHelper oo = OnOffHelper("ns3::UdpSocketFactory",Address(InetSocketAddress(dstAddr, port))); // ip address of server
+		if (traffic == "random"){
 	        oo.SetAttribute("OnTime",RandomVariableValue(ExponentialVariable(1)));  
 	        oo.SetAttribute("OffTime",RandomVariableValue(ExponentialVariable(1))); 
+		}
+		else{
+	        oo.SetAttribute("OnTime",RandomVariableValue(ConstantVariable(1000)));  
+	        oo.SetAttribute("OffTime",RandomVariableValue(ConstantVariable(0))); 
+		}
  	        oo.SetAttribute("PacketSize",UintegerValue (packetSize));
  	       	oo.SetAttribute("DataRate",StringValue (dataRate_OnOff));      
-	        oo.SetAttribute("MaxBytes",StringValue (maxBytes));
+	        oo.SetAttribute("MaxBytes",UintegerValue (max_bytes));
 
 		
  		NodeContainer onoff;
-		onoff.Add(host[i][j].Get(h));
+		onoff.Add(fatTree.GetHost (i, j, h));
 	    app[i] = oo.Install (onoff);
 		
 		
   		PacketSinkHelper sink ("ns3::UdpSocketFactory",
                          Address (InetSocketAddress (Ipv4Address::GetAny (), port)));
-		app[i] = sink.Install(host[i][j].Get (h));
+		app[i] = sink.Install(fatTree.GetHost (i, j, h));
 		app[i].Start (Seconds (0.0)); 	
 
 		std::cout << "From: " 
-		<< host[i][j].Get(h)->GetObject<Ipv4>()->GetAddress(1,0).GetLocal()
+		<< fatTree.GetHostAddress (i, j, h)
 		<< " dstaddr: "<< dstAddr << "\n";
 	//}
 		}
@@ -426,11 +419,98 @@ main (int argc, char *argv[])
   	NS_LOG_INFO ("Run Simulation.");
   	Simulator::Stop (Seconds(101.0));
   	Simulator::Run ();
+	if (!save_snapshot.empty ()){
+		fatTree.SaveSnapshot (save_snapshot);
+	}
+	if (portStats != 0){
+		portStats->Stop ();
+		std::cout << "Port stats: " << portStats->GetNSamples () << " samples of " << portStats->GetNPorts ()
+			<< " ports in statistics/Portland-ports.bin\n";
+	}
 
   	monitor->CheckForLostPackets ();
   	monitor->SerializeToXmlFile(filename, true, true);
 	monitor->PrintAggregatedStatistics();
 
+	// Packet copies made by the switches per forwarded frame
+	uint64_t copies = 0;
+	uint64_t forwarded = 0;
+	uint64_t cache_hits = 0;
+	uint64_t cache_misses = 0;
+	uint64_t held = 0;
+	uint64_t held_drops = 0;
+	uint64_t flood_frames = 0;
+	uint64_t buffer_drops = 0;
+	uint64_t buffer_marks = 0;
+	uint32_t buffer_max = 0;
+	for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); n++){
+		for (uint32_t d = 0; d < (*n)->GetNDevices (); d++){
+			Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> ((*n)->GetDevice (d));
+			if (sw != 0){
+				copies += sw->GetNPacketCopies ();
+				forwarded += sw->GetNForwardedPackets ();
+				cache_hits += sw->GetNPMACCacheHits ();
+				cache_misses += sw->GetNPMACCacheMisses ();
+				held += sw->GetNHeldPackets ();
+				held_drops += sw->GetNHeldPacketDrops ();
+				flood_frames += sw->GetNFloodFrames ();
+				Ptr<ns3::pld::SharedBufferQueue> queue = DynamicCast<ns3::pld::SharedBufferQueue> (sw->GetSwitchPort (0).queue);
+				if (queue != 0){
+					buffer_drops += queue->GetBuffer ()->GetNDrops ();
+					buffer_marks += queue->GetBuffer ()->GetNMarks ();
+					buffer_max = std::max (buffer_max, queue->GetBuffer ()->GetMaxOccupancy ());
+				}
+			}
+		}
+	}
+	std::cout << "Switch packet copies per forwarded frame: " << (forwarded ? (double) copies / forwarded : 0) << "\n";
+	std::cout << "Edge PMAC cache hits: " << cache_hits << ", misses (Fabric Manager queries): " << cache_misses << "\n";
+	std::cout << "Packets held for Fabric Manager lookups: " << held << ", dropped: " << held_drops << "\n";
+	std::cout << "Fabric Manager requests: " << fabricManager->GetNRequests ()
+		<< ", mean queueing delay: " << fabricManager->GetMeanQueueingDelay ().GetMicroSeconds () << " us"
+		<< ", max backlog: " << fabricManager->GetMaxBacklog () << "\n";
+	if (shared_buffer > 0){
+		std::cout << "Shared buffer drops: " << buffer_drops << ", ECN marks: " << buffer_marks
+			<< ", max occupancy: " << buffer_max << " bytes\n";
+	}
+	uint64_t floods = 0;
+	for (uint32_t s = 0; s < fabricManager->GetNShards (); s++){
+		floods += fabricManager->GetShard (s)->GetNFloods ();
+	}
+	std::cout << "ARP floods: " << floods << ", flood frames: " << flood_frames
+		<< " (" << (floods ? (double) flood_frames / floods : 0) << " per flood)\n";
+	std::cout << "Fabric Manager shards: " << fabricManager->GetNShards ()
+		<< ", hosts moved by rebalancing: " << fabricManager->GetNMovedHosts ()
+		<< ", messages redirected: " << fabricManager->GetNRedirects () << "\n";
+
+	// Goodput and flow completion times of the flows that delivered all their packets
+	std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+	std::vector<double> fct;
+	uint64_t rx_bytes = 0;
+	Time first_tx = Seconds (101.0);
+	Time last_rx = Seconds (0);
+	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator f = stats.begin (); f != stats.end (); f++){
+		if (f->second.rxPackets == 0){
+			continue;
+		}
+		rx_bytes += f->second.rxBytes;
+		first_tx = std::min (first_tx, f->second.timeFirstTxPacket);
+		last_rx = std::max (last_rx, f->second.timeLastRxPacket);
+		if (f->second.rxPackets == f->second.txPackets){
+			fct.push_back ((f->second.timeLastRxPacket - f->second.timeFirstTxPacket).GetSeconds () * 1000);
+		}
+	}
+	std::sort (fct.begin (), fct.end ());
+	if (last_rx > first_tx){
+		std::cout << "Aggregate goodput: " << rx_bytes * 8 / (last_rx - first_tx).GetSeconds () / 1e6 << " Mbps\n";
+	}
+	if (!fct.empty ()){
+		std::cout << "Completed flows: " << fct.size () << "/" << stats.size ()
+			<< ", FCT median: " << fct[fct.size () / 2] << " ms"
+			<< ", 99th percentile: " << fct[(fct.size () * 99) / 100] << " ms"
+			<< ", max: " << fct.back () << " ms\n";
+	}
+
 	std::cout << "Simulation finished "<<"\n";
 	
   	Simulator::Destroy ();
@@ -25,6 +25,7 @@
 
 #include "ptr.h"
 #include "pointer.h"
+#include "trace-source-accessor.h"
 #include "assert.h"
 #include "log.h"
 
@@ -42,6 +43,10 @@ DefaultSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DefaultSimulatorImpl")
     .SetParent<SimulatorImpl> ()
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddTraceSource ("Schedule",
+                     "An event was scheduled this far ahead of the current time; "
+                     "the delays can be replayed by utils/bench-simulator.",
+                     MakeTraceSourceAccessor (&DefaultSimulatorImpl::m_scheduleTrace))
   ;
   return tid;
 }
@@ -200,6 +205,7 @@ DefaultSimulatorImpl::Schedule (Time const &time, EventImpl *event)
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
+  m_scheduleTrace (time);
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
 }
 
@@ -216,6 +222,7 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, E
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
+  m_scheduleTrace (time);
 }
 
 EventId
@@ -229,6 +236,7 @@ DefaultSimulatorImpl::ScheduleNow (EventImpl *event)
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
+  m_scheduleTrace (TimeStep (0));
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
 }
 
@@ -24,6 +24,8 @@
 #include "simulator-impl.h"
 #include "scheduler.h"
 #include "event-impl.h"
+#include "traced-callback.h"
+#include "nstime.h"
 
 #include "ptr.h"
 
@@ -76,6 +78,8 @@ private:
   // number of events that have been inserted but not yet scheduled,
   // not counting the "destroy" events; this is used for validation
   int m_unscheduledEvents;
+  // delay of every event scheduled, the destroy events excepted
+  TracedCallback<Time> m_scheduleTrace;
 };
 
 } // namespace ns3
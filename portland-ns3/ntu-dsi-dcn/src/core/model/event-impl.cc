@@ -19,9 +19,130 @@
  */
 
 #include "event-impl.h"
+#include "ns3/core-config.h"
+#include <new>
+
+#if defined (__GNUC__)
+// free lists are per thread, so that events need no lock whichever thread schedules them
+#define EVENT_IMPL_POOL 1
+#define EVENT_IMPL_THREAD_LOCAL __thread
+#endif
+
+#if defined (EVENT_IMPL_POOL) && defined (HAVE_PTHREAD_H)
+#include <pthread.h>
+#define EVENT_IMPL_POOL_DRAIN 1
+#endif
 
 namespace ns3 {
 
+#ifdef EVENT_IMPL_POOL
+
+// size classes are the multiples of 16 bytes up to 128 bytes, which covers the events of
+// MakeEvent with up to five pointer-sized arguments
+static const size_t EVENT_IMPL_GRANULARITY = 16;
+static const uint32_t EVENT_IMPL_CLASSES = 8;
+// longest free list of a size class; the blocks freed beyond it go back to the heap
+static const uint32_t EVENT_IMPL_MAX_FREE = 1024;
+
+struct EventImplBlock
+{
+  EventImplBlock *next;
+};
+
+// A block may be freed by another thread than the one which allocated it, e.g. an event
+// scheduled for another partition of a MultithreadedSimulatorImpl: it then joins the list
+// of the freeing thread. The lists are bounded so that memory moving from thread to thread
+// returns to the heap instead of piling up on the receiving side.
+static EVENT_IMPL_THREAD_LOCAL EventImplBlock *g_eventImplFreeLists[EVENT_IMPL_CLASSES];
+static EVENT_IMPL_THREAD_LOCAL uint32_t g_eventImplFreeCounts[EVENT_IMPL_CLASSES];
+
+#ifdef EVENT_IMPL_POOL_DRAIN
+
+static pthread_key_t g_eventImplDrainKey;
+static pthread_once_t g_eventImplDrainOnce = PTHREAD_ONCE_INIT;
+static EVENT_IMPL_THREAD_LOCAL bool g_eventImplDrainRegistered = false;
+
+/* Returns the blocks on the lists of an exiting thread to the heap. */
+static void
+EventImplDrain (void *)
+{
+  for (uint32_t sizeClass = 0; sizeClass < EVENT_IMPL_CLASSES; sizeClass++)
+    {
+      while (g_eventImplFreeLists[sizeClass] != 0)
+        {
+          EventImplBlock *block = g_eventImplFreeLists[sizeClass];
+          g_eventImplFreeLists[sizeClass] = block->next;
+          ::operator delete (block);
+        }
+      g_eventImplFreeCounts[sizeClass] = 0;
+    }
+}
+
+static void
+EventImplCreateDrainKey (void)
+{
+  pthread_key_create (&g_eventImplDrainKey, &EventImplDrain);
+}
+
+/* Makes the calling thread drain its lists when it exits, e.g. the workers of a run. */
+static void
+EventImplRegisterDrain (void)
+{
+  pthread_once (&g_eventImplDrainOnce, &EventImplCreateDrainKey);
+  // any value but 0 has the destructor called
+  pthread_setspecific (g_eventImplDrainKey, &g_eventImplDrainKey);
+  g_eventImplDrainRegistered = true;
+}
+
+#endif /* EVENT_IMPL_POOL_DRAIN */
+
+#endif /* EVENT_IMPL_POOL */
+
+void *
+EventImpl::operator new (size_t size)
+{
+#ifdef EVENT_IMPL_POOL
+  uint32_t sizeClass = (size - 1) / EVENT_IMPL_GRANULARITY;
+  if (sizeClass < EVENT_IMPL_CLASSES)
+    {
+      EventImplBlock *block = g_eventImplFreeLists[sizeClass];
+      if (block == 0)
+        {
+          // allocate the whole size class so that the block fits any event of the class
+          return ::operator new ((sizeClass + 1) * EVENT_IMPL_GRANULARITY);
+        }
+      g_eventImplFreeLists[sizeClass] = block->next;
+      g_eventImplFreeCounts[sizeClass]--;
+      return block;
+    }
+#endif /* EVENT_IMPL_POOL */
+  return ::operator new (size);
+}
+
+void
+EventImpl::operator delete (void *p, size_t size)
+{
+  // the destructor is virtual, so size is that of the most derived class
+#ifdef EVENT_IMPL_POOL
+  uint32_t sizeClass = (size - 1) / EVENT_IMPL_GRANULARITY;
+  if (sizeClass < EVENT_IMPL_CLASSES && g_eventImplFreeCounts[sizeClass] < EVENT_IMPL_MAX_FREE)
+    {
+#ifdef EVENT_IMPL_POOL_DRAIN
+      if (!g_eventImplDrainRegistered)
+        {
+          EventImplRegisterDrain ();
+        }
+#endif /* EVENT_IMPL_POOL_DRAIN */
+      EventImplBlock *block = static_cast<EventImplBlock *> (p);
+      block->next = g_eventImplFreeLists[sizeClass];
+      g_eventImplFreeLists[sizeClass] = block;
+      g_eventImplFreeCounts[sizeClass]++;
+      return;
+    }
+#endif /* EVENT_IMPL_POOL */
+  ::operator delete (p);
+}
+
 EventImpl::~EventImpl ()
 {
 }
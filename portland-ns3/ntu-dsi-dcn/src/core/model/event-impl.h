@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "simple-ref-count.h"
 
 namespace ns3 {
@@ -35,6 +36,14 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Events are allocated from per-thread free lists of a few size classes
+ * instead of the general heap: a typical event, a function or method and a
+ * few arguments stored by value, is recycled from one Schedule to the next
+ * without ever calling malloc. Each list keeps at most 1024 freed events and
+ * gives the others back to the heap, as does a thread when it exits; events
+ * larger than the largest size class are allocated with the global operator
+ * new.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -58,6 +67,9 @@ public:
    */
   bool IsCancelled (void);
 
+  static void *operator new (size_t size);
+  static void operator delete (void *p, size_t size);
+
 protected:
   virtual void Notify (void) = 0;
 
@@ -0,0 +1,326 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "uinteger.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+    .AddAttribute ("Threshold",
+                   "Number of events above which a bucket is spread over a new rung instead of being sorted.",
+                   UintegerValue (50),
+                   MakeUintegerAccessor (&LadderScheduler::m_threshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxRungs",
+                   "Maximum number of rungs of the ladder; a bucket of the last rung is always sorted.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&LadderScheduler::m_maxRungs),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_threshold (50),
+    m_maxRungs (8),
+    m_topStart (0),
+    m_topMin (~(uint64_t)0),
+    m_topMax (0),
+    m_nRungs (0),
+    m_nEvents (0)
+{
+}
+LadderScheduler::~LadderScheduler ()
+{
+}
+
+uint32_t
+LadderScheduler::FindRung (uint64_t ts) const
+{
+  // each rung spans the bucket of the rung above that was current when it was made, and
+  // that bucket is now behind the current bucket of the rung above
+  for (uint32_t r = 0; r < m_nRungs; r++)
+    {
+      const Rung &rung = m_rungs[r];
+      if (ts >= rung.start + rung.current * rung.width)
+        {
+          return r;
+        }
+    }
+  return m_nRungs;
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_nEvents++;
+  if (ts >= m_topStart)
+    {
+      m_top.push_back (ev);
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+      return;
+    }
+  uint32_t r = FindRung (ts);
+  if (r < m_nRungs)
+    {
+      Rung &rung = m_rungs[r];
+      uint64_t b = (ts - rung.start) / rung.width;
+      NS_ASSERT (b < rung.buckets.size ());
+      rung.buckets[b].push_back (ev);
+      rung.nEvents++;
+      return;
+    }
+  m_bottom.insert (std::upper_bound (m_bottom.begin (), m_bottom.end (), ev), ev);
+  if (m_bottom.size () > m_threshold && m_nRungs < m_maxRungs
+      && m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      // events keep arriving before the current bucket: stop sorting them one by one
+      SpawnBottomRung ();
+    }
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_nEvents == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_nEvents > 0);
+  if (m_bottom.empty ())
+    {
+      // moving events down the ladder does not change the set of events
+      const_cast<LadderScheduler *> (this)->FillBottom ();
+    }
+  return m_bottom.front ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_nEvents > 0);
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+  Event ev = m_bottom.front ();
+  m_bottom.pop_front ();
+  m_nEvents--;
+  NS_LOG_DEBUG (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  return ev;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_nEvents--;
+  if (ts >= m_topStart)
+    {
+      // the bounds of Top may only get looser
+      RemoveFromBucket (m_top, ev);
+      return;
+    }
+  uint32_t r = FindRung (ts);
+  if (r < m_nRungs)
+    {
+      Rung &rung = m_rungs[r];
+      RemoveFromBucket (rung.buckets[(ts - rung.start) / rung.width], ev);
+      rung.nEvents--;
+      return;
+    }
+  std::deque<Event>::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev);
+  NS_ASSERT (i != m_bottom.end () && i->key.m_uid == ev.key.m_uid);
+  m_bottom.erase (i);
+}
+
+void
+LadderScheduler::RemoveFromBucket (Bucket &bucket, const Event &ev)
+{
+  // buckets are unsorted: fill the hole with the last event
+  for (Bucket::iterator i = bucket.begin (); i != bucket.end (); i++)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          *i = bucket.back ();
+          bucket.pop_back ();
+          return;
+        }
+    }
+  NS_ASSERT_MSG (false, "Event not found");
+}
+
+void
+LadderScheduler::FillBottom (void)
+{
+  NS_ASSERT (m_bottom.empty () && m_nEvents > 0);
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          NS_ASSERT (!m_top.empty ());
+          if (m_top.size () <= m_threshold || m_topMin == m_topMax)
+            {
+              m_topStart = m_topMax + 1;
+              m_topMin = ~(uint64_t)0;
+              m_topMax = 0;
+              SortIntoBottom (m_top);
+              return;
+            }
+          TransferTop ();
+        }
+
+      Rung &rung = m_rungs[m_nRungs - 1];
+      NS_ASSERT (rung.nEvents > 0);
+      while (rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+          NS_ASSERT (rung.current < rung.buckets.size ());
+        }
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t start = rung.start + rung.current * rung.width;
+      uint64_t width = rung.width;
+      rung.current++;
+      rung.nEvents -= bucket.size ();
+      if (bucket.size () > m_threshold && m_nRungs < m_maxRungs && width > 1)
+        {
+          SpawnRung (bucket, start, width);
+        }
+      else
+        {
+          SortIntoBottom (bucket);
+        }
+
+      while (m_nRungs > 0 && m_rungs[m_nRungs - 1].nEvents == 0)
+        {
+          m_nRungs--;
+        }
+    }
+}
+
+void
+LadderScheduler::TransferTop (void)
+{
+  uint32_t n = m_top.size ();
+  uint64_t width = (m_topMax - m_topMin) / n + 1;
+  Rung &rung = AddRung (n, m_topMin, width);
+  for (Bucket::const_iterator i = m_top.begin (); i != m_top.end (); i++)
+    {
+      rung.buckets[(i->key.m_ts - rung.start) / width].push_back (*i);
+    }
+  rung.nEvents = n;
+  m_topStart = rung.start + n * width;
+  m_topMin = ~(uint64_t)0;
+  m_topMax = 0;
+  m_top.clear ();
+  NS_LOG_LOGIC ("Top of " << n << " events to a rung of width " << width);
+}
+
+void
+LadderScheduler::SpawnRung (Bucket &bucket, uint64_t start, uint64_t width)
+{
+  uint32_t n = bucket.size ();
+  uint64_t childWidth = (width + n - 1) / n;
+  Rung &rung = AddRung ((width + childWidth - 1) / childWidth, start, childWidth);
+  for (Bucket::const_iterator i = bucket.begin (); i != bucket.end (); i++)
+    {
+      rung.buckets[(i->key.m_ts - start) / childWidth].push_back (*i);
+    }
+  rung.nEvents = n;
+  bucket.clear ();
+  NS_LOG_LOGIC ("Bucket of " << n << " events to rung " << m_nRungs - 1 << " of width " << childWidth);
+}
+
+void
+LadderScheduler::SpawnBottomRung (void)
+{
+  // the new rung spans from the earliest event to the current bucket of the lowest rung
+  uint64_t start = m_bottom.front ().key.m_ts;
+  uint64_t end = m_topStart;
+  if (m_nRungs > 0)
+    {
+      const Rung &lowest = m_rungs[m_nRungs - 1];
+      end = lowest.start + lowest.current * lowest.width;
+    }
+  uint32_t n = m_bottom.size ();
+  uint64_t width = (end - start) / n + 1;
+  Rung &rung = AddRung (n, start, width);
+  for (std::deque<Event>::const_iterator i = m_bottom.begin (); i != m_bottom.end (); i++)
+    {
+      rung.buckets[(i->key.m_ts - start) / width].push_back (*i);
+    }
+  rung.nEvents = n;
+  m_bottom.clear ();
+  NS_LOG_LOGIC ("Bottom of " << n << " events to rung " << m_nRungs - 1 << " of width " << width);
+}
+
+LadderScheduler::Rung &
+LadderScheduler::AddRung (uint32_t nBuckets, uint64_t start, uint64_t width)
+{
+  NS_ASSERT (m_nRungs < m_maxRungs);
+  if (m_rungs.empty ())
+    {
+      // rungs are never moved, so that references to their buckets stay valid
+      m_rungs.reserve (m_maxRungs);
+    }
+  if (m_nRungs == m_rungs.size ())
+    {
+      m_rungs.push_back (Rung ());
+    }
+  Rung &rung = m_rungs[m_nRungs++];
+  // the buckets of a rung no longer in use are all empty
+  rung.buckets.resize (nBuckets);
+  rung.start = start;
+  rung.width = width;
+  rung.current = 0;
+  rung.nEvents = 0;
+  return rung;
+}
+
+void
+LadderScheduler::SortIntoBottom (Bucket &bucket)
+{
+  NS_ASSERT (m_bottom.empty ());
+  std::sort (bucket.begin (), bucket.end ());
+  m_bottom.assign (bucket.begin (), bucket.end ());
+  // clearing keeps the memory of the bucket for the events to come
+  bucket.clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue of "Ladder Queue: An O(1) Priority Queue
+ * Structure for Large-Scale Discrete Event Simulation" by Tang, Goh and Thng (2005). Events
+ * live in one of three tiers:
+ *  - Top: an unsorted array of the events beyond the time span of the ladder, which is where
+ *    events scheduled far in the future go;
+ *  - Ladder: a few rungs of buckets, each rung dividing one bucket of the rung above into
+ *    finer buckets; events are appended to their bucket, unsorted;
+ *  - Bottom: a sorted queue of the earliest events, from which events are removed.
+ *
+ * When Bottom runs out, the next non-empty bucket of the lowest rung is sorted into it, or,
+ * if it holds more than Threshold events, spread over a new rung below. Events inserted
+ * before the current bucket of the lowest rung are sorted into Bottom; once it grows past
+ * Threshold events it is spread over a new rung too. When the ladder runs
+ * out, Top is spread over a new first rung whose bucket width matches the mean spacing of
+ * its events. Every event is thus moved a bounded number of times and only sorted in small
+ * groups, which gives amortized O(1) Insert and RemoveNext whatever the spread of the event
+ * times. Buckets are contiguous arrays and are reused, with their memory, from one rung to
+ * the next.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  struct Rung
+  {
+    std::vector<Bucket> buckets;
+    uint64_t start;             // timestamp at the start of bucket 0
+    uint64_t width;             // duration of a bucket
+    uint32_t current;           // buckets before this one are empty and will stay so
+    uint32_t nEvents;
+  };
+
+  /* Moves events down until Bottom holds the earliest ones; the queue must not be empty. */
+  void FillBottom (void);
+  /* Spreads Top over a new first rung. */
+  void TransferTop (void);
+  /* Spreads the events of a bucket of the lowest rung over a new rung below it. */
+  void SpawnRung (Bucket &bucket, uint64_t start, uint64_t width);
+  /* Spreads Bottom, grown past Threshold by events inserted before the current bucket, over a new rung. */
+  void SpawnBottomRung (void);
+  Rung &AddRung (uint32_t nBuckets, uint64_t start, uint64_t width);
+  void SortIntoBottom (Bucket &bucket);
+  /* Returns the rung whose buckets an event of timestamp ts belongs to, or m_nRungs for Bottom. */
+  uint32_t FindRung (uint64_t ts) const;
+  static void RemoveFromBucket (Bucket &bucket, const Event &ev);
+
+  uint32_t m_threshold;
+  uint32_t m_maxRungs;
+
+  Bucket m_top;
+  // events at or after m_topStart go to Top
+  uint64_t m_topStart;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  // only the first m_nRungs rungs are in use; the others keep their buckets for reuse
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  // sorted earliest first; a deque so that the many events inserted at the current time,
+  // which sort after the events of the same timestamp already there, move the shorter side
+  std::deque<Scheduler::Event> m_bottom;
+  uint32_t m_nEvents;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -337,14 +337,29 @@ double RngStream::nextSeed[6] =
 //-------------------------------------------------------------------------
 // constructor
 //
+// Streams may be created lazily, on the first draw of a random variable,
+// by the threads of a multithreaded simulation: nextSeed is advanced under
+// a spin lock.
+#if defined (__GNUC__)
+static volatile int g_nextSeedLock = 0;
+#endif
+
 RngStream::RngStream ()
 {
+#if defined (__GNUC__)
+  while (__sync_lock_test_and_set (&g_nextSeedLock, 1))
+    {
+    }
+#endif
   uint32_t run = EnsureGlobalInitialized ();
 
   anti = false;
   incPrec = false;
   // Stream initialization moved to separate method.
   InitializeStream ();
+#if defined (__GNUC__)
+  __sync_lock_release (&g_nextSeedLock);
+#endif
   //move the state of this stream up
   ResetNthSubstream (run);
 }
@@ -24,6 +24,13 @@
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
 #include "ns3/ns2-calendar-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#endif
+#include <set>
+#include <vector>
 
 namespace ns3 {
 
@@ -460,6 +467,194 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+private:
+  uint32_t Random (void);
+  ObjectFactory m_schedulerFactory;
+  uint32_t m_seed;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that events come out in order under random inserts and removes with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory),
+    m_seed (1)
+{
+}
+
+uint32_t
+SchedulerOrderTestCase::Random (void)
+{
+  m_seed = m_seed * 1103515245 + 12345;
+  return m_seed >> 8;
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  // drive the scheduler directly, as the simulator does, against a reference ordered set
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  std::set<Scheduler::EventKey> reference;
+  std::vector<Scheduler::Event> live;
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  for (uint32_t step = 0; step < 40000; step++)
+    {
+      uint32_t action = Random () % 10;
+      if (action < 5 || reference.empty ())
+        {
+          // mostly near-future events, some far ones and many at the same time
+          uint32_t kind = Random () % 20;
+          uint64_t delay = (kind < 13 ? Random () % 1000 : kind < 17 ? Random () % 1000000
+                            : kind < 19 ? (uint64_t) Random () * 64 : 0);
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = now + delay;
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          scheduler->Insert (ev);
+          reference.insert (ev.key);
+          live.push_back (ev);
+        }
+      else if (action < 9)
+        {
+          Scheduler::Event next = scheduler->PeekNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, reference.begin ()->m_uid, "PeekNext out of order");
+          Scheduler::Event ev = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (ev.key.m_uid, reference.begin ()->m_uid, "RemoveNext out of order");
+          NS_TEST_ASSERT_MSG_EQ (ev.key.m_ts, reference.begin ()->m_ts, "RemoveNext out of order");
+          now = ev.key.m_ts;
+          reference.erase (reference.begin ());
+        }
+      else
+        {
+          // remove a random pending event, skipping those already removed
+          uint32_t i = Random () % live.size ();
+          if (reference.find (live[i].key) != reference.end ())
+            {
+              scheduler->Remove (live[i]);
+              reference.erase (live[i].key);
+            }
+          live[i] = live.back ();
+          live.pop_back ();
+        }
+    }
+  while (!reference.empty ())
+    {
+      Scheduler::Event ev = scheduler->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (ev.key.m_uid, reference.begin ()->m_uid, "RemoveNext out of order");
+      reference.erase (reference.begin ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "Events left in the scheduler");
+}
+
+struct EventPoolLargeArgument
+{
+  uint32_t values[64];
+};
+
+class EventPoolTestCase : public TestCase
+{
+public:
+  EventPoolTestCase ();
+private:
+  virtual void DoRun (void);
+  void Small (uint32_t a, uint32_t b);
+  void Large (EventPoolLargeArgument a);
+  static void UnrefAll (std::vector<EventImpl *> *events);
+  uint32_t m_sum;
+};
+
+EventPoolTestCase::EventPoolTestCase ()
+  : TestCase ("Events are recycled through the size-class free lists")
+{
+}
+
+void
+EventPoolTestCase::Small (uint32_t a, uint32_t b)
+{
+  m_sum += a * b;
+}
+
+void
+EventPoolTestCase::Large (EventPoolLargeArgument a)
+{
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      m_sum += a.values[i];
+    }
+}
+
+void
+EventPoolTestCase::DoRun (void)
+{
+  m_sum = 0;
+  EventPoolLargeArgument large;
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      large.values[i] = i;
+    }
+  // events above the largest size class go to the heap and must come back there
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      Simulator::Schedule (NanoSeconds (i % 7), &EventPoolTestCase::Small, this, i, 2);
+      Simulator::Schedule (NanoSeconds (i % 5), &EventPoolTestCase::Large, this, large);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (m_sum, 999 * 1000 + 1000 * (63 * 64 / 2), "Events lost or garbled");
+
+#if defined (__GNUC__)
+  // free lists are last in, first out
+  EventImpl *first = MakeEvent (&EventPoolTestCase::Small, this, 1, 1);
+  first->Unref ();
+  EventImpl *second = MakeEvent (&EventPoolTestCase::Small, this, 2, 2);
+  NS_TEST_EXPECT_MSG_EQ (second, first, "A freed event was not reused");
+  second->Unref ();
+
+  // the free list of a size class is bounded: take everything off it, then free more
+  // events than it holds, and the last one it took back is the next one out
+  std::vector<EventImpl *> events;
+  for (uint32_t i = 0; i < 2100; i++)
+    {
+      events.push_back (MakeEvent (&EventPoolTestCase::Small, this, i, i));
+    }
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      events[i]->Unref ();
+    }
+  EventImpl *last = MakeEvent (&EventPoolTestCase::Small, this, 3, 3);
+  NS_TEST_EXPECT_MSG_EQ (last, events[1023], "The free list holds more events than its bound");
+  last->Unref ();
+
+#ifdef HAVE_PTHREAD_H
+  // events freed by another thread go to its lists, which go back to the heap when it
+  // exits (the leak checkers of test.py see the ones that would not)
+  events.clear ();
+  for (uint32_t i = 0; i < 2100; i++)
+    {
+      events.push_back (MakeEvent (&EventPoolTestCase::Small, this, i, i));
+    }
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeBoundCallback (&EventPoolTestCase::UnrefAll, &events));
+  thread->Start ();
+  thread->Join ();
+#endif /* HAVE_PTHREAD_H */
+#endif
+}
+
+void
+EventPoolTestCase::UnrefAll (std::vector<EventImpl *> *events)
+{
+  for (uint32_t i = 0; i < events->size (); i++)
+    {
+      (*events)[i]->Unref ();
+    }
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -478,6 +673,12 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    AddTestCase (new EventPoolTestCase ());
   }
 } g_simulatorTestSuite;
 
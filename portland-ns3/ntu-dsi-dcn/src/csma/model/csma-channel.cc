@@ -236,6 +236,13 @@ CsmaChannel::TransmitEnd ()
   return retVal;
 }
 
+bool
+CsmaChannel::TransmitEnd (uint32_t srcId)
+{
+  NS_ASSERT (srcId == m_currentSrc);
+  return TransmitEnd ();
+}
+
 void
 CsmaChannel::PropagationCompleteEvent ()
 {
@@ -328,6 +335,12 @@ CsmaChannel::GetState (void)
   return m_state;
 }
 
+WireState
+CsmaChannel::GetState (uint32_t deviceId)
+{
+  return GetState ();
+}
+
 Ptr<NetDevice>
 CsmaChannel::GetDevice (uint32_t i) const
 {
@@ -88,7 +88,7 @@ public:
    * \param device Device pointer to the netdevice to attach to the channel
    * \return The assigned device number
    */
-  int32_t Attach (Ptr<CsmaNetDevice> device);
+  virtual int32_t Attach (Ptr<CsmaNetDevice> device);
 
   /**
    * \brief Detach a given netdevice from this channel
@@ -160,7 +160,7 @@ public:
    * \return True if the channel is not busy and the transmitting net
    * device is currently active.
    */
-  bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
+  virtual bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
 
   /**
    * \brief Indicates that the net device has finished transmitting
@@ -178,6 +178,20 @@ public:
    */
   bool TransmitEnd ();
 
+  /**
+   * \brief Indicates that a net device has finished transmitting
+   * the packet over the channel
+   *
+   * The channel has a single transmitter at a time, so this is
+   * TransmitEnd (); channels letting net devices transmit at the same
+   * time tell the transmissions apart by source.
+   *
+   * \param srcId The device Id of the net device that transmitted.
+   * \return Returns true unless the source was detached before it
+   * completed its transmission.
+   */
+  virtual bool TransmitEnd (uint32_t srcId);
+
   /**
    * \brief Indicates that the channel has finished propagating the
    * current packet. The channel is released and becomes free.
@@ -202,6 +216,15 @@ public:
    */
   WireState GetState ();
 
+  /**
+   * \return Returns the state of the channel as sensed by a net
+   * device: the state of the channel itself, which all the net devices
+   * share
+   *
+   * \param deviceId The device Id of the net device sensing the channel.
+   */
+  virtual WireState GetState (uint32_t deviceId);
+
   /**
    * \brief Indicates if the channel is busy. The channel will only
    * accept new packets for transmission if it is not busy.
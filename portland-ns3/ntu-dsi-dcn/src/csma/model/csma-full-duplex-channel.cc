@@ -0,0 +1,175 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "csma-full-duplex-channel.h"
+#include "csma-net-device.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/mpi-receiver.h"
+
+NS_LOG_COMPONENT_DEFINE ("CsmaFullDuplexChannel");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (CsmaFullDuplexChannel);
+
+TypeId
+CsmaFullDuplexChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CsmaFullDuplexChannel")
+    .SetParent<CsmaChannel> ()
+    .AddConstructor<CsmaFullDuplexChannel> ()
+  ;
+  return tid;
+}
+
+CsmaFullDuplexChannel::CsmaFullDuplexChannel ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+CsmaFullDuplexChannel::~CsmaFullDuplexChannel ()
+{
+}
+
+int32_t
+CsmaFullDuplexChannel::Attach (Ptr<CsmaNetDevice> device)
+{
+  NS_LOG_FUNCTION (this << device);
+  NS_ASSERT_MSG (device->GetNode () != 0, "The net device must be added to its node before it is attached");
+
+  int32_t id = CsmaChannel::Attach (device);
+  NS_ASSERT (id == (int32_t)m_ports.size ());
+  Port port;
+  port.state = IDLE;
+  port.device = PeekPointer (device);
+  port.nodeId = device->GetNode ()->GetId ();
+  port.systemId = device->GetNode ()->GetSystemId ();
+  port.ifIndex = device->GetIfIndex ();
+  m_ports.push_back (port);
+
+  if (MpiInterface::IsEnabled () && device->GetObject<MpiReceiver> () == 0)
+    {
+      Ptr<MpiReceiver> mpiRec = CreateObject<MpiReceiver> ();
+      mpiRec->SetReceiveCallback (MakeBoundCallback (&CsmaFullDuplexChannel::ReceiveRemote, device));
+      device->AggregateObject (mpiRec);
+    }
+  return id;
+}
+
+void
+CsmaFullDuplexChannel::ReceiveRemote (Ptr<CsmaNetDevice> device, Ptr<Packet> p)
+{
+  device->Receive (p, 0);
+}
+
+bool
+CsmaFullDuplexChannel::TransmitStart (Ptr<Packet> p, uint32_t srcId)
+{
+  NS_LOG_FUNCTION (this << p << srcId);
+  NS_ASSERT (srcId < m_ports.size ());
+
+  if (m_ports[srcId].state != IDLE)
+    {
+      NS_LOG_WARN ("CsmaFullDuplexChannel::TransmitStart(): State is not IDLE");
+      return false;
+    }
+  if (!IsActive (srcId))
+    {
+      NS_LOG_ERROR ("CsmaFullDuplexChannel::TransmitStart(): Selected source is not currently attached to network");
+      return false;
+    }
+
+  m_ports[srcId].packet = p;
+  m_ports[srcId].state = TRANSMITTING;
+  return true;
+}
+
+bool
+CsmaFullDuplexChannel::TransmitEnd (uint32_t srcId)
+{
+  NS_LOG_FUNCTION (this << srcId);
+  Port &src = m_ports[srcId];
+  NS_ASSERT (src.state == TRANSMITTING);
+  Ptr<Packet> p = src.packet;
+  src.packet = 0;
+  // the frame is on its own wire: the next one may follow at once
+  src.state = IDLE;
+
+  if (!IsActive (srcId))
+    {
+      NS_LOG_ERROR ("CsmaFullDuplexChannel::TransmitEnd(): Selected source was detached before the end of the transmission");
+      return false;
+    }
+
+#ifdef NS3_MPI
+  if (MpiInterface::IsEnabled () && src.systemId != MpiInterface::GetSystemId ())
+    {
+      // every rank has a copy of every node, but only the rank of the
+      // node puts its frames on the wire
+      return true;
+    }
+#endif
+
+  Time delay = GetDelay ();
+  for (uint32_t i = 0; i < m_ports.size (); i++)
+    {
+      if (i == srcId || !IsActive (i))
+        {
+          continue;
+        }
+      const Port &dst = m_ports[i];
+#ifdef NS3_MPI
+      if (MpiInterface::IsEnabled ())
+        {
+          if (dst.systemId != MpiInterface::GetSystemId ())
+            {
+              MpiInterface::SendPacket (p->Copy (), Simulator::Now () + delay, dst.nodeId, dst.ifIndex);
+              continue;
+            }
+        }
+      else
+#endif
+      if (dst.systemId != src.systemId)
+        {
+          // another partition of a multithreaded simulation: hand it a
+          // deep copy, as the buffer of the packet is shared by its copies
+          uint32_t size = p->GetSerializedSize ();
+          uint8_t *buffer = new uint8_t[size];
+          p->Serialize (buffer, size);
+          Ptr<Packet> copy = Create<Packet> (buffer, size, true);
+          delete [] buffer;
+          Simulator::ScheduleWithContext (dst.nodeId, delay, &CsmaNetDevice::Receive,
+                                          dst.device, copy, Ptr<CsmaNetDevice> ());
+          continue;
+        }
+      Simulator::ScheduleWithContext (dst.nodeId, delay, &CsmaNetDevice::Receive,
+                                      dst.device, p->Copy (), Ptr<CsmaNetDevice> ());
+    }
+  return true;
+}
+
+WireState
+CsmaFullDuplexChannel::GetState (uint32_t deviceId)
+{
+  NS_ASSERT (deviceId < m_ports.size ());
+  return m_ports[deviceId].state;
+}
+
+} // namespace ns3
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CSMA_FULL_DUPLEX_CHANNEL_H
+#define CSMA_FULL_DUPLEX_CHANNEL_H
+
+#include "csma-channel.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief A switched Ethernet segment for CsmaNetDevices.
+ *
+ * Unlike the CsmaChannel bus, every attached net device has a wire of
+ * its own: net devices transmit at the same time without deferring to
+ * one another, and a frame reaches all the other active net devices
+ * GetDelay () after the end of its transmission. Between two net devices
+ * this is a full-duplex link, which is how the switches of a data center
+ * are cabled.
+ *
+ * The channel may connect nodes of different system ids. Under
+ * DistributedSimulatorImpl, frames for net devices of another rank are
+ * sent with MpiInterface::SendPacket, as PointToPointRemoteChannel does;
+ * otherwise, e.g. under MultithreadedSimulatorImpl, they get a deep copy
+ * of the frame so that no packet buffer is shared across partitions. The
+ * delay of the channel is then part of the lookahead of the simulation.
+ */
+class CsmaFullDuplexChannel : public CsmaChannel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CsmaFullDuplexChannel ();
+  virtual ~CsmaFullDuplexChannel ();
+
+  virtual int32_t Attach (Ptr<CsmaNetDevice> device);
+  virtual bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
+  virtual bool TransmitEnd (uint32_t srcId);
+  /**
+   * \return Returns the state of the wire of the net device: TRANSMITTING
+   * from TransmitStart to TransmitEnd, IDLE otherwise
+   *
+   * \param deviceId The device Id of the net device sensing the channel.
+   */
+  virtual WireState GetState (uint32_t deviceId);
+
+private:
+  /* The transmitter of a net device, and where frames for it go. */
+  struct Port
+  {
+    WireState state;
+    Ptr<Packet> packet;
+    // raw pointer: the net device may belong to another partition, whose
+    // reference counts must not be touched
+    CsmaNetDevice *device;
+    uint32_t nodeId;
+    uint32_t systemId;
+    uint32_t ifIndex;
+  };
+
+  static void ReceiveRemote (Ptr<CsmaNetDevice> device, Ptr<Packet> p);
+
+  std::vector<Port> m_ports;
+};
+
+} // namespace ns3
+
+#endif /* CSMA_FULL_DUPLEX_CHANNEL_H */
@@ -26,6 +26,12 @@
 #include "ns3/ipv4-l3-protocol.h"
 #include "ns3/node.h"
 #include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/multithreaded-simulator-impl.h"
+#endif
+#include "ns3/abort.h"
 
 
 namespace ns3 {
@@ -69,6 +75,18 @@ FlowMonitorHelper::GetClassifier ()
 Ptr<FlowMonitor>
 FlowMonitorHelper::Install (Ptr<Node> node)
 {
+#ifdef HAVE_PTHREAD_H
+  if (MultithreadedSimulatorImpl::IsEnabled ())
+    {
+      // the flow monitor is shared by the probes of all the nodes, whose events the threads
+      // of the partitions would run at the same time
+      for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+        {
+          NS_ABORT_MSG_IF ((*i)->GetSystemId () != 0,
+                           "FlowMonitor can not monitor several partitions of a MultithreadedSimulatorImpl");
+        }
+    }
+#endif
   Ptr<FlowMonitor> monitor = GetMonitor ();
   Ptr<FlowClassifier> classifier = GetClassifier ();
   Ptr<Ipv4FlowProbe> probe = Create<Ipv4FlowProbe> (monitor,
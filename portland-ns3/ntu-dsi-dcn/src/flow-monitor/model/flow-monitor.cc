@@ -105,6 +105,8 @@ FlowMonitor::GetStatsForFlow (FlowId flowId)
       ref.rxPackets = 0;
       ref.lostPackets = 0;
       ref.timesForwarded = 0;
+      ref.reorderedPackets = 0;
+      ref.maxRxPacketId = 0;
       ref.delayHistogram.SetDefaultBinWidth (m_delayBinWidth);
       ref.jitterHistogram.SetDefaultBinWidth (m_jitterBinWidth);
       ref.packetSizeHistogram.SetDefaultBinWidth (m_packetSizeBinWidth);
@@ -208,6 +210,15 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
     }
   stats.lastDelay = delay;
 
+  if (stats.rxPackets > 0 && packetId < stats.maxRxPacketId)
+    {
+      stats.reorderedPackets++;
+    }
+  else
+    {
+      stats.maxRxPacketId = packetId;
+    }
+
   stats.rxBytes += packetSize;
   stats.packetSizeHistogram.AddValue ((double) packetSize);
   stats.rxPackets++;
@@ -412,6 +423,7 @@ FlowMonitor::SerializeToXmlStream (std::ostream &os, int indent, bool enableHist
       ATTRIB (rxPackets)
       ATTRIB (lostPackets)
       ATTRIB (timesForwarded)
+      ATTRIB (reorderedPackets)
       << ">\n";
 #undef ATTRIB
 
@@ -489,10 +501,17 @@ FlowMonitor::PrintAggregatedStatistics()
 	uint32_t rxPackets = 0;
 	uint32_t droppedPackets = 0;
 	uint32_t lostPackets = 0;
+	uint32_t reorderedPackets = 0;
 	uint32_t rxBytes = 0;
 	double delaySum = 0;
 	double avgThroughput = 0;
 
+	if (m_flowStats.size() == 0)
+	{
+		std::cout << "FlowMon: No flows\n";
+		return;
+	}
+
 	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = m_flowStats.begin(); iter != m_flowStats.end(); ++iter)
 	{
 		txPackets += iter->second.txPackets;
@@ -501,13 +520,14 @@ FlowMonitor::PrintAggregatedStatistics()
 		droppedPackets += iter->second.packetsDropped.size();
 		delaySum += iter->second.delaySum.GetSeconds();
 		rxBytes += iter->second.rxBytes;
+		reorderedPackets += iter->second.reorderedPackets;
 		avgThroughput += iter->second.rxBytes * 8.0 /
 			(iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1000000;
 	}
 
 	avgThroughput /= m_flowStats.size();
 
-	std::cout << "Avg. Throughput (per flow basis): " << avgThroughput << " Mbps\n";
+//	std::cout << "Avg. Throughput (per flow basis): " << avgThroughput << " Mbps\n";
 	std::cout << "Avg. Throughput: " << rxBytes * 8.0 / delaySum / 1000000 << " Mbps\n";
 	std::cout << "Average Packet Delay: " << delaySum * 1000.0 / rxPackets << " ms\n";
 
@@ -515,51 +535,9 @@ FlowMonitor::PrintAggregatedStatistics()
 	std::cout << "RX Packets: " << rxPackets << "\n";
 	std::cout << "Lost Packets: " << lostPackets << "\n";
 	std::cout << "Dropped Packets: " << droppedPackets << "\n";
+	std::cout << "Reordered Packets: " << reorderedPackets << "\n";
 	std::cout << "Packet Delivery Ratio: " << ((rxPackets * 100) / txPackets) << "%\n";
 	std::cout << "Packet Loss Ratio: " << ((lostPackets * 100) / txPackets) << "%\n";
 }
 
-=======
- FlowMonitor::PrintAggregatedStatistics()
- {
- 	uint32_t txPackets = 0;
- 	uint32_t rxPackets = 0;
- 	uint32_t droppedPackets = 0;
- 	uint32_t lostPackets = 0;
- 	uint32_t rxBytes = 0;
- 	double delaySum = 0;
- 	double avgThroughput = 0;
-
-  if (m_flowStats.size() == 0)
-  {
-    std::cout << "FlowMon: No flows\n";
-    return;
-  }
-
- 	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = m_flowStats.begin(); iter != m_flowStats.end(); ++iter)
- 	{
- 		txPackets += iter->second.txPackets;
- 		rxPackets += iter->second.rxPackets;
- 		lostPackets = txPackets - rxPackets;
- 		droppedPackets += iter->second.packetsDropped.size();
- 		delaySum += iter->second.delaySum.GetSeconds();
- 		rxBytes += iter->second.rxBytes;
- 		avgThroughput += iter->second.rxBytes * 8.0 /
- 			(iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1000000;
- 	}
-
- 	avgThroughput /= m_flowStats.size();
-
-// 	std::cout << "Avg. Throughput (per flow basis): " << avgThroughput << " Mbps\n";
- 	std::cout << "Avg. Throughput: " << rxBytes * 8.0 / delaySum / 1000000 << " Mbps\n";
- 	std::cout << "Average Packet Delay: " << delaySum * 1000.0 / rxPackets << " ms\n";
-
- 	std::cout << "TX Packets: " << txPackets << "\n";
- 	std::cout << "RX Packets: " << rxPackets << "\n";
- 	std::cout << "Lost Packets: " << lostPackets << "\n";
- 	std::cout << "Dropped Packets: " << droppedPackets << "\n";
- 	std::cout << "Packet Delivery Ratio: " << ((rxPackets * 100) / txPackets) << "%\n";
- 	std::cout << "Packet Loss Ratio: " << ((lostPackets * 100) / txPackets) << "%\n";
- }
-
 } // namespace ns3
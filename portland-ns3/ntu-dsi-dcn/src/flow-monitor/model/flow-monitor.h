@@ -99,6 +99,13 @@ public:
     /// forwarded, summed for all received packets in the flow
     uint32_t timesForwarded;
 
+    /// Number of packets received after a packet of the same flow that
+    /// was transmitted later, i.e. packets that arrived out of order
+    uint32_t reorderedPackets;
+
+    /// Highest packet id received so far; used to detect reordering
+    uint32_t maxRxPacketId;
+
     /// Histogram of the packet delays
     Histogram delayHistogram;
     /// Histogram of the packet jitters
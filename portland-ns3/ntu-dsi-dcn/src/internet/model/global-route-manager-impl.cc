@@ -699,8 +699,9 @@ GlobalRouteManagerImpl::InitializeRoutes ()
       Ptr<GlobalRouter> rtr = 
         node->GetObject<GlobalRouter> ();
 
-      // Ignore nodes that are not assigned to our systemId (distributed sim)
-      if (node->GetSystemId () != MpiInterface::GetSystemId ()) 
+      // Ignore nodes that are not assigned to our systemId (distributed sim);
+      // without MPI, all the partitions of a simulation share the process
+      if (MpiInterface::IsEnabled () && node->GetSystemId () != MpiInterface::GetSystemId ())
         {
           continue;
         }
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * SimpleMultithreaded builds a k-ary fat tree of point-to-point links and
+ * runs it with MultithreadedSimulatorImpl, one partition per pod: the
+ * hosts, edge and aggregation switches of pod p get system id p and the
+ * core switches are spread over the pods. Every host sends a constant bit
+ * rate UDP flow to the host at the same position in the next pod, so that
+ * all flows cross the core.
+ *
+ * With --threads=0 the same topology runs in a single partition with
+ * DefaultSimulatorImpl, which gives the reference for the bytes received
+ * and the wall clock time; otherwise --threads bounds the number of
+ * threads running the k partitions.
+ *
+ *   ./waf --run "simple-multithreaded --k=8 --threads=0"
+ *   ./waf --run "simple-multithreaded --k=8 --threads=4"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/packet-sink.h"
+#include "ns3/multithreaded-simulator-impl.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleMultithreaded");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t k = 4;
+  uint32_t threads = 0;
+  double stop = 1.0;
+
+  Config::SetDefault ("ns3::OnOffApplication::PacketSize", UintegerValue (1024));
+  Config::SetDefault ("ns3::OnOffApplication::DataRate", StringValue ("10Mbps"));
+
+  CommandLine cmd;
+  cmd.AddValue ("k", "Number of ports of the switches of the fat tree (even)", k);
+  cmd.AddValue ("threads", "Number of threads, 0 for a sequential run", threads);
+  cmd.AddValue ("stop", "Simulated time, in seconds", stop);
+  cmd.Parse (argc, argv);
+
+  if (k < 2 || k % 2 != 0)
+    {
+      std::cout << "k must be even." << std::endl;
+      return 1;
+    }
+  if (threads != 0)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue ("ns3::MultithreadedSimulatorImpl"));
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads));
+    }
+
+  uint32_t half = k / 2;
+  // nodes of a pod and core switches go to the partition of their pod
+  NodeContainer hosts, edges, aggs, cores;
+  for (uint32_t pod = 0; pod < k; pod++)
+    {
+      uint32_t systemId = threads != 0 ? pod : 0;
+      hosts.Create (half * half, systemId);
+      edges.Create (half, systemId);
+      aggs.Create (half, systemId);
+    }
+  for (uint32_t c = 0; c < half * half; c++)
+    {
+      cores.Add (CreateObject<Node> (threads != 0 ? c % k : 0));
+    }
+
+  InternetStackHelper stack;
+  stack.InstallAll ();
+
+  PointToPointHelper link;
+  link.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  link.SetChannelAttribute ("Delay", StringValue ("10us"));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  Ipv4InterfaceContainer hostInterfaces;
+  for (uint32_t pod = 0; pod < k; pod++)
+    {
+      for (uint32_t e = 0; e < half; e++)
+        {
+          Ptr<Node> edge = edges.Get (pod * half + e);
+          for (uint32_t h = 0; h < half; h++)
+            {
+              Ipv4InterfaceContainer ifc = address.Assign (link.Install (hosts.Get ((pod * half + e) * half + h), edge));
+              hostInterfaces.Add (ifc.Get (0));
+              address.NewNetwork ();
+            }
+          for (uint32_t a = 0; a < half; a++)
+            {
+              address.Assign (link.Install (edge, aggs.Get (pod * half + a)));
+              address.NewNetwork ();
+            }
+        }
+      for (uint32_t a = 0; a < half; a++)
+        {
+          for (uint32_t c = 0; c < half; c++)
+            {
+              address.Assign (link.Install (aggs.Get (pod * half + a), cores.Get (a * half + c)));
+              address.NewNetwork ();
+            }
+        }
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  uint16_t port = 50000;
+  PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer sinkApps = sinkHelper.Install (hosts);
+  sinkApps.Start (Seconds (0.0));
+
+  OnOffHelper clientHelper ("ns3::UdpSocketFactory", Address ());
+  clientHelper.SetAttribute ("OnTime", RandomVariableValue (ConstantVariable (1)));
+  clientHelper.SetAttribute ("OffTime", RandomVariableValue (ConstantVariable (0)));
+  uint32_t podHosts = half * half;
+  for (uint32_t i = 0; i < hosts.GetN (); i++)
+    {
+      uint32_t dst = (i + podHosts) % hosts.GetN ();
+      clientHelper.SetAttribute ("Remote", AddressValue (InetSocketAddress (hostInterfaces.GetAddress (dst), port)));
+      ApplicationContainer app = clientHelper.Install (hosts.Get (i));
+      // spread the starts so that the flows do not send in lockstep
+      app.Start (MicroSeconds (100 + 7 * i));
+    }
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Stop (Seconds (stop));
+  Simulator::Run ();
+  int64_t ms = clock.End ();
+
+  uint64_t rx = 0;
+  for (uint32_t i = 0; i < sinkApps.GetN (); i++)
+    {
+      rx += DynamicCast<PacketSink> (sinkApps.Get (i))->GetTotalRx ();
+    }
+  std::cout << "k=" << k << " hosts=" << hosts.GetN () << " nodes=" << NodeList::GetNNodes ()
+            << (threads != 0 ? " multithreaded" : " sequential");
+  if (threads != 0)
+    {
+      Ptr<MultithreadedSimulatorImpl> impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+      std::cout << " partitions=" << k << " threads=" << std::min (threads, k)
+                << " lookahead=" << impl->GetLookAhead ().GetMicroSeconds () << "us";
+    }
+  std::cout << std::endl;
+  std::cout << "received " << rx << " bytes, wall clock " << ms << " ms" << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -27,9 +27,11 @@
 #include "ns3/ptr.h"
 #include "ns3/pointer.h"
 #include "ns3/assert.h"
+#include "ns3/boolean.h"
 #include "ns3/log.h"
 
 #include <math.h>
+#include <string.h>
 
 #ifdef NS3_MPI
 #include <mpi.h>
@@ -76,6 +78,11 @@ DistributedSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DistributedSimulatorImpl")
     .SetParent<Object> ()
     .AddConstructor<DistributedSimulatorImpl> ()
+    .AddAttribute ("BatchMessages",
+                   "Send the packets for each rank in one MPI message per synchronization round instead of one message each.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DistributedSimulatorImpl::m_batchMessages),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -105,6 +112,7 @@ DistributedSimulatorImpl::DistributedSimulatorImpl ()
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
   m_events = 0;
+  m_batchMessages = false;
 }
 
 DistributedSimulatorImpl::~DistributedSimulatorImpl ()
@@ -164,48 +172,50 @@ DistributedSimulatorImpl::CalculateLookAhead (void)
           for (uint32_t i = 0; i < (*iter)->GetNDevices (); ++i)
             {
               Ptr<NetDevice> localNetDevice = (*iter)->GetDevice (i);
-              // only works for p2p links currently
-              if (!localNetDevice->IsPointToPoint ())
-                {
-                  continue;
-                }
               Ptr<Channel> channel = localNetDevice->GetChannel ();
               if (channel == 0)
                 {
                   continue;
                 }
 
-              // grab the adjacent node
-              Ptr<Node> remoteNode;
-              if (channel->GetDevice (0) == localNetDevice)
-                {
-                  remoteNode = (channel->GetDevice (1))->GetNode ();
-                }
-              else
-                {
-                  remoteNode = (channel->GetDevice (0))->GetNode ();
-                }
-
-              // if it's not remote, don't consider it
-              if (remoteNode->GetSystemId () == MpiInterface::GetSystemId ())
-                {
-                  continue;
-                }
-
-              // compare delay on the channel with current value of
-              // m_lookAhead.  if delay on channel is smaller, make
-              // it the new lookAhead.
-              TimeValue delay;
-              channel->GetAttribute ("Delay", delay);
-              if (DistributedSimulatorImpl::m_lookAhead.IsZero ())
+              // any channel with a device of a remote node bounds the
+              // lookahead: point-to-point links as well as shared ones,
+              // such as CsmaFullDuplexChannel; channels of virtual
+              // devices, such as a BridgeChannel spanning the channels of
+              // the ports of a bridge, are not among them
+              bool attached = false;
+              for (uint32_t j = 0; j < channel->GetNDevices (); ++j)
                 {
-                  DistributedSimulatorImpl::m_lookAhead = delay.Get ();
-                  m_grantedTime = delay.Get ();
+                  attached = attached || channel->GetDevice (j) == localNetDevice;
                 }
-              if (delay.Get ().GetSeconds () < DistributedSimulatorImpl::m_lookAhead.GetSeconds ())
+              for (uint32_t j = 0; attached && j < channel->GetNDevices (); ++j)
                 {
-                  DistributedSimulatorImpl::m_lookAhead = delay.Get ();
-                  m_grantedTime = delay.Get ();
+                  Ptr<Node> remoteNode = channel->GetDevice (j)->GetNode ();
+                  // if it's not remote, don't consider it
+                  if (remoteNode == 0 || remoteNode->GetSystemId () == MpiInterface::GetSystemId ())
+                    {
+                      continue;
+                    }
+
+                  // compare delay on the channel with current value of
+                  // m_lookAhead.  if delay on channel is smaller, make
+                  // it the new lookAhead.
+                  TimeValue delay;
+                  if (!channel->GetAttributeFailSafe ("Delay", delay))
+                    {
+                      NS_FATAL_ERROR ("A " << channel->GetInstanceTypeId ().GetName ()
+                                      << " connects ranks but has no Delay attribute to take the lookahead from");
+                    }
+                  if (DistributedSimulatorImpl::m_lookAhead.IsZero ())
+                    {
+                      DistributedSimulatorImpl::m_lookAhead = delay.Get ();
+                      m_grantedTime = delay.Get ();
+                    }
+                  if (delay.Get ().GetSeconds () < DistributedSimulatorImpl::m_lookAhead.GetSeconds ())
+                    {
+                      DistributedSimulatorImpl::m_lookAhead = delay.Get ();
+                      m_grantedTime = delay.Get ();
+                    }
                 }
             }
         }
@@ -272,6 +282,14 @@ DistributedSimulatorImpl::Run (void)
 {
 #ifdef NS3_MPI
   CalculateLookAhead ();
+  MpiInterface::SetBatching (m_batchMessages);
+  // padded so that every LbtsMessage stays aligned
+  uint32_t lbtsStride = (sizeof (LbtsMessage) + m_systemCount * sizeof (uint32_t) + 15) / 16 * 16;
+  if (m_batchMessages)
+    {
+      m_lbtsBatchBuffer.resize (m_systemCount * lbtsStride);
+      m_batchSizes.resize (m_systemCount);
+    }
   m_stop = false;
   while (!m_events->IsEmpty () && !m_stop)
     {
@@ -285,10 +303,38 @@ DistributedSimulatorImpl::Run (void)
           // And check for send completes
           MpiInterface::TestSendComplete ();
           // Finally calculate the lbts
-          LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId, nextTime);
-          m_pLBTS[m_myId] = lMsg;
-          MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
-                         sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
+          if (m_batchMessages)
+            {
+              // the batched packets are in transit until the exchange
+              // below, and are as early as their receive times
+              Time smallest = Min (nextTime, MpiInterface::GetBatchSmallestTime ());
+              LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId, smallest);
+              uint8_t* mine = &m_lbtsBatchBuffer[m_myId * lbtsStride];
+              *reinterpret_cast<LbtsMessage *> (mine) = lMsg;
+              for (uint32_t i = 0; i < m_systemCount; ++i)
+                {
+                  uint32_t size = MpiInterface::GetBatchSize (i);
+                  memcpy (mine + sizeof (LbtsMessage) + i * sizeof (uint32_t), &size, sizeof (uint32_t));
+                }
+              MPI_Allgather (MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, &m_lbtsBatchBuffer[0],
+                             lbtsStride, MPI_BYTE, MPI_COMM_WORLD);
+              for (uint32_t i = 0; i < m_systemCount; ++i)
+                {
+                  const uint8_t* theirs = &m_lbtsBatchBuffer[i * lbtsStride];
+                  m_pLBTS[i] = *reinterpret_cast<const LbtsMessage *> (theirs);
+                  memcpy (&m_batchSizes[i], theirs + sizeof (LbtsMessage) + m_myId * sizeof (uint32_t),
+                          sizeof (uint32_t));
+                }
+              MpiInterface::ExchangeBatches (m_batchSizes);
+              nextTime = Next ();
+            }
+          else
+            {
+              LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId, nextTime);
+              m_pLBTS[m_myId] = lMsg;
+              MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
+                             sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
+            }
           Time smallestTime = m_pLBTS[0].GetSmallestTime ();
           // The totRx and totTx counts insure there are no transient
           // messages;  If totRx != totTx, there are transients,
@@ -25,6 +25,7 @@
 #include "ns3/ptr.h"
 
 #include <list>
+#include <vector>
 
 namespace ns3 {
 
@@ -87,6 +88,14 @@ private:
  * \ingroup mpi
  *
  * \brief distributed simulator implementation using lookahead
+ *
+ * With the BatchMessages attribute, packets for other ranks are not sent
+ * one MPI message each but batched per destination rank over each
+ * lookahead window (see MpiInterface::SetBatching). The size of every
+ * batch rides along with the LbtsMessage in the MPI_Allgather of the
+ * synchronization round, right after which the batches themselves are
+ * exchanged; the earliest receive time of a rank's batches counts towards
+ * its LBTS, as its next event would.
  */
 class DistributedSimulatorImpl : public SimulatorImpl
 {
@@ -143,6 +152,12 @@ private:
   Time         m_grantedTime; // Last LBTS
   static Time  m_lookAhead;   // Lookahead value
 
+  bool                  m_batchMessages;
+  // LbtsMessage then batch size for every rank, for every rank
+  std::vector<uint8_t>  m_lbtsBatchBuffer;
+  // Size of the batch of every rank for this one
+  std::vector<uint32_t> m_batchSizes;
+
 };
 
 } // namespace ns3
@@ -22,6 +22,7 @@
 #include <iostream>
 #include <iomanip>
 #include <list>
+#include <string.h>
 
 #include "mpi-interface.h"
 #include "mpi-receiver.h"
@@ -77,6 +78,15 @@ bool                  MpiInterface::m_enabled = false;
 uint32_t              MpiInterface::m_rxCount = 0;
 uint32_t              MpiInterface::m_txCount = 0;
 std::list<SentBuffer> MpiInterface::m_pendingTx;
+bool                  MpiInterface::m_batching = false;
+std::vector<std::vector<uint8_t> > MpiInterface::m_txBatches;
+std::vector<std::vector<uint8_t> > MpiInterface::m_rxBatches;
+uint64_t              MpiInterface::m_batchSmallestTime = ~(uint64_t)0;
+uint32_t              MpiInterface::m_txBatchCount = 0;
+uint32_t              MpiInterface::m_txBatchedCount = 0;
+
+// Header of a packet in a batch: receive time, dest node, dest device and size
+static const uint32_t BATCH_HEADER_SIZE = 8 + 4 + 4 + 4;
 
 #ifdef NS3_MPI
 MPI_Request* MpiInterface::m_requests;
@@ -95,6 +105,9 @@ MpiInterface::Destroy ()
   delete [] m_requests;
 
   m_pendingTx.clear ();
+  m_txBatches.clear ();
+  m_rxBatches.clear ();
+  m_batchSmallestTime = ~(uint64_t)0;
 #endif
 }
 
@@ -110,6 +123,18 @@ MpiInterface::GetTxCount ()
   return m_txCount;
 }
 
+uint32_t
+MpiInterface::GetTxBatchCount ()
+{
+  return m_txBatchCount;
+}
+
+uint32_t
+MpiInterface::GetTxBatchedCount ()
+{
+  return m_txBatchedCount;
+}
+
 uint32_t
 MpiInterface::GetSystemId ()
 {
@@ -163,6 +188,8 @@ MpiInterface::Enable (int* pargc, char*** pargv)
       MPI_Irecv (m_pRxBuffers[i], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
                  MPI_COMM_WORLD, &m_requests[i]);
     }
+  m_txBatches.resize (m_size);
+  m_rxBatches.resize (m_size);
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
@@ -172,6 +199,30 @@ void
 MpiInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
 {
 #ifdef NS3_MPI
+  if (m_batching)
+    {
+      // Append the packet to the batch of the rank of the destination node
+      uint32_t nodeSysId = NodeList::GetNode (node)->GetSystemId ();
+      NS_ASSERT (nodeSysId != m_sid);
+      std::vector<uint8_t> &batch = m_txBatches[nodeSysId];
+      uint32_t serializedSize = p->GetSerializedSize ();
+      uint32_t offset = batch.size ();
+      batch.resize (offset + BATCH_HEADER_SIZE + serializedSize);
+      uint8_t* record = &batch[offset];
+      uint64_t t = rxTime.GetNanoSeconds ();
+      memcpy (record, &t, 8);
+      memcpy (record + 8, &node, 4);
+      memcpy (record + 12, &dev, 4);
+      memcpy (record + 16, &serializedSize, 4);
+      p->Serialize (record + BATCH_HEADER_SIZE, serializedSize);
+      if (t < m_batchSmallestTime)
+        {
+          m_batchSmallestTime = t;
+        }
+      m_txBatchedCount++;
+      return;
+    }
+
   SentBuffer sendBuf;
   m_pendingTx.push_back (sendBuf);
   std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
@@ -231,32 +282,128 @@ MpiInterface::ReceiveMessages ()
 
       count -= sizeof (nanoSeconds) + sizeof (node) + sizeof (dev);
 
-      Ptr<Packet> p = Create<Packet> (reinterpret_cast<uint8_t *> (pData), count, true);
+      Deliver (rxTime, node, dev, reinterpret_cast<uint8_t *> (pData), count);
+
+      // Re-queue the next read
+      MPI_Irecv (m_pRxBuffers[index], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
+                 MPI_COMM_WORLD, &m_requests[index]);
+    }
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+MpiInterface::Deliver (const Time &rxTime, uint32_t node, uint32_t dev, const uint8_t *data, uint32_t size)
+{
+  Ptr<Packet> p = Create<Packet> (data, size, true);
 
-      // Find the correct node/device to schedule receive event
-      Ptr<Node> pNode = NodeList::GetNode (node);
-      Ptr<MpiReceiver> pMpiRec = 0;
-      uint32_t nDevices = pNode->GetNDevices ();
-      for (uint32_t i = 0; i < nDevices; ++i)
+  // Find the correct node/device to schedule receive event
+  Ptr<Node> pNode = NodeList::GetNode (node);
+  Ptr<MpiReceiver> pMpiRec = 0;
+  uint32_t nDevices = pNode->GetNDevices ();
+  for (uint32_t i = 0; i < nDevices; ++i)
+    {
+      Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
+      if (pThisDev->GetIfIndex () == dev)
         {
-          Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
-          if (pThisDev->GetIfIndex () == dev)
-            {
-              pMpiRec = pThisDev->GetObject<MpiReceiver> ();
-              break;
-            }
+          pMpiRec = pThisDev->GetObject<MpiReceiver> ();
+          break;
         }
+    }
 
-      NS_ASSERT (pNode && pMpiRec);
+  NS_ASSERT (pNode && pMpiRec);
 
-      // Schedule the rx event
-      Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
-                                      &MpiReceiver::Receive, pMpiRec, p);
+  // Schedule the rx event
+  Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
+                                  &MpiReceiver::Receive, pMpiRec, p);
+}
 
-      // Re-queue the next read
-      MPI_Irecv (m_pRxBuffers[index], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
-                 MPI_COMM_WORLD, &m_requests[index]);
+void
+MpiInterface::SetBatching (bool batching)
+{
+  m_batching = batching;
+}
+
+bool
+MpiInterface::IsBatching ()
+{
+  return m_batching;
+}
+
+uint32_t
+MpiInterface::GetBatchSize (uint32_t rank)
+{
+  if (rank >= m_txBatches.size ())
+    {
+      return 0;
+    }
+  return m_txBatches[rank].size ();
+}
+
+Time
+MpiInterface::GetBatchSmallestTime ()
+{
+  if (m_batchSmallestTime == ~(uint64_t)0)
+    {
+      return Simulator::GetMaximumSimulationTime ();
+    }
+  return NanoSeconds (m_batchSmallestTime);
+}
+
+void
+MpiInterface::ExchangeBatches (const std::vector<uint32_t> &sizes)
+{
+#ifdef NS3_MPI
+  NS_ASSERT (sizes.size () == m_size);
+  // Batches go with tag 1, apart from the single packets and their
+  // receives posted for any source with tag 0
+  std::vector<MPI_Request> requests;
+  requests.reserve (2 * m_size);
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      if (sizes[i] > 0)
+        {
+          m_rxBatches[i].resize (sizes[i]);
+          requests.push_back (MPI_Request ());
+          MPI_Irecv (&m_rxBatches[i][0], sizes[i], MPI_CHAR, i, 1,
+                     MPI_COMM_WORLD, &requests.back ());
+        }
+    }
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      if (!m_txBatches[i].empty ())
+        {
+          requests.push_back (MPI_Request ());
+          MPI_Isend (&m_txBatches[i][0], m_txBatches[i].size (), MPI_CHAR, i, 1,
+                     MPI_COMM_WORLD, &requests.back ());
+          m_txBatchCount++;
+        }
+    }
+  if (!requests.empty ())
+    {
+      MPI_Waitall (requests.size (), &requests[0], MPI_STATUSES_IGNORE);
+    }
+
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      const uint8_t* record = sizes[i] > 0 ? &m_rxBatches[i][0] : 0;
+      const uint8_t* end = record + sizes[i];
+      while (record < end)
+        {
+          uint64_t t;
+          uint32_t node, dev, size;
+          memcpy (&t, record, 8);
+          memcpy (&node, record + 8, 4);
+          memcpy (&dev, record + 12, 4);
+          memcpy (&size, record + 16, 4);
+          Deliver (NanoSeconds (t), node, dev, record + BATCH_HEADER_SIZE, size);
+          record += BATCH_HEADER_SIZE + size;
+        }
+      // clearing keeps the memory of the batches for the next round
+      m_txBatches[i].clear ();
     }
+  m_batchSmallestTime = ~(uint64_t)0;
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <list>
+#include <vector>
 
 #include "ns3/nstime.h"
 #include "ns3/buffer.h"
@@ -127,6 +128,41 @@ public:
    * Serialize and send a packet to the specified node and net device
    */
   static void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+  /**
+   * \param batching whether SendPacket batches packets
+   *
+   * Unless batching, SendPacket sends every packet in an MPI message of
+   * its own as soon as it is called. When batching, SendPacket serializes
+   * packets into one contiguous buffer per destination rank instead, and
+   * the buffers are only sent by ExchangeBatches, once per
+   * synchronization round; the buffers keep their memory from one round
+   * to the next.
+   */
+  static void SetBatching (bool batching);
+  /**
+   * \return true if SendPacket batches packets
+   */
+  static bool IsBatching ();
+  /**
+   * \param rank destination rank
+   * \return size in bytes of the packets batched for a rank since the
+   * last exchange
+   */
+  static uint32_t GetBatchSize (uint32_t rank);
+  /**
+   * \return the earliest receive time of the packets batched since the
+   * last exchange, or the maximum simulation time if there are none
+   */
+  static Time GetBatchSmallestTime ();
+  /**
+   * \param sizes size in bytes of the batch each rank has for this one,
+   * as given by GetBatchSize on that rank
+   *
+   * Sends the batched packets to their ranks, receives the batches of
+   * the other ranks and schedules the reception of their packets. Every
+   * rank must call it in the same synchronization round.
+   */
+  static void ExchangeBatches (const std::vector<uint32_t> &sizes);
   /**
    * Check for received messages complete
    */
@@ -143,8 +179,21 @@ public:
    * \return transmitted count in packets
    */
   static uint32_t GetTxCount ();
+  /**
+   * \return number of batches sent, in as many MPI messages
+   */
+  static uint32_t GetTxBatchCount ();
+  /**
+   * \return number of packets sent in batches
+   */
+  static uint32_t GetTxBatchedCount ();
 
 private:
+  /**
+   * Schedules the reception of a packet received from another rank.
+   */
+  static void Deliver (const Time &rxTime, uint32_t node, uint32_t dev, const uint8_t *data, uint32_t size);
+
   static uint32_t m_sid;
   static uint32_t m_size;
 
@@ -164,6 +213,16 @@ private:
 
   // List of pending non-blocking sends
   static std::list<SentBuffer> m_pendingTx;
+
+  static bool m_batching;
+  // Serialized packets for each rank since the last exchange
+  static std::vector<std::vector<uint8_t> > m_txBatches;
+  // Batches received from each rank
+  static std::vector<std::vector<uint8_t> > m_rxBatches;
+  // Earliest receive time of the batched packets, in nanoseconds
+  static uint64_t m_batchSmallestTime;
+  static uint32_t m_txBatchCount;
+  static uint32_t m_txBatchedCount;
 };
 
 } // namespace ns3
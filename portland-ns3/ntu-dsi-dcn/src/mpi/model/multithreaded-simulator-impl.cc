@@ -0,0 +1,741 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/system-thread.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/net-device.h"
+#include "ns3/channel.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <sched.h>
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+static const uint64_t MAX_TS = 0x7fffffffffffffffLL;
+
+// the partition whose events the calling thread runs; none in the main thread outside Run
+static __thread void *g_currentPartition = 0;
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<Object> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("MaxThreads",
+                   "Maximum number of threads running the partitions, the calling one included; "
+                   "0 for one thread per partition.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_maxThreads),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+bool MultithreadedSimulatorImpl::m_enabled = false;
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+{
+  m_enabled = true;
+  // uids are allocated from 4.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  m_uid = 4;
+  m_currentTs = 0;
+  m_maxThreads = 0;
+  m_nThreads = 1;
+  m_lookAhead = 0;
+  m_stopTs = MAX_TS;
+  m_stop = false;
+  m_barrierWaiting = 0;
+  m_barrierGeneration = 0;
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  m_enabled = false;
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  for (std::vector<Partition *>::iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      while (!(*p)->events->IsEmpty ())
+        {
+          Scheduler::Event next = (*p)->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (uint32_t dst = 0; dst < (*p)->outbox.size (); dst++)
+        {
+          for (std::vector<Message>::iterator m = (*p)->outbox[dst].begin (); m != (*p)->outbox[dst].end (); m++)
+            {
+              m->event->Unref ();
+            }
+        }
+      delete *p;
+    }
+  m_partitions.clear ();
+  for (std::vector<Scheduler::Event>::iterator i = m_pending.begin (); i != m_pending.end (); i++)
+    {
+      i->impl->Unref ();
+    }
+  m_pending.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::CreatePartitions (void)
+{
+  NS_ASSERT (m_partitions.empty ());
+  uint32_t n = 1;
+  m_nodePartition.resize (NodeList::GetNNodes ());
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      m_nodePartition[i] = NodeList::GetNode (i)->GetSystemId ();
+      n = std::max (n, m_nodePartition[i] + 1);
+    }
+  for (uint32_t id = 0; id < n; id++)
+    {
+      Partition *p = new Partition ();
+      p->id = id;
+      p->events = m_schedulerFactory.Create<Scheduler> ();
+      // the pending events keep the uids they were given
+      p->uid = m_uid;
+      p->currentUid = 0;
+      p->currentTs = m_currentTs;
+      p->currentContext = 0xffffffff;
+      p->unscheduledEvents = 0;
+      p->outbox.resize (n);
+      p->nextTs = MAX_TS;
+      p->windowEnd = 0;
+      m_partitions.push_back (p);
+    }
+  for (std::vector<Scheduler::Event>::const_iterator i = m_pending.begin (); i != m_pending.end (); i++)
+    {
+      Partition *p = m_partitions[GetPartition (i->key.m_context)];
+      p->events->Insert (*i);
+      p->unscheduledEvents++;
+    }
+  m_pending.clear ();
+  NS_LOG_LOGIC (n << " partitions of " << m_nodePartition.size () << " nodes");
+}
+
+void
+MultithreadedSimulatorImpl::CalculateLookAhead (void)
+{
+  m_lookAhead = 0;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      uint32_t partition = m_nodePartition[(*i)->GetId ()];
+      for (uint32_t d = 0; d < (*i)->GetNDevices (); d++)
+        {
+          Ptr<NetDevice> device = (*i)->GetDevice (d);
+          Ptr<Channel> channel = device->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+          // skip the channels of virtual devices, such as a BridgeChannel
+          // spanning the channels of the ports of a bridge
+          bool attached = false;
+          for (uint32_t j = 0; j < channel->GetNDevices (); j++)
+            {
+              attached = attached || channel->GetDevice (j) == device;
+            }
+          for (uint32_t j = 0; attached && j < channel->GetNDevices (); j++)
+            {
+              Ptr<Node> peer = channel->GetDevice (j)->GetNode ();
+              if (peer == 0 || m_nodePartition[peer->GetId ()] == partition)
+                {
+                  continue;
+                }
+              TimeValue delay;
+              if (!channel->GetAttributeFailSafe ("Delay", delay))
+                {
+                  NS_FATAL_ERROR ("A " << channel->GetInstanceTypeId ().GetName ()
+                                  << " connects partitions but has no Delay attribute to take the lookahead from");
+                }
+              uint64_t ts = delay.Get ().GetTimeStep ();
+              NS_ABORT_MSG_IF (ts == 0, "Partitions connected by a channel without delay");
+              if (m_lookAhead == 0 || ts < m_lookAhead)
+                {
+                  m_lookAhead = ts;
+                }
+            }
+        }
+    }
+  NS_LOG_LOGIC ("lookahead " << m_lookAhead);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context < m_nodePartition.size ())
+    {
+      return m_nodePartition[context];
+    }
+  return 0;
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetCurrentPartition (void) const
+{
+  return static_cast<Partition *> (g_currentPartition);
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  m_schedulerFactory = schedulerFactory;
+  for (std::vector<Partition *>::iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      while (!(*p)->events->IsEmpty ())
+        {
+          scheduler->Insert ((*p)->events->RemoveNext ());
+        }
+      (*p)->events = scheduler;
+    }
+}
+
+uint32_t
+MultithreadedSimulatorImpl::Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = partition->uid;
+  partition->uid++;
+  partition->unscheduledEvents++;
+  partition->events->Insert (ev);
+  return ev.key.m_uid;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::Enqueue (uint64_t ts, uint32_t context, EventImpl *event)
+{
+  if (m_partitions.empty ())
+    {
+      Scheduler::Event ev;
+      ev.impl = event;
+      ev.key.m_ts = ts;
+      ev.key.m_context = context;
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      m_pending.push_back (ev);
+      return ev.key.m_uid;
+    }
+  Partition *target = m_partitions[GetPartition (context)];
+  Partition *current = GetCurrentPartition ();
+  if (current == 0 || current == target)
+    {
+      return Insert (target, ts, context, event);
+    }
+  // another partition: its thread takes the event in at the end of the window and gives it
+  // its uid then. Only ScheduleWithContext gets here, which returns no EventId: the
+  // context of Schedule and ScheduleNow is that of the running event, in this partition.
+  NS_ABORT_MSG_IF (ts < current->windowEnd, "Event for partition " << target->id << " at " << ts
+                   << " within the window of partition " << current->id << ", which ends at " << current->windowEnd);
+  Message m;
+  m.ts = ts;
+  m.context = context;
+  m.event = event;
+  current->outbox[target->id].push_back (m);
+  return 0;
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  partition->unscheduledEvents--;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts << " in partition " << partition->id);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.key.m_context;
+  partition->currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  Partition *current = GetCurrentPartition ();
+  if (current != 0)
+    {
+      return current->events->IsEmpty ();
+    }
+  for (std::vector<Partition *>::const_iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      if (!(*p)->events->IsEmpty ())
+        {
+          return false;
+        }
+    }
+  return m_pending.empty ();
+}
+
+Time
+MultithreadedSimulatorImpl::Next (void) const
+{
+  Partition *current = GetCurrentPartition ();
+  if (current != 0)
+    {
+      NS_ASSERT (!current->events->IsEmpty ());
+      return TimeStep (current->events->PeekNext ().key.m_ts);
+    }
+  uint64_t next = MAX_TS;
+  for (std::vector<Partition *>::const_iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      if (!(*p)->events->IsEmpty ())
+        {
+          next = std::min (next, (*p)->events->PeekNext ().key.m_ts);
+        }
+    }
+  for (std::vector<Scheduler::Event>::const_iterator i = m_pending.begin (); i != m_pending.end (); i++)
+    {
+      next = std::min (next, i->key.m_ts);
+    }
+  NS_ASSERT (next != MAX_TS);
+  return TimeStep (next);
+}
+
+void
+MultithreadedSimulatorImpl::Barrier (void)
+{
+  if (m_nThreads == 1)
+    {
+      return;
+    }
+  uint32_t generation = m_barrierGeneration;
+  if (__sync_add_and_fetch (&m_barrierWaiting, 1) == m_nThreads)
+    {
+      // the last thread in lets the others go
+      m_barrierWaiting = 0;
+      __sync_fetch_and_add (&m_barrierGeneration, 1);
+    }
+  else
+    {
+      // spin while the others are likely to be about to arrive, then give way to them
+      uint32_t spins = 0;
+      while (m_barrierGeneration == generation)
+        {
+          if (++spins > 1000)
+            {
+              sched_yield ();
+            }
+        }
+    }
+  __sync_synchronize ();
+}
+
+void
+MultithreadedSimulatorImpl::DoRunWorker (Worker *worker)
+{
+  worker->impl->RunPartitions (worker->index);
+}
+
+void
+MultithreadedSimulatorImpl::RunPartitions (uint32_t worker)
+{
+  std::vector<Partition *> mine;
+  for (uint32_t id = worker; id < m_partitions.size (); id += m_nThreads)
+    {
+      mine.push_back (m_partitions[id]);
+    }
+  while (true)
+    {
+      for (std::vector<Partition *>::iterator p = mine.begin (); p != mine.end (); p++)
+        {
+          // take in the events the other partitions scheduled for this one in the last window,
+          // in the order of the partitions, so that the run does not depend on the threads
+          for (std::vector<Partition *>::iterator src = m_partitions.begin (); src != m_partitions.end (); src++)
+            {
+              std::vector<Message> &mailbox = (*src)->outbox[(*p)->id];
+              for (std::vector<Message>::const_iterator m = mailbox.begin (); m != mailbox.end (); m++)
+                {
+                  Insert (*p, m->ts, m->context, m->event);
+                }
+              mailbox.clear ();
+            }
+          (*p)->nextTs = (*p)->events->IsEmpty () ? MAX_TS : (*p)->events->PeekNext ().key.m_ts;
+        }
+      // read before the barrier: no event runs between it and the decision below
+      bool stop = m_stop;
+      Barrier ();
+
+      uint64_t next = MAX_TS;
+      for (std::vector<Partition *>::const_iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+        {
+          next = std::min (next, (*p)->nextTs);
+        }
+      if (stop || next == MAX_TS || next >= m_stopTs)
+        {
+          break;
+        }
+      // no partition can send anything earlier than the earliest event plus the lookahead
+      uint64_t windowEnd = MAX_TS;
+      if (m_lookAhead != 0 && next < MAX_TS - m_lookAhead)
+        {
+          windowEnd = next + m_lookAhead;
+        }
+      windowEnd = std::min (windowEnd, m_stopTs);
+
+      for (std::vector<Partition *>::iterator p = mine.begin (); p != mine.end (); p++)
+        {
+          (*p)->windowEnd = windowEnd;
+          g_currentPartition = *p;
+          while (!m_stop && !(*p)->events->IsEmpty ()
+                 && (*p)->events->PeekNext ().key.m_ts < windowEnd)
+            {
+              ProcessOneEvent (*p);
+            }
+          g_currentPartition = 0;
+        }
+      Barrier ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+    }
+  NS_ABORT_MSG_IF (NodeList::GetNNodes () != m_nodePartition.size (),
+                   "Nodes can not be added after the first call to Simulator::Run");
+  CalculateLookAhead ();
+  m_nThreads = m_partitions.size ();
+  if (m_maxThreads != 0 && m_maxThreads < m_nThreads)
+    {
+      m_nThreads = m_maxThreads;
+    }
+  m_stop = false;
+  m_barrierWaiting = 0;
+
+  // the calling thread runs the partitions of worker 0
+  std::vector<Worker> workers (m_nThreads);
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < m_nThreads; i++)
+    {
+      workers[i].impl = this;
+      workers[i].index = i;
+      if (i > 0)
+        {
+          Ptr<SystemThread> thread = Create<SystemThread> (MakeBoundCallback (&MultithreadedSimulatorImpl::DoRunWorker, &workers[i]));
+          thread->Start ();
+          threads.push_back (thread);
+        }
+    }
+  RunPartitions (0);
+  for (std::vector<Ptr<SystemThread> >::iterator thread = threads.begin (); thread != threads.end (); thread++)
+    {
+      (*thread)->Join ();
+    }
+
+  for (std::vector<Partition *>::const_iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      m_currentTs = std::max (m_currentTs, (*p)->currentTs);
+    }
+  if (!m_stop && m_stopTs != MAX_TS)
+    {
+      // stopped by time: every clock moves to the stop time, before the events there
+      m_currentTs = m_stopTs;
+      for (std::vector<Partition *>::iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+        {
+          (*p)->currentTs = m_stopTs;
+          (*p)->currentUid = 0;
+        }
+      m_stopTs = MAX_TS;
+    }
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  for (std::vector<Partition *>::const_iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      NS_ASSERT (!(*p)->events->IsEmpty () || (*p)->unscheduledEvents == 0);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunOneEvent (void)
+{
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+    }
+  Partition *earliest = 0;
+  for (std::vector<Partition *>::iterator p = m_partitions.begin (); p != m_partitions.end (); p++)
+    {
+      if (!(*p)->events->IsEmpty ()
+          && (earliest == 0 || (*p)->events->PeekNext ().key < earliest->events->PeekNext ().key))
+        {
+          earliest = *p;
+        }
+    }
+  NS_ASSERT (earliest != 0);
+  // one event at a time, in the calling thread: there is no window, the mailboxes are bypassed
+  ProcessOneEvent (earliest);
+  m_currentTs = std::max (m_currentTs, earliest->currentTs);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  Partition *current = GetCurrentPartition ();
+  return current != 0 ? current->id : 0;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  if (GetCurrentPartition () != 0)
+    {
+      Simulator::Schedule (time, &Simulator::Stop);
+      return;
+    }
+  m_stopTs = std::min (m_stopTs, m_currentTs + time.GetTimeStep ());
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  NS_ASSERT (time.IsPositive ());
+  uint64_t ts = static_cast<uint64_t> ((time + Now ()).GetTimeStep ());
+  uint32_t context = GetContext ();
+  uint32_t uid = Enqueue (ts, context, event);
+  NS_ASSERT_MSG (uid != 0, "Event scheduled for another partition from context " << context);
+  return EventId (event, ts, context, uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+  Enqueue (static_cast<uint64_t> ((time + Now ()).GetTimeStep ()), context, event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  uint64_t ts = static_cast<uint64_t> (Now ().GetTimeStep ());
+  uint32_t context = GetContext ();
+  uint32_t uid = Enqueue (ts, context, event);
+  NS_ASSERT_MSG (uid != 0, "Event scheduled for another partition from context " << context);
+  return EventId (event, ts, context, uid);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), Now ().GetTimeStep (), 0xffffffff, 2);
+  CriticalSection cs (m_destroyMutex);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  Partition *current = GetCurrentPartition ();
+  return TimeStep (current != 0 ? current->currentTs : m_currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - Now ().GetTimeStep ());
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  if (m_partitions.empty ())
+    {
+      for (std::vector<Scheduler::Event>::iterator i = m_pending.begin (); i != m_pending.end (); i++)
+        {
+          if (i->key.m_uid == event.key.m_uid)
+            {
+              m_pending.erase (i);
+              break;
+            }
+        }
+    }
+  else
+    {
+      Partition *p = m_partitions[GetPartition (id.GetContext ())];
+      NS_ASSERT_MSG (GetCurrentPartition () == 0 || GetCurrentPartition () == p,
+                     "Events of a partition can only be removed by its own events");
+      p->events->Remove (event);
+      p->unscheduledEvents--;
+    }
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0
+          || ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (ev.PeekEventImpl () == 0
+      || ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  NS_ASSERT_MSG (ev.GetUid () != 0, "EventId of an event for another partition");
+  if (m_partitions.empty ())
+    {
+      return false;
+    }
+  // the clock of the partition the event belongs to, which only its own thread writes:
+  // during a window, the other partitions must not read it
+  const Partition *p = m_partitions[GetPartition (ev.GetContext ())];
+  NS_ASSERT_MSG (GetCurrentPartition () == 0 || GetCurrentPartition () == p,
+                 "Events of a partition can only be checked by its own events");
+  return ev.GetTs () < p->currentTs
+         || (ev.GetTs () == p->currentTs && ev.GetUid () <= p->currentUid);
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  // XXX: I am fairly certain other compilers use other non-standard
+  // post-fixes to indicate 64 bit constants.
+  return TimeStep (MAX_TS);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  Partition *current = GetCurrentPartition ();
+  return current != 0 ? current->currentContext : 0xffffffff;
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookAhead (void) const
+{
+  return TimeStep (m_lookAhead);
+}
+
+bool
+MultithreadedSimulatorImpl::IsEnabled (void)
+{
+  return m_enabled;
+}
+
+} // namespace ns3
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-mutex.h"
+#include "ns3/ptr.h"
+
+#include <list>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief parallel simulator implementation using threads of one process
+ *
+ * Nodes are partitioned by system id, as for DistributedSimulatorImpl, but
+ * the partitions are simulated by a pool of threads of one process instead
+ * of MPI ranks. Each partition has its own event queue, clock and context.
+ * Time advances in windows as wide as the lookahead, the smallest delay of
+ * the channels connecting nodes of different partitions: every partition
+ * runs its events earlier than the end of the window, then the threads meet
+ * at a barrier and the events partitions scheduled for one another are
+ * delivered. The events for another partition are appended to a mailbox
+ * which only the sending partition writes during a window and only the
+ * receiving one reads after it, so that they need neither locks nor atomic
+ * operations.
+ *
+ * Events of a partition must only touch the objects of its nodes. Links
+ * between partitions must be remote channels, such as
+ * PointToPointRemoteChannel, which hand a private copy of each packet to
+ * the other side; the routing must be computed before the simulation
+ * starts, for example by global routing. Events scheduled without a node
+ * context belong to partition 0. Only Simulator::ScheduleWithContext
+ * schedules events for another partition, and it returns no EventId: an
+ * EventId is only cancelled, removed or checked by events of its own
+ * partition, which asserts it. Simulator::Stop (time) stops all
+ * partitions at the same time, before the events of that timestamp;
+ * Simulator::Stop () stops the calling partition at once and the others by
+ * the end of the window.
+ *
+ * Requires GCC-compatible thread-local storage and atomic builtins.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \returns the lookahead of the last run, zero before the first one
+   */
+  Time GetLookAhead (void) const;
+
+  /**
+   * \returns true while the simulator implementation is a
+   * MultithreadedSimulatorImpl, whose threads may run the events of nodes
+   * of different system ids at the same time
+   */
+  static bool IsEnabled (void);
+
+private:
+  // an event for another partition
+  struct Message
+  {
+    uint64_t ts;
+    uint32_t context;
+    EventImpl *event;
+  };
+
+  struct Partition
+  {
+    uint32_t id;
+    Ptr<Scheduler> events;
+    uint32_t uid;
+    uint32_t currentUid;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    // number of events inserted but not yet run, not counting the "destroy" events
+    int unscheduledEvents;
+    // events scheduled for other partitions during the current window, by destination
+    std::vector<std::vector<Message> > outbox;
+    // timestamp of the next event when the window starts
+    uint64_t nextTs;
+    // end of the current window: no message from another partition may arrive before it
+    uint64_t windowEnd;
+  };
+
+  struct Worker
+  {
+    MultithreadedSimulatorImpl *impl;
+    uint32_t index;
+  };
+
+  virtual void DoDispose (void);
+  /* Creates the partitions, or more of them, for the system ids of the nodes. */
+  void CreatePartitions (void);
+  void CalculateLookAhead (void);
+  uint32_t GetPartition (uint32_t context) const;
+  Partition *GetCurrentPartition (void) const;
+  /* Inserts an event into the queue of a partition and returns its uid. */
+  uint32_t Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event);
+  /* Inserts an event where it belongs: the pending events, a partition or a mailbox. */
+  uint32_t Enqueue (uint64_t ts, uint32_t context, EventImpl *event);
+  void ProcessOneEvent (Partition *partition);
+  /* Runs the partitions of one thread until the simulation stops. */
+  void RunPartitions (uint32_t worker);
+  static void DoRunWorker (Worker *worker);
+  void Barrier (void);
+
+  static bool m_enabled;
+
+  typedef std::list<EventId> DestroyEvents;
+
+  DestroyEvents m_destroyEvents;
+  mutable SystemMutex m_destroyMutex;
+  ObjectFactory m_schedulerFactory;
+  std::vector<Partition *> m_partitions;
+  // the partition of each node, by node id
+  std::vector<uint32_t> m_nodePartition;
+  // events scheduled before the partitions exist
+  std::vector<Scheduler::Event> m_pending;
+  uint32_t m_uid;
+  uint64_t m_currentTs;
+
+  uint32_t m_maxThreads;
+  uint32_t m_nThreads;
+  uint64_t m_lookAhead;
+  uint64_t m_stopTs;
+  volatile bool m_stop;
+
+  volatile uint32_t m_barrierWaiting;
+  volatile uint32_t m_barrierGeneration;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
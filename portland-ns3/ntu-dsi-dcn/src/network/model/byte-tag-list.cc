@@ -45,6 +45,30 @@ public:
 } g_freeList;
 static uint32_t g_maxSize = 0;
 
+// the threads of a multithreaded simulation share the free list: it is
+// only touched under a spin lock
+#if defined (__GNUC__)
+static volatile int g_freeListLock = 0;
+#endif
+
+static inline void
+LockFreeList (void)
+{
+#if defined (__GNUC__)
+  while (__sync_lock_test_and_set (&g_freeListLock, 1))
+    {
+    }
+#endif
+}
+
+static inline void
+UnlockFreeList (void)
+{
+#if defined (__GNUC__)
+  __sync_lock_release (&g_freeListLock);
+#endif
+}
+
 ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 {
   for (ByteTagListDataFreeList::iterator i = begin ();
@@ -339,6 +363,7 @@ struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
+  LockFreeList ();
   while (!g_freeList.empty ())
     {
       struct ByteTagListData *data = g_freeList.back ();
@@ -346,6 +371,7 @@ ByteTagList::Allocate (uint32_t size)
       NS_ASSERT (data != 0);
       if (data->size >= size)
         {
+          UnlockFreeList ();
           data->count = 1;
           data->dirty = 0;
           return data;
@@ -353,7 +379,9 @@ ByteTagList::Allocate (uint32_t size)
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
+  uint32_t maxSize = g_maxSize;
+  UnlockFreeList ();
+  uint8_t *buffer = new uint8_t [std::max (size, maxSize) + sizeof (struct ByteTagListData) - 4];
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
   data->size = size;
@@ -369,6 +397,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
+  LockFreeList ();
   g_maxSize = std::max (g_maxSize, data->size);
   data->count--;
   if (data->count == 0)
@@ -384,6 +413,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
           g_freeList.push_back (data);
         }
     }
+  UnlockFreeList ();
 }
 
 #else /* USE_FREE_LIST */
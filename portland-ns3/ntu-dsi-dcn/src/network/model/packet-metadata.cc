@@ -36,6 +36,7 @@ bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
+volatile int PacketMetadata::m_freeListLock = 0;
 PacketMetadata::DataFreeList PacketMetadata::m_freeList;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
@@ -562,9 +563,43 @@ PacketMetadata::ReadItems (uint16_t current,
   return buffer - &m_data->m_data[current];
 }
 
+void
+PacketMetadata::LockFreeList (void)
+{
+#if defined (__GNUC__)
+  while (__sync_lock_test_and_set (&m_freeListLock, 1))
+    {
+    }
+#endif
+}
+
+void
+PacketMetadata::UnlockFreeList (void)
+{
+#if defined (__GNUC__)
+  __sync_lock_release (&m_freeListLock);
+#endif
+}
+
+uint16_t
+PacketMetadata::AllocateChunkUid (void)
+{
+#if defined (__GNUC__)
+  return __sync_fetch_and_add (&m_chunkUid, 1);
+#else
+  return m_chunkUid++;
+#endif
+}
+
 struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
+  if (!m_enable)
+    {
+      // nothing is recycled, nor ever grows, while metadata is disabled
+      return PacketMetadata::Allocate (size);
+    }
+  LockFreeList ();
   NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
   if (size > m_maxSize)
     {
@@ -576,6 +611,7 @@ PacketMetadata::Create (uint32_t size)
       m_freeList.pop_back ();
       if (data->m_size >= size) 
         {
+          UnlockFreeList ();
           NS_LOG_LOGIC ("create found size="<<data->m_size);
           data->m_count = 1;
           return data;
@@ -583,8 +619,10 @@ PacketMetadata::Create (uint32_t size)
       PacketMetadata::Deallocate (data);
       NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
+  uint32_t maxSize = m_maxSize;
+  UnlockFreeList ();
+  NS_LOG_LOGIC ("create alloc size="<<maxSize);
+  return PacketMetadata::Allocate (maxSize);
 }
 
 void
@@ -595,8 +633,9 @@ PacketMetadata::Recycle (struct PacketMetadata::Data *data)
       PacketMetadata::Deallocate (data);
       return;
     } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
   NS_ASSERT (data->m_count == 0);
+  LockFreeList ();
+  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
   if (m_freeList.size () > 1000 ||
       data->m_size < m_maxSize) 
     {
@@ -606,6 +645,7 @@ PacketMetadata::Recycle (struct PacketMetadata::Data *data)
     {
       m_freeList.push_back (data);
     }
+  UnlockFreeList ();
 }
 
 struct PacketMetadata::Data *
@@ -664,8 +704,7 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
   item.prev = 0xffff;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = AllocateChunkUid ();
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
 }
@@ -733,8 +772,7 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = AllocateChunkUid ();
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
   NS_ASSERT (IsStateOk ());
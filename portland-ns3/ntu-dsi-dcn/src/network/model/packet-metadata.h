@@ -324,6 +324,11 @@ public:
 
   static struct PacketMetadata::Data *Create (uint32_t size);
   static void Recycle (struct PacketMetadata::Data *data);
+  /* Lock and unlock the free list, which the threads of a multithreaded simulation share. */
+  static void LockFreeList (void);
+  static void UnlockFreeList (void);
+  /* Returns a new chunk uid; safe to call from several threads. */
+  static uint16_t AllocateChunkUid (void);
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
 
@@ -338,6 +343,7 @@ public:
 
   static uint32_t m_maxSize;
   static uint16_t m_chunkUid;
+  static volatile int m_freeListLock;
 
   struct Data *m_data;
   /**
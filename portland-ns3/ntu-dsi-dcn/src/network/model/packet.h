@@ -567,6 +567,9 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
+  /* Returns a new packet uid; safe to call from several threads. */
+  static uint32_t AllocateUid (void);
+
   static uint32_t m_globalUid;
 };
 
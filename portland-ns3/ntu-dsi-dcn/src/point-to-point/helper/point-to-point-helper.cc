@@ -238,7 +238,9 @@ PointToPointHelper::Install (Ptr<Node> a, Ptr<Node> b)
   devB->SetQueue (queueB);
   // If MPI is enabled, we need to see if both nodes have the same system id 
   // (rank), and the rank is the same as this instance.  If both are true, 
-  //use a normal p2p channel, otherwise use a remote channel
+  //use a normal p2p channel, otherwise use a remote channel.  Without MPI,
+  // nodes of different system ids belong to different partitions of a
+  // multithreaded simulation, which need a remote channel too
   bool useNormalChannel = true;
   Ptr<PointToPointChannel> channel = 0;
   if (MpiInterface::IsEnabled ())
@@ -251,6 +253,10 @@ PointToPointHelper::Install (Ptr<Node> a, Ptr<Node> b)
           useNormalChannel = false;
         }
     }
+  else if (a->GetSystemId () != b->GetSystemId ())
+    {
+      useNormalChannel = false;
+    }
   if (useNormalChannel)
     {
       channel = m_channelFactory.Create<PointToPointChannel> ();
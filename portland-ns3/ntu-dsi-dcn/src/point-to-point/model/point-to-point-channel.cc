@@ -76,6 +76,13 @@ PointToPointChannel::Attach (Ptr<PointToPointNetDevice> device)
       m_link[1].m_dst = m_link[0].m_src;
       m_link[0].m_state = IDLE;
       m_link[1].m_state = IDLE;
+      for (uint32_t i = 0; i < N_DEVICES; i++)
+        {
+          if (m_link[i].m_dst->GetNode () != 0)
+            {
+              m_link[i].m_dstNodeId = m_link[i].m_dst->GetNode ()->GetId ();
+            }
+        }
     }
 }
 
@@ -142,6 +149,29 @@ PointToPointChannel::GetDestination (uint32_t i) const
   return m_link[i].m_dst;
 }
 
+PointToPointNetDevice *
+PointToPointChannel::PeekSource (uint32_t i) const
+{
+  return PeekPointer (m_link[i].m_src);
+}
+
+PointToPointNetDevice *
+PointToPointChannel::PeekDestination (uint32_t i) const
+{
+  return PeekPointer (m_link[i].m_dst);
+}
+
+uint32_t
+PointToPointChannel::GetDestinationNodeId (uint32_t i) const
+{
+  if (m_link[i].m_dstNodeId == 0xffffffff)
+    {
+      // the device was attached to the channel before being added to its node
+      return m_link[i].m_dst->GetNode ()->GetId ();
+    }
+  return m_link[i].m_dstNodeId;
+}
+
 bool
 PointToPointChannel::IsInitialized (void) const
 {
@@ -121,6 +121,30 @@ protected:
    */
   Ptr<PointToPointNetDevice> GetDestination (uint32_t i) const;
 
+  /*
+   * \brief Get the net-device source without taking a reference to it
+   * \param i the link requested
+   * \returns pointer to PointToPointNetDevice source for the
+   * specified link
+   */
+  PointToPointNetDevice *PeekSource (uint32_t i) const;
+
+  /*
+   * \brief Get the net-device destination without taking a reference to it
+   * \param i the link requested
+   * \returns pointer to PointToPointNetDevice destination for
+   * the specified link
+   */
+  PointToPointNetDevice *PeekDestination (uint32_t i) const;
+
+  /*
+   * \brief Get the id of the node of the net-device destination
+   * \param i the link requested
+   * \returns the node id, known without touching the node, which may
+   * belong to another partition of a parallel simulation
+   */
+  uint32_t GetDestinationNodeId (uint32_t i) const;
+
 private:
   // Each point to point link has exactly two net devices
   static const int N_DEVICES = 2;
@@ -155,10 +179,11 @@ private:
   class Link
   {
 public:
-    Link() : m_state (INITIALIZING), m_src (0), m_dst (0) {}
+    Link() : m_state (INITIALIZING), m_src (0), m_dst (0), m_dstNodeId (0xffffffff) {}
     WireState                  m_state;
     Ptr<PointToPointNetDevice> m_src;
     Ptr<PointToPointNetDevice> m_dst;
+    uint32_t                   m_dstNodeId;
   };
 
   Link    m_link[N_DEVICES];
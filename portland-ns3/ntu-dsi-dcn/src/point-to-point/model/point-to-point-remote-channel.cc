@@ -64,16 +64,28 @@ PointToPointRemoteChannel::TransmitStart (
 
   IsInitialized ();
 
-  uint32_t wire = src == GetSource (0) ? 0 : 1;
-  Ptr<PointToPointNetDevice> dst = GetDestination (wire);
+  // raw pointers: the destination may belong to another thread, whose
+  // reference counts must not be touched
+  uint32_t wire = PeekPointer (src) == PeekSource (0) ? 0 : 1;
 
 #ifdef NS3_MPI
-  // Calculate the rxTime (absolute)
-  Time rxTime = Simulator::Now () + txTime + GetDelay ();
-  MpiInterface::SendPacket (p, rxTime, dst->GetNode ()->GetId (), dst->GetIfIndex ());
-#else
-  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+  if (MpiInterface::IsEnabled ())
+    {
+      // Calculate the rxTime (absolute)
+      Time rxTime = Simulator::Now () + txTime + GetDelay ();
+      MpiInterface::SendPacket (p, rxTime, GetDestinationNodeId (wire), PeekDestination (wire)->GetIfIndex ());
+      return true;
+    }
 #endif
+  // another partition of a multithreaded simulation: hand it a deep copy,
+  // as the buffer of the packet is shared by its copies
+  uint32_t size = p->GetSerializedSize ();
+  uint8_t *buffer = new uint8_t[size];
+  p->Serialize (buffer, size);
+  Ptr<Packet> copy = Create<Packet> (buffer, size, true);
+  delete [] buffer;
+  Simulator::ScheduleWithContext (GetDestinationNodeId (wire), txTime + GetDelay (),
+                                  &PointToPointNetDevice::Receive, PeekDestination (wire), copy);
   return true;
 }
 
@@ -3,6 +3,13 @@
 #include "ns3/simulator.h"
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/node-container.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/core-config.h"
+
+#include <vector>
 
 namespace ns3 {
 
@@ -56,6 +63,104 @@ PointToPointTest::DoRun (void)
   Simulator::Destroy ();
 }
 //-----------------------------------------------------------------------------
+#ifdef HAVE_PTHREAD_H
+/* A ring of four nodes in two partitions, whose nodes send packets to
+ * their neighbours, must receive the same packets at the same times with
+ * MultithreadedSimulatorImpl as with DefaultSimulatorImpl. */
+class PointToPointMultithreadedTest : public TestCase
+{
+public:
+  PointToPointMultithreadedTest ();
+
+  virtual void DoRun (void);
+
+private:
+  void RunRing (std::string simulatorType);
+  void SendOnePacket (Ptr<NetDevice> device);
+  bool Receive (Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &from);
+
+  // packets and sum of the reception times, by node
+  std::vector<uint32_t> m_received;
+  std::vector<uint64_t> m_receiveTimes;
+};
+
+PointToPointMultithreadedTest::PointToPointMultithreadedTest ()
+  : TestCase ("PointToPoint links between the partitions of a multithreaded simulation")
+{
+}
+
+void
+PointToPointMultithreadedTest::SendOnePacket (Ptr<NetDevice> device)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  device->Send (p, device->GetBroadcast (), 0x800);
+}
+
+bool
+PointToPointMultithreadedTest::Receive (Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &from)
+{
+  // each node is only touched by the thread of its partition
+  uint32_t node = device->GetNode ()->GetId ();
+  m_received[node]++;
+  m_receiveTimes[node] += Simulator::Now ().GetNanoSeconds ();
+  return true;
+}
+
+void
+PointToPointMultithreadedTest::RunRing (std::string simulatorType)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (simulatorType));
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      nodes.Add (CreateObject<Node> (i / 2));
+    }
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      p2p.Install (nodes.Get (i), nodes.Get ((i + 1) % 4));
+    }
+  m_received.assign (4, 0);
+  m_receiveTimes.assign (4, 0);
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      for (uint32_t d = 0; d < node->GetNDevices (); d++)
+        {
+          Ptr<NetDevice> device = node->GetDevice (d);
+          device->SetReceiveCallback (MakeCallback (&PointToPointMultithreadedTest::Receive, this));
+          for (uint32_t k = 0; k < 10; k++)
+            {
+              Simulator::ScheduleWithContext (node->GetId (), MicroSeconds (1000 * k + 100 * i),
+                                              &PointToPointMultithreadedTest::SendOnePacket, this, device);
+            }
+        }
+    }
+  Simulator::Stop (Seconds (1.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+PointToPointMultithreadedTest::DoRun (void)
+{
+  RunRing ("ns3::DefaultSimulatorImpl");
+  std::vector<uint32_t> received = m_received;
+  std::vector<uint64_t> receiveTimes = m_receiveTimes;
+
+  RunRing ("ns3::MultithreadedSimulatorImpl");
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (received[i], 20, "Node " << i << " lost packets");
+      NS_TEST_EXPECT_MSG_EQ (m_received[i], received[i], "Node " << i << " received other packets");
+      NS_TEST_EXPECT_MSG_EQ (m_receiveTimes[i], receiveTimes[i], "Node " << i << " received packets at other times");
+    }
+}
+#endif /* HAVE_PTHREAD_H */
+//-----------------------------------------------------------------------------
 class PointToPointTestSuite : public TestSuite
 {
 public:
@@ -66,6 +171,9 @@ PointToPointTestSuite::PointToPointTestSuite ()
   : TestSuite ("devices-point-to-point", UNIT)
 {
   AddTestCase (new PointToPointTest);
+#ifdef HAVE_PTHREAD_H
+  AddTestCase (new PointToPointMultithreadedTest);
+#endif
 }
 
 static PointToPointTestSuite g_pointToPointTestSuite;
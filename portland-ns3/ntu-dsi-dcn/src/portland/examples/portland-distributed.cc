@@ -0,0 +1,200 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * PortlandDistributed builds a k-ary PortLand fat tree of full-duplex CSMA
+ * links and splits it over the ranks of a distributed simulation with
+ * PortlandFatTreeHelper::SetSystemCount: pods are dealt out to the ranks
+ * in contiguous blocks and the core switches spread over them. The
+ * lookahead is the delay of the links to the core switches. Every rank
+ * runs a replica of the Fabric Manager, which is pre-warmed so that all
+ * replicas know every host from the start. Every host sends a constant
+ * bit rate UDP flow to the host at the same position in the next pod.
+ *
+ * Built with MPI (./waf configure --enable-mpi), run it with one process
+ * per rank, e.g. on one machine:
+ *
+ *   ./waf --run portland-distributed --command-template="mpirun -np 4 %s --k=8"
+ *
+ * Each rank then prints the bytes received by its hosts, and the MPI
+ * messages it sent with the packets for other ranks, per second of wall
+ * clock time. With --batch=1 the packets are batched per destination rank
+ * and synchronization round instead of sent in a message each (see
+ * DistributedSimulatorImpl::BatchMessages), so that the two modes are
+ * compared with
+ *
+ *   ./waf --run portland-distributed --command-template="mpirun -np 4 %s --k=8 --batch=0"
+ *   ./waf --run portland-distributed --command-template="mpirun -np 4 %s --k=8 --batch=1"
+ *
+ * Without MPI, or with --mpi=0, the partitioned tree runs in one process
+ * and --ranks sets the number of partitions, which gives the reference
+ * for the bytes received:
+ *
+ *   ./waf --run "portland-distributed --k=8 --ranks=4"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/packet-sink.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PortlandDistributed");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t k = 4;
+  uint32_t ranks = 1;
+  bool mpi = true;
+  bool batch = false;
+  double stop = 0.1;
+  std::string delay = "1us";
+
+  Config::SetDefault ("ns3::OnOffApplication::PacketSize", UintegerValue (1024));
+  Config::SetDefault ("ns3::OnOffApplication::DataRate", StringValue ("10Mbps"));
+
+  CommandLine cmd;
+  cmd.AddValue ("k", "Number of ports of the switches of the fat tree (even)", k);
+  cmd.AddValue ("ranks", "Number of partitions when not running under MPI", ranks);
+  cmd.AddValue ("mpi", "Run distributed when MPI is available", mpi);
+  cmd.AddValue ("batch", "Batch the packets for each rank over each synchronization round", batch);
+  cmd.AddValue ("stop", "Simulated time, in seconds", stop);
+  cmd.AddValue ("delay", "Delay of the links, which is the lookahead", delay);
+  cmd.Parse (argc, argv);
+
+  uint32_t systemId = 0;
+  bool distributed = false;
+#ifdef NS3_MPI
+  if (mpi)
+    {
+      MpiInterface::Enable (&argc, &argv);
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue ("ns3::DistributedSimulatorImpl"));
+      Config::SetDefault ("ns3::DistributedSimulatorImpl::BatchMessages", BooleanValue (batch));
+      systemId = MpiInterface::GetSystemId ();
+      ranks = MpiInterface::GetSize ();
+      distributed = true;
+    }
+#endif
+
+  if (k < 2 || k % 2 != 0 || ranks == 0 || ranks > k)
+    {
+      std::cout << "k must be even and at least the number of ranks." << std::endl;
+      return 1;
+    }
+
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetFullDuplex (true);
+  fatTree.SetSystemCount (ranks);
+  fatTree.SetChannelAttribute ("DataRate", StringValue ("1Gbps"));
+  fatTree.SetChannelAttribute ("Delay", StringValue (delay));
+  Ptr<pld::FabricManager> fabricManager = CreateObject<pld::FabricManager> ();
+  fatTree.Install (fabricManager);
+  fatTree.Prewarm ();
+
+  uint32_t half = k / 2;
+  if (systemId == 0)
+    {
+      std::cout << "k=" << k << " hosts=" << fatTree.GetNHosts () << " ranks=" << ranks
+                << (distributed ? " distributed" : " sequential")
+                << " cut links=" << fatTree.GetNCutLinks () << " lookahead=" << delay << std::endl;
+      for (uint32_t rank = 0; rank < ranks; rank++)
+        {
+          uint32_t pods = 0, cores = 0;
+          for (uint32_t pod = 0; pod < k; pod++)
+            {
+              pods += fatTree.GetPodSystemId (pod) == rank;
+            }
+          for (uint32_t c = 0; c < half * half; c++)
+            {
+              cores += fatTree.GetCoreSystemId (c / half, c % half) == rank;
+            }
+          std::cout << "rank " << rank << ": " << pods << " pods, " << pods * half * half << " hosts, "
+                    << cores << " core switches" << std::endl;
+        }
+    }
+
+  // applications only run on the hosts of this rank
+  uint16_t port = 50000;
+  PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  OnOffHelper clientHelper ("ns3::UdpSocketFactory", Address ());
+  clientHelper.SetAttribute ("OnTime", RandomVariableValue (ConstantVariable (1)));
+  clientHelper.SetAttribute ("OffTime", RandomVariableValue (ConstantVariable (0)));
+  ApplicationContainer sinkApps;
+  for (uint32_t pod = 0; pod < k; pod++)
+    {
+      if (distributed && fatTree.GetPodSystemId (pod) != systemId)
+        {
+          continue;
+        }
+      for (uint32_t e = 0; e < half; e++)
+        {
+          for (uint32_t h = 0; h < half; h++)
+            {
+              sinkApps.Add (sinkHelper.Install (fatTree.GetHost (pod, e, h)));
+              Ipv4Address dst = fatTree.GetHostAddress ((pod + 1) % k, e, h);
+              clientHelper.SetAttribute ("Remote", AddressValue (InetSocketAddress (dst, port)));
+              ApplicationContainer app = clientHelper.Install (fatTree.GetHost (pod, e, h));
+              // spread the starts so that the flows do not send in lockstep
+              app.Start (MicroSeconds (100 + 7 * ((pod * half + e) * half + h)));
+            }
+        }
+    }
+  sinkApps.Start (Seconds (0.0));
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Stop (Seconds (stop));
+  Simulator::Run ();
+  int64_t ms = clock.End ();
+
+  uint64_t rx = 0;
+  for (uint32_t i = 0; i < sinkApps.GetN (); i++)
+    {
+      rx += DynamicCast<PacketSink> (sinkApps.Get (i))->GetTotalRx ();
+    }
+  if (distributed)
+    {
+      std::cout << "rank " << systemId << ": ";
+    }
+  std::cout << "received " << rx << " bytes, wall clock " << ms << " ms";
+#ifdef NS3_MPI
+  if (distributed)
+    {
+      uint32_t messages = MpiInterface::GetTxCount () + MpiInterface::GetTxBatchCount ();
+      uint32_t packets = MpiInterface::GetTxCount () + MpiInterface::GetTxBatchedCount ();
+      std::cout << ", sent " << packets << " packets in " << messages << " MPI messages ("
+                << (batch ? "batched" : "per packet") << "), "
+                << (ms > 0 ? messages * 1000.0 / ms : 0) << " messages/s";
+    }
+#endif
+  std::cout << std::endl;
+
+  Simulator::Destroy ();
+#ifdef NS3_MPI
+  if (distributed)
+    {
+      MpiInterface::Disable ();
+    }
+#endif
+  return 0;
+}
@@ -0,0 +1,851 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-fat-tree-helper.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/node.h"
+#include "ns3/ipv4.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/string.h"
+#include "ns3/csma-net-device.h"
+#include "ns3/csma-channel.h"
+#include "ns3/arp-header.h"
+#include "ns3/arp-l3-protocol.h"
+#include "ns3/error-model.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/arp-cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <sys/resource.h>
+
+NS_LOG_COMPONENT_DEFINE ("PortlandFatTreeHelper");
+
+namespace ns3 {
+
+PortlandFatTreeHelper::PortlandFatTreeHelper (uint32_t k)
+  : m_k (k),
+    m_systemCount (1),
+    m_network ("10.1.0.0"),
+    m_mask ("255.255.0.0"),
+    m_locationDiscovery (false),
+    m_linkMonitoring (false),
+    m_sharedBuffers (false),
+    m_setupTime (0),
+    m_peakMemory (0)
+{
+  NS_ASSERT_MSG (k >= 2 && k % 2 == 0, "A fat tree needs an even number of ports per switch");
+  NS_ABORT_MSG_IF (k - 1 > pld::PMAC::MAX_POD || k / 2 - 1 > pld::PMAC::MAX_POSITION || k / 2 - 1 > pld::PMAC::MAX_PORT,
+                   "A fat tree of k=" << k << " does not fit in the PMAC layout");
+  m_bufferFactory.SetTypeId ("ns3::pld::SharedBuffer");
+  m_channelFactory.SetTypeId ("ns3::CsmaChannel");
+  SetSystemCount (1);
+}
+
+
+void
+PortlandFatTreeHelper::SetChannelAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_channelFactory.Set (n1, v1);
+}
+
+
+void
+PortlandFatTreeHelper::SetFullDuplex (bool full_duplex)
+{
+  NS_ABORT_MSG_IF (!full_duplex && m_systemCount > 1, "Only full-duplex links may connect nodes of different system ids");
+  m_channelFactory.SetTypeId (full_duplex ? "ns3::CsmaFullDuplexChannel" : "ns3::CsmaChannel");
+}
+
+
+void
+PortlandFatTreeHelper::SetSystemCount (uint32_t n)
+{
+  NS_ASSERT_MSG (m_hosts.empty (), "Fat tree already installed");
+  NS_ABORT_MSG_IF (n == 0 || n > m_k, "A k=" << m_k << " fat tree cannot be split over " << n << " system ids");
+  m_systemCount = n;
+  if (n > 1)
+    {
+      SetFullDuplex (true);
+    }
+
+  uint32_t half = m_k / 2;
+  std::vector<uint32_t> pods (n, 0), switches (n, 0);
+  m_podSystemIds.resize (m_k);
+  for (uint32_t pod = 0; pod < m_k; pod++)
+    {
+      m_podSystemIds[pod] = pod * n / m_k;
+      pods[m_podSystemIds[pod]]++;
+      switches[m_podSystemIds[pod]] += m_k;
+    }
+  // a core switch has a link to every pod, of which the pods of its own system id are not cut
+  m_coreSystemIds.resize (half * half);
+  for (uint32_t c = 0; c < half * half; c++)
+    {
+      uint32_t best = 0;
+      for (uint32_t id = 1; id < n; id++)
+        {
+          if (switches[id] < switches[best] || (switches[id] == switches[best] && pods[id] > pods[best]))
+            {
+              best = id;
+            }
+        }
+      m_coreSystemIds[c] = best;
+      switches[best]++;
+    }
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetSystemCount (void) const
+{
+  return m_systemCount;
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetPodSystemId (uint32_t pod) const
+{
+  NS_ASSERT (pod < m_k);
+  return m_podSystemIds[pod];
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetCoreSystemId (uint32_t group, uint32_t position) const
+{
+  NS_ASSERT (group < m_k / 2 && position < m_k / 2);
+  return m_coreSystemIds[group * m_k / 2 + position];
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetNCutLinks (void) const
+{
+  uint32_t cut = 0;
+  for (uint32_t c = 0; c < m_coreSystemIds.size (); c++)
+    {
+      for (uint32_t pod = 0; pod < m_k; pod++)
+        {
+          cut += m_coreSystemIds[c] != m_podSystemIds[pod];
+        }
+    }
+  return cut;
+}
+
+
+void
+PortlandFatTreeHelper::SetSwitchAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_switchHelper.SetDeviceAttribute (n1, v1);
+}
+
+
+void
+PortlandFatTreeHelper::SetIpv4Base (Ipv4Address network, Ipv4Mask mask)
+{
+  m_network = network;
+  m_mask = mask;
+}
+
+
+void
+PortlandFatTreeHelper::SetLocationDiscovery (bool discover)
+{
+  m_locationDiscovery = discover;
+}
+
+
+void
+PortlandFatTreeHelper::SetLinkMonitoring (bool monitor)
+{
+  m_linkMonitoring = monitor;
+}
+
+
+void
+PortlandFatTreeHelper::SetSharedBuffers (bool shared)
+{
+  m_sharedBuffers = shared;
+}
+
+
+void
+PortlandFatTreeHelper::SetSharedBufferAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_bufferFactory.Set (n1, v1);
+}
+
+
+void
+PortlandFatTreeHelper::Install (Ptr<pld::FabricManager> fabric_manager)
+{
+  m_fabricManager = fabric_manager;
+  DoInstall (fabric_manager);
+}
+
+
+void
+PortlandFatTreeHelper::Install (Ptr<pld::FabricManagerCluster> cluster)
+{
+  m_cluster = cluster;
+  DoInstall (cluster);
+}
+
+
+/*
+ * A replica of the Fabric Manager of an MPI run misses every host of the other ranks, and its switches drop the
+ * packets held for it, unless the tree was pre-warmed.
+ */
+template <typename T>
+static void
+CheckPrewarmed (Ptr<T> fabric_manager, uint32_t n_hosts)
+{
+  NS_ABORT_MSG_IF (fabric_manager->GetNHosts () < n_hosts,
+                   "A fat tree partitioned over MPI ranks must be pre-warmed with PortlandFatTreeHelper::Prewarm ()");
+}
+
+
+/*
+ * Creates the nodes and links layer by layer, then the switches, then the host stacks. Port devices are
+ * collected per switch in pre-sized containers so that each switch is installed with all its ports at once.
+ */
+template <typename T>
+void
+PortlandFatTreeHelper::DoInstall (Ptr<T> fabric_manager)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_ASSERT_MSG (m_hosts.empty (), "Fat tree already installed");
+
+  SystemWallClockMs clock;
+  clock.Start ();
+
+  uint32_t half = m_k / 2;
+  uint32_t n_pod_switches = m_k * half;
+  uint32_t n_cores = half * half;
+  uint32_t n_hosts = n_pod_switches * half;
+
+  // nodes are created cores first, then aggregation and edge switches, then hosts
+  NodeContainer cores, aggregations, edges, hosts;
+  for (uint32_t c = 0; c < n_cores; c++)
+    {
+      cores.Create (1, m_coreSystemIds[c]);
+    }
+  for (uint32_t pod = 0; pod < m_k; pod++)
+    {
+      aggregations.Create (half, m_podSystemIds[pod]);
+    }
+  for (uint32_t pod = 0; pod < m_k; pod++)
+    {
+      edges.Create (half, m_podSystemIds[pod]);
+    }
+  for (uint32_t pod = 0; pod < m_k; pod++)
+    {
+      hosts.Create (half * half, m_podSystemIds[pod]);
+    }
+
+  std::vector<NetDeviceContainer> edge_lower (n_pod_switches), edge_upper (n_pod_switches);
+  std::vector<NetDeviceContainer> agg_lower (n_pod_switches), agg_upper (n_pod_switches);
+  std::vector<NetDeviceContainer> core_lower (n_cores);
+  NetDeviceContainer host_devices;
+
+  // host h of edge switch e in pod p is host (p * k/2 + e) * k/2 + h
+  for (uint32_t e = 0; e < n_pod_switches; e++)
+    {
+      for (uint32_t h = 0; h < half; h++)
+        {
+          NetDeviceContainer link = m_csma.Install (NodeContainer (hosts.Get (e * half + h), edges.Get (e)),
+                                                    m_channelFactory.Create<CsmaChannel> ());
+          host_devices.Add (link.Get (0));
+          edge_lower[e].Add (link.Get (1));
+        }
+    }
+
+  // upper port j of edge switch e in pod p connects to aggregation switch j of the pod
+  for (uint32_t pod = 0; pod < m_k; pod++)
+    {
+      for (uint32_t j = 0; j < half; j++)
+        {
+          uint32_t a = pod * half + j;
+          for (uint32_t e = 0; e < half; e++)
+            {
+              NetDeviceContainer link = m_csma.Install (NodeContainer (edges.Get (pod * half + e), aggregations.Get (a)),
+                                                        m_channelFactory.Create<CsmaChannel> ());
+              edge_upper[pod * half + e].Add (link.Get (0));
+              agg_lower[a].Add (link.Get (1));
+            }
+        }
+    }
+
+  // upper port j of aggregation switch i in every pod connects to core j of group i
+  for (uint32_t group = 0; group < half; group++)
+    {
+      for (uint32_t j = 0; j < half; j++)
+        {
+          uint32_t c = group * half + j;
+          for (uint32_t pod = 0; pod < m_k; pod++)
+            {
+              NetDeviceContainer link = m_csma.Install (NodeContainer (aggregations.Get (pod * half + group), cores.Get (c)),
+                                                        m_channelFactory.Create<CsmaChannel> ());
+              agg_upper[pod * half + group].Add (link.Get (0));
+              core_lower[c].Add (link.Get (1));
+            }
+        }
+    }
+
+  // the switches take the queues of their ports as they are installed
+  if (m_sharedBuffers)
+    {
+      for (uint32_t s = 0; s < n_pod_switches; s++)
+        {
+          InstallSharedBuffer (edges.Get (s));
+          InstallSharedBuffer (aggregations.Get (s));
+        }
+      for (uint32_t c = 0; c < n_cores; c++)
+        {
+          InstallSharedBuffer (cores.Get (c));
+        }
+    }
+
+  m_edges.reserve (n_pod_switches);
+  m_aggregations.reserve (n_pod_switches);
+  m_cores.reserve (n_cores);
+  for (uint32_t s = 0; s < n_pod_switches; s++)
+    {
+      NetDeviceContainer dev = (m_locationDiscovery
+                                ? m_switchHelper.Install (edges.Get (s), NetDeviceContainer (edge_upper[s], edge_lower[s]), fabric_manager)
+                                : m_switchHelper.Install (edges.Get (s), edge_lower[s], edge_upper[s], fabric_manager,
+                                                          EDGE, s / half, s % half));
+      m_edges.push_back (DynamicCast<PortlandSwitchNetDevice> (dev.Get (0)));
+    }
+  for (uint32_t s = 0; s < n_pod_switches; s++)
+    {
+      NetDeviceContainer dev = (m_locationDiscovery
+                                ? m_switchHelper.Install (aggregations.Get (s), NetDeviceContainer (agg_upper[s], agg_lower[s]), fabric_manager)
+                                : m_switchHelper.Install (aggregations.Get (s), agg_lower[s], agg_upper[s], fabric_manager,
+                                                          AGGREGATION, s / half, s % half));
+      m_aggregations.push_back (DynamicCast<PortlandSwitchNetDevice> (dev.Get (0)));
+    }
+  for (uint32_t c = 0; c < n_cores; c++)
+    {
+      NetDeviceContainer dev = (m_locationDiscovery
+                                ? m_switchHelper.Install (cores.Get (c), core_lower[c], fabric_manager)
+                                : m_switchHelper.Install (cores.Get (c), core_lower[c], NetDeviceContainer (), fabric_manager,
+                                                          CORE, c / half, c % half));
+      m_cores.push_back (DynamicCast<PortlandSwitchNetDevice> (dev.Get (0)));
+    }
+
+  if (m_linkMonitoring && !m_locationDiscovery)
+    {
+      for (uint32_t s = 0; s < n_pod_switches; s++)
+        {
+          m_edges[s]->StartLinkMonitoring ();
+          m_aggregations[s]->StartLinkMonitoring ();
+        }
+      for (uint32_t c = 0; c < n_cores; c++)
+        {
+          m_cores[c]->StartLinkMonitoring ();
+        }
+    }
+
+  InternetStackHelper internet;
+  internet.Install (hosts);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase (m_network, m_mask);
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (host_devices);
+
+  m_hosts.reserve (n_hosts);
+  m_hostAddresses.reserve (n_hosts);
+  Ipv4StaticRoutingHelper static_routing;
+  for (uint32_t h = 0; h < n_hosts; h++)
+    {
+      m_hosts.push_back (hosts.Get (h));
+      m_hostAddresses.push_back (interfaces.GetAddress (h));
+      // multicast goes out of the host's only NIC, to its edge switch
+      Ptr<Ipv4> ipv4 = hosts.Get (h)->GetObject<Ipv4> ();
+      static_routing.GetStaticRouting (ipv4)->SetDefaultMulticastRoute (ipv4->GetInterfaceForDevice (host_devices.Get (h)));
+    }
+
+  if (m_systemCount > 1 && MpiInterface::IsEnabled ())
+    {
+      Simulator::Schedule (Seconds (0), &CheckPrewarmed<T>, fabric_manager, n_hosts);
+    }
+
+  m_setupTime = clock.End ();
+  m_peakMemory = GetPeakResidentMemory ();
+  NS_LOG_INFO ("Built k=" << m_k << " fat tree in " << m_setupTime << " ms, peak memory " << m_peakMemory << " bytes");
+}
+
+
+void
+PortlandFatTreeHelper::InstallSharedBuffer (Ptr<Node> node)
+{
+  Ptr<pld::SharedBuffer> buffer = m_bufferFactory.Create<pld::SharedBuffer> ();
+  for (uint32_t d = 0; d < node->GetNDevices (); d++)
+    {
+      Ptr<CsmaNetDevice> device = DynamicCast<CsmaNetDevice> (node->GetDevice (d));
+      NS_ASSERT_MSG (device != 0, "Switch port is not a CsmaNetDevice");
+      Ptr<pld::SharedBufferQueue> queue = CreateObject<pld::SharedBufferQueue> ();
+      queue->SetBuffer (buffer);
+      device->SetQueue (queue);
+    }
+}
+
+
+uint64_t
+PortlandFatTreeHelper::GetPeakResidentMemory (void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    {
+      return 0;
+    }
+  // ru_maxrss is in kilobytes
+  return (uint64_t) usage.ru_maxrss * 1024;
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetK (void) const
+{
+  return m_k;
+}
+
+
+uint32_t
+PortlandFatTreeHelper::GetNHosts (void) const
+{
+  return m_hosts.size ();
+}
+
+
+NodeContainer
+PortlandFatTreeHelper::GetHosts (void) const
+{
+  NodeContainer hosts;
+  for (uint32_t h = 0; h < m_hosts.size (); h++)
+    {
+      hosts.Add (m_hosts[h]);
+    }
+  return hosts;
+}
+
+
+Ptr<Node>
+PortlandFatTreeHelper::GetHost (uint32_t pod, uint32_t edge, uint32_t host) const
+{
+  return m_hosts[(pod * (m_k / 2) + edge) * (m_k / 2) + host];
+}
+
+
+Ipv4Address
+PortlandFatTreeHelper::GetHostAddress (uint32_t pod, uint32_t edge, uint32_t host) const
+{
+  return m_hostAddresses[(pod * (m_k / 2) + edge) * (m_k / 2) + host];
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+PortlandFatTreeHelper::GetEdgeSwitch (uint32_t pod, uint32_t position) const
+{
+  return m_edges[pod * (m_k / 2) + position];
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+PortlandFatTreeHelper::GetAggregationSwitch (uint32_t pod, uint32_t position) const
+{
+  return m_aggregations[pod * (m_k / 2) + position];
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+PortlandFatTreeHelper::GetCoreSwitch (uint32_t group, uint32_t position) const
+{
+  return m_cores[group * (m_k / 2) + position];
+}
+
+
+Ptr<pld::PortStatsSampler>
+PortlandFatTreeHelper::EnablePortStats (std::string file_name, Time interval) const
+{
+  Ptr<pld::PortStatsSampler> sampler = CreateObject<pld::PortStatsSampler> ();
+  sampler->SetAttribute ("FileName", StringValue (file_name));
+  sampler->SetAttribute ("Interval", TimeValue (interval));
+  for (uint32_t s = 0; s < m_edges.size (); s++)
+    {
+      sampler->AddSwitch (m_edges[s]);
+    }
+  for (uint32_t s = 0; s < m_aggregations.size (); s++)
+    {
+      sampler->AddSwitch (m_aggregations[s]);
+    }
+  for (uint32_t s = 0; s < m_cores.size (); s++)
+    {
+      sampler->AddSwitch (m_cores[s]);
+    }
+  sampler->Start ();
+  return sampler;
+}
+
+
+int64_t
+PortlandFatTreeHelper::GetSetupTime (void) const
+{
+  return m_setupTime;
+}
+
+
+uint64_t
+PortlandFatTreeHelper::GetPeakMemory (void) const
+{
+  return m_peakMemory;
+}
+
+
+static Ptr<CsmaNetDevice>
+GetCsmaDevice (Ptr<Node> node)
+{
+  for (uint32_t i = 0; i < node->GetNDevices (); i++)
+    {
+      Ptr<CsmaNetDevice> dev = DynamicCast<CsmaNetDevice> (node->GetDevice (i));
+      if (dev != 0)
+        {
+          return dev;
+        }
+    }
+  return 0;
+}
+
+
+void
+PortlandFatTreeHelper::MigrateHost (Ptr<Node> host, Ptr<Node> next_to)
+{
+  Ptr<CsmaNetDevice> dev = GetCsmaDevice (host);
+  Ptr<CsmaNetDevice> peer = GetCsmaDevice (next_to);
+  NS_ASSERT_MSG (dev != 0 && peer != 0, "Hosts must have a CSMA NIC");
+  Ptr<CsmaChannel> from = DynamicCast<CsmaChannel> (dev->GetChannel ());
+  Ptr<CsmaChannel> to = DynamicCast<CsmaChannel> (peer->GetChannel ());
+
+  if (!from->Detach (dev))
+    {
+      // the NIC is transmitting; try again shortly
+      Simulator::Schedule (MicroSeconds (1), &PortlandFatTreeHelper::MigrateHost, host, next_to);
+      return;
+    }
+  dev->Attach (to);
+  NS_LOG_INFO ("Host " << host->GetId () << " moved next to host " << next_to->GetId ());
+  AnnounceHost (host);
+}
+
+
+void
+PortlandFatTreeHelper::AnnounceHost (Ptr<Node> host)
+{
+  Ptr<CsmaNetDevice> dev = GetCsmaDevice (host);
+  NS_ASSERT_MSG (dev != 0, "Hosts must have a CSMA NIC");
+  Ptr<Ipv4> ipv4 = host->GetObject<Ipv4> ();
+  Ipv4Address ip = ipv4->GetAddress (ipv4->GetInterfaceForDevice (dev), 0).GetLocal ();
+  ArpHeader arp;
+  arp.SetRequest (dev->GetAddress (), ip, Mac48Address::GetBroadcast (), ip);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (arp);
+  dev->Send (packet, dev->GetBroadcast (), ArpL3Protocol::PROT_NUMBER);
+}
+
+
+/*
+ * Sends an IGMPv2 message from a host to its edge switch: Membership Reports go to the group, Leave Group
+ * messages to the all-routers group, as in RFC 2236.
+ */
+static void
+SendIgmp (Ptr<Node> host, Ipv4Address group, uint8_t type)
+{
+  Ptr<CsmaNetDevice> dev = GetCsmaDevice (host);
+  NS_ASSERT_MSG (dev != 0, "Hosts must have a CSMA NIC");
+  NS_ASSERT_MSG (group.IsMulticast (), "Not a multicast group: " << group);
+  Ptr<Ipv4> ipv4 = host->GetObject<Ipv4> ();
+  Ipv4Address ip = ipv4->GetAddress (ipv4->GetInterfaceForDevice (dev), 0).GetLocal ();
+  Ipv4Address dst = (type == pld::IgmpHeader::LEAVE_GROUP ? Ipv4Address ("224.0.0.2") : group);
+
+  pld::IgmpHeader igmp;
+  igmp.SetType (type);
+  igmp.SetGroup (group);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (igmp);
+  Ipv4Header ip_hd;
+  ip_hd.SetSource (ip);
+  ip_hd.SetDestination (dst);
+  ip_hd.SetProtocol (pld::IgmpHeader::PROT_NUMBER);
+  ip_hd.SetTtl (1);
+  ip_hd.SetPayloadSize (igmp.GetSerializedSize ());
+  packet->AddHeader (ip_hd);
+  dev->Send (packet, dev->GetMulticast (dst), Ipv4L3Protocol::PROT_NUMBER);
+}
+
+
+void
+PortlandFatTreeHelper::JoinGroup (Ptr<Node> host, Ipv4Address group)
+{
+  SendIgmp (host, group, pld::IgmpHeader::MEMBERSHIP_REPORT);
+}
+
+
+void
+PortlandFatTreeHelper::LeaveGroup (Ptr<Node> host, Ipv4Address group)
+{
+  SendIgmp (host, group, pld::IgmpHeader::LEAVE_GROUP);
+}
+
+
+void
+PortlandFatTreeHelper::FailLink (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b)
+{
+  Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+  em->SetUnit (EU_PKT);
+  em->SetRate (1);
+  SetLinkErrorModel (a, b, em);
+}
+
+
+void
+PortlandFatTreeHelper::RestoreLink (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b)
+{
+  SetLinkErrorModel (a, b, 0);
+}
+
+
+void
+PortlandFatTreeHelper::SetLinkErrorModel (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b, Ptr<ErrorModel> em)
+{
+  Ptr<Node> node = a->GetNode ();
+  Ptr<Node> peer = b->GetNode ();
+  for (uint32_t i = 0; i < node->GetNDevices (); i++)
+    {
+      Ptr<CsmaNetDevice> dev = DynamicCast<CsmaNetDevice> (node->GetDevice (i));
+      if (dev == 0)
+        {
+          continue;
+        }
+      Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel> (dev->GetChannel ());
+      for (uint32_t j = 0; j < channel->GetNDevices (); j++)
+        {
+          Ptr<CsmaNetDevice> other = channel->GetCsmaDevice (j);
+          if (other->GetNode () == peer)
+            {
+              dev->SetReceiveErrorModel (em);
+              other->SetReceiveErrorModel (em);
+              return;
+            }
+        }
+    }
+  NS_FATAL_ERROR ("Switches are not linked");
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+PortlandFatTreeHelper::GetEdgePort (Ptr<Node> host, uint32_t& port)
+{
+  Ptr<CsmaNetDevice> dev = GetCsmaDevice (host);
+  NS_ASSERT_MSG (dev != 0, "Hosts must have a CSMA NIC");
+  Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel> (dev->GetChannel ());
+  for (uint32_t i = 0; i < channel->GetNDevices (); i++)
+    {
+      Ptr<CsmaNetDevice> other = channel->GetCsmaDevice (i);
+      Ptr<Node> node = other->GetNode ();
+      for (uint32_t d = 0; d < node->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> edge = DynamicCast<PortlandSwitchNetDevice> (node->GetDevice (d));
+          if (edge == 0)
+            {
+              continue;
+            }
+          for (port = 0; port < edge->GetNSwitchPorts () - edge->GetNUpperPorts (); port++)
+            {
+              if (edge->GetSwitchPort (port).netdev == other)
+                {
+                  return edge;
+                }
+            }
+        }
+    }
+  NS_FATAL_ERROR ("Host " << host->GetId () << " is not plugged into an edge switch");
+  return 0;
+}
+
+
+void
+PortlandFatTreeHelper::Prewarm (void)
+{
+  std::vector<HostState> hosts (m_hosts.size ());
+  for (uint32_t h = 0; h < m_hosts.size (); h++)
+    {
+      hosts[h].edge = GetEdgePort (m_hosts[h], hosts[h].port);
+      hosts[h].amac = Mac48Address::ConvertFrom (GetCsmaDevice (m_hosts[h])->GetAddress ());
+    }
+  DoPrewarm (hosts);
+}
+
+
+/*
+ * The whole snapshot is checked against the tree before anything is pre-warmed: every host must be plugged into
+ * the edge switch port its PMAC names. Hosts are known by their IP Address; their actual MAC addresses may differ
+ * from the run that wrote the snapshot.
+ */
+bool
+PortlandFatTreeHelper::Prewarm (std::string snapshot)
+{
+  std::ifstream file (snapshot.c_str ());
+  if (!file)
+    {
+      NS_LOG_WARN ("Cannot read snapshot " << snapshot);
+      return false;
+    }
+
+  std::map<Ipv4Address, uint32_t> index;
+  for (uint32_t h = 0; h < m_hostAddresses.size (); h++)
+    {
+      index[m_hostAddresses[h]] = h;
+    }
+
+  std::vector<HostState> hosts (m_hosts.size ());
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      std::istringstream fields (line);
+      std::string ip, pmac;
+      if (!(fields >> ip >> pmac) || pmac.size () != 17)
+        {
+          NS_LOG_WARN ("Malformed snapshot line: " << line);
+          return false;
+        }
+      std::map<Ipv4Address, uint32_t>::iterator h = index.find (Ipv4Address (ip.c_str ()));
+      if (h == index.end ())
+        {
+          NS_LOG_WARN ("No host has the address " << ip);
+          return false;
+        }
+      HostState& host = hosts[h->second];
+      host.edge = GetEdgePort (m_hosts[h->second], host.port);
+      host.amac = Mac48Address::ConvertFrom (GetCsmaDevice (m_hosts[h->second])->GetAddress ());
+      host.pmac = Mac48Address (pmac.c_str ());
+      if (host.edge->GetPod () != pld::PMAC::GetPod (host.pmac)
+          || host.edge->GetPosition () != pld::PMAC::GetPosition (host.pmac)
+          || host.port != pld::PMAC::GetPort (host.pmac))
+        {
+          NS_LOG_WARN ("Host " << ip << " of the snapshot is not where it was in this tree");
+          return false;
+        }
+    }
+  DoPrewarm (hosts);
+  return true;
+}
+
+
+void
+PortlandFatTreeHelper::DoPrewarm (std::vector<HostState>& hosts)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  std::vector<std::pair<Ipv4Address, Mac48Address> > mappings;
+  mappings.reserve (hosts.size ());
+  for (uint32_t h = 0; h < hosts.size (); h++)
+    {
+      if (hosts[h].edge == 0)
+        {
+          continue;
+        }
+      uint32_t vmid = (hosts[h].pmac == Mac48Address () ? 0 : pld::PMAC::GetVmid (hosts[h].pmac));
+      hosts[h].pmac = hosts[h].edge->PreloadHost (hosts[h].amac, m_hostAddresses[h], hosts[h].port, vmid);
+      NS_ASSERT_MSG (hosts[h].pmac != Mac48Address::GetBroadcast (), "No PMAC for host " << m_hostAddresses[h]);
+      mappings.push_back (std::make_pair (m_hostAddresses[h], hosts[h].pmac));
+    }
+
+  if (m_cluster != 0)
+    {
+      m_cluster->RegisterHosts (mappings);
+    }
+  else if (m_fabricManager != 0)
+    {
+      m_fabricManager->RegisterHosts (mappings);
+    }
+
+  // entries are added as the ARP layer would on a reply: waiting for the reply, then alive
+  for (uint32_t h = 0; h < m_hosts.size (); h++)
+    {
+      Ptr<Ipv4L3Protocol> ipv4 = m_hosts[h]->GetObject<Ipv4L3Protocol> ();
+      Ptr<ArpCache> cache = ipv4->GetInterface (ipv4->GetInterfaceForDevice (GetCsmaDevice (m_hosts[h])))->GetArpCache ();
+      for (uint32_t m = 0; m < mappings.size (); m++)
+        {
+          if (mappings[m].first == m_hostAddresses[h])
+            {
+              continue;
+            }
+          ArpCache::Entry* entry = cache->Lookup (mappings[m].first);
+          if (entry == 0)
+            {
+              entry = cache->Add (mappings[m].first);
+            }
+          else if (entry->IsWaitReply ())
+            {
+              continue;
+            }
+          entry->MarkWaitReply (Create<Packet> ());
+          entry->MarkAlive (mappings[m].second);
+          entry->DequeuePending ();
+        }
+    }
+  NS_LOG_INFO ("Pre-warmed " << mappings.size () << " hosts");
+}
+
+
+bool
+PortlandFatTreeHelper::SaveSnapshot (std::string file_name) const
+{
+  std::ofstream file (file_name.c_str ());
+  if (!file)
+    {
+      NS_LOG_WARN ("Cannot write snapshot " << file_name);
+      return false;
+    }
+  file << "# PortLand PMAC snapshot of a k=" << m_k << " fat tree: IP address, PMAC" << std::endl;
+  for (uint32_t h = 0; h < m_hosts.size (); h++)
+    {
+      uint32_t port;
+      Ptr<PortlandSwitchNetDevice> edge = GetEdgePort (m_hosts[h], port);
+      Mac48Address pmac = edge->GetHostPMAC (m_hostAddresses[h]);
+      if (pmac != Mac48Address::GetBroadcast ())
+        {
+          file << m_hostAddresses[h] << " " << pmac << std::endl;
+        }
+    }
+  return !file.fail ();
+}
+
+} // namespace ns3
@@ -0,0 +1,299 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PORTLAND_FAT_TREE_HELPER_H
+#define PORTLAND_FAT_TREE_HELPER_H 1
+
+#include "ns3/portland-switch-helper.h"
+#include "ns3/portland-fabric-manager.h"
+#include "ns3/portland-fabric-manager-cluster.h"
+#include "ns3/portland-switch-net-device.h"
+#include "ns3/portland-port-stats-sampler.h"
+#include "ns3/portland-shared-buffer.h"
+#include "ns3/csma-helper.h"
+#include "ns3/node-container.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/object-factory.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class AttributeValue;
+class ErrorModel;
+
+/**
+ * \brief Builds a k-ary PortLand fat tree in one call.
+ *
+ * The tree has k pods of k/2 edge and k/2 aggregation switches, (k/2)^2 core switches in k/2 groups,
+ * and k/2 hosts under every edge switch. Port h of an edge switch leads to host h and upper port j to
+ * aggregation switch j of the pod; upper port j of aggregation switch i leads to core j of group i.
+ * Hosts get an internet stack and consecutive addresses from the configured base, in pod, edge, host order.
+ *
+ * The wall clock time and the peak resident memory of the process are recorded when the tree is built.
+ */
+class PortlandFatTreeHelper
+{
+public:
+  /**
+   * \param k Number of ports per switch; must be even.
+   */
+  PortlandFatTreeHelper (uint32_t k);
+
+  /**
+   * Set an attribute on every CsmaChannel linking the nodes of the tree.
+   */
+  void SetChannelAttribute (std::string n1, const AttributeValue &v1);
+
+  /**
+   * Set an attribute on every ns3::PortlandSwitchNetDevice of the tree.
+   */
+  void SetSwitchAttribute (std::string n1, const AttributeValue &v1);
+
+  /**
+   * Set the network the host addresses are allocated from; 10.1.0.0/255.255.0.0 by default.
+   */
+  void SetIpv4Base (Ipv4Address network, Ipv4Mask mask);
+
+  /**
+   * Have the switches find their level, pod and position with the Location Discovery Protocol instead of
+   * being told them; off by default. The switches are then given their ports upper ports first, and the
+   * switch accessors below index the tree as it was built, not by the discovered pods and positions.
+   */
+  void SetLocationDiscovery (bool discover);
+
+  /**
+   * Have the switches exchange LDMs to detect failed links, and reroute around them with the help of the
+   * Fabric Manager; off by default. Switches running the Location Discovery Protocol always do.
+   */
+  void SetLinkMonitoring (bool monitor);
+
+  /**
+   * Give every switch a pld::SharedBuffer holding the egress queues of all its ports, each a
+   * pld::SharedBufferQueue, instead of a drop-tail queue per port; off by default. Host NICs keep their queues.
+   */
+  void SetSharedBuffers (bool shared);
+
+  /**
+   * Set an attribute on every pld::SharedBuffer of the tree.
+   */
+  void SetSharedBufferAttribute (std::string n1, const AttributeValue &v1);
+
+  /**
+   * Link the nodes of the tree with ns3::CsmaFullDuplexChannel, on which the two ends of a link transmit at
+   * the same time, instead of half-duplex ns3::CsmaChannel buses; off by default.
+   */
+  void SetFullDuplex (bool full_duplex);
+
+  /**
+   * Partitions the tree over system ids 0 to n - 1, e.g. the ranks of a DistributedSimulatorImpl run, and
+   * links it with full-duplex channels, which carry frames from one system id to another. Pods go to the
+   * system ids in contiguous blocks, so that their hosts are balanced and only links to core switches cross
+   * system ids; core switches are then dealt out, group by group, to the system id with the fewest switches,
+   * preferring the one with the most pods, which cuts the fewest of their links. 1 by default, which puts
+   * the whole tree in system id 0.
+   *
+   * Under MPI every rank runs a replica of the Fabric Manager, which only hears the host registrations of
+   * the switches of its rank: a tree partitioned over several ranks must be pre-warmed with Prewarm () after
+   * Install (), so that every replica knows every host. The run aborts at its start otherwise.
+   *
+   * \param n Number of system ids, at most k.
+   */
+  void SetSystemCount (uint32_t n);
+
+  uint32_t GetSystemCount (void) const;
+  /**
+   * \return The system id of the hosts and switches of a pod.
+   */
+  uint32_t GetPodSystemId (uint32_t pod) const;
+  uint32_t GetCoreSystemId (uint32_t group, uint32_t position) const;
+  /**
+   * \return Number of links between nodes of different system ids.
+   */
+  uint32_t GetNCutLinks (void) const;
+
+  /**
+   * Builds the tree, connecting every switch to the Fabric Manager.
+   */
+  void Install (Ptr<pld::FabricManager> fabric_manager);
+
+  /**
+   * Builds the tree, connecting every switch to a cluster of Fabric Manager shards.
+   */
+  void Install (Ptr<pld::FabricManagerCluster> cluster);
+
+  uint32_t GetK (void) const;
+  uint32_t GetNHosts (void) const;
+
+  /**
+   * \return All hosts, in pod, edge, host order.
+   */
+  NodeContainer GetHosts (void) const;
+  Ptr<Node> GetHost (uint32_t pod, uint32_t edge, uint32_t host) const;
+  Ipv4Address GetHostAddress (uint32_t pod, uint32_t edge, uint32_t host) const;
+
+  Ptr<PortlandSwitchNetDevice> GetEdgeSwitch (uint32_t pod, uint32_t position) const;
+  Ptr<PortlandSwitchNetDevice> GetAggregationSwitch (uint32_t pod, uint32_t position) const;
+  Ptr<PortlandSwitchNetDevice> GetCoreSwitch (uint32_t group, uint32_t position) const;
+
+  /**
+   * Samples the counters of every port of every switch, edge switches first, then aggregation and core
+   * switches, into a file every interval, from now until the sampler is stopped or the simulation destroyed.
+   * Call it after Install (); see pld::PortStatsSampler for the file format.
+   */
+  Ptr<pld::PortStatsSampler> EnablePortStats (std::string file_name, Time interval) const;
+
+  /**
+   * Builds up front the state PortLand otherwise builds from the first frames of every host, so that a run
+   * measures the steady state: every edge switch gives each of its hosts a PMAC, the Fabric Manager learns
+   * their IP Address <-> PMAC mappings and every host's ARP cache gets the PMACs of all other hosts. No ARP
+   * Request is then sent, to the Fabric Manager or flooded, until the ARP cache entries expire.
+   *
+   * Call it after Install (), once the switches are located, and before the hosts send anything. The ARP
+   * caches take n^2 entries for n hosts.
+   */
+  void Prewarm (void);
+
+  /**
+   * As Prewarm (), giving the hosts the PMACs they had in the run that wrote the snapshot with SaveSnapshot ();
+   * hosts that are not in the snapshot keep a cold start. The snapshot must come from the same tree.
+   *
+   * \return False, with nothing pre-warmed, if the file cannot be read or does not match the tree.
+   */
+  bool Prewarm (std::string snapshot);
+
+  /**
+   * Writes the IP Address and PMAC of every host that has a PMAC to a text file, one host per line.
+   *
+   * \return False if the file cannot be written.
+   */
+  bool SaveSnapshot (std::string file_name) const;
+
+  /**
+   * \return Wall clock time, in milliseconds, Install () took.
+   */
+  int64_t GetSetupTime (void) const;
+
+  /**
+   * \return Peak resident memory of the process, in bytes, when Install () returned.
+   */
+  uint64_t GetPeakMemory (void) const;
+
+  /**
+   * Live-migrates a host (VM): its NIC is unplugged from its edge switch port and plugged into the port of
+   * another host, after which the host announces itself with a gratuitous ARP, as a hypervisor does once a
+   * migrated VM resumes. The host keeps its IP Address. A NIC in the middle of a transmission is moved as
+   * soon as the transmission ends.
+   *
+   * \param host The host to move.
+   * \param next_to A host on the edge switch port to move it to.
+   */
+  static void MigrateHost (Ptr<Node> host, Ptr<Node> next_to);
+
+  /**
+   * Has a host send a gratuitous ARP, so that its edge switch registers it with the Fabric Manager before
+   * the host sends anything itself, e.g. when a VM boots.
+   */
+  static void AnnounceHost (Ptr<Node> host);
+
+  /**
+   * Has a host join a multicast group: it sends an IGMP Membership Report, from which its edge switch learns
+   * the member and the Fabric Manager adds the edge switch to the group's tree. ns-3 has no IGMP, so the
+   * host's sockets receive the group's packets whether it joined or not; only the switches care.
+   */
+  static void JoinGroup (Ptr<Node> host, Ipv4Address group);
+
+  /**
+   * Has a host leave a multicast group it joined with JoinGroup: it sends an IGMP Leave Group message.
+   */
+  static void LeaveGroup (Ptr<Node> host, Ipv4Address group);
+
+  /**
+   * Fails the link between two switches in both directions: every frame sent on it from now on is lost.
+   */
+  static void FailLink (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b);
+
+  /**
+   * Brings back a link failed with FailLink.
+   */
+  static void RestoreLink (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b);
+
+private:
+  template <typename T>
+  void DoInstall (Ptr<T> fabric_manager);
+
+  /**
+   * A host as pre-warmed: its PMAC and the edge switch port that gave it out.
+   */
+  struct HostState
+  {
+    Ptr<PortlandSwitchNetDevice> edge;
+    uint32_t port;
+    Mac48Address amac;
+    Mac48Address pmac;
+  };
+
+  /**
+   * \return The edge switch the NIC of a host is plugged into, and the index of the port in port.
+   */
+  static Ptr<PortlandSwitchNetDevice> GetEdgePort (Ptr<Node> host, uint32_t& port);
+
+  /**
+   * Binds the hosts with a state to their PMACs on their edge switches, registers them with the Fabric
+   * Manager and fills the ARP caches of all hosts with them. hosts is in m_hosts order.
+   */
+  void DoPrewarm (std::vector<HostState>& hosts);
+
+  /**
+   * Replaces the queues of all the devices of a switch node, which must not be installed yet, with queues
+   * sharing a new buffer.
+   */
+  void InstallSharedBuffer (Ptr<Node> node);
+
+  static uint64_t GetPeakResidentMemory (void);
+
+  /**
+   * Sets the receive error model of both devices of the link between two switches.
+   */
+  static void SetLinkErrorModel (Ptr<PortlandSwitchNetDevice> a, Ptr<PortlandSwitchNetDevice> b, Ptr<ErrorModel> em);
+
+  uint32_t m_k;
+  CsmaHelper m_csma;
+  ObjectFactory m_channelFactory;
+  uint32_t m_systemCount;
+  std::vector<uint32_t> m_podSystemIds;
+  std::vector<uint32_t> m_coreSystemIds;        ///< In group, position order
+  PortlandSwitchHelper m_switchHelper;
+  Ipv4Address m_network;
+  Ipv4Mask m_mask;
+  bool m_locationDiscovery;
+  bool m_linkMonitoring;
+  bool m_sharedBuffers;
+  ObjectFactory m_bufferFactory;
+  Ptr<pld::FabricManager> m_fabricManager;
+  Ptr<pld::FabricManagerCluster> m_cluster;
+
+  std::vector<Ptr<Node> > m_hosts;              ///< Hosts, in pod, edge, host order
+  std::vector<Ipv4Address> m_hostAddresses;
+  std::vector<Ptr<PortlandSwitchNetDevice> > m_edges;           ///< Edge switches, in pod, position order
+  std::vector<Ptr<PortlandSwitchNetDevice> > m_aggregations;    ///< Aggregation switches, in pod, position order
+  std::vector<Ptr<PortlandSwitchNetDevice> > m_cores;           ///< Core switches, in group, position order
+  int64_t m_setupTime;
+  uint64_t m_peakMemory;
+};
+
+} // namespace ns3
+
+#endif /* PORTLAND_FAT_TREE_HELPER_H */
@@ -51,6 +51,7 @@ PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer c, Ptr<ns3::pl
 
   NetDeviceContainer devs;
   Ptr<PortlandSwitchNetDevice> dev = m_deviceFactory.Create<PortlandSwitchNetDevice> ();
+  dev->SetDeviceType (UNKNOWN_LEVEL);
   devs.Add (dev);
   node->AddDevice (dev);
 
@@ -62,12 +63,35 @@ PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer c, Ptr<ns3::pl
       //NS_LOG_INFO ("**** Add SwitchPort " << *i);
       dev->AddSwitchPort (*i, false);
     }
+  dev->StartLocationDiscovery ();
+  return devs;
+}
+
+NetDeviceContainer
+PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer c, Ptr<ns3::pld::FabricManagerCluster> cluster)
+{
+ NS_LOG_FUNCTION_NOARGS ();
+ NS_LOG_INFO ("**** Install switch device on node " << node->GetId ());
+
+  NetDeviceContainer devs;
+  Ptr<PortlandSwitchNetDevice> dev = m_deviceFactory.Create<PortlandSwitchNetDevice> ();
+  dev->SetDeviceType (UNKNOWN_LEVEL);
+  devs.Add (dev);
+  node->AddDevice (dev);
+
+  dev->SetFabricManagerCluster (cluster);
+
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      dev->AddSwitchPort (*i, false);
+    }
+  dev->StartLocationDiscovery ();
   return devs;
 }
 
 NetDeviceContainer
 PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer lowerDevices, NetDeviceContainer upperDevices, Ptr<ns3::pld::FabricManager> fabric_manager, 
-                                PortlandSwitchType device_type, uint8_t pod, uint8_t position)
+                                PortlandSwitchType device_type, uint16_t pod, uint16_t position)
 {
  NS_LOG_FUNCTION_NOARGS ();
  NS_LOG_INFO ("**** Install switch device on node " << node->GetId ());
@@ -98,6 +122,39 @@ PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer lowerDevices,
   return devs;
 }
 
+NetDeviceContainer
+PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer lowerDevices, NetDeviceContainer upperDevices, Ptr<ns3::pld::FabricManagerCluster> cluster, 
+                                PortlandSwitchType device_type, uint16_t pod, uint16_t position)
+{
+ NS_LOG_FUNCTION_NOARGS ();
+ NS_LOG_INFO ("**** Install switch device on node " << node->GetId ());
+
+  NetDeviceContainer devs;
+  Ptr<PortlandSwitchNetDevice> dev = m_deviceFactory.Create<PortlandSwitchNetDevice> ();
+  dev->SetDeviceType(device_type);
+  dev->SetPod(pod);
+  dev->SetPosition(position);
+  devs.Add (dev);
+  node->AddDevice (dev);
+
+  //NS_LOG_INFO ("**** Set up Fabric Manager");
+  dev->SetFabricManagerCluster (cluster);
+
+  for (NetDeviceContainer::Iterator i = lowerDevices.Begin (); i != lowerDevices.End (); ++i)
+    {
+     NS_LOG_INFO ("**** Add SwitchPort " << *i);
+      dev->AddSwitchPort (*i, false);
+    }
+
+  for (NetDeviceContainer::Iterator i = upperDevices.Begin (); i != upperDevices.End (); ++i)
+    {
+     NS_LOG_INFO ("**** Add SwitchPort " << *i);
+      dev->AddSwitchPort (*i, true);
+    }
+ 
+  return devs;
+}
+
 NetDeviceContainer
 PortlandSwitchHelper::Install (Ptr<Node> node, NetDeviceContainer c)
 {
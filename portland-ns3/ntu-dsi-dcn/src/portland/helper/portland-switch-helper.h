@@ -21,6 +21,7 @@
 #define PORTLAND_SWITCH_HELPER_H 1
 
 #include "ns3/portland-fabric-manager.h"
+#include "ns3/portland-fabric-manager-cluster.h"
 #include "ns3/portland-switch-net-device.h"
 #include "ns3/net-device-container.h"
 #include "ns3/object-factory.h"
@@ -57,19 +58,33 @@ public:
    * configured by PortlandSwitchHelper::SetDeviceAttribute, adds the device
    * to the node, attaches the given NetDevices as ports of the
    * switch, and sets up a controller connection using the provided
-   * Controller.
+   * Controller. The switch finds its level, pod and position with the
+   * Location Discovery Protocol.
    *
    * \param node The node to install the device in
-   * \param c Container of NetDevices to add as switch ports
+   * \param c Container of NetDevices to add as switch ports, in any order
    * \param controller The controller connection.
    * \returns A container holding the added net device.
    */
   NetDeviceContainer
   Install (Ptr<Node> node, NetDeviceContainer c, Ptr<ns3::pld::FabricManager> fabric_manager);
+
+  /**
+   * As above, but connects the switch to a cluster of Fabric Manager shards.
+   */
+  NetDeviceContainer
+  Install (Ptr<Node> node, NetDeviceContainer c, Ptr<ns3::pld::FabricManagerCluster> cluster);
   
   NetDeviceContainer
   Install (Ptr<Node> node, NetDeviceContainer lowerDevices, NetDeviceContainer upperDevices, Ptr<ns3::pld::FabricManager> fabric_manager,
-	PortlandSwitchType device_type, uint8_t pod, uint8_t position);
+	PortlandSwitchType device_type, uint16_t pod, uint16_t position);
+
+  /**
+   * As above, but connects the switch to a cluster of Fabric Manager shards.
+   */
+  NetDeviceContainer
+  Install (Ptr<Node> node, NetDeviceContainer lowerDevices, NetDeviceContainer upperDevices, Ptr<ns3::pld::FabricManagerCluster> cluster,
+	PortlandSwitchType device_type, uint16_t pod, uint16_t position);
   
   /**
    * This method creates an ns3::PortlandSwitchNetDevice with the attributes
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-control-message.h"
+
+#include <vector>
+
+namespace ns3 {
+
+namespace pld {
+
+namespace {
+
+/// Storage of one message; large enough and aligned for every message type
+union MessageBlock {
+  char reg[sizeof (PMACRegister)];
+  char request[sizeof (ARPRequest)];
+  char response[sizeof (ARPResponse)];
+  char flood[sizeof (ARPFloodRequest)];
+  char invalidate[sizeof (PMACInvalidate)];
+  char location_request[sizeof (LocationRequest)];
+  char location_assign[sizeof (LocationAssign)];
+  char fault_report[sizeof (FaultReport)];
+  char port_exclusion[sizeof (PortExclusion)];
+  char group_membership[sizeof (GroupMembership)];
+  char group_route[sizeof (GroupRoute)];
+  MessageBlock* next;           ///< Next free block while the block is in the free list
+  uint64_t align;
+};
+
+/*
+ * Free list of message blocks, carved from chunks that are only released at exit; messages still in
+ * flight when the simulation is destroyed are reclaimed with their chunk. It has no lock: the Fabric
+ * Manager refuses switches in several partitions of a MultithreadedSimulatorImpl.
+ */
+class MessagePool
+{
+public:
+  MessagePool () : m_free (0), m_inUse (0) {}
+
+  ~MessagePool ()
+  {
+    for (std::vector<MessageBlock*>::iterator i = m_chunks.begin (); i != m_chunks.end (); i++)
+      {
+        delete [] *i;
+      }
+  }
+
+  void* Allocate (void)
+  {
+    if (m_free == 0)
+      {
+        MessageBlock* chunk = new MessageBlock[CHUNK_SIZE];
+        m_chunks.push_back (chunk);
+        for (uint32_t i = 0; i < CHUNK_SIZE; i++)
+          {
+            chunk[i].next = m_free;
+            m_free = &chunk[i];
+          }
+      }
+    MessageBlock* block = m_free;
+    m_free = block->next;
+    m_inUse++;
+    return block;
+  }
+
+  void Free (void* p)
+  {
+    MessageBlock* block = static_cast<MessageBlock*> (p);
+    block->next = m_free;
+    m_free = block;
+    m_inUse--;
+  }
+
+  uint32_t GetNInUse (void) const
+  {
+    return m_inUse;
+  }
+
+private:
+  static const uint32_t CHUNK_SIZE = 256;
+
+  std::vector<MessageBlock*> m_chunks;
+  MessageBlock* m_free;
+  uint32_t m_inUse;
+};
+
+MessagePool g_messagePool;
+
+} // anonymous namespace
+
+const uint16_t PortExclusion::ANY_POSITION;
+
+
+void*
+AllocateMessageBlock (void)
+{
+  return g_messagePool.Allocate ();
+}
+
+
+void
+FreeMessageBlock (void* block)
+{
+  g_messagePool.Free (block);
+}
+
+
+uint32_t
+GetNMessagesInUse (void)
+{
+  return g_messagePool.GetNInUse ();
+}
+
+
+void
+FreeMessage (BufferData& buffer)
+{
+  if (buffer.message != 0)
+    {
+      FreeMessageBlock (buffer.message);
+      buffer.message = 0;
+    }
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PORTLAND_CONTROL_MESSAGE_H
+#define PORTLAND_CONTROL_MESSAGE_H 1
+
+#include "ns3/assert.h"
+#include "ns3/mac48-address.h"
+#include "ns3/ipv4-address.h"
+
+#include <new>
+
+#include "portland.h"
+
+namespace ns3 {
+
+namespace pld {
+
+/*
+ * Messages exchanged between the switches and the Fabric Manager. Each message type names its
+ * PACKET_TYPE in TYPE; messages must stay trivially destructible as the pool never runs destructors.
+ */
+
+typedef struct PMACRegister {
+    static const PACKET_TYPE TYPE = PKT_MAC_REGISTER;
+    Ipv4Address hostIP;
+    Mac48Address PMACAddress;
+} PMACRegister;
+
+typedef struct ARPRequest {
+    static const PACKET_TYPE TYPE = PKT_ARP_REQUEST;
+    Ipv4Address destIPAddress;
+    Ipv4Address srcIPAddress;
+    Mac48Address srcPMACAddress;
+} ARPRequest;
+
+typedef struct ARPResponse {
+    static const PACKET_TYPE TYPE = PKT_ARP_RESPONSE;
+    Ipv4Address destIPAddress;
+    Mac48Address destPMACAddress;
+    Ipv4Address srcIPAddress;
+    Mac48Address srcPMACAddress;
+} ARPResponse;
+
+typedef struct ARPFloodRequest {
+    static const PACKET_TYPE TYPE = PKT_ARP_FLOOD;
+    Ipv4Address destIPAddress;
+    Ipv4Address srcIPAddress;
+    Mac48Address srcPMACAddress;
+} ARPFloodRequest;
+
+typedef struct PMACInvalidate {
+    static const PACKET_TYPE TYPE = PKT_PMAC_INVALIDATE;
+    Ipv4Address hostIP;
+    Mac48Address oldPMACAddress;        // PMAC no longer valid for hostIP
+    Mac48Address newPMACAddress;        // PMAC hostIP moved to; broadcast if it is not known
+} PMACInvalidate;
+
+typedef struct LocationRequest {
+    static const PACKET_TYPE TYPE = PKT_LOCATION_REQUEST;
+    Mac48Address switchId;              // Requesting EDGE switch
+    Mac48Address podId;                 // Lowest identifier of the switch's aggregation switches, shared by its pod
+} LocationRequest;
+
+typedef struct LocationAssign {
+    static const PACKET_TYPE TYPE = PKT_LOCATION_ASSIGN;
+    uint16_t pod;
+    uint16_t position;
+} LocationAssign;
+
+typedef struct FaultReport {
+    static const PACKET_TYPE TYPE = PKT_FAULT_REPORT;
+    uint8_t level;                      // Level, pod and position of the lower switch of the link
+    uint16_t pod;
+    uint16_t position;
+    uint16_t uplink;                    // Upper port of the lower switch the link is on
+    bool up;                            // Whether the link came back up or went down
+} FaultReport;
+
+typedef struct PortExclusion {
+    static const PACKET_TYPE TYPE = PKT_PORT_EXCLUSION;
+    static const uint16_t ANY_POSITION = 0xffff;
+    uint16_t pod;                       // Destination pod
+    uint16_t position;                  // Destination EDGE switch in the pod, or ANY_POSITION
+    uint64_t uplinks;                   // Bit i set: do not send to the destination on upper port i
+} PortExclusion;
+
+typedef struct GroupMembership {
+    static const PACKET_TYPE TYPE = PKT_GROUP_MEMBERSHIP;
+    Ipv4Address group;                  // Multicast group
+    bool join;                          // Whether the EDGE switch got its first member or lost its last one
+} GroupMembership;
+
+typedef struct GroupRoute {
+    static const PACKET_TYPE TYPE = PKT_GROUP_ROUTE;
+    Ipv4Address group;                  // Multicast group
+    uint64_t ports;                     // Bit i set: copies go down lower port i; ignored by EDGE switches
+    bool up;                            // Whether copies from below also go up the group's tree
+    uint16_t uplink;                    // Upper port the copies going up are sent on; ignored by CORE switches
+} GroupRoute;
+
+/**
+ * \brief A message to or from the Fabric Manager.
+ *
+ * The receiver of a BufferData owns its message and returns it to the pool with FreeMessage ().
+ */
+typedef struct BufferData {
+    PACKET_TYPE pkt_type; // PACKET_TYPE enum defined in portland.h
+    void* message; // Allocated by CreateMessage (); read it with Get<T> ()
+
+    template <typename T>
+    T* Get (void) const
+    {
+      NS_ASSERT_MSG (pkt_type == T::TYPE, "Control message is not of the requested type");
+      return static_cast<T*> (message);
+    }
+} BufferData;
+
+/**
+ * \return A block of the message pool large enough for any control message.
+ */
+void* AllocateMessageBlock (void);
+
+/**
+ * Returns a block to the message pool.
+ */
+void FreeMessageBlock (void* block);
+
+/**
+ * \return Number of message blocks currently handed out by the pool.
+ */
+uint32_t GetNMessagesInUse (void);
+
+/**
+ * Allocates a message of type T from the message pool.
+ *
+ * \param msg Set to the new, default constructed message.
+ * \return The buffer carrying the message.
+ */
+template <typename T>
+BufferData
+CreateMessage (T*& msg)
+{
+  msg = new (AllocateMessageBlock ()) T ();
+  BufferData buffer;
+  buffer.pkt_type = T::TYPE;
+  buffer.message = msg;
+  return buffer;
+}
+
+/**
+ * Returns the message of a buffer to the message pool.
+ */
+void FreeMessage (BufferData& buffer);
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_CONTROL_MESSAGE_H */
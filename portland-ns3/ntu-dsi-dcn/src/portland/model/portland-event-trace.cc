@@ -0,0 +1,206 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-event-trace.h"
+#include "portland-switch-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+
+NS_LOG_COMPONENT_DEFINE ("PortlandEventTrace");
+
+namespace ns3 {
+
+namespace pld {
+
+bool EventTrace::m_enabled = false;
+std::vector<EventTrace::Event> EventTrace::m_events;
+uint64_t EventTrace::m_nRecorded = 0;
+uint64_t EventTrace::m_counts[EventTrace::N_EVENT_TYPES][4];
+std::string EventTrace::m_fileName;
+std::ostream* EventTrace::m_summary = 0;
+
+
+void
+EventTrace::Enable (uint32_t capacity, std::string file_name, std::ostream* summary)
+{
+  NS_ASSERT (capacity > 0);
+  if (!IsBuilt ())
+    {
+      NS_LOG_UNCOND ("PortLand event trace enabled in a build configured with --disable-portland-event-trace;"
+                     " no events will be recorded");
+    }
+  if (!m_enabled)
+    {
+      Simulator::ScheduleDestroy (&EventTrace::Finish);
+    }
+  m_enabled = true;
+  m_events.clear ();
+  m_events.reserve (capacity);
+  m_nRecorded = 0;
+  memset (m_counts, 0, sizeof (m_counts));
+  m_fileName = file_name;
+  m_summary = summary;
+}
+
+
+bool
+EventTrace::IsBuilt (void)
+{
+#ifdef NS3_PORTLAND_EVENT_TRACE
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void
+EventTrace::Disable (void)
+{
+  m_enabled = false;
+}
+
+
+void
+EventTrace::Record (EventType type, const PortlandSwitchNetDevice& swtch, Ipv4Address ip, uint16_t reason)
+{
+  Event event;
+  event.time = Simulator::Now ().GetNanoSeconds ();
+  event.node = swtch.GetNode ()->GetId ();
+  event.ip = ip.Get ();
+  event.pod = swtch.GetPod ();
+  event.position = swtch.GetPosition ();
+  event.reason = reason;
+  event.type = type;
+  event.level = (uint8_t) swtch.GetDeviceType () & 3;
+
+  if (m_events.size () < m_events.capacity ())
+    {
+      m_events.push_back (event);
+    }
+  else
+    {
+      m_events[m_nRecorded % m_events.size ()] = event;
+    }
+  m_nRecorded++;
+  m_counts[type][event.level]++;
+}
+
+
+uint64_t
+EventTrace::GetNEvents (EventType type)
+{
+  uint64_t n = 0;
+  for (uint32_t level = 0; level < 4; level++)
+    {
+      n += m_counts[type][level];
+    }
+  return n;
+}
+
+
+uint32_t
+EventTrace::GetNBuffered (void)
+{
+  return m_events.size ();
+}
+
+
+const EventTrace::Event&
+EventTrace::GetEvent (uint32_t n)
+{
+  NS_ASSERT (n < m_events.size ());
+  // once the buffer is full, the oldest event is the one to be overwritten next
+  uint32_t oldest = (m_events.size () < m_events.capacity () ? 0 : m_nRecorded % m_events.size ());
+  return m_events[(oldest + n) % m_events.size ()];
+}
+
+
+const char*
+EventTrace::GetTypeName (EventType type)
+{
+  static const char* names[N_EVENT_TYPES] = {
+    "register", "query", "hit", "miss", "flood", "local-hit", "cache-hit", "cache-miss", "drop"
+  };
+  return names[type];
+}
+
+
+void
+EventTrace::PrintSummary (std::ostream& os)
+{
+  os << "PortLand control plane events: " << m_nRecorded << " recorded, " << m_events.size () << " buffered"
+     << std::endl;
+  os << std::setw (12) << "event" << std::setw (12) << "total" << std::setw (12) << "edge"
+     << std::setw (12) << "aggregation" << std::setw (12) << "core" << std::endl;
+  for (uint32_t type = 0; type < N_EVENT_TYPES; type++)
+    {
+      os << std::setw (12) << GetTypeName ((EventType) type) << std::setw (12) << GetNEvents ((EventType) type);
+      for (uint32_t level = EDGE; level <= CORE; level++)
+        {
+          os << std::setw (12) << m_counts[type][level];
+        }
+      os << std::endl;
+    }
+}
+
+
+void
+EventTrace::Write (std::string file_name)
+{
+  std::ofstream file (file_name.c_str (), std::ios::binary | std::ios::trunc);
+  if (!file)
+    {
+      NS_LOG_WARN ("Cannot open event trace file " << file_name);
+      return;
+    }
+  uint32_t header[2] = { sizeof (Event), (uint32_t) m_events.size () };
+  file.write ("PLDTRACE", 8);
+  file.write (reinterpret_cast<const char*> (header), sizeof (header));
+  for (uint32_t n = 0; n < m_events.size (); n++)
+    {
+      file.write (reinterpret_cast<const char*> (&GetEvent (n)), sizeof (Event));
+    }
+}
+
+
+void
+EventTrace::Finish (void)
+{
+  if (!m_enabled)
+    {
+      return;
+    }
+  if (m_summary != 0)
+    {
+      PrintSummary (*m_summary);
+    }
+  if (!m_fileName.empty ())
+    {
+      Write (m_fileName);
+    }
+  m_enabled = false;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_EVENT_TRACE_H
+#define PORTLAND_EVENT_TRACE_H 1
+
+#include "ns3/ipv4-address.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+class PortlandSwitchNetDevice;
+
+namespace pld {
+
+/**
+ * \brief Trace of the control plane events of the switches and the Fabric Manager, kept in a ring buffer.
+ *
+ * Events are recorded through PLD_TRACE_EVENT, which costs a test of a flag while the trace is disabled. It is
+ * built into every profile, optimized included, and compiles to nothing when configured with
+ * --disable-portland-event-trace (NS3_PORTLAND_EVENT_TRACE undefined). Each event is a
+ * fixed size record of its time, type, the switch it concerns and an IP address; the ring buffer keeps the
+ * most recent Capacity events while the totals count them all.
+ *
+ * When the simulation is destroyed a summary of the totals is printed to the stream given to Enable, standard
+ * output by default, and, if a file name was given, the buffered events are written to it, oldest first, after
+ * a header:
+ *
+ *   - char[8] magic, "PLDTRACE";
+ *   - uint32 size of an Event record, uint32 number of records.
+ *
+ * The trace is then disabled; enable it again for the next simulation.
+ */
+class EventTrace
+{
+public:
+  enum EventType
+  {
+    REGISTER,           ///< The Fabric Manager registered the PMAC of a host seen by an EDGE switch
+    QUERY,              ///< The Fabric Manager was asked for the PMAC of an IP address
+    HIT,                ///< ... and knew it
+    MISS,               ///< ... and did not, so has the ARP Request flooded
+    FLOOD,              ///< A switch flooded an ARP Request for the Fabric Manager
+    LOCAL_HIT,          ///< An EDGE switch found a destination PMAC in its own table
+    CACHE_HIT,          ///< An EDGE switch found a destination PMAC in its cache
+    CACHE_MISS,         ///< An EDGE switch did not know a destination PMAC
+    DROP,               ///< A switch dropped a frame; the reason tells where
+    N_EVENT_TYPES
+  };
+
+  struct Event
+  {
+    int64_t time;       ///< Nanoseconds
+    uint32_t node;      ///< Node id of the switch
+    uint32_t ip;        ///< Host order; 0 if the event has no address
+    uint16_t pod;
+    uint16_t position;
+    uint16_t reason;    ///< Drop site of a DROP, 0 otherwise
+    uint8_t type;       ///< An EventType
+    uint8_t level;      ///< A PortlandSwitchType
+  };
+
+  /**
+   * Starts recording events from the current simulation.
+   * \param capacity Number of events the ring buffer keeps.
+   * \param file_name File the buffered events are written to when the simulation is destroyed; empty for none.
+   * \param summary Stream the summary is printed to when the simulation is destroyed; 0 for none.
+   */
+  static void Enable (uint32_t capacity, std::string file_name = "", std::ostream* summary = &std::cout);
+  static void Disable (void);
+  static bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+  /**
+   * \return Whether PLD_TRACE_EVENT records events in this build.
+   */
+  static bool IsBuilt (void);
+
+  static void Record (EventType type, const PortlandSwitchNetDevice& swtch, Ipv4Address ip, uint16_t reason = 0);
+
+  /**
+   * \return Number of events of a type recorded since the trace was enabled, including those overwritten.
+   */
+  static uint64_t GetNEvents (EventType type);
+
+  /**
+   * \return Number of events held in the ring buffer.
+   */
+  static uint32_t GetNBuffered (void);
+
+  /**
+   * \param n Index of a buffered event, 0 for the oldest.
+   */
+  static const Event& GetEvent (uint32_t n);
+
+  static void PrintSummary (std::ostream& os);
+  static void Write (std::string file_name);
+
+  static const char* GetTypeName (EventType type);
+
+private:
+  /**
+   * Prints the summary and writes the file at Simulator::Destroy.
+   */
+  static void Finish (void);
+
+  static bool m_enabled;
+  static std::vector<Event> m_events;
+  static uint64_t m_nRecorded;
+  static uint64_t m_counts[N_EVENT_TYPES][4];   ///< By type and switch level
+  static std::string m_fileName;
+  static std::ostream* m_summary;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#ifdef NS3_PORTLAND_EVENT_TRACE
+#define PLD_TRACE_EVENT(type, swtch, ip, reason)                        \
+  do                                                                    \
+    {                                                                   \
+      if (ns3::pld::EventTrace::IsEnabled ())                           \
+        {                                                               \
+          ns3::pld::EventTrace::Record (type, *(swtch), ip, reason);    \
+        }                                                               \
+    }                                                                   \
+  while (false)
+#else
+#define PLD_TRACE_EVENT(type, swtch, ip, reason)
+#endif
+
+#endif /* PORTLAND_EVENT_TRACE_H */
@@ -0,0 +1,352 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-fabric-manager-cluster.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+namespace pld {
+
+NS_LOG_COMPONENT_DEFINE ("PortlandFabricManagerCluster");
+
+NS_OBJECT_ENSURE_REGISTERED (FabricManagerCluster);
+
+
+TypeId
+FabricManagerCluster::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::FabricManagerCluster")
+    .SetParent<Object> ()
+    .AddConstructor<FabricManagerCluster> ()
+    .AddAttribute ("VirtualNodes",
+                   "Number of points each shard takes on the hash ring; more points spread the hosts more evenly.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&FabricManagerCluster::m_virtualNodes),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MovedHosts",
+                   "Number of host mappings moved between shards by rebalancing.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManagerCluster::GetNMovedHosts),
+                   MakeUintegerChecker<uint64_t> ())
+  ;
+  return tid;
+}
+
+
+FabricManagerCluster::FabricManagerCluster ()
+  : m_virtualNodes (64),
+    m_nextShardId (0),
+    m_nMovedHosts (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+FabricManagerCluster::~FabricManagerCluster ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+void
+FabricManagerCluster::DoDispose (void)
+{
+  for (uint32_t i = 0; i < m_shards.size (); i++)
+    {
+      m_shards[i]->SetCluster (0);
+    }
+  for (uint32_t i = 0; i < m_retired.size (); i++)
+    {
+      m_retired[i]->SetCluster (0);
+    }
+  m_ring.clear ();
+  m_shards.clear ();
+  m_shardIds.clear ();
+  m_retired.clear ();
+  m_switches.clear ();
+  Object::DoDispose ();
+}
+
+
+/*
+ * 64-bit finalizer (from MurmurHash3), as used by the PMAC tables
+ */
+uint32_t
+FabricManagerCluster::Hash (uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (uint32_t) key;
+}
+
+
+Ptr<FabricManager>
+FabricManagerCluster::AddShard (void)
+{
+  Ptr<FabricManager> shard = CreateObject<FabricManager> ();
+  AddShard (shard);
+  return shard;
+}
+
+
+/*
+ * Places the shard on the ring and takes over the hosts of the ring intervals it now owns
+ */
+void
+FabricManagerCluster::AddShard (Ptr<FabricManager> shard)
+{
+  NS_LOG_FUNCTION (this << shard);
+  uint32_t id = m_nextShardId++;
+  for (uint32_t v = 0; v < m_virtualNodes; v++)
+    {
+      // on the rare collision of two virtual nodes the first one keeps the point
+      m_ring.insert (std::make_pair (Hash (((uint64_t) id << 32) | v), shard));
+    }
+  m_shards.push_back (shard);
+  m_shardIds.push_back (id);
+
+  shard->SetCluster (this);
+  for (std::set<Ptr<PortlandSwitchNetDevice> >::iterator sw = m_switches.begin (); sw != m_switches.end (); sw++)
+    {
+      shard->AddSwitch (*sw);
+    }
+
+  for (uint32_t i = 0; i + 1 < m_shards.size (); i++)
+    {
+      Rebalance (m_shards[i]);
+    }
+}
+
+
+void
+FabricManagerCluster::RemoveShard (Ptr<FabricManager> shard)
+{
+  NS_LOG_FUNCTION (this << shard);
+  uint32_t i = 0;
+  while (i < m_shards.size () && m_shards[i] != shard)
+    {
+      i++;
+    }
+  if (i == m_shards.size ())
+    {
+      NS_LOG_WARN ("Fabric Manager is not a shard of this cluster");
+      return;
+    }
+  NS_ASSERT_MSG (m_shards.size () > 1, "Cannot remove the last shard of a Fabric Manager cluster");
+
+  uint32_t id = m_shardIds[i];
+  for (uint32_t v = 0; v < m_virtualNodes; v++)
+    {
+      Ring_t::iterator point = m_ring.find (Hash (((uint64_t) id << 32) | v));
+      if (point != m_ring.end () && point->second == shard)
+        {
+          m_ring.erase (point);
+        }
+    }
+  m_shards.erase (m_shards.begin () + i);
+  m_shardIds.erase (m_shardIds.begin () + i);
+  m_retired.push_back (shard);
+
+  Rebalance (shard);
+}
+
+
+void
+FabricManagerCluster::Rebalance (Ptr<FabricManager> shard)
+{
+  std::vector<std::pair<Ipv4Address, Mac48Address> > hosts;
+  shard->GetHosts (hosts);
+  for (uint32_t h = 0; h < hosts.size (); h++)
+    {
+      Ptr<FabricManager> owner = GetShard (hosts[h].first);
+      if (owner != shard)
+        {
+          shard->MoveHost (hosts[h].first, owner);
+          m_nMovedHosts++;
+        }
+    }
+}
+
+
+uint32_t
+FabricManagerCluster::GetNShards (void) const
+{
+  return m_shards.size ();
+}
+
+
+Ptr<FabricManager>
+FabricManagerCluster::GetShard (uint32_t i) const
+{
+  return m_shards[i];
+}
+
+
+Ptr<FabricManager>
+FabricManagerCluster::GetShard (Ipv4Address ip) const
+{
+  NS_ASSERT_MSG (!m_ring.empty (), "Fabric Manager cluster has no shards");
+  Ring_t::const_iterator point = m_ring.lower_bound (Hash (ip.Get ()));
+  if (point == m_ring.end ())
+    {
+      point = m_ring.begin ();
+    }
+  return point->second;
+}
+
+
+Ipv4Address
+FabricManagerCluster::GetRequestKey (const BufferData& buffer)
+{
+  switch (buffer.pkt_type)
+    {
+    case PKT_MAC_REGISTER:
+      return buffer.Get<PMACRegister> ()->hostIP;
+    case PKT_ARP_REQUEST:
+      return buffer.Get<ARPRequest> ()->destIPAddress;
+    default:
+      return Ipv4Address::GetAny ();
+    }
+}
+
+
+void
+FabricManagerCluster::AddSwitch (Ptr<PortlandSwitchNetDevice> swtch)
+{
+  m_switches.insert (swtch);
+  for (uint32_t i = 0; i < m_shards.size (); i++)
+    {
+      m_shards[i]->AddSwitch (swtch);
+    }
+}
+
+
+void
+FabricManagerCluster::SwitchLocated (Ptr<PortlandSwitchNetDevice> swtch)
+{
+  for (uint32_t i = 0; i < m_shards.size (); i++)
+    {
+      m_shards[i]->SwitchLocated (swtch);
+    }
+}
+
+
+void
+FabricManagerCluster::ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer)
+{
+  GetShard (GetRequestKey (buffer))->ReceiveFromSwitch (swtch, buffer);
+}
+
+
+void
+FabricManagerCluster::RegisterHosts (const std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts)
+{
+  std::map<Ptr<FabricManager>, std::vector<std::pair<Ipv4Address, Mac48Address> > > shares;
+  for (uint32_t h = 0; h < hosts.size (); h++)
+    {
+      shares[GetShard (hosts[h].first)].push_back (hosts[h]);
+    }
+  for (std::map<Ptr<FabricManager>, std::vector<std::pair<Ipv4Address, Mac48Address> > >::iterator s = shares.begin ();
+       s != shares.end (); s++)
+    {
+      s->first->RegisterHosts (s->second);
+    }
+}
+
+
+uint32_t
+FabricManagerCluster::GetNHosts (void) const
+{
+  uint32_t hosts = 0;
+  for (uint32_t i = 0; i < m_shards.size (); i++)
+    {
+      hosts += m_shards[i]->GetNHosts ();
+    }
+  return hosts;
+}
+
+
+uint64_t
+FabricManagerCluster::GetNRequests (void) const
+{
+  uint64_t requests = 0;
+  for (uint32_t i = 0; i < m_shards.size () + m_retired.size (); i++)
+    {
+      Ptr<FabricManager> shard = (i < m_shards.size () ? m_shards[i] : m_retired[i - m_shards.size ()]);
+      requests += shard->GetNRequests ();
+    }
+  return requests;
+}
+
+
+Time
+FabricManagerCluster::GetMeanQueueingDelay (void) const
+{
+  double delay = 0;
+  uint64_t requests = 0;
+  for (uint32_t i = 0; i < m_shards.size () + m_retired.size (); i++)
+    {
+      Ptr<FabricManager> shard = (i < m_shards.size () ? m_shards[i] : m_retired[i - m_shards.size ()]);
+      delay += shard->GetMeanQueueingDelay ().GetSeconds () * shard->GetNRequests ();
+      requests += shard->GetNRequests ();
+    }
+  return (requests == 0 ? Seconds (0) : Seconds (delay / requests));
+}
+
+
+uint32_t
+FabricManagerCluster::GetMaxBacklog (void) const
+{
+  uint32_t backlog = 0;
+  for (uint32_t i = 0; i < m_shards.size () + m_retired.size (); i++)
+    {
+      Ptr<FabricManager> shard = (i < m_shards.size () ? m_shards[i] : m_retired[i - m_shards.size ()]);
+      backlog = std::max (backlog, shard->GetMaxBacklog ());
+    }
+  return backlog;
+}
+
+
+uint64_t
+FabricManagerCluster::GetNRedirects (void) const
+{
+  uint64_t redirects = 0;
+  for (uint32_t i = 0; i < m_shards.size () + m_retired.size (); i++)
+    {
+      Ptr<FabricManager> shard = (i < m_shards.size () ? m_shards[i] : m_retired[i - m_shards.size ()]);
+      redirects += shard->GetNRedirects ();
+    }
+  return redirects;
+}
+
+
+uint64_t
+FabricManagerCluster::GetNMovedHosts (void) const
+{
+  return m_nMovedHosts;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_FABRIC_MANAGER_CLUSTER_H
+#define PORTLAND_FABRIC_MANAGER_CLUSTER_H 1
+
+#include "ns3/object.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "portland-control-message.h"
+#include "portland-fabric-manager.h"
+
+namespace ns3 {
+
+class PortlandSwitchNetDevice;
+
+namespace pld {
+
+/**
+ * \brief A set of Fabric Manager shards that partition the host IP Addresses by consistent hashing.
+ *
+ * Every shard is placed on a hash ring at a number of virtual nodes; a host is owned by the shard
+ * whose virtual node follows the hash of its IP Address on the ring. Switches send each message to
+ * the shard owning the IP Address it is about, so each shard queues and serves only its share of
+ * the control traffic with its own latency and service time.
+ *
+ * Shards can be added and removed while the simulation runs. Only the hosts whose owner changes
+ * are moved, along with the edge switches that may have them cached; messages that reach a shard
+ * which no longer owns them are passed on to the new owner.
+ */
+class FabricManagerCluster : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  FabricManagerCluster ();
+  virtual ~FabricManagerCluster ();
+
+  /**
+   * Creates a shard with the default Fabric Manager attributes and adds it to the cluster.
+   *
+   * \return The new shard.
+   */
+  Ptr<FabricManager> AddShard (void);
+
+  /**
+   * Adds a shard to the cluster and moves the hosts it now owns over from the other shards.
+   */
+  void AddShard (Ptr<FabricManager> shard);
+
+  /**
+   * Removes a shard from the cluster and moves its hosts to their new owners. The shard keeps serving
+   * the messages already sent to it, passing them on to their owners. The last shard cannot be removed.
+   */
+  void RemoveShard (Ptr<FabricManager> shard);
+
+  uint32_t GetNShards (void) const;
+  Ptr<FabricManager> GetShard (uint32_t i) const;
+
+  /**
+   * \return The shard owning the IP Address.
+   */
+  Ptr<FabricManager> GetShard (Ipv4Address ip) const;
+
+  /**
+   * \return The IP Address a switch to Fabric Manager message is about; it decides the owning shard.
+   */
+  static Ipv4Address GetRequestKey (const BufferData& buffer);
+
+  /**
+   * Registers a switch with every shard, present and future.
+   */
+  void AddSwitch (Ptr<PortlandSwitchNetDevice> swtch);
+
+  /**
+   * Tells every shard that a switch running the Location Discovery Protocol has been located.
+   */
+  void SwitchLocated (Ptr<PortlandSwitchNetDevice> swtch);
+
+  /**
+   * Passes a message from a switch on to the shard owning it.
+   */
+  void ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
+
+  /**
+   * Registers the IP Address <-> PMAC mappings of many hosts directly with their owning shards.
+   */
+  void RegisterHosts (const std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts);
+
+  /**
+   * \return Number of hosts with a mapping, over all shards.
+   */
+  uint32_t GetNHosts (void) const;
+
+  /**
+   * \return Number of messages handled, over all shards.
+   */
+  uint64_t GetNRequests (void) const;
+
+  /**
+   * \return Mean queueing delay of the handled messages, over all shards.
+   */
+  Time GetMeanQueueingDelay (void) const;
+
+  /**
+   * \return Largest backlog of any shard.
+   */
+  uint32_t GetMaxBacklog (void) const;
+
+  /**
+   * \return Number of messages passed on between shards, over all shards including removed ones.
+   */
+  uint64_t GetNRedirects (void) const;
+
+  /**
+   * \return Number of host mappings moved between shards by rebalancing.
+   */
+  uint64_t GetNMovedHosts (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static uint32_t Hash (uint64_t key);
+
+  // Moves the hosts of a shard that the ring assigns elsewhere to their owners
+  void Rebalance (Ptr<FabricManager> shard);
+
+  typedef std::map<uint32_t, Ptr<FabricManager> > Ring_t;
+  Ring_t m_ring;                                ///< Hash of virtual node -> shard
+  std::vector<Ptr<FabricManager> > m_shards;
+  std::vector<uint32_t> m_shardIds;             ///< Ring identifier of each shard in m_shards
+  std::vector<Ptr<FabricManager> > m_retired;   ///< Removed shards, kept alive to drain their queues
+  std::set<Ptr<PortlandSwitchNetDevice> > m_switches;
+  uint32_t m_virtualNodes;
+  uint32_t m_nextShardId;
+  uint64_t m_nMovedHosts;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_FABRIC_MANAGER_CLUSTER_H */
@@ -19,6 +19,17 @@
  */
 
 #include "portland-fabric-manager.h"
+#include "portland-fabric-manager-cluster.h"
+#include "portland-event-trace.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/multithreaded-simulator-impl.h"
+#endif
+
+#include <algorithm>
 
 namespace ns3 {
 
@@ -26,6 +37,19 @@ namespace pld {
 
 NS_LOG_COMPONENT_DEFINE ("PortlandFabricManager");
 
+NS_OBJECT_ENSURE_REGISTERED (FabricManager);
+
+
+static bool
+IsMultithreaded (void)
+{
+#ifdef HAVE_PTHREAD_H
+  return MultithreadedSimulatorImpl::IsEnabled ();
+#else
+  return false;
+#endif
+}
+
 
 /*
  * Registers a PortlandSwitchNetDevice as a switch with the fabric manager.
@@ -33,31 +57,86 @@ NS_LOG_COMPONENT_DEFINE ("PortlandFabricManager");
 void
 FabricManager::AddSwitch (Ptr<PortlandSwitchNetDevice> swtch)
 {
-	NS_LOG_UNCOND("Adding switch to fabric manager");
+  NS_LOG_FUNCTION (this << swtch);
   if (m_switches.find (swtch) != m_switches.end ())
     {
-      NS_LOG_UNCOND ("This Fabric Manager has already registered this switch!");
+      NS_LOG_WARN ("This Fabric Manager has already registered this switch!");
     }
   else
     {
+      Ptr<Node> node = swtch->GetNode ();
+      if (node != 0 && !m_switches.empty () && (*m_switches.begin ())->GetNode () != 0
+          && node->GetSystemId () != (*m_switches.begin ())->GetNode ()->GetSystemId ()
+          && IsMultithreaded ())
+        {
+          // the Fabric Manager and the pool of control messages would be shared by the threads of the partitions
+          NS_FATAL_ERROR ("A Fabric Manager can not serve switches of several partitions of a MultithreadedSimulatorImpl");
+        }
       m_switches.insert (swtch);
+      FileSwitch (swtch);
+    }
+}
+
+
+/*
+ * Files a switch by its level; switches still discovering their location are filed once located.
+ */
+void
+FabricManager::FileSwitch (Ptr<PortlandSwitchNetDevice> swtch)
+{
+  if (swtch->GetDeviceType () != UNKNOWN_LEVEL)
+    {
+      uint64_t key = ((uint64_t) swtch->GetDeviceType () << 32) | ((uint32_t) swtch->GetPod () << 16) | swtch->GetPosition ();
+      m_switchIndex[key] = swtch;
+    }
+  if (swtch->GetDeviceType () == CORE)
+    {
+      m_cores.push_back (swtch);
+      if (swtch->GetPosition () == 0)
+        {
+          m_treeRoots.push_back (swtch);
+        }
     }
+  else if (swtch->GetDeviceType () == EDGE)
+    {
+      m_edges.push_back (swtch);
+    }
+  else if (swtch->GetDeviceType () == AGGREGATION)
+    {
+      m_aggregations.push_back (swtch);
+    }
+}
+
+
+void
+FabricManager::SwitchLocated (Ptr<PortlandSwitchNetDevice> swtch)
+{
+  NS_LOG_FUNCTION (this << swtch);
+  NS_ASSERT_MSG (m_switches.find (swtch) != m_switches.end (), "Switch not registered with this Fabric Manager");
+  FileSwitch (swtch);
+  m_nDiscoveredSwitches++;
+  m_lastDiscoveryTime = Simulator::Now ();
 }
 
 
 /* 
- * Function to send a message/action to the switch (No longer in use)
+ * Function to send a message/action to the switch over the control channel
  */
 void
 FabricManager::SendToSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer)
 {
-	NS_LOG_UNCOND("Inside fabric manager send to switch");
 	if (m_switches.find (swtch) == m_switches.end ()) {
 		NS_LOG_ERROR ("Can't send to this switch, not registered to the Fabric Manager.");
+		FreeMessage (buffer);
+		return;
+	}
+	if (MpiInterface::IsEnabled () && swtch->GetNode ()->GetSystemId () != MpiInterface::GetSystemId ()) {
+		// every rank runs a replica of the Fabric Manager, and each talks to the switches of its rank only
+		FreeMessage (buffer);
 		return;
 	}
 
-	//swtch->ForwardControlInput(buffer);
+	Simulator::Schedule (m_latency, &PortlandSwitchNetDevice::ReceiveBufferFromFabricManager, swtch, buffer);
 }
 
 
@@ -67,7 +146,6 @@ FabricManager::SendToSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buff
 PACKET_TYPE
 FabricManager::GetPacketType (BufferData buffer)
 {
-	NS_LOG_UNCOND("In getPacketType");
 	return buffer.pkt_type;
 }
 
@@ -79,45 +157,291 @@ TypeId
 FabricManager::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::pld::FabricManager")
+    .SetParent<Object> ()
     .AddConstructor<FabricManager> ()
-    //.SetParent (Object)
+    .AddAttribute ("Latency",
+                   "One-way latency of the control channel between a switch and the Fabric Manager.",
+                   TimeValue (MicroSeconds (50)),
+                   MakeTimeAccessor (&FabricManager::m_latency),
+                   MakeTimeChecker ())
+    .AddAttribute ("ServiceTime",
+                   "Time the Fabric Manager spends handling one message; messages queue while it is busy.",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&FabricManager::m_serviceTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("Requests",
+                   "Number of messages handled so far.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNRequests),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("MaxBacklog",
+                   "Largest number of messages waiting for or in service at once.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetMaxBacklog),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Redirects",
+                   "Number of messages passed on to the shard of the cluster that owns them.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNRedirects),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("FloodMode",
+                   "Switches an ARP Request for an unknown destination is flooded from: every core switch, "
+                   "one core switch, or the edge switches with host ports that have not been seen yet.",
+                   EnumValue (FLOOD_CORE_TREE),
+                   MakeEnumAccessor (&FabricManager::m_floodMode),
+                   MakeEnumChecker (FLOOD_ALL_CORES, "AllCores",
+                                    FLOOD_CORE_TREE, "CoreTree",
+                                    FLOOD_EDGES, "Edges"))
+    .AddAttribute ("Floods",
+                   "Number of ARP Requests flooded because the destination was unknown.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNFloods),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("DiscoveredSwitches",
+                   "Number of switches located by the Location Discovery Protocol.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNDiscoveredSwitches),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LinkFaults",
+                   "Number of links currently reported down.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNLinkFaults),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MulticastGroups",
+                   "Number of multicast groups with members.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNGroups),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Migrations",
+                   "Number of hosts registered again with a new PMAC, i.e. hosts that moved.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FabricManager::GetNMigrations),
+                   MakeUintegerChecker<uint64_t> ())
   ;
   return tid;
 }
 
 
+FabricManager::FabricManager ()
+  : m_latency (MicroSeconds (50)),
+    m_serviceTime (MicroSeconds (10)),
+    m_busyUntil (Seconds (0)),
+    m_backlog (0),
+    m_maxBacklog (0),
+    m_nRequests (0),
+    m_queueingDelay (Seconds (0)),
+    m_cluster (0),
+    m_nRedirects (0),
+    m_floodMode (FLOOD_CORE_TREE),
+    m_nFloods (0),
+    m_nMigrations (0),
+    m_nDiscoveredSwitches (0),
+    m_lastDiscoveryTime (Seconds (0)),
+    m_nExclusionUpdates (0),
+    m_nGroupRouteUpdates (0)
+{
+}
+
+
 /*
- * Callback from switch with a request buffer
+ * Callback from switch with a request buffer; the message crosses the control channel first
  */
-BufferData
+void
 FabricManager::ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer)
 {
+  Simulator::Schedule (m_latency, &FabricManager::EnqueueRequest, this, swtch, buffer);
+}
+
+
+/*
+ * Function to queue an arrived message behind the ones being served; the Fabric Manager serves one
+ * message at a time, in arrival order
+ */
+void
+FabricManager::EnqueueRequest (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer)
+{
+  Time now = Simulator::Now ();
+  Time start = (m_busyUntil > now ? m_busyUntil : now);
+  m_busyUntil = start + m_serviceTime;
+  m_queueingDelay += start - now;
+  m_backlog++;
+  if (m_backlog > m_maxBacklog)
+  {
+    m_maxBacklog = m_backlog;
+  }
+  Simulator::Schedule (m_busyUntil - now, &FabricManager::HandleRequest, this, swtch, buffer);
+}
+
+
+/*
+ * Function to handle a message once it has been served
+ */
+void
+FabricManager::HandleRequest (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer)
+{
+  m_backlog--;
+
+  if (m_cluster != 0 && (buffer.pkt_type == PKT_MAC_REGISTER || buffer.pkt_type == PKT_ARP_REQUEST))
+  {
+    // the shards were rebalanced while the message was in flight or queued
+    Ptr<FabricManager> owner = m_cluster->GetShard (FabricManagerCluster::GetRequestKey (buffer));
+    if (owner != this)
+    {
+      m_nRedirects++;
+      Simulator::Schedule (m_latency, &FabricManager::EnqueueRequest, owner, swtch, buffer);
+      return;
+    }
+  }
+
+  m_nRequests++;
+
   PACKET_TYPE packet_type = GetPacketType(buffer);
-  NS_LOG_UNCOND("FM received a packet from switch");
   switch (packet_type)
   {
     case PKT_MAC_REGISTER:
     {
-		NS_LOG_UNCOND("Handling PKT_MAC_REGISTER");
-      pld::PMACRegister* message = (pld::PMACRegister*) (buffer.message);
-      return PMACRegisterHandler(message);
+      PMACRegisterHandler(buffer.Get<PMACRegister> (), swtch);
+      break;
     }
 
     case PKT_ARP_REQUEST:
     {
-		NS_LOG_UNCOND("Handling PKT_ARP_REQUEST");
-      pld::ARPRequest* message = (pld::ARPRequest*) (buffer.message);
-      return ARPRequestHandler(message, swtch);
+      ARPRequestHandler(buffer.Get<ARPRequest> (), swtch);
+      break;
+    }
+
+    case PKT_LOCATION_REQUEST:
+    {
+      LocationRequestHandler(buffer.Get<LocationRequest> (), swtch);
+      break;
+    }
+
+    case PKT_FAULT_REPORT:
+    {
+      FaultReportHandler(buffer.Get<FaultReport> ());
+      break;
+    }
+
+    case PKT_GROUP_MEMBERSHIP:
+    {
+      GroupMembershipHandler(buffer.Get<GroupMembership> (), swtch);
+      break;
     }
 
     default:
     {
-		NS_LOG_UNCOND("Wrong packet type");
-      NS_LOG_UNCOND("Wrong packet type detected : ReceiveFromSwitch Fabric Manager");
-      BufferData buffer;
-      return buffer;
+      NS_LOG_WARN("Wrong packet type detected : ReceiveFromSwitch Fabric Manager");
+      break;
     }
   }
+
+  FreeMessage (buffer);
+}
+
+
+uint64_t
+FabricManager::GetNRequests (void) const
+{
+  return m_nRequests;
+}
+
+
+Time
+FabricManager::GetMeanQueueingDelay (void) const
+{
+  return (m_nRequests == 0 ? Seconds (0) : Seconds (m_queueingDelay.GetSeconds () / m_nRequests));
+}
+
+
+uint32_t
+FabricManager::GetMaxBacklog (void) const
+{
+  return m_maxBacklog;
+}
+
+
+uint64_t
+FabricManager::GetNRedirects (void) const
+{
+  return m_nRedirects;
+}
+
+
+uint64_t
+FabricManager::GetNFloods (void) const
+{
+  return m_nFloods;
+}
+
+
+uint64_t
+FabricManager::GetNMigrations (void) const
+{
+  return m_nMigrations;
+}
+
+
+uint32_t
+FabricManager::GetNDiscoveredSwitches (void) const
+{
+  return m_nDiscoveredSwitches;
+}
+
+
+Time
+FabricManager::GetLastDiscoveryTime (void) const
+{
+  return m_lastDiscoveryTime;
+}
+
+
+uint32_t
+FabricManager::GetNPods (void) const
+{
+  return m_podSizes.size ();
+}
+
+
+uint32_t
+FabricManager::GetNLinkFaults (void) const
+{
+  return m_linkFaults.size ();
+}
+
+
+uint64_t
+FabricManager::GetNExclusionUpdates (void) const
+{
+  return m_nExclusionUpdates;
+}
+
+
+uint32_t
+FabricManager::GetNGroups (void) const
+{
+  return m_groupMembers.size ();
+}
+
+
+uint64_t
+FabricManager::GetNGroupRouteUpdates (void) const
+{
+  return m_nGroupRouteUpdates;
+}
+
+
+void
+FabricManager::SetCluster (FabricManagerCluster* cluster)
+{
+  m_cluster = cluster;
 }
 
 
@@ -127,28 +451,144 @@ FabricManager::ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData
 void
 FabricManager::addPMACToTable (Ipv4Address ip, Mac48Address pmac)
 {
-	NS_LOG_UNCOND("adding PMAC to table");
-  IpPMACTable[ip] = pmac;
+  // a recycled PMAC (vmid) no longer locates the host it was handed to before
+  Ipv4Address owner = m_store.FindIP(pmac);
+  Mac48Address previous = m_store.Add(ip, pmac);
+  if (previous != Mac48Address::GetBroadcast() && previous != pmac)
+  {
+    // the host moved; switches must not keep using the old PMAC
+    m_nMigrations++;
+    InvalidatePMAC(ip, previous, pmac);
+  }
+  if (owner != Ipv4Address::GetBroadcast() && owner != ip)
+  {
+    InvalidatePMAC(owner, pmac, Mac48Address::GetBroadcast());
+  }
 }
 
 
 /*
- * Function to return IP Address for the given PMAC
+ * Function to register the IP Address <-> PMAC mappings of many hosts at once, e.g. when the
+ * simulation starts with a populated Fabric Manager; no control messages are exchanged
  */
-Ipv4Address
-FabricManager::getIPforPMAC (Mac48Address pmac)
+void
+FabricManager::RegisterHosts (const std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts)
+{
+  m_store.Reserve(m_store.GetNEntries() + hosts.size());
+  for (std::vector<std::pair<Ipv4Address, Mac48Address> >::const_iterator h = hosts.begin(); h != hosts.end(); h++)
+  {
+    addPMACToTable(h->first, h->second);
+  }
+}
+
+
+uint32_t
+FabricManager::GetNHosts (void) const
+{
+  return m_store.GetNEntries();
+}
+
+
+uint64_t
+FabricManager::GetStoreMemoryUsage (void) const
+{
+  return m_store.GetMemoryUsage();
+}
+
+
+void
+FabricManager::GetHosts (std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts) const
+{
+  m_store.GetMappings(hosts);
+}
+
+
+/*
+ * Function to move the mapping of a host to another Fabric Manager along with its cache subscribers, so
+ * that the new owner can still invalidate the PMAC
+ */
+void
+FabricManager::MoveHost (Ipv4Address ip, Ptr<FabricManager> to)
+{
+  Mac48Address pmac = m_store.FindPMAC(ip);
+  if (pmac == Mac48Address::GetBroadcast())
+  {
+    return;
+  }
+  m_store.Remove(ip);
+  to->addPMACToTable(ip, pmac);
+
+  Subscribers_t::iterator sub = m_subscribers.find(ip);
+  if (sub != m_subscribers.end())
+  {
+    to->m_subscribers[ip].insert(sub->second.begin(), sub->second.end());
+    m_subscribers.erase(sub);
+  }
+}
+
+
+/*
+ * Function to tell the edge switches that were handed the PMAC of an IP Address that it is no longer valid.
+ * When the host moved, the subscribers are given its new PMAC and stay subscribed, and the edge switch that
+ * handed out the old PMAC is told too, so that it forgets the host and traps packets still in flight to it.
+ */
+void
+FabricManager::InvalidatePMAC (Ipv4Address ip, Mac48Address old_pmac, Mac48Address new_pmac)
 {
-	NS_LOG_UNCOND("getting IP for PMAC");
-  it = IpPMACTable.begin();
-  for (it = IpPMACTable.begin(); it != IpPMACTable.end(); ++it)
+  std::set<Ptr<PortlandSwitchNetDevice> > targets;
+  Subscribers_t::iterator sub = m_subscribers.find(ip);
+  if (sub != m_subscribers.end())
   {
-    if (it->second == pmac)
+    targets = sub->second;
+    if (new_pmac == Mac48Address::GetBroadcast())
     {
-      return it->first;
+      m_subscribers.erase(sub);
+    }
+  }
+  if (new_pmac != Mac48Address::GetBroadcast())
+  {
+    Ptr<PortlandSwitchNetDevice> old_edge = GetEdgeSwitch(PMAC::GetPod(old_pmac), PMAC::GetPosition(old_pmac));
+    if (old_edge != 0)
+    {
+      targets.insert(old_edge);
     }
   }
 
-  return Ipv4Address("255.255.255.255");
+  for (std::set<Ptr<PortlandSwitchNetDevice> >::iterator sw = targets.begin(); sw != targets.end(); sw++)
+  {
+    PMACInvalidate* msg;
+    BufferData buffer = CreateMessage (msg);
+    msg->hostIP = ip;
+    msg->oldPMACAddress = old_pmac;
+    msg->newPMACAddress = new_pmac;
+    SendToSwitch(*sw, buffer);
+  }
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+FabricManager::GetEdgeSwitch (uint32_t pod, uint32_t position) const
+{
+  return GetSwitch (EDGE, pod, position);
+}
+
+
+Ptr<PortlandSwitchNetDevice>
+FabricManager::GetSwitch (PortlandSwitchType level, uint32_t pod, uint32_t position) const
+{
+  uint64_t key = ((uint64_t) level << 32) | ((pod & 0xffff) << 16) | (position & 0xffff);
+  std::map<uint64_t, Ptr<PortlandSwitchNetDevice> >::const_iterator it = m_switchIndex.find (key);
+  return (it == m_switchIndex.end () ? 0 : it->second);
+}
+
+
+/*
+ * Function to return IP Address for the given PMAC
+ */
+Ipv4Address
+FabricManager::getIPforPMAC (Mac48Address pmac)
+{
+  return m_store.FindIP(pmac);
 }
 
 
@@ -158,28 +598,18 @@ FabricManager::getIPforPMAC (Mac48Address pmac)
 bool
 FabricManager::isIPRegistered (Ipv4Address ip)
 {
-	NS_LOG_UNCOND("checking if IP is registered");
-  it = IpPMACTable.find(ip);
-  return (it == IpPMACTable.end() ? false : true);
+  return m_store.Contains(ip);
 }
 
 
 /*
- * Function to get PMAC for a given IP Address
+ * Function to get PMAC for a given IP Address; the broadcast address indicates a broadcast/flood
+ * from CORE switches is needed
  */
 Mac48Address
 FabricManager::getPMACforIP (Ipv4Address ip)
 {
-	NS_LOG_UNCOND("get PMAC for IP");
-  if (FabricManager::isIPRegistered(ip))
-  {
-    return IpPMACTable[ip];
-  }
-  else
-  {
-    // indicates a broadcast/flood from CORE switches is needed
-    return Mac48Address("ff:ff:ff:ff:ff:ff");
-  }
+  return m_store.FindPMAC(ip);
 }
 
 
@@ -189,7 +619,6 @@ FabricManager::getPMACforIP (Ipv4Address ip)
 bool
 FabricManager::isPmacRegistered (Mac48Address pmac)
 {
-	NS_LOG_UNCOND("Checking if PMAC is registered");
   Ipv4Address ip = getIPforPMAC(pmac);
   return (ip == Ipv4Address("255.255.255.255") ? false : true);
 }
@@ -198,89 +627,490 @@ FabricManager::isPmacRegistered (Mac48Address pmac)
 /*
  * Function to handle a new IPAddress <-> PMAC mapping registration
  */
-BufferData
-FabricManager::PMACRegisterHandler(pld::PMACRegister* message)
+void
+FabricManager::PMACRegisterHandler(pld::PMACRegister* message, Ptr<PortlandSwitchNetDevice> swtch)
 {
-	NS_LOG_UNCOND("Inside PMAC register handler");
-  BufferData response_buffer;
-  response_buffer.pkt_type = PKT_ARP_RESPONSE;
-  response_buffer.message = (ARPResponse*) malloc(sizeof(ARPResponse));
+  NS_LOG_LOGIC ("FM: Event=PMAC Register, pmac=" << message->PMACAddress << "/" << message->hostIP);
+  PLD_TRACE_EVENT (EventTrace::REGISTER, swtch, message->hostIP, 0);
   addPMACToTable(message->hostIP, message->PMACAddress);
-  NS_LOG_UNCOND("Calling free on message");
-  free(message);
-  NS_LOG_UNCOND("Returning from PMACRegisterHandler");
-  return response_buffer;
 }
 
 
 /*
- * Function to handle a query for PMAC in associated ARP request received on the switch.
+ * Function to handle a query for PMAC in associated ARP request received on the switch; the switch
+ * is answered with the PMAC, or with the broadcast address if the Fabric Manager has to flood the
+ * ARP Request from the CORE switches.
  */
-BufferData
+void
 FabricManager::ARPRequestHandler(pld::ARPRequest* message, Ptr<PortlandSwitchNetDevice> swtch)
 {
-  //NS_LOG_UNCOND("Inside ARP request handler");
-  NS_LOG_UNCOND("FM: Event=PMAC Query, src=" << message->srcPMACAddress << "/" << message->srcIPAddress << ", dst=" << "unknown" << "/" << message->destIPAddress);
-  if (FabricManager::isIPRegistered(message->destIPAddress))
+  NS_LOG_LOGIC ("FM: Event=PMAC Query, src=" << message->srcPMACAddress << "/" << message->srcIPAddress << ", dst=" << "unknown" << "/" << message->destIPAddress);
+  PLD_TRACE_EVENT (EventTrace::QUERY, swtch, message->destIPAddress, 0);
+  ARPResponse* msg;
+  BufferData response = CreateMessage (msg);
+  msg->srcIPAddress = message->srcIPAddress;
+  msg->srcPMACAddress = message->srcPMACAddress;
+  msg->destIPAddress = message->destIPAddress;
+
+  msg->destPMACAddress = getPMACforIP(message->destIPAddress);
+  if (msg->destPMACAddress != Mac48Address::GetBroadcast())
   {
     // IP address mapping present
-    ARPResponse* msg = (pld::ARPResponse*) malloc (sizeof(ARPResponse));
-    msg->srcIPAddress = message->srcIPAddress;
-    msg->srcPMACAddress = message->srcPMACAddress;
-    msg->destIPAddress = message->destIPAddress;
-    msg->destPMACAddress = getPMACforIP(message->destIPAddress);
-    return ARPResponseHandler(msg, swtch);
+    PLD_TRACE_EVENT (EventTrace::HIT, swtch, message->destIPAddress, 0);
+    m_subscribers[message->destIPAddress].insert(swtch);
   } else {
     // Miss in the store, flood it to core
-    FloodARPRequest((pld::ARPFloodRequest *)message, swtch);
-    ARPResponse* msg = (pld::ARPResponse*) malloc (sizeof(ARPResponse));
-    msg->srcIPAddress = message->srcIPAddress;
-    msg->srcPMACAddress = message->srcPMACAddress;
-    msg->destIPAddress = message->destIPAddress;
-    msg->destPMACAddress = Mac48Address("ff:ff:ff:ff:ff:ff");
-    return ARPResponseHandler(msg, swtch);
+    PLD_TRACE_EVENT (EventTrace::MISS, swtch, message->destIPAddress, 0);
+    FloodARPRequest(message, swtch);
   }
-  
-  free(message);
+
+  SendToSwitch(swtch, response);
 }
 
 
 /*
- * Function to create a response to query for PMAC in associated ARP request received on the switch.
+ * Function to give an EDGE switch found by the Location Discovery Protocol its pod and position. The EDGE
+ * switches of a pod share their aggregation switches, so the lowest aggregation switch identifier names the
+ * pod; pods are numbered, and the EDGE switches of a pod positioned, in the order they ask. A switch that asks
+ * again is given the same location.
  */
-BufferData
-FabricManager::ARPResponseHandler(pld::ARPResponse* msg, Ptr<PortlandSwitchNetDevice> swtch)
+void
+FabricManager::LocationRequestHandler(pld::LocationRequest* message, Ptr<PortlandSwitchNetDevice> swtch)
 {
-	NS_LOG_UNCOND("Inside ARP response handler");
-  BufferData buffer;
-  buffer.pkt_type = PKT_ARP_RESPONSE;
-  buffer.message = msg;	
+  std::map<Mac48Address, std::pair<uint16_t, uint16_t> >::iterator location = m_locations.find(message->switchId);
+  if (location == m_locations.end())
+  {
+    std::map<Mac48Address, uint16_t>::iterator pod = m_pods.find(message->podId);
+    if (pod == m_pods.end())
+    {
+      pod = m_pods.insert(std::make_pair(message->podId, (uint16_t) m_podSizes.size())).first;
+      m_podSizes.push_back(0);
+    }
+    uint16_t position = m_podSizes[pod->second]++;
+    NS_ABORT_MSG_IF (pod->second > PMAC::MAX_POD || position > PMAC::MAX_POSITION,
+                     "Location " << pod->second << "." << position << " does not fit in the PMAC layout");
+    location = m_locations.insert(std::make_pair(message->switchId, std::make_pair(pod->second, position))).first;
+  }
+  NS_LOG_LOGIC ("FM: Event=Location, switch=" << message->switchId << ", pod=" << location->second.first
+                << ", position=" << location->second.second);
 
-  return buffer;
+  LocationAssign* msg;
+  BufferData reply = CreateMessage (msg);
+  msg->pod = location->second.first;
+  msg->position = location->second.second;
+  SendToSwitch(swtch, reply);
 }
 
 
 /*
- * Function to handle the case of no existing IP Address <-> PMAC mapping
- * by instructing the CORE switches to broadcast ARP Requests for given IP Address
+ * Function to record a link going down or coming back up, as reported by either of its switches, and to tell the
+ * switches whose upstream choices lead over it which upper ports to avoid. A failed link between an EDGE switch
+ * and the AGGREGATION switch in position j cuts every path through position j to that EDGE switch, so all
+ * EDGE switches exclude upper port j for it. A failed link between an AGGREGATION switch and a CORE switch cuts
+ * the CORE switch off from the pod, so the AGGREGATION switches of the same position in the other pods exclude
+ * that CORE switch for the pod; EDGE switches exclude position j for a pod only once no CORE switch of group j
+ * links both pods. A switch avoids its own failed upper ports without being told.
  */
 void
-FabricManager::FloodARPRequest(pld::ARPFloodRequest* msg, Ptr<PortlandSwitchNetDevice> swtch)
+FabricManager::FaultReportHandler(pld::FaultReport* message)
+{
+  uint64_t key = GetLinkKey(message->level, message->pod, message->position, message->uplink);
+  bool changed = (message->up ? m_linkFaults.erase(key) > 0 : m_linkFaults.insert(key).second);
+  NS_LOG_LOGIC ("FM: Event=Link " << (message->up ? "up" : "down") << ", level=" << (uint32_t) message->level
+                << ", pod=" << message->pod << ", position=" << message->position << ", uplink=" << message->uplink);
+  if (!changed)
+  {
+    // already reported by the other end of the link
+    return;
+  }
+
+  // the trees of the multicast groups move off the link while it is down
+  for (GroupMembers_t::const_iterator g = m_groupMembers.begin(); g != m_groupMembers.end(); g++)
+  {
+    UpdateGroupTree(g->first);
+  }
+
+  if (message->level == EDGE)
+  {
+    for (SwitchList_t::iterator e = m_edges.begin(); e != m_edges.end(); e++)
+    {
+      if ((*e)->GetPod() != message->pod || (*e)->GetPosition() != message->position)
+      {
+        SendExclusion(*e, message->pod, message->position, GetEdgeExclusion(*e, message->pod, message->position));
+      }
+    }
+  }
+  else if (message->level == AGGREGATION)
+  {
+    for (SwitchList_t::iterator a = m_aggregations.begin(); a != m_aggregations.end(); a++)
+    {
+      if ((*a)->GetPosition() == message->position && (*a)->GetPod() != message->pod)
+      {
+        SendExclusion(*a, message->pod, PortExclusion::ANY_POSITION, GetAggregationExclusion(*a, message->pod));
+      }
+    }
+    // paths between the pod and every other pod may have lost the whole CORE group
+    for (SwitchList_t::iterator e = m_edges.begin(); e != m_edges.end(); e++)
+    {
+      for (SwitchList_t::iterator d = m_edges.begin(); d != m_edges.end(); d++)
+      {
+        if ((*e)->GetPod() != (*d)->GetPod() && ((*e)->GetPod() == message->pod || (*d)->GetPod() == message->pod))
+        {
+          SendExclusion(*e, (*d)->GetPod(), (*d)->GetPosition(), GetEdgeExclusion(*e, (*d)->GetPod(), (*d)->GetPosition()));
+        }
+      }
+    }
+  }
+}
+
+
+uint64_t
+FabricManager::GetLinkKey(uint8_t level, uint16_t pod, uint16_t position, uint16_t uplink)
+{
+  return ((uint64_t) level << 48) | ((uint64_t) pod << 32) | ((uint64_t) position << 16) | uplink;
+}
+
+
+bool
+FabricManager::IsLinkDown(uint8_t level, uint16_t pod, uint16_t position, uint16_t uplink) const
+{
+  return !m_linkFaults.empty() && m_linkFaults.find(GetLinkKey(level, pod, position, uplink)) != m_linkFaults.end();
+}
+
+
+uint64_t
+FabricManager::GetEdgeExclusion(Ptr<PortlandSwitchNetDevice> edge, uint16_t pod, uint16_t position) const
 {
-	NS_LOG_UNCOND("Inside FloodARPRequest");
-  BufferData buffer;
-  buffer.pkt_type = PKT_ARP_FLOOD;
-  buffer.message = msg;
+  uint32_t n_uplinks = std::min<uint32_t> (edge->GetNUpperPorts(), 64);
+  uint32_t n_cores = (m_aggregations.empty() ? 0 : m_aggregations[0]->GetNUpperPorts());
+  uint64_t excluded = 0;
+  for (uint32_t j = 0; j < n_uplinks; j++)
+  {
+    bool cut = IsLinkDown(EDGE, pod, position, j);
+    if (!cut && edge->GetPod() != pod)
+    {
+      // the AGGREGATION switches in position j of both pods need a live CORE switch in common
+      cut = true;
+      for (uint32_t c = 0; c < n_cores && cut; c++)
+      {
+        cut = IsLinkDown(AGGREGATION, edge->GetPod(), j, c) || IsLinkDown(AGGREGATION, pod, j, c);
+      }
+    }
+    if (cut)
+    {
+      excluded |= (uint64_t) 1 << j;
+    }
+  }
+  return excluded;
+}
+
 
-  for (std::set<Ptr<PortlandSwitchNetDevice> >::iterator it = m_switches.begin(); it != m_switches.end(); it++)
+uint64_t
+FabricManager::GetAggregationExclusion(Ptr<PortlandSwitchNetDevice> aggregation, uint16_t pod) const
+{
+  uint32_t n_uplinks = std::min<uint32_t> (aggregation->GetNUpperPorts(), 64);
+  uint64_t excluded = 0;
+  for (uint32_t c = 0; c < n_uplinks; c++)
   {
-    if ( (*it)->GetDeviceType () == CORE && (*it) != swtch)
+    if (IsLinkDown(AGGREGATION, pod, aggregation->GetPosition(), c))
     {
-      (*it)->ReceiveBufferFromFabricManager(buffer);
+      excluded |= (uint64_t) 1 << c;
     }
   }
-  NS_LOG_UNCOND("Finished FloodARPRequest");
-  free(buffer.message);
+  return excluded;
+}
+
+
+void
+FabricManager::SendExclusion(Ptr<PortlandSwitchNetDevice> swtch, uint16_t pod, uint16_t position, uint64_t uplinks)
+{
+  uint32_t destination = ((uint32_t) pod << 16) | position;
+  std::map<uint32_t, uint64_t>& sent = m_exclusions[swtch];
+  std::map<uint32_t, uint64_t>::iterator it = sent.find(destination);
+  if ((it == sent.end() ? 0 : it->second) == uplinks)
+  {
+    return;
+  }
+  if (uplinks == 0)
+  {
+    sent.erase(it);
+  }
+  else
+  {
+    sent[destination] = uplinks;
+  }
+
+  m_nExclusionUpdates++;
+  PortExclusion* msg;
+  BufferData buffer = CreateMessage (msg);
+  msg->pod = pod;
+  msg->position = position;
+  msg->uplinks = uplinks;
+  SendToSwitch(swtch, buffer);
+}
+
+
+/*
+ * Function to track the EDGE switches with members of a multicast group; an EDGE switch reports its first
+ * member joining and its last member leaving.
+ */
+void
+FabricManager::GroupMembershipHandler(GroupMembership* message, Ptr<PortlandSwitchNetDevice> swtch)
+{
+  std::pair<uint16_t, uint16_t> edge (swtch->GetPod(), swtch->GetPosition());
+  bool changed;
+  if (message->join)
+  {
+    changed = m_groupMembers[message->group].insert(edge).second;
+  }
+  else
+  {
+    GroupMembers_t::iterator g = m_groupMembers.find(message->group);
+    changed = (g != m_groupMembers.end() && g->second.erase(edge) > 0);
+    if (g != m_groupMembers.end() && g->second.empty())
+    {
+      m_groupMembers.erase(g);
+    }
+  }
+  NS_LOG_LOGIC ("FM: Event=Group " << (message->join ? "join" : "leave") << ", group=" << message->group
+                << ", pod=" << edge.first << ", position=" << edge.second);
+  if (changed)
+  {
+    UpdateGroupTree(message->group);
+  }
+}
+
+
+static bool
+IsSameGroupRoute (const GroupRoute& a, const GroupRoute& b)
+{
+  return a.ports == b.ports && a.up == b.up && a.uplink == b.uplink;
+}
+
+
+/*
+ * The tree of a group is rooted at CORE switch c of group j: the AGGREGATION switches in position j of the pods
+ * with members copy packets down to the EDGE switches with members, and up to the root if other pods have
+ * members; the root copies them down to those pods. The root keeps the group's pods even if they are all the
+ * same pod, as senders elsewhere without state send towards it. (j, c) is picked by HashGroup; while a link of
+ * that tree to a member is reported down, the tree moves to the next (j, c) whose links are all up, and the
+ * switches of the tree are told the upper port it goes up on.
+ */
+void
+FabricManager::UpdateGroupTree(Ipv4Address group)
+{
+  GroupRoutes_t routes;
+  GroupMembers_t::const_iterator g = m_groupMembers.find(group);
+  if (g != m_groupMembers.end() && !m_edges.empty() && !m_aggregations.empty())
+  {
+    uint32_t h = PortlandSwitchNetDevice::HashGroup(group);
+    uint32_t n_aggregations = std::max<uint32_t> (m_edges[0]->GetNUpperPorts(), 1);
+    uint32_t n_cores = std::max<uint32_t> (m_aggregations[0]->GetNUpperPorts(), 1);
+    uint32_t j = h % n_aggregations;
+    uint32_t c = (h / n_aggregations) % n_cores;
+
+    std::map<uint16_t, uint64_t> pods;          // pod -> EDGE positions with members
+    for (std::set<std::pair<uint16_t, uint16_t> >::const_iterator e = g->second.begin(); e != g->second.end(); e++)
+    {
+      uint64_t& positions = pods[e->first];
+      if (e->second < 64)
+      {
+        positions |= (uint64_t) 1 << e->second;
+      }
+    }
+
+    if (!m_linkFaults.empty())
+    {
+      // the first (j, c) from the hashed one on whose links from the members to the root none is down
+      bool found = false;
+      for (uint32_t n = 0; n < n_aggregations * n_cores && !found; n++)
+      {
+        uint32_t tj = (j + n / n_cores) % n_aggregations;
+        uint32_t tc = (c + n % n_cores) % n_cores;
+        found = true;
+        for (std::set<std::pair<uint16_t, uint16_t> >::const_iterator e = g->second.begin(); e != g->second.end() && found; e++)
+        {
+          found = !IsLinkDown(EDGE, e->first, e->second, tj);
+        }
+        // the links to the root only carry the members' packets if the members span pods
+        for (std::map<uint16_t, uint64_t>::const_iterator p = pods.begin(); p != pods.end() && found && pods.size() > 1; p++)
+        {
+          found = !IsLinkDown(AGGREGATION, p->first, tj, tc);
+        }
+        if (found)
+        {
+          j = tj;
+          c = tc;
+        }
+      }
+    }
+
+    GroupRoute route;
+    route.group = group;
+    route.ports = 0;
+    route.up = g->second.size() > 1;
+    route.uplink = j;
+    for (std::set<std::pair<uint16_t, uint16_t> >::const_iterator e = g->second.begin(); e != g->second.end(); e++)
+    {
+      Ptr<PortlandSwitchNetDevice> edge = GetSwitch(EDGE, e->first, e->second);
+      if (edge != 0)
+      {
+        routes[edge] = route;
+      }
+    }
+
+    uint64_t root_ports = 0;
+    route.up = pods.size() > 1;
+    route.uplink = c;
+    for (std::map<uint16_t, uint64_t>::const_iterator p = pods.begin(); p != pods.end(); p++)
+    {
+      Ptr<PortlandSwitchNetDevice> aggregation = GetSwitch(AGGREGATION, p->first, j);
+      if (aggregation != 0)
+      {
+        route.ports = p->second;
+        routes[aggregation] = route;
+      }
+      if (p->first < 64)
+      {
+        root_ports |= (uint64_t) 1 << p->first;
+      }
+    }
+    Ptr<PortlandSwitchNetDevice> root = GetSwitch(CORE, j, c);
+    if (root != 0)
+    {
+      route.ports = root_ports;
+      route.up = false;
+      route.uplink = 0;
+      routes[root] = route;
+    }
+  }
+
+  GroupRoutes_t& sent = m_groupRoutes[group];
+  for (GroupRoutes_t::const_iterator r = routes.begin(); r != routes.end(); r++)
+  {
+    GroupRoutes_t::const_iterator old = sent.find(r->first);
+    if (old == sent.end() || !IsSameGroupRoute(old->second, r->second))
+    {
+      SendGroupRoute(r->first, r->second);
+    }
+  }
+  for (GroupRoutes_t::const_iterator old = sent.begin(); old != sent.end(); old++)
+  {
+    if (routes.find(old->first) == routes.end())
+    {
+      GroupRoute removal = old->second;
+      removal.ports = 0;
+      removal.up = false;
+      SendGroupRoute(old->first, removal);
+    }
+  }
+  if (routes.empty())
+  {
+    m_groupRoutes.erase(group);
+  }
+  else
+  {
+    sent.swap(routes);
+  }
+}
+
+
+void
+FabricManager::SendGroupRoute(Ptr<PortlandSwitchNetDevice> swtch, const GroupRoute& route)
+{
+  m_nGroupRouteUpdates++;
+  GroupRoute* msg;
+  BufferData buffer = CreateMessage (msg);
+  *msg = route;
+  SendToSwitch(swtch, buffer);
+}
+
+
+
+/*
+ * Function to handle the case of no existing IP Address <-> PMAC mapping by instructing switches to
+ * broadcast ARP Requests for given IP Address. The aggregation switches pass on a flood from the core
+ * only when it arrives on their lowest upper port that is up, which connects to the core in that position,
+ * so a single core reaches every edge switch exactly once while no link is down. Otherwise the flood also
+ * starts at the cores of the same group that are the lowest live uplink of some aggregation switch.
+ */
+void
+FabricManager::FloodARPRequest(pld::ARPRequest* message, Ptr<PortlandSwitchNetDevice> swtch)
+{
+  NS_LOG_LOGIC ("FM: Event=Flood, dst=" << message->destIPAddress);
+  m_nFloods++;
+
+  SwitchList_t targets;
+  if (m_floodMode == FLOOD_CORE_TREE && !m_treeRoots.empty())
+  {
+    // spread the floods over the roots by destination
+    uint32_t root = message->destIPAddress.Get() * 2654435761U;
+    Ptr<PortlandSwitchNetDevice> core = m_treeRoots[(root >> 16) % m_treeRoots.size()];
+    if (m_linkFaults.empty())
+    {
+      targets.push_back(core);
+    }
+    else
+    {
+      // the AGGREGATION switches of the core's position in each pod take the flood from the same rule
+      uint16_t group = core->GetPod();
+      uint64_t positions = 0;
+      for (SwitchList_t::iterator a = m_aggregations.begin(); a != m_aggregations.end(); a++)
+      {
+        if ((*a)->GetPosition() != group)
+        {
+          continue;
+        }
+        uint32_t n_uplinks = std::min<uint32_t> ((*a)->GetNUpperPorts(), 64);
+        for (uint32_t j = 0; j < n_uplinks; j++)
+        {
+          if (!IsLinkDown(AGGREGATION, (*a)->GetPod(), group, j))
+          {
+            positions |= (uint64_t) 1 << j;
+            break;
+          }
+        }
+      }
+      for (uint32_t j = 0; j < 64 && (positions >> j) != 0; j++)
+      {
+        core = GetSwitch(CORE, group, j);
+        if (((positions >> j) & 1) && core != 0)
+        {
+          targets.push_back(core);
+        }
+      }
+    }
+  }
+  else if (m_floodMode == FLOOD_EDGES)
+  {
+    for (SwitchList_t::iterator it = m_edges.begin(); it != m_edges.end(); it++)
+    {
+      if ((*it)->HasUnresolvedHosts())
+      {
+        targets.push_back(*it);
+      }
+    }
+  }
+  else
+  {
+    for (SwitchList_t::iterator it = m_cores.begin(); it != m_cores.end(); it++)
+    {
+      if ((*it) != swtch)
+      {
+        targets.push_back(*it);
+      }
+    }
+  }
+
+  for (SwitchList_t::iterator it = targets.begin(); it != targets.end(); it++)
+  {
+    ARPFloodRequest* msg;
+    BufferData buffer = CreateMessage (msg);
+    msg->destIPAddress = message->destIPAddress;
+    msg->srcIPAddress = message->srcIPAddress;
+    msg->srcPMACAddress = message->srcPMACAddress;
+    SendToSwitch(*it, buffer);
+  }
 }
 
 
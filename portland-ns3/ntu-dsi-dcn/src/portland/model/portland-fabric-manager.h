@@ -34,8 +34,11 @@
 #include <set>
 #include <map>
 #include <limits>
+#include <vector>
 
 #include "portland.h"
+#include "portland-control-message.h"
+#include "portland-ip-pmac-store.h"
 #include "portland-switch-net-device.h"
 
 namespace ns3 {
@@ -44,35 +47,7 @@ class PortlandSwitchNetDevice;
 
 namespace pld {
 
-// Message information for fabric manager
-typedef struct BufferData {
-    PACKET_TYPE pkt_type; // PACKET_TYPE enum defined in portland.h
-    void* message; // Need to cast the message based on the packet type
-} BufferData;
-
-typedef struct PMACRegister {
-    Ipv4Address hostIP;
-    Mac48Address PMACAddress;
-} PMACRegister;
-
-typedef struct ARPRequest {
-    Ipv4Address destIPAddress;
-    Ipv4Address srcIPAddress;
-    Mac48Address srcPMACAddress;
-} ARPRequest;
-
-typedef struct ARPResponse {
-	Ipv4Address destIPAddress;
-	Mac48Address destPMACAddress;
-	Ipv4Address srcIPAddress;
-  Mac48Address srcPMACAddress;
-} ARPResponse;
-
-typedef struct ARPFloodRequest {
-    Ipv4Address destIPAddress;
-    Ipv4Address srcIPAddress;
-    Mac48Address srcPMACAddress;
-} ARPFloodIPAddress;
+class FabricManagerCluster;
 
 /**
  * \brief An interface for a FabricManager of PortlandSwitchNetDevices
@@ -83,8 +58,29 @@ class FabricManager : public Object {
 public:
     static TypeId GetTypeId (void);
 
+  /**
+   * Switches an ARP Request is flooded from when the Fabric Manager does not know the destination.
+   */
+    enum FloodMode {
+      FLOOD_ALL_CORES,    ///< Every core switch floods to every pod; aggregation switches drop the duplicates
+      FLOOD_CORE_TREE,    ///< One core switch floods, more of its group if links are down; it reaches every pod once
+      FLOOD_EDGES         ///< Only edge switches with host ports that have not been seen yet flood, to those ports
+    };
+
+    FabricManager ();
+
     ~FabricManager () {
         m_switches.clear ();
+        m_cores.clear ();
+        m_treeRoots.clear ();
+        m_edges.clear ();
+        m_aggregations.clear ();
+        m_exclusions.clear ();
+        m_switchIndex.clear ();
+        m_groupMembers.clear ();
+        m_groupRoutes.clear ();
+        m_pods.clear ();
+        m_locations.clear ();
     }
 
   /**
@@ -95,18 +91,123 @@ public:
    virtual void AddSwitch (Ptr<PortlandSwitchNetDevice> swtch);
 
   /**
-   * A switch calls this method to pass a message on to the Fabric Manager.
+   * A switch running the Location Discovery Protocol calls this method once it knows its level, pod
+   * and position; until then the Fabric Manager does not flood through it or invalidate PMACs on it.
+   */
+    void SwitchLocated (Ptr<PortlandSwitchNetDevice> swtch);
+
+  /**
+   * A switch calls this method to pass a message on to the Fabric Manager. The message reaches the
+   * Fabric Manager after the channel latency and is handled, in arrival order, after the service time;
+   * any reply is sent back to the switch with ReceiveBufferFromFabricManager.
    *
    * \param swtch The switch the message was received from.
-   * \param buffer The message.
+   * \param buffer The message; owned by the Fabric Manager from now on.
+   */
+    void ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
+
+  /**
+   * Registers the IP Address <-> PMAC mappings of many hosts directly, without control messages;
+   * meant for populating the Fabric Manager before the simulation starts.
+   */
+    void RegisterHosts (const std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts);
+
+  /**
+   * \return Number of hosts with an IP Address <-> PMAC mapping.
+   */
+    uint32_t GetNHosts (void) const;
+
+  /**
+   * \return Bytes allocated by the IP Address <-> PMAC store.
+   */
+    uint64_t GetStoreMemoryUsage (void) const;
+
+  /**
+   * Appends the IP Address <-> PMAC mappings of all registered hosts to hosts.
+   */
+    void GetHosts (std::vector<std::pair<Ipv4Address, Mac48Address> >& hosts) const;
+
+  /**
+   * Hands the mapping of a host, and the edge switches that may have it cached, over to another
+   * Fabric Manager; used when a FabricManagerCluster rebalances its shards.
+   */
+    void MoveHost (Ipv4Address ip, Ptr<FabricManager> to);
+
+  /**
+   * Makes this Fabric Manager a shard of a cluster; messages it does not own are passed on to the
+   * owning shard. The cluster is not owned by the Fabric Manager.
+   */
+    void SetCluster (FabricManagerCluster* cluster);
+
+  /**
+   * \return Number of messages passed on to the owning shard of the cluster.
+   */
+    uint64_t GetNRedirects (void) const;
+
+  /**
+   * \return Number of ARP Requests flooded because the destination was unknown.
+   */
+    uint64_t GetNFloods (void) const;
+
+  /**
+   * \return Number of hosts registered again with a new PMAC, i.e. hosts that moved.
+   */
+    uint64_t GetNMigrations (void) const;
+
+  /**
+   * \return Number of switches located by the Location Discovery Protocol.
+   */
+    uint32_t GetNDiscoveredSwitches (void) const;
+
+  /**
+   * \return Time at which the last switch was located by the Location Discovery Protocol.
    */
-    BufferData ReceiveFromSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
+    Time GetLastDiscoveryTime (void) const;
+
+  /**
+   * \return Number of pods the Fabric Manager has numbered for the Location Discovery Protocol.
+   */
+    uint32_t GetNPods (void) const;
+
+  /**
+   * \return Number of links currently reported down.
+   */
+    uint32_t GetNLinkFaults (void) const;
+
+  /**
+   * \return Number of port exclusion updates sent to switches.
+   */
+    uint64_t GetNExclusionUpdates (void) const;
+
+  /**
+   * \return Number of multicast groups with members.
+   */
+    uint32_t GetNGroups (void) const;
+
+  /**
+   * \return Number of multicast replication updates sent to switches.
+   */
+    uint64_t GetNGroupRouteUpdates (void) const;
+
+  /**
+   * \return Number of messages handled so far.
+   */
+    uint64_t GetNRequests (void) const;
+
+  /**
+   * \return Mean time the handled messages waited for the Fabric Manager to become idle.
+   */
+    Time GetMeanQueueingDelay (void) const;
+
+  /**
+   * \return Largest number of messages waiting for or in service at once.
+   */
+    uint32_t GetMaxBacklog (void) const;
 
 private:
 
     // IP - PMAC table and management functions
-    std::map<Ipv4Address, Mac48Address> IpPMACTable;
-    std::map<Ipv4Address, Mac48Address>::iterator it;
+    IpPMACStore m_store;
 
     void addPMACToTable(Ipv4Address ip, Mac48Address pmac);
 
@@ -118,22 +219,111 @@ private:
 
     bool isPmacRegistered (Mac48Address pmac);
 
+    // Edge switches that have been handed the PMAC of an IP, and so may have it cached
+    typedef std::map<Ipv4Address, std::set<Ptr<PortlandSwitchNetDevice> > > Subscribers_t;
+    Subscribers_t m_subscribers;
+
+    // Tells the subscribers of ip, and the edge switch that handed out old_pmac if the host moved to
+    // new_pmac, that old_pmac is no longer valid
+    void InvalidatePMAC(Ipv4Address ip, Mac48Address old_pmac, Mac48Address new_pmac);
+
+    // Files a switch whose level is known under the CORE, tree root or EDGE switches
+    void FileSwitch(Ptr<PortlandSwitchNetDevice> swtch);
+
+    // EDGE switch at a pod and position, or 0
+    Ptr<PortlandSwitchNetDevice> GetEdgeSwitch(uint32_t pod, uint32_t position) const;
+
+    // Switch of a level at a pod (group of a CORE switch) and position, or 0
+    Ptr<PortlandSwitchNetDevice> GetSwitch(PortlandSwitchType level, uint32_t pod, uint32_t position) const;
+
+    // Queues a message that has crossed the control channel behind the ones being served
+    void EnqueueRequest(Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
+
+    // Handles a message once it has been served, then frees it
+    void HandleRequest(Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
+
     // Fabric manager function handlers for packet types
-    BufferData PMACRegisterHandler(PMACRegister* message);
+    void PMACRegisterHandler(PMACRegister* message, Ptr<PortlandSwitchNetDevice> swtch);
+
+    void ARPRequestHandler(ARPRequest* message, Ptr<PortlandSwitchNetDevice> swtch);
+
+    void LocationRequestHandler(LocationRequest* message, Ptr<PortlandSwitchNetDevice> swtch);
+
+    void FaultReportHandler(FaultReport* message);
+
+    void GroupMembershipHandler(GroupMembership* message, Ptr<PortlandSwitchNetDevice> swtch);
+
+    // Computes the tree of a group, rooted at the CORE switch picked by PortlandSwitchNetDevice::HashGroup, or the
+    // next one whose links to the members are up, and pruned to the EDGE switches with members, and sends the
+    // switches whose replication state changed
+    void UpdateGroupTree(Ipv4Address group);
+
+    void SendGroupRoute(Ptr<PortlandSwitchNetDevice> swtch, const GroupRoute& route);
+
+    // Link failures: a link is named by the level, pod and position of its lower switch and the upper port of
+    // that switch it is on
+    static uint64_t GetLinkKey(uint8_t level, uint16_t pod, uint16_t position, uint16_t uplink);
+    bool IsLinkDown(uint8_t level, uint16_t pod, uint16_t position, uint16_t uplink) const;
+
+    // Upper ports of an EDGE switch that lead to no live path to the EDGE switch at pod.position
+    uint64_t GetEdgeExclusion(Ptr<PortlandSwitchNetDevice> edge, uint16_t pod, uint16_t position) const;
 
-    BufferData ARPRequestHandler(ARPRequest* message, Ptr<PortlandSwitchNetDevice> swtch);
+    // Upper ports of an AGGREGATION switch whose CORE switches have lost the pod
+    uint64_t GetAggregationExclusion(Ptr<PortlandSwitchNetDevice> aggregation, uint16_t pod) const;
 
-    BufferData ARPResponseHandler(ARPResponse* message, Ptr<PortlandSwitchNetDevice> swtch);
+    // Sends a switch its excluded upper ports for a destination, if they changed
+    void SendExclusion(Ptr<PortlandSwitchNetDevice> swtch, uint16_t pod, uint16_t position, uint64_t uplinks);
 
     // Packets being generated by the fabric manager
-    void FloodARPRequest(ARPFloodRequest* message, Ptr<PortlandSwitchNetDevice> swtch);
+    void FloodARPRequest(ARPRequest* message, Ptr<PortlandSwitchNetDevice> swtch);
+
+    Time m_latency;                 ///< One-way latency of the control channel
+    Time m_serviceTime;             ///< Time the Fabric Manager spends on one message
+    Time m_busyUntil;               ///< Time at which the last queued message will have been served
+    uint32_t m_backlog;             ///< Messages waiting for or in service
+    uint32_t m_maxBacklog;
+    uint64_t m_nRequests;
+    Time m_queueingDelay;           ///< Sum of the time messages waited for service
+    FabricManagerCluster* m_cluster;        ///< Cluster this Fabric Manager is a shard of, if any
+    uint64_t m_nRedirects;
+    FloodMode m_floodMode;
+    uint64_t m_nFloods;
+    uint64_t m_nMigrations;
+    uint32_t m_nDiscoveredSwitches;
+    Time m_lastDiscoveryTime;
+    uint64_t m_nExclusionUpdates;
+    uint64_t m_nGroupRouteUpdates;
+
+    std::set<uint64_t> m_linkFaults;            ///< Links reported down
+    typedef std::map<Ptr<PortlandSwitchNetDevice>, std::map<uint32_t, uint64_t> > Exclusions_t;
+    Exclusions_t m_exclusions;                  ///< Switch -> destination -> upper ports it was told to exclude
+
+    // Multicast groups: the EDGE switches with members, and the replication state sent to the switches of the tree
+    typedef std::map<Ipv4Address, std::set<std::pair<uint16_t, uint16_t> > > GroupMembers_t;
+    GroupMembers_t m_groupMembers;              ///< Group -> pod, position of the EDGE switches with members
+    typedef std::map<Ptr<PortlandSwitchNetDevice>, GroupRoute> GroupRoutes_t;
+    std::map<Ipv4Address, GroupRoutes_t> m_groupRoutes;     ///< Group -> switch -> replication state sent
+
+    // Location Discovery Protocol: the pod of the EDGE switches sharing an aggregation switch, and the
+    // pod and position given to each EDGE switch
+    std::map<Mac48Address, uint16_t> m_pods;                    ///< Pod identifier -> pod
+    std::vector<uint16_t> m_podSizes;                           ///< Pod -> EDGE switches given a position in it
+    std::map<Mac48Address, std::pair<uint16_t, uint16_t> > m_locations;     ///< EDGE switch -> pod, position
+
+    typedef std::vector<Ptr<PortlandSwitchNetDevice> > SwitchList_t;
+    SwitchList_t m_cores;           ///< CORE switches, in registration order
+    SwitchList_t m_treeRoots;       ///< CORE switches in position 0, one per group of FLOOD_CORE_TREE floods
+    SwitchList_t m_edges;           ///< EDGE switches
+    SwitchList_t m_aggregations;    ///< AGGREGATION switches
+    std::map<uint64_t, Ptr<PortlandSwitchNetDevice> > m_switchIndex;   ///< Level, pod, position -> located switch
 
 protected:
   /**
    * \internal
    *
    * However the faric manager is implemented, this method is to
-   * be used to pass a message on to a switch.
+   * be used to pass a message on to a switch. The switch receives it
+   * after the channel latency and owns it from then on.
    */
    virtual void SendToSwitch (Ptr<PortlandSwitchNetDevice> swtch, BufferData buffer);
 
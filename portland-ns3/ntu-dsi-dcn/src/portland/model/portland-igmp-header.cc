@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-igmp-header.h"
+#include "ns3/address-utils.h"
+
+namespace ns3 {
+
+namespace pld {
+
+NS_OBJECT_ENSURE_REGISTERED (IgmpHeader);
+
+const uint8_t IgmpHeader::PROT_NUMBER;
+
+IgmpHeader::IgmpHeader ()
+  : m_type (MEMBERSHIP_REPORT)
+{
+}
+
+
+TypeId
+IgmpHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::IgmpHeader")
+    .SetParent<Header> ()
+    .AddConstructor<IgmpHeader> ()
+  ;
+  return tid;
+}
+
+
+TypeId
+IgmpHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+
+void
+IgmpHeader::Print (std::ostream &os) const
+{
+  os << (m_type == LEAVE_GROUP ? "leave" : "report") << " group=" << m_group;
+}
+
+
+uint32_t
+IgmpHeader::GetSerializedSize (void) const
+{
+  // type, max response time, checksum, group address
+  return 1 + 1 + 2 + 4;
+}
+
+
+void
+IgmpHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (m_type);
+  i.WriteU8 (0);
+  i.WriteU16 (0);
+  WriteTo (i, m_group);
+
+  i = start;
+  uint16_t checksum = i.CalculateIpChecksum (GetSerializedSize ());
+  i = start;
+  i.Next (2);
+  i.WriteU16 (checksum);
+}
+
+
+uint32_t
+IgmpHeader::Deserialize (Buffer::Iterator start)
+{
+  m_type = start.ReadU8 ();
+  start.ReadU8 ();
+  start.ReadU16 ();
+  ReadFrom (start, m_group);
+  return GetSerializedSize ();
+}
+
+
+void
+IgmpHeader::SetType (uint8_t type)
+{
+  m_type = type;
+}
+
+
+uint8_t
+IgmpHeader::GetType (void) const
+{
+  return m_type;
+}
+
+
+void
+IgmpHeader::SetGroup (Ipv4Address group)
+{
+  m_group = group;
+}
+
+
+Ipv4Address
+IgmpHeader::GetGroup (void) const
+{
+  return m_group;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,72 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_IGMP_HEADER_H
+#define PORTLAND_IGMP_HEADER_H 1
+
+#include "ns3/header.h"
+#include "ns3/ipv4-address.h"
+
+#include <stdint.h>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief IGMPv2 membership message, sent by a host to join or leave a multicast group.
+ *
+ * Edge switches snoop these messages on their host ports to learn which ports lead to members of a group,
+ * and do not forward them. ns-3 has no IGMP of its own; PortlandFatTreeHelper::JoinGroup and LeaveGroup have
+ * hosts send them.
+ */
+class IgmpHeader : public Header
+{
+public:
+  /// IPv4 protocol number of IGMP
+  static const uint8_t PROT_NUMBER = 2;
+
+  enum MessageType
+  {
+    MEMBERSHIP_REPORT = 0x16,   ///< Version 2 Membership Report: the host joins the group
+    LEAVE_GROUP = 0x17          ///< Leave Group: the host leaves the group
+  };
+
+  IgmpHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  void SetType (uint8_t type);
+  uint8_t GetType (void) const;
+
+  void SetGroup (Ipv4Address group);
+  Ipv4Address GetGroup (void) const;
+
+private:
+  uint8_t m_type;
+  Ipv4Address m_group;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_IGMP_HEADER_H */
@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-ip-pmac-store.h"
+#include "portland-pmac.h"
+
+namespace ns3 {
+
+namespace pld {
+
+const uint32_t IpPMACStore::EMPTY_SLOT;
+const uint32_t IpPMACStore::MIN_CAPACITY;
+
+
+IpPMACStore::IpPMACStore ()
+  : m_mask (0)
+{
+  Rehash (MIN_CAPACITY);
+}
+
+
+uint64_t
+IpPMACStore::MakeKey (const Mac48Address& mac)
+{
+  return PMAC::ToBits (mac);
+}
+
+
+Mac48Address
+IpPMACStore::MakeMac (uint64_t key)
+{
+  return PMAC::FromBits (key);
+}
+
+
+/*
+ * 64-bit finalizer (from MurmurHash3); PMACs and host IP Addresses differ
+ * mostly in a few low-order bits.
+ */
+uint32_t
+IpPMACStore::Hash (uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (uint32_t) key;
+}
+
+
+uint64_t
+IpPMACStore::GetKey (IndexType index, uint32_t entry) const
+{
+  return (index == INDEX_IP ? m_entries[entry].ip : m_entries[entry].pmac);
+}
+
+
+uint32_t
+IpPMACStore::FindSlot (IndexType index, uint64_t key) const
+{
+  const std::vector<uint32_t>& slots = m_index[index];
+  uint32_t i = Hash (key) & m_mask;
+  while (slots[i] != EMPTY_SLOT)
+    {
+      if (GetKey (index, slots[i]) == key)
+        {
+          return i;
+        }
+      i = (i + 1) & m_mask;
+    }
+  return EMPTY_SLOT;
+}
+
+
+uint32_t
+IpPMACStore::FindEntry (IndexType index, uint64_t key) const
+{
+  uint32_t slot = FindSlot (index, key);
+  return (slot == EMPTY_SLOT ? EMPTY_SLOT : m_index[index][slot]);
+}
+
+
+void
+IpPMACStore::InsertSlot (IndexType index, uint64_t key, uint32_t entry)
+{
+  std::vector<uint32_t>& slots = m_index[index];
+  uint32_t i = Hash (key) & m_mask;
+  while (slots[i] != EMPTY_SLOT)
+    {
+      i = (i + 1) & m_mask;
+    }
+  slots[i] = entry;
+}
+
+
+/*
+ * Backward-shift deletion, as in PMACTable::EraseSlot.
+ */
+void
+IpPMACStore::EraseSlot (IndexType index, uint32_t slot)
+{
+  std::vector<uint32_t>& slots = m_index[index];
+  uint32_t hole = slot;
+  uint32_t i = slot;
+  while (true)
+    {
+      slots[hole] = EMPTY_SLOT;
+      while (true)
+        {
+          i = (i + 1) & m_mask;
+          if (slots[i] == EMPTY_SLOT)
+            {
+              return;
+            }
+          uint32_t home = Hash (GetKey (index, slots[i])) & m_mask;
+          bool reachable = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+          if (!reachable)
+            {
+              break;
+            }
+        }
+      slots[hole] = slots[i];
+      hole = i;
+    }
+}
+
+
+/*
+ * Removes an entry by moving the last entry into its place and re-pointing
+ * the moved entry's index slots.
+ */
+void
+IpPMACStore::EraseEntry (uint32_t entry)
+{
+  EraseSlot (INDEX_IP, FindSlot (INDEX_IP, m_entries[entry].ip));
+  EraseSlot (INDEX_PMAC, FindSlot (INDEX_PMAC, m_entries[entry].pmac));
+
+  uint32_t last = m_entries.size () - 1;
+  if (entry != last)
+    {
+      m_entries[entry] = m_entries[last];
+      m_index[INDEX_IP][FindSlot (INDEX_IP, m_entries[entry].ip)] = entry;
+      m_index[INDEX_PMAC][FindSlot (INDEX_PMAC, m_entries[entry].pmac)] = entry;
+    }
+  m_entries.pop_back ();
+}
+
+
+void
+IpPMACStore::Rehash (uint32_t capacity)
+{
+  m_mask = capacity - 1;
+  for (int index = 0; index < N_INDICES; index++)
+    {
+      m_index[index].assign (capacity, EMPTY_SLOT);
+    }
+
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      InsertSlot (INDEX_IP, m_entries[i].ip, i);
+      InsertSlot (INDEX_PMAC, m_entries[i].pmac, i);
+    }
+}
+
+
+void
+IpPMACStore::Reserve (uint32_t n)
+{
+  m_entries.reserve (n);
+  uint32_t capacity = m_mask + 1;
+  while (n * 2 > capacity)
+    {
+      capacity *= 2;
+    }
+  if (capacity != m_mask + 1)
+    {
+      Rehash (capacity);
+    }
+}
+
+
+Mac48Address
+IpPMACStore::Add (const Ipv4Address& ip_address, const Mac48Address& pmac)
+{
+  uint64_t pmac_key = MakeKey (pmac);
+  Mac48Address previous = Mac48Address::GetBroadcast ();
+
+  uint32_t i = FindEntry (INDEX_IP, ip_address.Get ());
+  if (i != EMPTY_SLOT)
+    {
+      if (m_entries[i].pmac == pmac_key)
+        {
+          return pmac;
+        }
+      previous = FindPMAC (ip_address);
+      EraseEntry (i);
+    }
+
+  // the PMAC now locates this host; drop the stale binding of another IP Address
+  i = FindEntry (INDEX_PMAC, pmac_key);
+  if (i != EMPTY_SLOT)
+    {
+      EraseEntry (i);
+    }
+
+  // keep the load factor of the indices at or below 1/2
+  if ((m_entries.size () + 1) * 2 > m_mask + 1)
+    {
+      Rehash ((m_mask + 1) * 2);
+    }
+
+  Entry entry;
+  entry.pmac = pmac_key;
+  entry.ip = ip_address.Get ();
+  uint32_t n = m_entries.size ();
+  m_entries.push_back (entry);
+  InsertSlot (INDEX_IP, entry.ip, n);
+  InsertSlot (INDEX_PMAC, entry.pmac, n);
+  return previous;
+}
+
+
+bool
+IpPMACStore::Remove (const Ipv4Address& ip_address)
+{
+  uint32_t i = FindEntry (INDEX_IP, ip_address.Get ());
+  if (i == EMPTY_SLOT)
+    {
+      return false;
+    }
+  EraseEntry (i);
+  return true;
+}
+
+
+bool
+IpPMACStore::Contains (const Ipv4Address& ip_address) const
+{
+  return FindEntry (INDEX_IP, ip_address.Get ()) != EMPTY_SLOT;
+}
+
+
+Mac48Address
+IpPMACStore::FindPMAC (const Ipv4Address& ip_address) const
+{
+  uint32_t i = FindEntry (INDEX_IP, ip_address.Get ());
+  return (i == EMPTY_SLOT ? Mac48Address::GetBroadcast () : MakeMac (m_entries[i].pmac));
+}
+
+
+Ipv4Address
+IpPMACStore::FindIP (const Mac48Address& pmac) const
+{
+  uint32_t i = FindEntry (INDEX_PMAC, MakeKey (pmac));
+  return (i == EMPTY_SLOT ? Ipv4Address ("255.255.255.255") : Ipv4Address (m_entries[i].ip));
+}
+
+
+uint32_t
+IpPMACStore::GetNEntries (void) const
+{
+  return m_entries.size ();
+}
+
+
+void
+IpPMACStore::GetMappings (std::vector<std::pair<Ipv4Address, Mac48Address> >& mappings) const
+{
+  mappings.reserve (mappings.size () + m_entries.size ());
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      mappings.push_back (std::make_pair (Ipv4Address (m_entries[i].ip), MakeMac (m_entries[i].pmac)));
+    }
+}
+
+
+uint64_t
+IpPMACStore::GetMemoryUsage (void) const
+{
+  uint64_t bytes = sizeof (*this) + m_entries.capacity () * sizeof (Entry);
+  for (int index = 0; index < N_INDICES; index++)
+    {
+      bytes += m_index[index].capacity () * sizeof (uint32_t);
+    }
+  return bytes;
+}
+
+
+void
+IpPMACStore::clear (void)
+{
+  m_entries.clear ();
+  Rehash (MIN_CAPACITY);
+}
+
+} // namespace pld
+
+} // namespace ns3
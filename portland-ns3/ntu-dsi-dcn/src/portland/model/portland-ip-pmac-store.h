@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_IP_PMAC_STORE_H
+#define PORTLAND_IP_PMAC_STORE_H 1
+
+#include "ns3/mac48-address.h"
+#include "ns3/ipv4-address.h"
+
+#include <vector>
+#include <utility>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief The Fabric Manager's IP Address <-> PMAC store.
+ *
+ * Mappings are stored densely as packed integers and indexed by two
+ * open-addressing (linear probing) hash indices, IP -> entry and
+ * PMAC -> entry, that hold only entry numbers. Both lookup directions are
+ * O(1) on average and an entry costs a few tens of bytes, so the store
+ * holds the hosts of large fat trees (k=48 has 27,648 hosts).
+ *
+ * IP Addresses and PMACs are each unique in the store.
+ */
+class IpPMACStore
+{
+public:
+  IpPMACStore ();
+
+  /**
+   * Maps an IP Address to a PMAC, replacing the previous PMAC of the IP Address and
+   * dropping any other IP Address bound to the PMAC.
+   *
+   * \return The previous PMAC of the IP Address; the broadcast address if it had none.
+   */
+  Mac48Address Add (const Ipv4Address& ip_address, const Mac48Address& pmac);
+
+  /**
+   * Makes room for n entries, so that adding them does not rehash.
+   */
+  void Reserve (uint32_t n);
+
+  /**
+   * \return True if the IP Address had a mapping.
+   */
+  bool Remove (const Ipv4Address& ip_address);
+
+  bool Contains (const Ipv4Address& ip_address) const;
+
+  /**
+   * \return The PMAC of the IP Address; the broadcast address if it has none.
+   */
+  Mac48Address FindPMAC (const Ipv4Address& ip_address) const;
+
+  /**
+   * \return The IP Address bound to the PMAC; 255.255.255.255 if there is none.
+   */
+  Ipv4Address FindIP (const Mac48Address& pmac) const;
+
+  uint32_t GetNEntries (void) const;
+
+  /**
+   * Appends every IP Address <-> PMAC mapping to mappings.
+   */
+  void GetMappings (std::vector<std::pair<Ipv4Address, Mac48Address> >& mappings) const;
+
+  /**
+   * \return Bytes allocated for the entries and the indices.
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+  void clear ();
+
+private:
+  typedef struct Entry {
+    uint64_t pmac;      ///< The six octets of the PMAC
+    uint32_t ip;
+  } Entry;
+
+  enum IndexType {
+    INDEX_IP = 0,
+    INDEX_PMAC,
+    N_INDICES
+  };
+
+  static uint64_t MakeKey (const Mac48Address& mac);
+  static Mac48Address MakeMac (uint64_t key);
+  static uint32_t Hash (uint64_t key);
+  uint64_t GetKey (IndexType index, uint32_t entry) const;
+
+  uint32_t FindSlot (IndexType index, uint64_t key) const;
+  uint32_t FindEntry (IndexType index, uint64_t key) const;
+  void InsertSlot (IndexType index, uint64_t key, uint32_t entry);
+  void EraseSlot (IndexType index, uint32_t slot);
+  void EraseEntry (uint32_t entry);
+  void Rehash (uint32_t capacity);
+
+  static const uint32_t EMPTY_SLOT = 0xffffffff;
+  static const uint32_t MIN_CAPACITY = 16;
+
+  std::vector<Entry> m_entries;                 ///< Dense entry storage
+  std::vector<uint32_t> m_index[N_INDICES];     ///< IP and PMAC indices into m_entries
+  uint32_t m_mask;                              ///< Index capacity - 1; capacity is a power of two
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_IP_PMAC_STORE_H */
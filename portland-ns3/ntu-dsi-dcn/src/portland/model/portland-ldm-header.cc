@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-ldm-header.h"
+#include "ns3/address-utils.h"
+
+namespace ns3 {
+
+namespace pld {
+
+NS_OBJECT_ENSURE_REGISTERED (LdmHeader);
+
+const uint16_t LdmHeader::PROT_NUMBER;
+const uint16_t LdmHeader::NO_UPLINK;
+
+LdmHeader::LdmHeader ()
+  : m_level (0),
+    m_located (false),
+    m_pod (0),
+    m_position (0),
+    m_uplink (NO_UPLINK)
+{
+}
+
+
+TypeId
+LdmHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::LdmHeader")
+    .SetParent<Header> ()
+    .AddConstructor<LdmHeader> ()
+  ;
+  return tid;
+}
+
+
+TypeId
+LdmHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+
+void
+LdmHeader::Print (std::ostream &os) const
+{
+  os << "switch=" << m_switchId << " level=" << (uint32_t) m_level;
+  if (m_located)
+    {
+      os << " pod=" << m_pod << " position=" << m_position;
+    }
+  if (m_uplink != NO_UPLINK)
+    {
+      os << " uplink=" << m_uplink;
+    }
+}
+
+
+uint32_t
+LdmHeader::GetSerializedSize (void) const
+{
+  // switch identifier, level, flags, pod, position, uplink
+  return 6 + 1 + 1 + 2 + 2 + 2;
+}
+
+
+void
+LdmHeader::Serialize (Buffer::Iterator start) const
+{
+  WriteTo (start, m_switchId);
+  start.WriteU8 (m_level);
+  start.WriteU8 (m_located ? 1 : 0);
+  start.WriteHtonU16 (m_pod);
+  start.WriteHtonU16 (m_position);
+  start.WriteHtonU16 (m_uplink);
+}
+
+
+uint32_t
+LdmHeader::Deserialize (Buffer::Iterator start)
+{
+  ReadFrom (start, m_switchId);
+  m_level = start.ReadU8 ();
+  m_located = (start.ReadU8 () & 1) != 0;
+  m_pod = start.ReadNtohU16 ();
+  m_position = start.ReadNtohU16 ();
+  m_uplink = start.ReadNtohU16 ();
+  return GetSerializedSize ();
+}
+
+
+void
+LdmHeader::SetSwitchId (Mac48Address id)
+{
+  m_switchId = id;
+}
+
+
+Mac48Address
+LdmHeader::GetSwitchId (void) const
+{
+  return m_switchId;
+}
+
+
+void
+LdmHeader::SetLevel (uint8_t level)
+{
+  m_level = level;
+}
+
+
+uint8_t
+LdmHeader::GetLevel (void) const
+{
+  return m_level;
+}
+
+
+void
+LdmHeader::SetLocation (uint16_t pod, uint16_t position)
+{
+  m_located = true;
+  m_pod = pod;
+  m_position = position;
+}
+
+
+bool
+LdmHeader::IsLocated (void) const
+{
+  return m_located;
+}
+
+
+uint16_t
+LdmHeader::GetPod (void) const
+{
+  return m_pod;
+}
+
+
+uint16_t
+LdmHeader::GetPosition (void) const
+{
+  return m_position;
+}
+
+
+void
+LdmHeader::SetUplink (uint16_t uplink)
+{
+  m_uplink = uplink;
+}
+
+
+uint16_t
+LdmHeader::GetUplink (void) const
+{
+  return m_uplink;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_LDM_HEADER_H
+#define PORTLAND_LDM_HEADER_H 1
+
+#include "ns3/header.h"
+#include "ns3/mac48-address.h"
+
+#include <stdint.h>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief Location Discovery Message, sent by a switch on every port at a fixed interval.
+ *
+ * An LDM tells the switch at the other end of a link who sent it (the switch identifier), the sender's
+ * level in the tree, if known, and its pod and position once it has been located. An LDM sent on an
+ * upper port also carries the index of that port among the sender's upper ports, from which aggregation
+ * and core switches learn their own position.
+ */
+class LdmHeader : public Header
+{
+public:
+  /// Ethertype of the frames carrying LDMs (IEEE 802 local experimental)
+  static const uint16_t PROT_NUMBER = 0x88B5;
+
+  /// Value of the uplink field of an LDM that was not sent on an upper port
+  static const uint16_t NO_UPLINK = 0xffff;
+
+  LdmHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  void SetSwitchId (Mac48Address id);
+  Mac48Address GetSwitchId (void) const;
+
+  /**
+   * \param level A PortlandSwitchType, or 0 if the sender does not know its level yet.
+   */
+  void SetLevel (uint8_t level);
+  uint8_t GetLevel (void) const;
+
+  /**
+   * Sets the pod and position of the sender, which is then located.
+   */
+  void SetLocation (uint16_t pod, uint16_t position);
+  bool IsLocated (void) const;
+  uint16_t GetPod (void) const;
+  uint16_t GetPosition (void) const;
+
+  /**
+   * \param uplink Index of the port the LDM is sent on among the sender's upper ports, or NO_UPLINK.
+   */
+  void SetUplink (uint16_t uplink);
+  uint16_t GetUplink (void) const;
+
+private:
+  Mac48Address m_switchId;
+  uint8_t m_level;
+  bool m_located;
+  uint16_t m_pod;
+  uint16_t m_position;
+  uint16_t m_uplink;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_LDM_HEADER_H */
@@ -0,0 +1,152 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-pmac-cache.h"
+
+namespace ns3 {
+
+namespace pld {
+
+PMACCache::PMACCache ()
+  : m_maxEntries (0),
+    m_timeout (Seconds (0))
+{
+}
+
+
+void
+PMACCache::SetMaxEntries (uint32_t max_entries)
+{
+  m_maxEntries = max_entries;
+  while (m_lru.size () > m_maxEntries)
+    {
+      m_index.erase (m_lru.back ().ip_address);
+      m_lru.pop_back ();
+    }
+}
+
+
+uint32_t
+PMACCache::GetMaxEntries (void) const
+{
+  return m_maxEntries;
+}
+
+
+void
+PMACCache::SetTimeout (Time timeout)
+{
+  m_timeout = timeout;
+}
+
+
+Time
+PMACCache::GetTimeout (void) const
+{
+  return m_timeout;
+}
+
+
+/*
+ * Looks up a destination IP Address; a hit moves the entry to the front of the LRU list,
+ * an expired entry is dropped and counts as a miss.
+ */
+bool
+PMACCache::Lookup (const Ipv4Address& ip_address, Time now, Mac48Address& pmac)
+{
+  Index_t::iterator it = m_index.find (ip_address);
+  if (it == m_index.end ())
+    {
+      return false;
+    }
+
+  Lru_t::iterator entry = it->second;
+  if (!m_timeout.IsZero () && entry->expires <= now)
+    {
+      m_lru.erase (entry);
+      m_index.erase (it);
+      return false;
+    }
+
+  m_lru.splice (m_lru.begin (), m_lru, entry);
+  pmac = entry->pmac;
+  return true;
+}
+
+
+void
+PMACCache::Insert (const Ipv4Address& ip_address, const Mac48Address& pmac, Time now)
+{
+  if (m_maxEntries == 0)
+    {
+      return;
+    }
+
+  Index_t::iterator it = m_index.find (ip_address);
+  if (it != m_index.end ())
+    {
+      m_lru.splice (m_lru.begin (), m_lru, it->second);
+    }
+  else
+    {
+      if (m_lru.size () >= m_maxEntries)
+        {
+          // evict the least recently used entry
+          m_index.erase (m_lru.back ().ip_address);
+          m_lru.pop_back ();
+        }
+      m_lru.push_front (CacheEntry ());
+      m_index[ip_address] = m_lru.begin ();
+    }
+
+  CacheEntry& entry = m_lru.front ();
+  entry.ip_address = ip_address;
+  entry.pmac = pmac;
+  entry.expires = now + m_timeout;
+}
+
+
+bool
+PMACCache::Invalidate (const Ipv4Address& ip_address)
+{
+  Index_t::iterator it = m_index.find (ip_address);
+  if (it == m_index.end ())
+    {
+      return false;
+    }
+  m_lru.erase (it->second);
+  m_index.erase (it);
+  return true;
+}
+
+
+uint32_t
+PMACCache::GetNEntries (void) const
+{
+  return m_lru.size ();
+}
+
+
+void
+PMACCache::clear (void)
+{
+  m_lru.clear ();
+  m_index.clear ();
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_PMAC_CACHE_H
+#define PORTLAND_PMAC_CACHE_H 1
+
+#include "ns3/mac48-address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+#include <list>
+#include <map>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief Edge switch cache of destination IP -> PMAC mappings learnt from the Fabric Manager.
+ *
+ * The cache holds at most a configured number of entries and evicts the least
+ * recently used one when full. Entries expire after a configured timeout and
+ * can be invalidated by the Fabric Manager when a mapping changes.
+ */
+class PMACCache
+{
+public:
+  PMACCache ();
+
+  /**
+   * \param max_entries Maximum number of entries; 0 disables the cache.
+   */
+  void SetMaxEntries (uint32_t max_entries);
+  uint32_t GetMaxEntries (void) const;
+
+  /**
+   * \param timeout Lifetime of an entry; zero means entries never expire.
+   */
+  void SetTimeout (Time timeout);
+  Time GetTimeout (void) const;
+
+  /**
+   * Looks up the PMAC for an IP Address and marks the entry as most recently used.
+   *
+   * \param ip_address The destination IP Address.
+   * \param now The current simulation time, used to expire the entry.
+   * \param pmac Set to the cached PMAC on a hit.
+   * \return True on a hit; false otherwise.
+   */
+  bool Lookup (const Ipv4Address& ip_address, Time now, Mac48Address& pmac);
+
+  /**
+   * Adds or refreshes the mapping of an IP Address, evicting the least recently used entry if the cache is full.
+   */
+  void Insert (const Ipv4Address& ip_address, const Mac48Address& pmac, Time now);
+
+  /**
+   * Removes the mapping of an IP Address, if present.
+   *
+   * \return True if an entry was removed.
+   */
+  bool Invalidate (const Ipv4Address& ip_address);
+
+  uint32_t GetNEntries (void) const;
+
+  void clear ();
+
+private:
+  typedef struct CacheEntry {
+    Ipv4Address ip_address;
+    Mac48Address pmac;
+    Time expires;
+  } CacheEntry;
+
+  typedef std::list<CacheEntry> Lru_t;
+  typedef std::map<Ipv4Address, Lru_t::iterator> Index_t;
+
+  Lru_t m_lru;                  ///< Entries, most recently used first
+  Index_t m_index;              ///< IP Address -> entry in m_lru
+  uint32_t m_maxEntries;
+  Time m_timeout;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_PMAC_CACHE_H */
@@ -0,0 +1,338 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Dhruv Sharma  <dhsharma@cs.ucsd.edu>
+ */
+
+#include "portland-pmac-table.h"
+
+namespace ns3 {
+
+namespace pld {
+
+const uint32_t PMACTable::EMPTY_SLOT;
+const uint32_t PMACTable::MIN_CAPACITY;
+
+
+PMACTable::PMACTable ()
+  : m_mask (0)
+{
+  Rehash (MIN_CAPACITY);
+}
+
+
+/*
+ * Packs the six octets of a MAC address into an index key.
+ */
+uint64_t
+PMACTable::MakeKey (const Mac48Address& mac)
+{
+  uint8_t buffer[6];
+  mac.CopyTo (buffer);
+  uint64_t key = 0;
+  for (int i = 0; i < 6; i++)
+    {
+      key = (key << 8) | buffer[i];
+    }
+  return key;
+}
+
+
+uint64_t
+PMACTable::MakeKey (const Ipv4Address& ip_address)
+{
+  return ip_address.Get ();
+}
+
+
+/*
+ * 64-bit finalizer (from MurmurHash3) so that keys differing only in the
+ * low-order pod/position/port octets spread over the whole index.
+ */
+uint32_t
+PMACTable::Hash (uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (uint32_t) key;
+}
+
+
+uint32_t
+PMACTable::FindSlot (IndexType index, uint64_t key) const
+{
+  const std::vector<IndexSlot>& slots = m_index[index];
+  uint32_t i = Hash (key) & m_mask;
+  while (slots[i].entry != EMPTY_SLOT)
+    {
+      if (slots[i].key == key)
+        {
+          return i;
+        }
+      i = (i + 1) & m_mask;
+    }
+  return EMPTY_SLOT;
+}
+
+
+uint32_t
+PMACTable::FindEntry (IndexType index, uint64_t key) const
+{
+  uint32_t slot = FindSlot (index, key);
+  return (slot == EMPTY_SLOT ? EMPTY_SLOT : m_index[index][slot].entry);
+}
+
+
+void
+PMACTable::InsertSlot (IndexType index, uint64_t key, uint32_t entry)
+{
+  std::vector<IndexSlot>& slots = m_index[index];
+  uint32_t i = Hash (key) & m_mask;
+  while (slots[i].entry != EMPTY_SLOT)
+    {
+      i = (i + 1) & m_mask;
+    }
+  slots[i].key = key;
+  slots[i].entry = entry;
+}
+
+
+/*
+ * Backward-shift deletion: pulls later members of the probe run into the
+ * hole so that no tombstones are needed and probe lengths stay short.
+ */
+void
+PMACTable::EraseSlot (IndexType index, uint32_t slot)
+{
+  std::vector<IndexSlot>& slots = m_index[index];
+  uint32_t hole = slot;
+  uint32_t i = slot;
+  while (true)
+    {
+      slots[hole].entry = EMPTY_SLOT;
+      while (true)
+        {
+          i = (i + 1) & m_mask;
+          if (slots[i].entry == EMPTY_SLOT)
+            {
+              return;
+            }
+          uint32_t home = Hash (slots[i].key) & m_mask;
+          // the slot may move into the hole only if its home is not cyclically in (hole, i]
+          bool reachable = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+          if (!reachable)
+            {
+              break;
+            }
+        }
+      slots[hole] = slots[i];
+      hole = i;
+    }
+}
+
+
+/*
+ * Removes an entry by moving the last entry into its place and re-pointing
+ * the moved entry's index slots.
+ */
+void
+PMACTable::EraseEntry (uint32_t entry)
+{
+  PMACEntry& victim = m_entries[entry];
+  EraseSlot (INDEX_PMAC, FindSlot (INDEX_PMAC, MakeKey (victim.pmac)));
+  EraseSlot (INDEX_AMAC, FindSlot (INDEX_AMAC, MakeKey (victim.amac)));
+  EraseSlot (INDEX_IP, FindSlot (INDEX_IP, MakeKey (victim.ip_address)));
+
+  uint32_t last = m_entries.size () - 1;
+  if (entry != last)
+    {
+      m_entries[entry] = m_entries[last];
+      const PMACEntry& moved = m_entries[entry];
+      m_index[INDEX_PMAC][FindSlot (INDEX_PMAC, MakeKey (moved.pmac))].entry = entry;
+      m_index[INDEX_AMAC][FindSlot (INDEX_AMAC, MakeKey (moved.amac))].entry = entry;
+      m_index[INDEX_IP][FindSlot (INDEX_IP, MakeKey (moved.ip_address))].entry = entry;
+    }
+  m_entries.pop_back ();
+}
+
+
+void
+PMACTable::Rehash (uint32_t capacity)
+{
+  IndexSlot empty;
+  empty.key = 0;
+  empty.entry = EMPTY_SLOT;
+
+  m_mask = capacity - 1;
+  for (int index = 0; index < N_INDICES; index++)
+    {
+      m_index[index].assign (capacity, empty);
+    }
+
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      InsertSlot (INDEX_PMAC, MakeKey (m_entries[i].pmac), i);
+      InsertSlot (INDEX_AMAC, MakeKey (m_entries[i].amac), i);
+      InsertSlot (INDEX_IP, MakeKey (m_entries[i].ip_address), i);
+    }
+}
+
+
+/*
+ * Adds an entry of AMAC, IP, in-port <-> PMAC in the PMAC table.
+ */
+void
+PMACTable::Add (const Mac48Address& pmac, const Mac48Address& amac, const Ipv4Address ip_address, const uint32_t port)
+{
+  if (FindEntry (INDEX_PMAC, MakeKey (pmac)) != EMPTY_SLOT)
+    {
+      return;
+    }
+
+  // drop stale bindings of this host
+  uint32_t stale = FindEntry (INDEX_AMAC, MakeKey (amac));
+  if (stale != EMPTY_SLOT)
+    {
+      EraseEntry (stale);
+    }
+  stale = FindEntry (INDEX_IP, MakeKey (ip_address));
+  if (stale != EMPTY_SLOT)
+    {
+      EraseEntry (stale);
+    }
+
+  // keep the load factor of the indices at or below 1/2
+  if ((m_entries.size () + 1) * 2 > m_mask + 1)
+    {
+      Rehash ((m_mask + 1) * 2);
+    }
+
+  PMACEntry entry;
+  entry.pmac = pmac;
+  entry.amac = amac;
+  entry.ip_address = ip_address;
+  entry.port = port;
+
+  uint32_t i = m_entries.size ();
+  m_entries.push_back (entry);
+  InsertSlot (INDEX_PMAC, MakeKey (pmac), i);
+  InsertSlot (INDEX_AMAC, MakeKey (amac), i);
+  InsertSlot (INDEX_IP, MakeKey (ip_address), i);
+}
+
+
+/*
+ * Removes PMAC Entry from the table based on the given AMAC
+ */
+void
+PMACTable::Remove (const Mac48Address& amac)
+{
+  uint32_t i = FindEntry (INDEX_AMAC, MakeKey (amac));
+  if (i != EMPTY_SLOT)
+    {
+      EraseEntry (i);
+    }
+}
+
+
+/*
+ * Finds the port of host based on given PMAC
+ */
+int
+PMACTable::FindPort (const Mac48Address& pmac) const
+{
+  uint32_t i = FindEntry (INDEX_PMAC, MakeKey (pmac));
+  return (i == EMPTY_SLOT ? -1 : (int) m_entries[i].port);
+}
+
+
+/*
+ * Finds the port of host based on given IP Address
+ */
+int
+PMACTable::FindPort (const Ipv4Address& ip_address) const
+{
+  uint32_t i = FindEntry (INDEX_IP, MakeKey (ip_address));
+  return (i == EMPTY_SLOT ? -1 : (int) m_entries[i].port);
+}
+
+
+/*
+ * Finds an AMAC based on the given PMAC
+ */
+Mac48Address
+PMACTable::FindAMAC (const Mac48Address& pmac) const
+{
+  uint32_t i = FindEntry (INDEX_PMAC, MakeKey (pmac));
+  return (i == EMPTY_SLOT ? Mac48Address::GetBroadcast () : m_entries[i].amac);
+}
+
+
+/*
+ * Finds an AMAC based on the given IP Address.
+ */
+Mac48Address
+PMACTable::FindAMAC (const Ipv4Address& ip_address) const
+{
+  uint32_t i = FindEntry (INDEX_IP, MakeKey (ip_address));
+  return (i == EMPTY_SLOT ? Mac48Address::GetBroadcast () : m_entries[i].amac);
+}
+
+
+/*
+ * Finds a PMAC based on the given AMAC.
+ */
+Mac48Address
+PMACTable::FindPMAC (const Mac48Address& amac) const
+{
+  uint32_t i = FindEntry (INDEX_AMAC, MakeKey (amac));
+  return (i == EMPTY_SLOT ? Mac48Address::GetBroadcast () : m_entries[i].pmac);
+}
+
+
+/*
+ * Finds a PMAC based on the given IP Address.
+ */
+Mac48Address
+PMACTable::FindPMAC (const Ipv4Address& ip_address) const
+{
+  uint32_t i = FindEntry (INDEX_IP, MakeKey (ip_address));
+  return (i == EMPTY_SLOT ? Mac48Address::GetBroadcast () : m_entries[i].pmac);
+}
+
+
+uint32_t
+PMACTable::GetNEntries (void) const
+{
+  return m_entries.size ();
+}
+
+
+/*
+ * Clears all entries in the PMAC table.
+ */
+void
+PMACTable::clear (void)
+{
+  m_entries.clear ();
+  Rehash (MIN_CAPACITY);
+}
+
+} // namespace pld
+
+} // namespace ns3
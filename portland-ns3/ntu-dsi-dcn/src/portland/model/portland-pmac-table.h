@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Dhruv Sharma  <dhsharma@cs.ucsd.edu>
+ */
+
+#ifndef PORTLAND_PMAC_TABLE_H
+#define PORTLAND_PMAC_TABLE_H 1
+
+#include "ns3/mac48-address.h"
+#include "ns3/ipv4-address.h"
+
+#include <vector>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief PMAC table of an edge switch; PMAC <-> AMAC, IP, in-port.
+ *
+ * Entries are stored densely in a vector and indexed by three open-addressing
+ * (linear probing) hash indices, one per lookup direction, so that lookups by
+ * PMAC, AMAC and IP Address are all O(1) on average.
+ *
+ * PMAC, AMAC and IP Address are each unique in the table. Add () is a no-op if
+ * the PMAC is already allocated, and otherwise replaces any stale entry that
+ * is bound to the same AMAC or IP Address.
+ */
+class PMACTable
+{
+public:
+  PMACTable ();
+
+  void Add (const Mac48Address& pmac, const Mac48Address& amac, const Ipv4Address ip_address, const uint32_t port);
+  void Remove (const Mac48Address& amac);
+  int FindPort (const Mac48Address& pmac) const;
+  int FindPort (const Ipv4Address& ip_address) const;
+  Mac48Address FindAMAC (const Mac48Address& pmac) const;
+  Mac48Address FindAMAC (const Ipv4Address& ip_address) const;
+  Mac48Address FindPMAC (const Mac48Address& amac) const;
+  Mac48Address FindPMAC (const Ipv4Address& ip_address) const;
+
+  /**
+   * \return Number of entries in the table.
+   */
+  uint32_t GetNEntries (void) const;
+
+  void clear ();
+
+private:
+  typedef struct PMACEntry {
+    Mac48Address pmac;
+    Mac48Address amac;
+    Ipv4Address ip_address;
+    uint32_t port;
+  } PMACEntry;
+
+  /// One slot of an index; the key is kept inline so that probing never touches m_entries.
+  typedef struct IndexSlot {
+    uint64_t key;
+    uint32_t entry;
+  } IndexSlot;
+
+  enum IndexType {
+    INDEX_PMAC = 0,
+    INDEX_AMAC,
+    INDEX_IP,
+    N_INDICES
+  };
+
+  static uint64_t MakeKey (const Mac48Address& mac);
+  static uint64_t MakeKey (const Ipv4Address& ip_address);
+  static uint32_t Hash (uint64_t key);
+
+  /**
+   * \return The slot holding key in the given index, or EMPTY_SLOT.
+   */
+  uint32_t FindSlot (IndexType index, uint64_t key) const;
+
+  /**
+   * \return The entry bound to key in the given index, or EMPTY_SLOT.
+   */
+  uint32_t FindEntry (IndexType index, uint64_t key) const;
+
+  void InsertSlot (IndexType index, uint64_t key, uint32_t entry);
+  void EraseSlot (IndexType index, uint32_t slot);
+  void EraseEntry (uint32_t entry);
+  void Rehash (uint32_t capacity);
+
+  static const uint32_t EMPTY_SLOT = 0xffffffff;
+  static const uint32_t MIN_CAPACITY = 16;
+
+  std::vector<PMACEntry> m_entries;             ///< Dense entry storage
+  std::vector<IndexSlot> m_index[N_INDICES];    ///< PMAC, AMAC and IP indices into m_entries
+  uint32_t m_mask;                              ///< Index capacity - 1; capacity is a power of two
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_PMAC_TABLE_H */
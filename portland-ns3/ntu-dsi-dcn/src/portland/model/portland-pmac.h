@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_PMAC_H
+#define PORTLAND_PMAC_H 1
+
+#include "ns3/mac48-address.h"
+#include "ns3/abort.h"
+
+#include <stdint.h>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief Encoder/decoder of PMACs laid out as pod.position.port.vmid.
+ *
+ * The width in bits of every field is fixed at compile time and the four
+ * widths must add up to the 48 bits of a MAC address; the pod is the most
+ * significant field. A PMAC is handled as a 48-bit integer so that decoding
+ * a field is a shift and a mask.
+ *
+ * Encoding a value that does not fit in its field aborts the simulation
+ * instead of silently truncating it into another switch's address space.
+ */
+template <uint32_t POD_BITS, uint32_t POSITION_BITS, uint32_t PORT_BITS, uint32_t VMID_BITS>
+class PMACCodec
+{
+public:
+  static const uint32_t VMID_SHIFT = 0;
+  static const uint32_t PORT_SHIFT = VMID_SHIFT + VMID_BITS;
+  static const uint32_t POSITION_SHIFT = PORT_SHIFT + PORT_BITS;
+  static const uint32_t POD_SHIFT = POSITION_SHIFT + POSITION_BITS;
+
+  static const uint32_t MAX_POD = (1U << POD_BITS) - 1;
+  static const uint32_t MAX_POSITION = (1U << POSITION_BITS) - 1;
+  static const uint32_t MAX_PORT = (1U << PORT_BITS) - 1;
+  static const uint32_t MAX_VMID = (1U << VMID_BITS) - 1;
+
+  /**
+   * \return The 48-bit integer value of a MAC address, first octet most significant.
+   */
+  static uint64_t ToBits (const Mac48Address& mac)
+  {
+    uint8_t buffer[6];
+    mac.CopyTo (buffer);
+    return ((uint64_t) buffer[0] << 40) | ((uint64_t) buffer[1] << 32) | ((uint64_t) buffer[2] << 24)
+           | ((uint64_t) buffer[3] << 16) | ((uint64_t) buffer[4] << 8) | (uint64_t) buffer[5];
+  }
+
+  /**
+   * \return The MAC address of the low 48 bits of bits.
+   */
+  static Mac48Address FromBits (uint64_t bits)
+  {
+    uint8_t buffer[6] = { (uint8_t)(bits >> 40), (uint8_t)(bits >> 32), (uint8_t)(bits >> 24),
+                          (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t) bits };
+    Mac48Address mac;
+    mac.CopyFrom (buffer);
+    return mac;
+  }
+
+  static Mac48Address Encode (uint32_t pod, uint32_t position, uint32_t port, uint32_t vmid)
+  {
+    NS_ABORT_MSG_IF (pod > MAX_POD, "PMAC pod " << pod << " does not fit in " << POD_BITS << " bits");
+    NS_ABORT_MSG_IF (position > MAX_POSITION, "PMAC position " << position << " does not fit in " << POSITION_BITS << " bits");
+    NS_ABORT_MSG_IF (port > MAX_PORT, "PMAC port " << port << " does not fit in " << PORT_BITS << " bits");
+    NS_ABORT_MSG_IF (vmid > MAX_VMID, "PMAC vmid " << vmid << " does not fit in " << VMID_BITS << " bits");
+    return FromBits (((uint64_t) pod << POD_SHIFT) | ((uint64_t) position << POSITION_SHIFT)
+                     | ((uint64_t) port << PORT_SHIFT) | ((uint64_t) vmid << VMID_SHIFT));
+  }
+
+  static uint32_t GetPod (uint64_t bits)
+  {
+    return (uint32_t)(bits >> POD_SHIFT) & MAX_POD;
+  }
+
+  static uint32_t GetPosition (uint64_t bits)
+  {
+    return (uint32_t)(bits >> POSITION_SHIFT) & MAX_POSITION;
+  }
+
+  static uint32_t GetPort (uint64_t bits)
+  {
+    return (uint32_t)(bits >> PORT_SHIFT) & MAX_PORT;
+  }
+
+  static uint32_t GetVmid (uint64_t bits)
+  {
+    return (uint32_t)(bits >> VMID_SHIFT) & MAX_VMID;
+  }
+
+  static uint32_t GetPod (const Mac48Address& pmac)
+  {
+    return GetPod (ToBits (pmac));
+  }
+
+  static uint32_t GetPosition (const Mac48Address& pmac)
+  {
+    return GetPosition (ToBits (pmac));
+  }
+
+  static uint32_t GetPort (const Mac48Address& pmac)
+  {
+    return GetPort (ToBits (pmac));
+  }
+
+  static uint32_t GetVmid (const Mac48Address& pmac)
+  {
+    return GetVmid (ToBits (pmac));
+  }
+
+private:
+  // compile-time checks: every field is 1..31 bits wide and the fields fill the 48 bits of a MAC address
+  typedef char FieldWidthsCheck[(POD_BITS > 0 && POD_BITS < 32 && POSITION_BITS > 0 && POSITION_BITS < 32
+                                 && PORT_BITS > 0 && PORT_BITS < 32 && VMID_BITS > 0 && VMID_BITS < 32) ? 1 : -1];
+  typedef char LayoutSizeCheck[(POD_BITS + POSITION_BITS + PORT_BITS + VMID_BITS == 48) ? 1 : -1];
+};
+
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::VMID_SHIFT;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::PORT_SHIFT;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::POSITION_SHIFT;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::POD_SHIFT;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::MAX_POD;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::MAX_POSITION;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::MAX_PORT;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D> const uint32_t PMACCodec<A, B, C, D>::MAX_VMID;
+
+/**
+ * PMAC layout used by the switches and the Fabric Manager: 16-bit pod, 8-bit
+ * position, 8-bit port and 16-bit vmid, i.e. pp:pp:ss:tt:vv:vv. This is wide
+ * enough for fat trees of k <= 512; fabrics with more pods or ports per switch
+ * choose another split of the 48 bits here.
+ */
+typedef PMACCodec<16, 8, 8, 16> PMAC;
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_PMAC_H */
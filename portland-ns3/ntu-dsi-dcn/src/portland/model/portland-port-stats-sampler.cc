@@ -0,0 +1,232 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-port-stats-sampler.h"
+#include "portland-switch-net-device.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/queue.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ns3 {
+
+namespace pld {
+
+NS_LOG_COMPONENT_DEFINE ("PortlandPortStatsSampler");
+
+NS_OBJECT_ENSURE_REGISTERED (PortStatsSampler);
+
+
+TypeId
+PortStatsSampler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::PortStatsSampler")
+    .SetParent<Object> ()
+    .AddConstructor<PortStatsSampler> ()
+    .AddAttribute ("Interval",
+                   "Time between two samples.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&PortStatsSampler::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("FileName",
+                   "File the samples are written to.",
+                   StringValue ("portland-port-stats.bin"),
+                   MakeStringAccessor (&PortStatsSampler::m_fileName),
+                   MakeStringChecker ())
+    .AddAttribute ("Samples",
+                   "Number of samples written.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortStatsSampler::GetNSamples),
+                   MakeUintegerChecker<uint64_t> ())
+  ;
+  return tid;
+}
+
+
+PortStatsSampler::PortStatsSampler ()
+  : m_interval (MilliSeconds (10)),
+    m_fileName ("portland-port-stats.bin"),
+    m_lastSample (Seconds (0)),
+    m_nSamples (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+PortStatsSampler::~PortStatsSampler ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+void
+PortStatsSampler::DoDispose (void)
+{
+  Stop ();
+  m_switches.clear ();
+  Object::DoDispose ();
+}
+
+
+void
+PortStatsSampler::AddSwitch (Ptr<PortlandSwitchNetDevice> swtch)
+{
+  NS_ASSERT_MSG (!m_file.is_open (), "Switches must be added before the sampler starts");
+  m_switches.push_back (swtch);
+}
+
+
+template <typename T>
+static void
+WriteValue (std::ofstream& file, T value)
+{
+  file.write (reinterpret_cast<const char*> (&value), sizeof (value));
+}
+
+
+/*
+ * Writes the header of the file and takes the counters as they are now as the base of the first sample.
+ */
+void
+PortStatsSampler::Start (void)
+{
+  NS_LOG_FUNCTION (this << m_fileName);
+  NS_ASSERT_MSG (!m_file.is_open (), "Sampler already started");
+  m_file.open (m_fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "Can't open " << m_fileName);
+
+  uint32_t n_ports = 0;
+  for (uint32_t s = 0; s < m_switches.size (); s++)
+    {
+      n_ports += m_switches[s]->GetNSwitchPorts ();
+    }
+  m_file.write ("PLDSTAT1", 8);
+  WriteValue<uint32_t> (m_file, n_ports);
+  WriteValue<uint32_t> (m_file, N_COLUMNS);
+  WriteValue<int64_t> (m_file, m_interval.GetNanoSeconds ());
+
+  m_last.assign (n_ports * N_COLUMNS, 0);
+  m_block.assign (n_ports * N_COLUMNS, 0);
+  uint32_t i = 0;
+  for (uint32_t s = 0; s < m_switches.size (); s++)
+    {
+      Ptr<PortlandSwitchNetDevice> swtch = m_switches[s];
+      uint32_t n_lower = swtch->GetNSwitchPorts () - swtch->GetNUpperPorts ();
+      for (uint32_t n = 0; n < swtch->GetNSwitchPorts (); n++, i++)
+        {
+          const Port& p = swtch->GetSwitchPort (n);
+          WriteValue<uint32_t> (m_file, swtch->GetNode () == 0 ? 0 : swtch->GetNode ()->GetId ());
+          WriteValue<uint8_t> (m_file, swtch->GetDeviceType ());
+          WriteValue<uint8_t> (m_file, n >= n_lower ? 1 : 0);
+          WriteValue<uint16_t> (m_file, swtch->GetPod ());
+          WriteValue<uint16_t> (m_file, swtch->GetPosition ());
+          WriteValue<uint16_t> (m_file, n >= n_lower ? n - n_lower : n);
+          m_last[i * N_COLUMNS + TX_BYTES] = p.tx_bytes;
+          m_last[i * N_COLUMNS + RX_BYTES] = p.rx_bytes;
+          m_last[i * N_COLUMNS + TX_PACKETS] = p.tx_packets;
+          m_last[i * N_COLUMNS + RX_PACKETS] = p.rx_packets;
+          m_last[i * N_COLUMNS + TX_DROPPED] = p.tx_dropped;
+        }
+    }
+
+  // the events hold the sampler, which may have no other owner
+  m_lastSample = Simulator::Now ();
+  m_event = Simulator::Schedule (m_interval, &PortStatsSampler::Sample, Ptr<PortStatsSampler> (this));
+}
+
+
+void
+PortStatsSampler::Stop (void)
+{
+  m_event.Cancel ();
+  if (m_file.is_open ())
+    {
+      if (Simulator::Now () > m_lastSample)
+        {
+          WriteSample ();
+        }
+      m_file.close ();
+    }
+}
+
+
+void
+PortStatsSampler::Sample (void)
+{
+  WriteSample ();
+  m_event = Simulator::Schedule (m_interval, &PortStatsSampler::Sample, Ptr<PortStatsSampler> (this));
+}
+
+
+/*
+ * Reads the counters of every port in the order of the header and writes them out column by column. The
+ * counters are read in one pass, port by port; the block is written with a single call.
+ */
+void
+PortStatsSampler::WriteSample (void)
+{
+  uint32_t n_ports = m_last.size () / N_COLUMNS;
+  uint32_t i = 0;
+  for (uint32_t s = 0; s < m_switches.size () && i < n_ports; s++)
+    {
+      Ptr<PortlandSwitchNetDevice> swtch = m_switches[s];
+      for (uint32_t n = 0; n < swtch->GetNSwitchPorts () && i < n_ports; n++, i++)
+        {
+          const Port& p = swtch->GetSwitchPort (n);
+          uint64_t counters[QUEUE_BYTES] = { p.tx_bytes, p.rx_bytes, p.tx_packets, p.rx_packets, p.tx_dropped };
+          uint64_t* last = &m_last[i * N_COLUMNS];
+          for (uint32_t c = 0; c < QUEUE_BYTES; c++)
+            {
+              m_block[c * n_ports + i] = (uint32_t) std::min<uint64_t> (counters[c] - last[c],
+                                                                         std::numeric_limits<uint32_t>::max ());
+              last[c] = counters[c];
+            }
+          m_block[QUEUE_BYTES * n_ports + i] = (p.queue == 0 ? 0 : p.queue->GetNBytes ());
+        }
+    }
+
+  WriteValue<int64_t> (m_file, Simulator::Now ().GetNanoSeconds ());
+  if (!m_block.empty ())
+    {
+      m_file.write (reinterpret_cast<const char*> (&m_block[0]), m_block.size () * sizeof (uint32_t));
+    }
+  m_lastSample = Simulator::Now ();
+  m_nSamples++;
+}
+
+
+uint32_t
+PortStatsSampler::GetNPorts (void) const
+{
+  return m_last.size () / N_COLUMNS;
+}
+
+
+uint64_t
+PortStatsSampler::GetNSamples (void) const
+{
+  return m_nSamples;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_PORT_STATS_SAMPLER_H
+#define PORTLAND_PORT_STATS_SAMPLER_H 1
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class PortlandSwitchNetDevice;
+
+namespace pld {
+
+/**
+ * \brief Samples the counters of every port of a set of switches at a fixed interval into a binary file.
+ *
+ * The file is columnar, in the host's byte order, and starts with a header:
+ *
+ *   - char[8] magic, "PLDSTAT1";
+ *   - uint32 number of ports, P, and uint32 number of columns, C;
+ *   - int64 sampling interval, in nanoseconds;
+ *   - P port descriptors of 12 bytes: uint32 node id of the switch, uint8 level (a PortlandSwitchType),
+ *     uint8 1 for an upper layer port, uint16 pod, uint16 position, uint16 index of the port among the
+ *     switch's upper or lower layer ports.
+ *
+ * It is followed by one block per sample: int64 time in nanoseconds, then C columns of P uint32 values,
+ * in Column order. The counter columns hold the increase since the previous sample, capped at 2^32 - 1;
+ * QUEUE_BYTES holds the bytes queued for transmission on the port when the sample was taken.
+ *
+ * Ports are described as the switches number them when Start () is called; with the Location Discovery
+ * Protocol, start sampling once the switches are located.
+ */
+class PortStatsSampler : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  enum Column
+  {
+    TX_BYTES,
+    RX_BYTES,
+    TX_PACKETS,
+    RX_PACKETS,
+    TX_DROPPED,
+    QUEUE_BYTES,
+    N_COLUMNS
+  };
+
+  PortStatsSampler ();
+  virtual ~PortStatsSampler ();
+
+  /**
+   * Adds the ports of a switch to the samples; call it before Start ().
+   */
+  void AddSwitch (Ptr<PortlandSwitchNetDevice> swtch);
+
+  /**
+   * Opens the file, writes its header and takes a sample every Interval from now on, until Stop () is called
+   * or the simulation is destroyed. Call Stop () once Simulator::Run () returns to sample the end of the run.
+   */
+  void Start (void);
+
+  /**
+   * Takes a last sample, if time went by since the previous one, and closes the file.
+   */
+  void Stop (void);
+
+  /**
+   * \return Number of ports sampled.
+   */
+  uint32_t GetNPorts (void) const;
+
+  /**
+   * \return Number of samples written.
+   */
+  uint64_t GetNSamples (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Writes a sample and schedules the next one.
+   */
+  void Sample (void);
+
+  void WriteSample (void);
+
+  Time m_interval;
+  std::string m_fileName;
+  std::ofstream m_file;
+  EventId m_event;
+  Time m_lastSample;
+  uint64_t m_nSamples;
+
+  std::vector<Ptr<PortlandSwitchNetDevice> > m_switches;
+  std::vector<uint64_t> m_last;         ///< Counters at the previous sample, N_COLUMNS per port
+  std::vector<uint32_t> m_block;        ///< Columns of the sample being written
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_PORT_STATS_SAMPLER_H */
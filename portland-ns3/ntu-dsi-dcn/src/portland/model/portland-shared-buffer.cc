@@ -0,0 +1,392 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-shared-buffer.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/ethernet-trailer.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+namespace pld {
+
+NS_LOG_COMPONENT_DEFINE ("PortlandSharedBuffer");
+
+NS_OBJECT_ENSURE_REGISTERED (SharedBuffer);
+NS_OBJECT_ENSURE_REGISTERED (SharedBufferQueue);
+
+
+TypeId
+SharedBuffer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::SharedBuffer")
+    .SetParent<Object> ()
+    .AddConstructor<SharedBuffer> ()
+    .AddAttribute ("Size",
+                   "Bytes of packet memory shared by the egress queues of the switch.",
+                   UintegerValue (1024 * 1024),
+                   MakeUintegerAccessor (&SharedBuffer::m_size),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Alpha",
+                   "Dynamic threshold factor: a queue may grow to Alpha times the free buffer memory.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&SharedBuffer::m_alpha),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("EcnThreshold",
+                   "Queue length, in bytes, from which ECN-capable packets are marked Congestion Experienced; "
+                   "0 for no marking.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SharedBuffer::m_ecnThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Priorities",
+                   "Number of strict priority queues per port; set it before the queues are created.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&SharedBuffer::m_nPriorities),
+                   MakeUintegerChecker<uint32_t> (1, 8))
+    .AddTraceSource ("Occupancy",
+                     "Bytes held by all queues of the buffer.",
+                     MakeTraceSourceAccessor (&SharedBuffer::m_occupancy))
+  ;
+  return tid;
+}
+
+
+SharedBuffer::SharedBuffer ()
+  : m_size (1024 * 1024),
+    m_alpha (1.0),
+    m_ecnThreshold (0),
+    m_nPriorities (1),
+    m_occupancy (0),
+    m_maxOccupancy (0),
+    m_nDrops (0),
+    m_nMarks (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+SharedBuffer::~SharedBuffer ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+bool
+SharedBuffer::Admit (uint32_t queued, uint32_t size) const
+{
+  uint32_t free = m_size - m_occupancy;
+  return size <= free && queued + size <= m_alpha * free;
+}
+
+
+void
+SharedBuffer::Allocate (uint32_t size)
+{
+  m_occupancy += size;
+  m_maxOccupancy = std::max<uint32_t> (m_maxOccupancy, m_occupancy);
+}
+
+
+void
+SharedBuffer::Release (uint32_t size)
+{
+  NS_ASSERT (size <= m_occupancy);
+  m_occupancy -= size;
+}
+
+
+uint32_t
+SharedBuffer::GetSize (void) const
+{
+  return m_size;
+}
+
+
+uint32_t
+SharedBuffer::GetOccupancy (void) const
+{
+  return m_occupancy;
+}
+
+
+uint32_t
+SharedBuffer::GetMaxOccupancy (void) const
+{
+  return m_maxOccupancy;
+}
+
+
+uint32_t
+SharedBuffer::GetEcnThreshold (void) const
+{
+  return m_ecnThreshold;
+}
+
+
+uint32_t
+SharedBuffer::GetNPriorities (void) const
+{
+  return m_nPriorities;
+}
+
+
+void
+SharedBuffer::NotifyDrop (void)
+{
+  m_nDrops++;
+}
+
+
+void
+SharedBuffer::NotifyMark (void)
+{
+  m_nMarks++;
+}
+
+
+uint64_t
+SharedBuffer::GetNDrops (void) const
+{
+  return m_nDrops;
+}
+
+
+uint64_t
+SharedBuffer::GetNMarks (void) const
+{
+  return m_nMarks;
+}
+
+
+TypeId
+SharedBufferQueue::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::pld::SharedBufferQueue")
+    .SetParent<Queue> ()
+    .AddConstructor<SharedBufferQueue> ()
+    .AddAttribute ("Buffer",
+                   "The switch buffer memory the queue holds its packets in.",
+                   PointerValue (),
+                   MakePointerAccessor (&SharedBufferQueue::SetBuffer, &SharedBufferQueue::GetBuffer),
+                   MakePointerChecker<SharedBuffer> ())
+    .AddTraceSource ("Occupancy",
+                     "A priority queue changed length: the priority and its new length in bytes.",
+                     MakeTraceSourceAccessor (&SharedBufferQueue::m_occupancyTrace))
+  ;
+  return tid;
+}
+
+
+SharedBufferQueue::SharedBufferQueue ()
+  : m_queues (1),
+    m_bytes (1, 0),
+    m_totalBytes (0),
+    m_maxBytes (0),
+    m_nMarks (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+SharedBufferQueue::~SharedBufferQueue ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+
+void
+SharedBufferQueue::DoDispose (void)
+{
+  DequeueAll ();
+  m_buffer = 0;
+  Queue::DoDispose ();
+}
+
+
+void
+SharedBufferQueue::SetBuffer (Ptr<SharedBuffer> buffer)
+{
+  NS_ASSERT_MSG (m_totalBytes == 0, "Cannot move a queue holding packets to another buffer");
+  m_buffer = buffer;
+  m_queues.assign (buffer->GetNPriorities (), std::queue<Ptr<Packet> > ());
+  m_bytes.assign (buffer->GetNPriorities (), 0);
+}
+
+
+Ptr<SharedBuffer>
+SharedBufferQueue::GetBuffer (void) const
+{
+  return m_buffer;
+}
+
+
+uint32_t
+SharedBufferQueue::GetNBytes (uint32_t priority) const
+{
+  NS_ASSERT (priority < m_bytes.size ());
+  return m_bytes[priority];
+}
+
+
+uint32_t
+SharedBufferQueue::GetMaxBytes (void) const
+{
+  return m_maxBytes;
+}
+
+
+uint64_t
+SharedBufferQueue::GetNMarks (void) const
+{
+  return m_nMarks;
+}
+
+
+uint32_t
+SharedBufferQueue::ClassifyAndMark (Ptr<Packet> p, uint32_t size)
+{
+  uint32_t n_priorities = m_queues.size ();
+  uint32_t threshold = m_buffer->GetEcnThreshold ();
+  // with a single priority the headers are only needed to mark, so leave them alone while the queue is short
+  if (n_priorities == 1 && (threshold == 0 || m_bytes[0] < threshold))
+    {
+      return 0;
+    }
+
+  // read the headers from a copy, which shares the bytes of the frame: the frame is only rewritten to mark it
+  Ptr<Packet> frame = p->Copy ();
+  EthernetHeader eth (false);
+  frame->RemoveHeader (eth);
+  if (eth.GetLengthType () != Ipv4L3Protocol::PROT_NUMBER)
+    {
+      return 0;
+    }
+  Ipv4Header ip;
+  frame->PeekHeader (ip);
+  uint32_t precedence = ip.GetTos () >> 5;
+  uint32_t priority = (n_priorities - 1) - std::min (precedence, n_priorities - 1);
+  if (threshold != 0 && m_bytes[priority] >= threshold
+      && ip.GetEcn () != Ipv4Header::NotECT && ip.GetEcn () != Ipv4Header::CE
+      && m_buffer->Admit (m_bytes[priority], size))
+    {
+      Mark (p);
+      m_nMarks++;
+      m_buffer->NotifyMark ();
+    }
+  return priority;
+}
+
+
+void
+SharedBufferQueue::Mark (Ptr<Packet> p)
+{
+  // the frame carries the trailer of the CsmaNetDevice, whose FCS covers the IPv4 header
+  EthernetHeader eth (false);
+  p->RemoveHeader (eth);
+  EthernetTrailer trailer;
+  p->RemoveTrailer (trailer);
+  Ipv4Header ip;
+  p->RemoveHeader (ip);
+  ip.SetEcn (Ipv4Header::CE);
+  if (Node::ChecksumEnabled ())
+    {
+      ip.EnableChecksum ();
+      trailer.EnableFcs (true);
+    }
+  p->AddHeader (ip);
+  p->AddHeader (eth);
+  trailer.CalcFcs (p);
+  p->AddTrailer (trailer);
+}
+
+
+bool
+SharedBufferQueue::DoEnqueue (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+  NS_ASSERT_MSG (m_buffer != 0, "SharedBufferQueue without a buffer");
+
+  uint32_t size = p->GetSize ();
+  uint32_t priority = ClassifyAndMark (p, size);
+  if (!m_buffer->Admit (m_bytes[priority], size))
+    {
+      NS_LOG_LOGIC ("Queue " << priority << " over its share of the buffer -- dropping packet");
+      m_buffer->NotifyDrop ();
+      Drop (p);
+      return false;
+    }
+
+  m_queues[priority].push (p);
+  m_bytes[priority] += size;
+  m_totalBytes += size;
+  m_maxBytes = std::max (m_maxBytes, m_totalBytes);
+  m_buffer->Allocate (size);
+  m_occupancyTrace (priority, m_bytes[priority]);
+  return true;
+}
+
+
+Ptr<Packet>
+SharedBufferQueue::DoDequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t priority = 0; priority < m_queues.size (); priority++)
+    {
+      if (!m_queues[priority].empty ())
+        {
+          Ptr<Packet> p = m_queues[priority].front ();
+          m_queues[priority].pop ();
+          uint32_t size = p->GetSize ();
+          m_bytes[priority] -= size;
+          m_totalBytes -= size;
+          m_buffer->Release (size);
+          m_occupancyTrace (priority, m_bytes[priority]);
+          return p;
+        }
+    }
+  return 0;
+}
+
+
+Ptr<const Packet>
+SharedBufferQueue::DoPeek (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t priority = 0; priority < m_queues.size (); priority++)
+    {
+      if (!m_queues[priority].empty ())
+        {
+          return m_queues[priority].front ();
+        }
+    }
+  return 0;
+}
+
+} // namespace pld
+
+} // namespace ns3
@@ -0,0 +1,186 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_SHARED_BUFFER_H
+#define PORTLAND_SHARED_BUFFER_H 1
+
+#include "ns3/object.h"
+#include "ns3/queue.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+
+#include <queue>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief Packet memory of a switch, shared by the egress queues of all its ports.
+ *
+ * Admission follows the dynamic threshold scheme of Choudhury and Hahne: a queue may take a packet while its
+ * length stays below Alpha times the buffer memory still free, so a few busy ports can use most of the buffer
+ * while every port keeps a share once many are busy. The buffer itself never holds more than Size bytes.
+ */
+class SharedBuffer : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  SharedBuffer ();
+  virtual ~SharedBuffer ();
+
+  /**
+   * \param queued Bytes held by the queue the packet is for.
+   * \param size Bytes of the packet.
+   * \return True if the packet may be queued.
+   */
+  bool Admit (uint32_t queued, uint32_t size) const;
+
+  /**
+   * Accounts for a packet a queue took or let go of.
+   */
+  void Allocate (uint32_t size);
+  void Release (uint32_t size);
+
+  uint32_t GetSize (void) const;
+  uint32_t GetOccupancy (void) const;
+
+  /**
+   * \return Largest occupancy so far.
+   */
+  uint32_t GetMaxOccupancy (void) const;
+
+  /**
+   * \return Queue length, in bytes, from which queued ECN-capable packets are marked Congestion Experienced.
+   */
+  uint32_t GetEcnThreshold (void) const;
+
+  /**
+   * \return Number of priority queues per port.
+   */
+  uint32_t GetNPriorities (void) const;
+
+  /**
+   * Counts a packet a queue of the buffer refused or marked.
+   */
+  void NotifyDrop (void);
+  void NotifyMark (void);
+
+  /**
+   * \return Number of packets refused by the queues of the buffer.
+   */
+  uint64_t GetNDrops (void) const;
+
+  /**
+   * \return Number of packets marked Congestion Experienced by the queues of the buffer.
+   */
+  uint64_t GetNMarks (void) const;
+
+private:
+  uint32_t m_size;
+  double m_alpha;
+  uint32_t m_ecnThreshold;
+  uint32_t m_nPriorities;
+  TracedValue<uint32_t> m_occupancy;
+  uint32_t m_maxOccupancy;
+  uint64_t m_nDrops;
+  uint64_t m_nMarks;
+};
+
+
+/**
+ * \brief Egress queue of a switch port, holding its packets in the memory of a SharedBuffer.
+ *
+ * The queue keeps one FIFO per priority, served in strict priority order. Frames that do not carry IPv4 (ARP,
+ * LDMs) go to the highest priority; IPv4 packets go by the precedence bits of their TOS, higher precedence
+ * first, the lowest priority taking precedence 0 and, with fewer priorities than precedences, the highest
+ * taking all precedences that do not fit. Each priority queue is admitted by the buffer on its own.
+ *
+ * An ECN-capable IPv4 packet arriving at a priority queue at least EcnThreshold bytes long is marked
+ * Congestion Experienced, as DCTCP expects from the switches; other packets are queued unmarked.
+ *
+ * Set it as the TxQueue of a CsmaNetDevice, whose frames carry an Ethernet header in DIX encapsulation.
+ */
+class SharedBufferQueue : public Queue
+{
+public:
+  static TypeId GetTypeId (void);
+
+  SharedBufferQueue ();
+  virtual ~SharedBufferQueue ();
+
+  void SetBuffer (Ptr<SharedBuffer> buffer);
+  Ptr<SharedBuffer> GetBuffer (void) const;
+
+  using Queue::GetNBytes;
+
+  /**
+   * \return Bytes held by a priority queue; priority 0 is served first.
+   */
+  uint32_t GetNBytes (uint32_t priority) const;
+
+  /**
+   * \return Largest number of bytes the queue held, over all priorities.
+   */
+  uint32_t GetMaxBytes (void) const;
+
+  /**
+   * \return Number of packets the queue marked Congestion Experienced.
+   */
+  uint64_t GetNMarks (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual bool DoEnqueue (Ptr<Packet> p);
+  virtual Ptr<Packet> DoDequeue (void);
+  virtual Ptr<const Packet> DoPeek (void) const;
+
+  /**
+   * Finds the priority of a frame and marks it Congestion Experienced if it is ECN-capable, the queue of that
+   * priority has reached the ECN threshold and the buffer admits it; a frame about to be dropped is left alone.
+   * The headers are only parsed when either is needed, and the frame is only rewritten when it is marked.
+   *
+   * \param size Bytes of the frame.
+   * \return The priority.
+   */
+  uint32_t ClassifyAndMark (Ptr<Packet> p, uint32_t size);
+  /**
+   * Sets the ECN field of an IPv4 frame to Congestion Experienced, with the IPv4 checksum and the Ethernet FCS
+   * recomputed when checksums are enabled.
+   */
+  void Mark (Ptr<Packet> p);
+
+  Ptr<SharedBuffer> m_buffer;
+  std::vector<std::queue<Ptr<Packet> > > m_queues;      ///< By priority
+  std::vector<uint32_t> m_bytes;                        ///< Bytes of each priority queue
+  uint32_t m_totalBytes;
+  uint32_t m_maxBytes;
+  uint64_t m_nMarks;
+
+  /// Priority and new length in bytes of a priority queue that changed
+  TracedCallback<uint32_t, uint32_t> m_occupancyTrace;
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_SHARED_BUFFER_H */
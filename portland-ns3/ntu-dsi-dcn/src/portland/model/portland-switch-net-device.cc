@@ -17,10 +17,15 @@
  */
 
 #include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 #include "portland-switch-net-device.h"
+#include "portland-fabric-manager-cluster.h"
+#include "portland-event-trace.h"
 #include "ns3/udp-l4-protocol.h"
 #include "ns3/tcp-l4-protocol.h"
+#include "ns3/pointer.h"
 
 namespace ns3 {
 
@@ -28,6 +33,9 @@ NS_LOG_COMPONENT_DEFINE ("PortlandSwitchNetDevice");
 
 NS_OBJECT_ENSURE_REGISTERED (PortlandSwitchNetDevice);
 
+/// Entry of m_portIndex for an interface index that is not a port of the switch
+static const uint32_t NO_PORT = 0xffffffff;
+
 
 const char *
 PortlandSwitchNetDevice::GetManufacturerDescription ()
@@ -76,6 +84,158 @@ PortlandSwitchNetDevice::GetTypeId (void)
                    UintegerValue (GenerateId ()),
                    MakeUintegerAccessor (&PortlandSwitchNetDevice::m_id),
                    MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("UplinkPolicy",
+                   "How edge and aggregation switches pick the upper layer port of a packet going upstream.",
+                   EnumValue (UPLINK_HASH),
+                   MakeEnumAccessor (&PortlandSwitchNetDevice::m_uplinkPolicy),
+                   MakeEnumChecker (UPLINK_RANDOM, "Random",
+                                    UPLINK_HASH, "Hash",
+                                    UPLINK_FLOWLET, "Flowlet",
+                                    UPLINK_ADAPTIVE, "Adaptive"))
+    .AddAttribute ("HashSeed",
+                   "Seed of the 5-tuple hash used by the Hash and Flowlet uplink policies.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::m_hashSeed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FlowletGap",
+                   "Idle time after which the next packet of a flow starts a new flowlet and may take another uplink.",
+                   TimeValue (MicroSeconds (500)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::m_flowletGap),
+                   MakeTimeChecker ())
+    .AddAttribute ("LoadTimeConstant",
+                   "Time constant of the moving average of transmitted bytes that the Adaptive uplink policy uses to "
+                   "rank ports with equally long transmit queues.",
+                   TimeValue (MicroSeconds (100)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::m_loadTimeConstant),
+                   MakeTimeChecker ())
+    .AddAttribute ("RebalanceThreshold",
+                   "Transmit queue length, in bytes, above which the Adaptive uplink policy moves a flowlet to a port "
+                   "with a shorter queue.",
+                   UintegerValue (16384),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::m_rebalanceThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FlowletTableSize",
+                   "Number of slots of the flowlet table; a flow that takes over the slot of another flow ends that flow's flowlet.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::SetFlowletTableSize,
+                                         &PortlandSwitchNetDevice::GetFlowletTableSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PMACCacheSize",
+                   "Maximum number of destination IP -> PMAC mappings cached by an edge switch; 0 disables the cache.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::SetPMACCacheSize,
+                                         &PortlandSwitchNetDevice::GetPMACCacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("PMACCacheTimeout",
+                   "Lifetime of a cached destination PMAC; zero means entries only leave the cache on eviction or invalidation.",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::SetPMACCacheTimeout,
+                                     &PortlandSwitchNetDevice::GetPMACCacheTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("PMACCacheHits",
+                   "Number of destination PMAC lookups answered by the PMAC cache.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNPMACCacheHits),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("PMACCacheMisses",
+                   "Number of destination PMAC lookups that had to query the Fabric Manager.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNPMACCacheMisses),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("MaxHeldPackets",
+                   "Maximum number of packets an edge switch holds per destination while the Fabric Manager resolves its PMAC.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::m_maxHeldPackets),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HeldPackets",
+                   "Number of packets from hosts held while the Fabric Manager resolved their destination.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNHeldPackets),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("HeldPacketDrops",
+                   "Number of held packets dropped because too many were held or the destination was unknown.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNHeldPacketDrops),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("FloodFrames",
+                   "Number of broadcast ARP Request frames sent while flooding for the Fabric Manager.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNFloodFrames),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("MigrationTrapTime",
+                   "How long the old edge switch of a host that moved traps packets still sent to its old PMAC.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::m_migrationTrapTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("ForwardMovedPackets",
+                   "Whether trapped packets are forwarded to the new location of the host; they are dropped otherwise.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&PortlandSwitchNetDevice::m_forwardMovedPackets),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TrappedPackets",
+                   "Number of packets for hosts that moved away that arrived at their old edge switch.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNTrappedPackets),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("GratuitousArps",
+                   "Number of gratuitous ARP Replies sent to the senders of trapped packets.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNGratuitousArps),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("MulticastFlood",
+                   "Whether multicast packets are flooded to every host down the group's tree instead of only "
+                   "to the members; the naive baseline of the replication trees.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PortlandSwitchNetDevice::m_multicastFlood),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MulticastFrames",
+                   "Number of multicast frames handed to a port device for transmission.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNMulticastFrames),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("LdmInterval",
+                   "Time between two Location Discovery Messages on a port.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::m_ldmInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("LdmTimeout",
+                   "Time without Location Discovery Messages on a port after which the port is taken to lead to hosts, "
+                   "or, on a located switch, to be down.",
+                   TimeValue (MilliSeconds (50)),
+                   MakeTimeAccessor (&PortlandSwitchNetDevice::m_ldmTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("LdmsSent",
+                   "Number of Location Discovery Messages sent.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNLdmsSent),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("LinkFailures",
+                   "Number of ports taken down because their Location Discovery Messages stopped.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNLinkFailures),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("PacketCopies",
+                   "Number of packet copies made on the forwarding path.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNPacketCopies),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("ForwardedPackets",
+                   "Number of frames handed to a port device for transmission.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PortlandSwitchNetDevice::GetNForwardedPackets),
+                   MakeUintegerChecker<uint64_t> ())
   ;
   return tid;
 }
@@ -91,20 +251,51 @@ PortlandSwitchNetDevice::PortlandSwitchNetDevice ()
     m_device_type(EDGE),
     m_pod(0),
     m_position(0),
+    m_located(true),
+    m_locationRequested(false),
+    m_ldmInterval(MilliSeconds (10)),
+    m_ldmTimeout(MilliSeconds (50)),
+    m_ldpStart(Seconds (0)),
+    m_nLdmsSent(0),
+    m_deadUplinks(0),
+    m_excludedUplinks(),
+    m_nLinkFailures(0),
     m_packetData(),
     m_upper_ports(),
     m_lower_ports(),
     m_fabricManager(0),
-    m_table()
+    m_fabricManagerCluster(0),
+    m_table(),
+    m_packetCopies(0),
+    m_forwardedPackets(0),
+    m_pmacCache(),
+    m_pmacCacheHits(0),
+    m_pmacCacheMisses(0),
+    m_heldPackets(),
+    m_maxHeldPackets(64),
+    m_nHeldPackets(0),
+    m_nHeldPacketDrops(0),
+    m_nFloodFrames(0),
+    m_movedPMACs(),
+    m_migrationTrapTime(Seconds (1)),
+    m_forwardMovedPackets(true),
+    m_nTrappedPackets(0),
+    m_nGratuitousArps(0),
+    m_groups(),
+    m_multicastFlood(false),
+    m_nMulticastFrames(0),
+    m_uplinkPolicy(UPLINK_HASH),
+    m_hashSeed(0),
+    m_flowletGap(MicroSeconds (500)),
+    m_loadTimeConstant(MicroSeconds (100)),
+    m_rebalanceThreshold(16384),
+    m_flowlets()
 {
   NS_LOG_FUNCTION_NOARGS ();
 
   m_channel = CreateObject<BridgeChannel> ();
 
   m_fabricManager = 0;
-  
-  m_upper_ports.reserve (100);
-  m_lower_ports.reserve (100);
 }
 
 
@@ -125,20 +316,30 @@ PortlandSwitchNetDevice::DoDispose ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  m_ldmEvent.Cancel ();
   for (Ports_t::iterator b = m_upper_ports.begin (), e = m_upper_ports.end (); b != e; b++)
     {
       b->netdev = 0;
+      b->queue = 0;
     }
   m_upper_ports.clear ();
   for (Ports_t::iterator b = m_lower_ports.begin (), e = m_lower_ports.end (); b != e; b++)
     {
       b->netdev = 0;
+      b->queue = 0;
     }
   m_lower_ports.clear ();
+  m_portIndex.clear ();
 
   m_fabricManager = 0;
+  m_fabricManagerCluster = 0;
 
   m_table.clear();
+  m_pmacCache.clear();
+  m_heldPackets.clear();
+  m_flowlets.clear();
+  m_excludedUplinks.clear();
+  m_groups.clear();
 
   m_channel = 0;
   m_node = 0;
@@ -152,7 +353,7 @@ PortlandSwitchNetDevice::DoDispose ()
 void
 PortlandSwitchNetDevice::SetFabricManager (Ptr<pld::FabricManager> fm)
 {
-  if (m_fabricManager != 0)
+  if (m_fabricManager != 0 || m_fabricManagerCluster != 0)
     {
       NS_LOG_ERROR ("Fabric Manager already set.");
       return;
@@ -163,6 +364,23 @@ PortlandSwitchNetDevice::SetFabricManager (Ptr<pld::FabricManager> fm)
 }
 
 
+/*
+ * Function to connect the PortlandSwitchNetDevice to a cluster of Fabric Manager shards
+ */
+void
+PortlandSwitchNetDevice::SetFabricManagerCluster (Ptr<pld::FabricManagerCluster> cluster)
+{
+  if (m_fabricManager != 0 || m_fabricManagerCluster != 0)
+    {
+      NS_LOG_ERROR ("Fabric Manager already set.");
+      return;
+    }
+
+  m_fabricManagerCluster = cluster;
+  m_fabricManagerCluster->AddSwitch (this);
+}
+
+
 /*
  * Registers other NetDevices/NICs (eg. CsmaNetDevice) on the switch with this  PortlandSwitchNetDevice as switch ports,
  * and register the receive callback function with those devices.
@@ -187,6 +405,12 @@ PortlandSwitchNetDevice::AddSwitchPort (Ptr<NetDevice> switchPort, bool is_upper
 
     pld::Port p;
     p.netdev = switchPort;
+    // the transmit queue, if any, gives the Adaptive uplink policy the port's backlog
+    PointerValue queue;
+    if (switchPort->GetAttributeFailSafe ("TxQueue", queue))
+    {
+      p.queue = queue.Get<Queue> ();
+    }
     if (is_upper)
     {
       m_upper_ports.push_back (p);
@@ -195,6 +419,7 @@ PortlandSwitchNetDevice::AddSwitchPort (Ptr<NetDevice> switchPort, bool is_upper
     {
       m_lower_ports.push_back (p);
     }
+    IndexPorts ();
 
     NS_LOG_DEBUG ("RegisterProtocolHandler for " << switchPort->GetInstanceTypeId ().GetName ());
     m_node->RegisterProtocolHandler (MakeCallback (&PortlandSwitchNetDevice::ReceiveFromDevice, this),
@@ -247,7 +472,7 @@ PortlandSwitchNetDevice::IsCore(void)
  * Updates the Pod number of the switch in the topology.
  */
 void
-PortlandSwitchNetDevice::SetPod (const uint8_t pod)
+PortlandSwitchNetDevice::SetPod (const uint16_t pod)
 {
   NS_LOG_FUNCTION_NOARGS ();
   m_pod = pod;
@@ -257,7 +482,7 @@ PortlandSwitchNetDevice::SetPod (const uint8_t pod)
 /*
  * Returns the Pod number of the switch in the topology.
  */
-uint8_t
+uint16_t
 PortlandSwitchNetDevice::GetPod (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -269,7 +494,7 @@ PortlandSwitchNetDevice::GetPod (void) const
  * Updates the Position number of the switch in the pod.
  */
 void
-PortlandSwitchNetDevice::SetPosition (const uint8_t position)
+PortlandSwitchNetDevice::SetPosition (const uint16_t position)
 {
   NS_LOG_FUNCTION_NOARGS ();
   m_position = position;
@@ -279,7 +504,7 @@ PortlandSwitchNetDevice::SetPosition (const uint8_t position)
 /*
  * Returns the Position number of the switch in the pod.
  */
-uint8_t
+uint16_t
 PortlandSwitchNetDevice::GetPosition (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -343,13 +568,32 @@ bool
 PortlandSwitchNetDevice::IsLinkUp (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
-  return true;
+  // the switch is up while any of its ports is
+  for (size_t i = 0; i < m_lower_ports.size (); i++)
+    {
+      if (m_lower_ports[i].is_up)
+        {
+          return true;
+        }
+    }
+  for (size_t i = 0; i < m_upper_ports.size (); i++)
+    {
+      if (m_upper_ports[i].is_up)
+        {
+          return true;
+        }
+    }
+  return false;
 }
 
 
+/*
+ * The callbacks are called whenever a port goes down or comes back up.
+ */
 void
 PortlandSwitchNetDevice::AddLinkChangeCallback (Callback<void> callback)
 {
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
 }
 
 bool
@@ -476,18 +720,20 @@ PortlandSwitchNetDevice::GetMulticast (Ipv6Address addr) const
 
 /*
  * Function to attract packet fields from the packet received and return a buffer with all necessary fields including
- * srcAMAC/PMAC, dstPMAC, srcIP and dstIP.
+ * srcAMAC/PMAC, dstPMAC, srcIP and dstIP. Headers are only peeked at, so the packet is not copied; metadata.packet
+ * is left empty until the packet is actually forwarded.
  */
 SwitchPacketMetadata
-PortlandSwitchNetDevice::MetadataFromPacket (Ptr<const Packet> constPacket, Address src, Address dst, uint16_t protocol)
+PortlandSwitchNetDevice::MetadataFromPacket (Ptr<const Packet> packet, const Address& src, const Address& dst, uint16_t protocol)
 {
   NS_LOG_INFO ("Extracting metadata from packet.");
 
-  Ptr<Packet> packet = constPacket->Copy ();
-
   SwitchPacketMetadata metadata;
 
-  metadata.packet = packet->Copy();
+  metadata.is_arp_request = false;
+  metadata.ip_protocol = 0;
+  metadata.src_port = 0;
+  metadata.dst_port = 0;
   metadata.src_amac = Mac48Address::ConvertFrom (src);             // Actual Source Mac Address
   metadata.dst_pmac = Mac48Address::ConvertFrom (dst);             // Destination Psuedo Mac Address
   metadata.protocol_number = protocol;
@@ -509,9 +755,22 @@ PortlandSwitchNetDevice::MetadataFromPacket (Ptr<const Packet> constPacket, Addr
           metadata.src_ip = ip_hd.GetSource ();         // Source IP Address
           metadata.dst_ip = ip_hd.GetDestination ();    // Destination IP Address
           metadata.is_arp_request = false;              // This is not an ARP packet
+          metadata.ip_protocol = ip_hd.GetProtocol ();
+
+          // TCP and UDP ports are the first four bytes of the L4 header; only the first fragment carries them
+          if ((metadata.ip_protocol == TcpL4Protocol::PROT_NUMBER || metadata.ip_protocol == UdpL4Protocol::PROT_NUMBER)
+              && ip_hd.GetFragmentOffset () == 0)
+            {
+              uint32_t l4_offset = ip_hd.GetSerializedSize ();
+              uint8_t buffer[64];
+              if (l4_offset + 4 <= sizeof (buffer) && packet->CopyData (buffer, l4_offset + 4) == l4_offset + 4)
+                {
+                  metadata.src_port = ((uint16_t) buffer[l4_offset] << 8) | buffer[l4_offset + 1];
+                  metadata.dst_port = ((uint16_t) buffer[l4_offset + 2] << 8) | buffer[l4_offset + 3];
+                }
+            }
 
           NS_LOG_INFO ("Parsed Ipv4Header");
-          packet->RemoveHeader (ip_hd);
         }
     }
   else
@@ -525,7 +784,6 @@ PortlandSwitchNetDevice::MetadataFromPacket (Ptr<const Packet> constPacket, Addr
           metadata.is_arp_request = arp_hd.IsRequest ();          // If it is an ARP Request
           
           NS_LOG_INFO ("Parsed ArpHeader");
-          packet->RemoveHeader (arp_hd);
         }
     }
 
@@ -552,30 +810,36 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
   Mac48Address dst_mac = Mac48Address::ConvertFrom (dst);
   Mac48Address src_mac = Mac48Address::ConvertFrom (src);
 
-  bool from_upper = false;
-  uint8_t in_port;
-  uint8_t out_port;
-  for (size_t i = 0; i < m_lower_ports.size (); i++)
+  uint32_t if_index = netdev->GetIfIndex ();
+  if (if_index >= m_portIndex.size () || m_portIndex[if_index] == NO_PORT)
     {
-      if (m_lower_ports[i].netdev == netdev)
-        {
-          from_upper = false;
-          in_port = i;
-          m_lower_ports[i].rx_packets++;
-          m_lower_ports[i].rx_bytes += packet->GetSize();
-        }
+      NS_LOG_WARN ("Frame from a device that is not a port of the switch");
+      return;
     }
+  bool from_upper = (m_portIndex[if_index] & 1) != 0;
+  uint32_t in_port = m_portIndex[if_index] >> 1;
+  int out_port;
+  pld::Port& rx_port = (from_upper ? m_upper_ports[in_port] : m_lower_ports[in_port]);
+  rx_port.rx_packets++;
+  rx_port.rx_bytes += packet->GetSize();
+
+    if (protocol == pld::LdmHeader::PROT_NUMBER)
+      {
+        ReceiveLdm (in_port, from_upper, packet);
+        return;
+      }
+    if (!m_located)
+      {
+        PLD_TRACE_EVENT (pld::EventTrace::DROP, this, Ipv4Address (), 14);
+        return; // the switch does not know where it is yet
+      }
 
-  for (size_t i = 0; i < m_upper_ports.size (); i++)
-    {
-      if (m_upper_ports[i].netdev == netdev)
-        {
-          from_upper = true;
-          in_port = i;
-          m_upper_ports[i].rx_packets++;
-          m_upper_ports[i].rx_bytes += packet->GetSize();
-        }
-    }
+    if (packetType == PACKET_MULTICAST && protocol == Ipv4L3Protocol::PROT_NUMBER)
+      {
+        SwitchPacketMetadata metadata = MetadataFromPacket (packet, src, dst, protocol);
+        ReceiveMulticast (metadata, packet, in_port, from_upper);
+        return;
+      }
 
     if (packetType == PACKET_HOST && dst_mac == m_address)
       {
@@ -596,8 +860,8 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
 
               // parse packet
               SwitchPacketMetadata metadata;
-              metadata = MetadataFromPacket (packet->Copy (), src, dst, protocol);
-              NS_LOG_UNCOND ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Received packet, src=" << src_mac << ", dst=" << dst_mac <<  ", Protocol=" << (int)protocol << ", in-port=" << (int)in_port << ", from_upper=" << from_upper << ", is_arp_request=" << metadata.is_arp_request);
+              metadata = MetadataFromPacket (packet, src, dst, protocol);
+              NS_LOG_LOGIC ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Received packet, src=" << src_mac << ", dst=" << dst_mac <<  ", Protocol=" << (int)protocol << ", in-port=" << (int)in_port << ", from_upper=" << from_upper << ", is_arp_request=" << metadata.is_arp_request);
 
               if (!from_upper)
               {
@@ -606,72 +870,59 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
                   metadata.src_pmac = GetSourcePMAC (metadata, in_port, from_upper);
                   if (metadata.src_pmac == Mac48Address("ff:ff:ff:ff:ff:ff"))
                   {
-					          NS_LOG_UNCOND ("Drop packet 1 ");
+					          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 1);
                     return; // drop packet due to error in finding/allocating PMAC
                   }
-                  
-                  // Query for dst_pmac based on dst_ip from local table and/or Fabric Manager
-                  Mac48Address dst_pmac = GetDestinationPMAC (metadata.dst_ip, metadata.src_ip, metadata.src_pmac);
-                  // if dst_pmac is broadcast => failed to find dst_pmac; Fabric Manager will broadcast ARP Request
-                  if (dst_pmac == Mac48Address::ConvertFrom(GetBroadcast ()))
-                  {
-					          NS_LOG_UNCOND ("Drop packet 2 ");
-                    return; // drop ARP Request here as it will be re-created at CORE switches
-                  }
-                  
-                  metadata.dst_pmac = dst_pmac;
-                  int out_port = GetOutputPort(metadata.dst_pmac);
-                  if (out_port < 0) {
-					          NS_LOG_UNCOND ("Drop packet 3 ");
-                    return;
-                  }
 
-                  if (metadata.protocol_number == ArpL3Protocol::PROT_NUMBER && !metadata.is_arp_request)
+                  // a gratuitous ARP, e.g. from a host that just moved here, only announces the host
+                  if (metadata.protocol_number == ArpL3Protocol::PROT_NUMBER && metadata.src_ip == metadata.dst_ip)
                   {
-                    ArpHeader arp;
-                    arp.SetReply(metadata.src_pmac, metadata.src_ip, metadata.dst_pmac, metadata.dst_ip);
-                    Ptr<Packet> updated_packet = Create<Packet> ();
-                    updated_packet->AddHeader(arp);
-                    metadata.packet = updated_packet;
+                    return;
                   }
-                  else
+                  
+                  // Look up dst_pmac based on dst_ip in the local table and cache; otherwise hold the packet
+                  // until the Fabric Manager answers
+                  Mac48Address dst_pmac;
+                  if (!GetDestinationPMAC (metadata.dst_ip, dst_pmac))
                   {
-                    metadata.packet = packet->Copy ();
+                    HoldPacket (metadata, packet);
+                    return;
                   }
 
-                  OutputPacket(metadata, (uint8_t) out_port, true);
+                  metadata.dst_pmac = dst_pmac;
+                  ForwardFromHost (metadata, packet);
                 }
                 else if (m_device_type == AGGREGATION)
                 {
                   // basic forwarding
-                  out_port = GetOutputPort(metadata.dst_pmac);
+                  out_port = GetOutputPort(metadata);
                   if (out_port < 0) {
-					          NS_LOG_UNCOND ("Drop packet 4 ");
+					          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 4);
                     return;
                   }
-                  metadata.packet = packet->Copy ();
+                  metadata.packet = CopyPacket (packet);
                   metadata.src_pmac = metadata.src_amac;
                   metadata.src_amac = Mac48Address();
-                  OutputPacket(metadata, (uint8_t) out_port, true);
+                  OutputPacket(metadata, out_port, true);
                 }
                 else if (m_device_type == CORE)
                 {
 
                   // basic forwarding
-                  out_port = GetOutputPort(metadata.dst_pmac);
+                  out_port = GetOutputPort(metadata);
                   if (out_port < 0) {
-					          NS_LOG_UNCOND ("Drop packet 5 ");
+					          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 5);
                     return;
                   }
-                  metadata.packet = packet->Copy ();
+                  metadata.packet = CopyPacket (packet);
                   metadata.src_pmac = metadata.src_amac;
                   metadata.src_amac = Mac48Address();
-                  OutputPacket(metadata, (uint8_t) out_port, false);
+                  OutputPacket(metadata, out_port, false);
                 }
                 else
                 {
                   // no-op; not valid switch type
-					        NS_LOG_UNCOND ("Drop packet 6 ");
+					        PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 6);
                   return;
                 }
               }
@@ -681,26 +932,42 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
                 { 
                   if (metadata.dst_pmac == Mac48Address::ConvertFrom(GetBroadcast()))
                   {
+                    metadata.src_pmac = metadata.src_amac;
+                    metadata.src_amac = Mac48Address();
                     for (size_t i = 0; i < m_lower_ports.size(); i++)
                     {
-                      metadata.packet = packet->Copy ();
-                      metadata.src_pmac = metadata.src_amac;
-                      metadata.src_amac = Mac48Address();
+                      // every port needs its own packet as the port device adds its headers to it
+                      metadata.packet = CopyPacket (packet);
                       OutputPacket(metadata, i, false);
+                      m_nFloodFrames++;
                     }
                   }
                   else
                   {
+                    if (!m_movedPMACs.empty() && m_movedPMACs.find(metadata.dst_pmac) != m_movedPMACs.end())
+                    {
+                      TrapMovedPacket(metadata, packet);
+                      return;
+                    }
+
+                    // an ARP Reply refreshes the cached PMAC of its sender, e.g. a gratuitous ARP from the old
+                    // edge switch of a host that moved
+                    if (metadata.protocol_number == ArpL3Protocol::PROT_NUMBER && !metadata.is_arp_request
+                        && m_pmacCache.Invalidate(metadata.src_ip))
+                    {
+                      m_pmacCache.Insert(metadata.src_ip, metadata.src_amac, Simulator::Now ());
+                    }
+
                     Mac48Address dst_amac = m_table.FindAMAC(metadata.dst_pmac);
                     if (dst_amac == Mac48Address::ConvertFrom(GetBroadcast ()))
                     {
-						          NS_LOG_UNCOND ("Drop packet 7 ");
+						          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 7);
                       return; // drop packet due to error (AMAC never seen)
                     }
 
-                    out_port = GetOutputPort(metadata.dst_pmac);
+                    out_port = GetOutputPort(metadata);
                     if (out_port < 0) {
-						          NS_LOG_UNCOND ("Drop packet 8 ");
+						          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 8);
                       return;
                     }
                     metadata.dst_pmac = dst_amac; // re-write dst_amac and forward to port
@@ -716,35 +983,59 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
                     }
                     else
                     {
-                      metadata.packet = packet->Copy ();
+                      metadata.packet = CopyPacket (packet);
                     }
 
-                    OutputPacket(metadata, (uint8_t) out_port, false);
+                    OutputPacket(metadata, out_port, false);
                   }
                 }
                 else if (m_device_type == AGGREGATION)
                 {
+                  if (metadata.dst_pmac == Mac48Address::ConvertFrom(GetBroadcast()))
+                  {
+                    // every core switch above may flood the same ARP Request; pass on only the copy arriving
+                    // on the lowest upper port that is up, to all edge switches of the pod
+                    uint32_t first_live = 0;
+                    while (first_live < m_upper_ports.size() && first_live < 64 && ((m_deadUplinks >> first_live) & 1))
+                    {
+                      first_live++;
+                    }
+                    if (in_port != first_live)
+                    {
+                      return;
+                    }
+                    metadata.src_pmac = metadata.src_amac;
+                    metadata.src_amac = Mac48Address();
+                    for (size_t i = 0; i < m_lower_ports.size(); i++)
+                    {
+                      metadata.packet = CopyPacket (packet);
+                      OutputPacket(metadata, i, false);
+                      m_nFloodFrames++;
+                    }
+                    return;
+                  }
+
                   // basic forwarding
-                  out_port = GetOutputPort(metadata.dst_pmac);
+                  out_port = GetOutputPort(metadata);
                   if (out_port < 0) {
-					          NS_LOG_UNCOND ("Drop packet 9 ");
+					          PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 9);
                     return;
                   }
-                  metadata.packet = packet->Copy ();
+                  metadata.packet = CopyPacket (packet);
                   metadata.src_pmac = metadata.src_amac;
                   metadata.src_amac = Mac48Address();
-                  OutputPacket(metadata, (uint8_t) out_port, false);
+                  OutputPacket(metadata, out_port, false);
                 }
                 else if (m_device_type == CORE)
                 {
-					        NS_LOG_UNCOND ("Drop packet 10 ");
+					        PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 10);
                   // no-op; as for CORE switch from_upper = false always so this case should never happen
                   return;
                 }
                 else
                 {
                   // no-op; invalid switch type
-					        NS_LOG_INFO ("Drop packet 11 ");
+					        PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 11);
                   return;
                 }
               }
@@ -755,28 +1046,158 @@ PortlandSwitchNetDevice::ReceiveFromDevice (Ptr<NetDevice> netdev, Ptr<const Pac
 }
 
 
+/*
+ * Function to send a packet received from a host on to its destination once both PMACs are known.
+ * ARP Replies are re-created with the PMACs so that hosts only ever learn PMACs.
+ */
+void
+PortlandSwitchNetDevice::ForwardFromHost (SwitchPacketMetadata& metadata, Ptr<const Packet> packet)
+{
+  int out_port = GetOutputPort(metadata);
+  if (out_port < 0) {
+    PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 3);
+    return;
+  }
+
+  if (metadata.protocol_number == ArpL3Protocol::PROT_NUMBER && !metadata.is_arp_request)
+  {
+    ArpHeader arp;
+    arp.SetReply(metadata.src_pmac, metadata.src_ip, metadata.dst_pmac, metadata.dst_ip);
+    Ptr<Packet> updated_packet = Create<Packet> ();
+    updated_packet->AddHeader(arp);
+    metadata.packet = updated_packet;
+  }
+  else
+  {
+    metadata.packet = CopyPacket (packet);
+  }
+
+  OutputPacket(metadata, out_port, true);
+}
+
+
+/*
+ * Function to hold a packet whose destination PMAC is being resolved by the Fabric Manager. Only the
+ * first packet for a destination queries the Fabric Manager; the others wait for the same answer.
+ */
+void
+PortlandSwitchNetDevice::HoldPacket (const SwitchPacketMetadata& metadata, Ptr<const Packet> packet)
+{
+  HeldPackets_t::iterator held = m_heldPackets.find (metadata.dst_ip);
+  if (held == m_heldPackets.end ())
+  {
+    m_pmacCacheMisses++;
+    held = m_heldPackets.insert (std::make_pair (metadata.dst_ip, std::vector<HeldPacket> ())).first;
+    QueryFabricManager(metadata.dst_ip, metadata.src_ip, metadata.src_pmac);
+  }
+
+  if (held->second.size () >= m_maxHeldPackets)
+  {
+    m_nHeldPacketDrops++;
+    return;
+  }
+
+  HeldPacket p;
+  p.metadata = metadata;
+  p.packet = packet;
+  held->second.push_back (p);
+  m_nHeldPackets++;
+}
+
+
+/*
+ * Function to forward the packets held for a destination once the Fabric Manager has answered. A broadcast
+ * PMAC means the Fabric Manager did not know the destination and has the CORE switches flood the ARP Request,
+ * so the held packets are dropped.
+ */
+void
+PortlandSwitchNetDevice::ReleaseHeldPackets (Ipv4Address dst_ip, Mac48Address dst_pmac)
+{
+  HeldPackets_t::iterator held = m_heldPackets.find (dst_ip);
+  if (held == m_heldPackets.end ())
+  {
+    return;
+  }
+
+  std::vector<HeldPacket> packets;
+  packets.swap (held->second);
+  m_heldPackets.erase (held);
+
+  if (dst_pmac == Mac48Address::GetBroadcast ())
+  {
+    PLD_TRACE_EVENT (pld::EventTrace::DROP, this, dst_ip, 2);
+    m_nHeldPacketDrops += packets.size ();
+    return;
+  }
+
+  m_pmacCache.Insert(dst_ip, dst_pmac, Simulator::Now ());
+  for (std::vector<HeldPacket>::iterator p = packets.begin (); p != packets.end (); p++)
+  {
+    p->metadata.dst_pmac = dst_pmac;
+    ForwardFromHost (p->metadata, p->packet);
+  }
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNHeldPackets (void) const
+{
+  return m_nHeldPackets;
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNHeldPacketDrops (void) const
+{
+  return m_nHeldPacketDrops;
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNFloodFrames (void) const
+{
+  return m_nFloodFrames;
+}
+
+
+bool
+PortlandSwitchNetDevice::HasUnresolvedHosts (void) const
+{
+  if (m_device_type != EDGE)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < m_lower_ports.size(); i++)
+  {
+    if (m_lower_ports[i].vmids.GetNAllocated () == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
 /*
  * Function to forward a given packet to the specified out port.
  */
 void
-PortlandSwitchNetDevice::OutputPacket (SwitchPacketMetadata metadata, uint8_t out_port, bool is_upper)
+PortlandSwitchNetDevice::OutputPacket (const SwitchPacketMetadata& metadata, uint32_t out_port, bool is_upper)
 {
-  Ports_t ports = (is_upper ? m_upper_ports : m_lower_ports);
+  Ports_t& ports = (is_upper ? m_upper_ports : m_lower_ports);
   if (out_port >= 0 && out_port < ports.size())
     {
       pld::Port& p = ports[out_port];
       if (p.netdev != 0)
         {
           NS_LOG_INFO ("Sending packet " << metadata.packet->GetUid () << " over port " << (int) out_port);
-          NS_LOG_UNCOND ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Transmit Packet, src=" << metadata.src_pmac << ", dst=" << metadata.dst_pmac <<  ", Protocol=" << (int)metadata.protocol_number << ", out-port=" << (int)out_port << ", to_upper=" << is_upper << ", is_arp_request=" << metadata.is_arp_request);
-          if (p.netdev->SendFrom (metadata.packet->Copy (), metadata.src_pmac, metadata.dst_pmac, metadata.protocol_number))
+          NS_LOG_LOGIC ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Transmit Packet, src=" << metadata.src_pmac << ", dst=" << metadata.dst_pmac <<  ", Protocol=" << (int)metadata.protocol_number << ", out-port=" << (int)out_port << ", to_upper=" << is_upper << ", is_arp_request=" << metadata.is_arp_request);
+          m_forwardedPackets++;
+          uint32_t size = metadata.packet->GetSize();
+          if (SendOnPort (p, metadata.packet, metadata.src_pmac, metadata.dst_pmac, metadata.protocol_number))
             {
-              p.tx_packets++;
-              p.tx_bytes += metadata.packet->GetSize();
-            }
-          else
-            {
-              p.tx_dropped++;
+              p.tx_load = GetPortLoad (p) + size;
+              p.tx_load_time = Simulator::Now ();
             }
           return;
         }
@@ -787,36 +1208,119 @@ PortlandSwitchNetDevice::OutputPacket (SwitchPacketMetadata metadata, uint8_t ou
 
 
 /*
- * Function to send request buffer to Fabric Manager
+ * Function to hand a frame to a port device. The bytes are counted before the device adds its Ethernet header,
+ * as they are on receipt.
+ */
+bool
+PortlandSwitchNetDevice::SendOnPort (pld::Port& p, Ptr<Packet> packet, Mac48Address src, Mac48Address dst, uint16_t protocol)
+{
+  uint32_t size = packet->GetSize ();
+  if (!p.netdev->SendFrom (packet, src, dst, protocol))
+    {
+      p.tx_dropped++;
+      return false;
+    }
+  p.tx_packets++;
+  p.tx_bytes += size;
+  return true;
+}
+
+
+/*
+ * Makes the (copy-on-write) copy of a received packet that is handed to a port device; the only packet
+ * copy on the forwarding path.
+ */
+Ptr<Packet>
+PortlandSwitchNetDevice::CopyPacket (Ptr<const Packet> packet)
+{
+  m_packetCopies++;
+  return packet->Copy ();
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNPacketCopies (void) const
+{
+  return m_packetCopies;
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNForwardedPackets (void) const
+{
+  return m_forwardedPackets;
+}
+
+
+/*
+ * Function to send request buffer to Fabric Manager; any answer comes back through ReceiveBufferFromFabricManager
  */
-pld::BufferData
+void
 PortlandSwitchNetDevice::SendBufferToFabricManager(pld::BufferData request_buffer)
 {
-  pld::BufferData response_buffer;
-  if (m_fabricManager != 0)
+  if (m_fabricManagerCluster != 0)
+  {
+    m_fabricManagerCluster->ReceiveFromSwitch(this, request_buffer);
+  }
+  else if (m_fabricManager != 0)
+  {
+    m_fabricManager->ReceiveFromSwitch(this, request_buffer);
+  }
+  else
   {
-    response_buffer = m_fabricManager->ReceiveFromSwitch(this, request_buffer);
+    pld::FreeMessage(request_buffer);
   }
-  // NS_LOG_UNCOND("Received response from FM");
-  return response_buffer;
 }
 
 /*
- * Function to receive response buffer from the Fabric Manager
+ * Function to receive a message from the Fabric Manager; the switch owns the message and frees it
  */
 void
 PortlandSwitchNetDevice::ReceiveBufferFromFabricManager(pld::BufferData request_buffer)
 {
-  if (m_device_type == CORE && request_buffer.pkt_type == PKT_ARP_FLOOD)
+  if ((m_device_type == CORE || m_device_type == EDGE) && request_buffer.pkt_type == PKT_ARP_FLOOD)
   {
-    pld::ARPFloodRequest* msg = (pld::ARPFloodRequest*)request_buffer.message;
+    pld::ARPFloodRequest* msg = request_buffer.Get<pld::ARPFloodRequest> ();
     ARPFloodFromFabricManager(msg->destIPAddress, msg->srcIPAddress, msg->srcPMACAddress);
   }
+  else if (m_device_type == EDGE && request_buffer.pkt_type == PKT_PMAC_INVALIDATE)
+  {
+    pld::PMACInvalidate* msg = request_buffer.Get<pld::PMACInvalidate> ();
+    InvalidatePMAC(msg->hostIP, msg->oldPMACAddress, msg->newPMACAddress);
+  }
+  else if (m_device_type == EDGE && request_buffer.pkt_type == PKT_ARP_RESPONSE)
+  {
+    pld::ARPResponse* msg = request_buffer.Get<pld::ARPResponse> ();
+    ReleaseHeldPackets(msg->destIPAddress, msg->destPMACAddress);
+  }
+  else if (m_device_type == EDGE && request_buffer.pkt_type == PKT_LOCATION_ASSIGN && !m_located)
+  {
+    pld::LocationAssign* msg = request_buffer.Get<pld::LocationAssign> ();
+    SetLocated(msg->pod, msg->position);
+  }
+  else if ((m_device_type == EDGE || m_device_type == AGGREGATION) && request_buffer.pkt_type == PKT_PORT_EXCLUSION)
+  {
+    pld::PortExclusion* msg = request_buffer.Get<pld::PortExclusion> ();
+    uint32_t destination = ((uint32_t) msg->pod << 16) | msg->position;
+    if (msg->uplinks == 0)
+    {
+      m_excludedUplinks.erase(destination);
+    }
+    else
+    {
+      m_excludedUplinks[destination] = msg->uplinks;
+    }
+  }
+  else if (request_buffer.pkt_type == PKT_GROUP_ROUTE)
+  {
+    pld::GroupRoute* msg = request_buffer.Get<pld::GroupRoute> ();
+    SetGroupRoute(msg->group, msg->ports, msg->up, msg->uplink);
+  }
   else
   {
     // no-op
   }
-  // NS_LOG_UNCOND("Finished ReceiveBufferFromFabricManager");
+  pld::FreeMessage(request_buffer);
 }
 
 
@@ -826,17 +1330,12 @@ PortlandSwitchNetDevice::ReceiveBufferFromFabricManager(pld::BufferData request_
 void
 PortlandSwitchNetDevice::UpdateFabricManager(Ipv4Address src_ip, Mac48Address src_pmac)
 {
-  pld::PMACRegister* msg = (pld::PMACRegister *) malloc (sizeof(pld::PMACRegister));
+  pld::PMACRegister* msg;
+  pld::BufferData buffer = pld::CreateMessage (msg);
   msg->hostIP = src_ip;
   msg->PMACAddress = src_pmac;
-  
-  pld::BufferData buffer;
-  buffer.pkt_type = PKT_MAC_REGISTER;
-  buffer.message = msg;
 
-  pld::BufferData buf = SendBufferToFabricManager(buffer);
-  free(buf.message);
-  // NS_LOG_UNCOND("EOF UpdateFabricManager");
+  SendBufferToFabricManager(buffer);
 }
 
 
@@ -844,51 +1343,49 @@ PortlandSwitchNetDevice::UpdateFabricManager(Ipv4Address src_ip, Mac48Address sr
  * Queries Fabric Manager for PMAC for the corresponding IP Address. It passes the srcPMAC additionally because
  * Fabric Manager might have to flood ARP Requests to the network via the Core switches
  */
-Mac48Address
+void
 PortlandSwitchNetDevice::QueryFabricManager(Ipv4Address dst_ip, Ipv4Address src_ip, Mac48Address src_pmac)
 {
-  pld::ARPRequest* msg = (pld::ARPRequest *) malloc (sizeof(pld::ARPRequest));
+  pld::ARPRequest* msg;
+  pld::BufferData buffer = pld::CreateMessage (msg);
   msg->srcIPAddress = src_ip;
   msg->srcPMACAddress = src_pmac;
   msg->destIPAddress = dst_ip;
-  
-  pld::BufferData buffer;
-  buffer.pkt_type = PKT_ARP_REQUEST;
-  buffer.message = msg;
-
-  pld::BufferData response = SendBufferToFabricManager(buffer);
-  pld::ARPResponse* arp_resp = (pld::ARPResponse *)(response.message);
-  Mac48Address dst_pmac = arp_resp->destPMACAddress;
-  
-  free(response.message);
 
-  return dst_pmac;
+  SendBufferToFabricManager(buffer);
 }
 
 
 /*
- * Function to flood ARP requests to all lower layer ports of the Core switches.
+ * Function to flood ARP requests to all lower layer ports of a Core switch, or to the host ports of an Edge
+ * switch on which no host has been seen yet.
  */
 void
 PortlandSwitchNetDevice::ARPFloodFromFabricManager(Ipv4Address dst_ip, Ipv4Address src_ip, Mac48Address src_pmac)
 {
-  if (m_device_type == CORE)
+  if (m_device_type == CORE || m_device_type == EDGE)
   {
     ArpHeader arp;
     Ptr<Packet> packet = Create<Packet> ();
     // NS_LOG_UNCOND ("ARP: sending request from node (CORE) "<<m_node->GetId ()<<
     //             " || src: " << src_pmac << " / " << src_ip <<
     //             " || dst: " << Mac48Address::ConvertFrom(GetBroadcast ()) << " / " << dst_ip);
-    NS_LOG_UNCOND ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Init Flood, src=" << src_pmac << "/" << src_ip << ", dst=" << Mac48Address("ff:ff:ff:ff:ff:ff") << "/" << dst_ip);
+    NS_LOG_LOGIC ("SW" << (int)m_device_type << "-" << (int)m_pod << "-" << (int)m_position << ": Event=Init Flood, src=" << src_pmac << "/" << src_ip << ", dst=" << Mac48Address("ff:ff:ff:ff:ff:ff") << "/" << dst_ip);
+    PLD_TRACE_EVENT (pld::EventTrace::FLOOD, this, dst_ip, 0);
     arp.SetRequest ((Address)src_pmac, src_ip, Mac48Address("ff:ff:ff:ff:ff:ff"), dst_ip);
     packet->AddHeader (arp);
 
-    SwitchPacketMetadata metadata = MetadataFromPacket (packet->Copy (), Mac48Address("ff:ff:ff:ff:ff:ff"), Mac48Address("ff:ff:ff:ff:ff:ff"), ArpL3Protocol::PROT_NUMBER);
+    SwitchPacketMetadata metadata = MetadataFromPacket (packet, Mac48Address("ff:ff:ff:ff:ff:ff"), Mac48Address("ff:ff:ff:ff:ff:ff"), ArpL3Protocol::PROT_NUMBER);
     metadata.src_pmac = src_pmac;
     for (size_t i = 0; i < m_lower_ports.size(); i++)
     {
-      metadata.packet = packet->Copy ();
+      if (m_device_type == EDGE && m_lower_ports[i].vmids.GetNAllocated () != 0)
+      {
+        continue;
+      }
+      metadata.packet = CopyPacket (packet);
       OutputPacket(metadata, i, false);
+      m_nFloodFrames++;
     }
   }
   // NS_LOG_UNCOND("Finished ARPFloodFromFabricManager");
@@ -896,321 +1393,1261 @@ PortlandSwitchNetDevice::ARPFloodFromFabricManager(Ipv4Address dst_ip, Ipv4Addre
 
 
 /*
- * Function that gets the output port index based on destination PMAC address
- * Each device has k ports; first half are south-bound, next half are north-bound
- * Device type and position are assumed to be known
+ * Function to handle a PMAC invalidation from the Fabric Manager. Subscribers learn the new PMAC of a host that
+ * moved directly, without querying again. The edge switch that handed out the old PMAC releases it and keeps
+ * trapping packets sent to it for MigrationTrapTime, as senders learn of the move at different times.
  */
-int
-PortlandSwitchNetDevice::GetOutputPort(Mac48Address dst_pmac)
-{   
-  // dst_mac_buffer contains the six octets of the destination MAC address
-  uint8_t dst_pmac_buffer[6];
-  dst_pmac.CopyTo(dst_pmac_buffer);
-  uint16_t dst_pod = ((uint16_t) dst_pmac_buffer[0]) << 8 | dst_pmac_buffer[1];
-  //dst_pod -= 4; // TODO: only for testing; delete this line
+void
+PortlandSwitchNetDevice::InvalidatePMAC (Ipv4Address host_ip, Mac48Address old_pmac, Mac48Address new_pmac)
+{
+  bool moved = (new_pmac != Mac48Address::GetBroadcast());
+  if (m_pmacCache.Invalidate(host_ip) && moved)
+  {
+    m_pmacCache.Insert(host_ip, new_pmac, Simulator::Now ());
+  }
 
-  // if this device is core, downstream to dst_pod
-  if (m_device_type == CORE)
+  if (!moved || pld::PMAC::GetPod(old_pmac) != m_pod || pld::PMAC::GetPosition(old_pmac) != m_position)
   {
-    return dst_pod;
+    return;
   }
-  
-  // if this device is aggregate: same pod -- downstream, otherwise -- upstream on random port to core
-  else if (m_device_type == AGGREGATION)
+
+  NS_LOG_INFO ("Host " << host_ip << " moved from " << old_pmac << " to " << new_pmac);
+  if (m_table.FindPMAC(host_ip) == old_pmac)
   {
-    // same pod -- downstream
-    if (m_pod == dst_pod)
+    ReleasePMAC(old_pmac);
+  }
+
+  // drop the trap entries that have expired
+  Time now = Simulator::Now ();
+  for (MovedPMACs_t::iterator it = m_movedPMACs.begin(); it != m_movedPMACs.end(); )
+  {
+    if (it->second.expires <= now)
     {
-      // return the dst_position -- this is the port connected to edge
-      return dst_pmac_buffer[2];
+      m_movedPMACs.erase(it++);
     }
-    // different pod -- upstream
     else
     {
-      // random port connected to aggregation layer
-      return (rand() % m_upper_ports.size());
-    }
-  }
-  
-  // if this device is edge: same pod and position -- downstream, otherwise -- upstream on random port to aggregate
-  else if (m_device_type == EDGE)
-  { 
-    // same pod and position
-    if (m_pod == dst_pod && m_position == dst_pmac_buffer[2])
-    { 
-      // return the dst port -- this is the port connected to the dst host 
-      return dst_pmac_buffer[3];
-    }
-    // upstream
-    else
-    {
-      // random port connected to core layer
-      return (rand() % m_upper_ports.size());
+      it++;
     }
   }
 
-  return -1;
+  MovedPMAC& entry = m_movedPMACs[old_pmac];
+  entry.new_pmac = new_pmac;
+  entry.expires = now + m_migrationTrapTime;
+  entry.notified.clear();
 }
 
 
-/*
- * Checks the PMAC table for existing PMAC entry. If not found, creates a new PMAC based on switch's pod and position
- * and packet in-port.
- */
-Mac48Address
-PortlandSwitchNetDevice::GetSourcePMAC (SwitchPacketMetadata metadata, uint8_t in_port, bool from_upper)
+void
+PortlandSwitchNetDevice::TrapMovedPacket (SwitchPacketMetadata& metadata, Ptr<const Packet> packet)
 {
-  // port checking
-  if ((from_upper && !(in_port < m_upper_ports.size())) || (!from_upper && !(in_port < m_lower_ports.size())))
+  MovedPMACs_t::iterator moved = m_movedPMACs.find(metadata.dst_pmac);
+  if (moved->second.expires <= Simulator::Now ())
   {
-    NS_LOG_INFO("Illegal in-port" << in_port);
-    return Mac48Address("ff:ff:ff:ff:ff:ff");
+    m_movedPMACs.erase(moved);
+    PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 12);
+    return;
   }
-  
-  Mac48Address src_amac = metadata.src_amac;
-  Ipv4Address dst_ip = metadata.dst_ip;
-  Ipv4Address src_ip = metadata.src_ip;
-  Mac48Address src_pmac;
-  
-  // check for src_PMAC existence
-  if (m_table.FindPort(src_ip) != -1)
+  m_nTrappedPackets++;
+  Mac48Address new_pmac = moved->second.new_pmac;
+
+  // frames from upper ports carry the PMAC of their sender as source address
+  Mac48Address sender_pmac = metadata.src_amac;
+  if (moved->second.notified.insert(metadata.src_ip).second)
   {
-    src_pmac = m_table.FindPMAC(src_amac);
+    ArpHeader arp;
+    arp.SetReply(new_pmac, metadata.dst_ip, sender_pmac, metadata.src_ip);
+    Ptr<Packet> reply = Create<Packet> ();
+    reply->AddHeader(arp);
+
+    SwitchPacketMetadata garp = MetadataFromPacket (reply, new_pmac, sender_pmac, ArpL3Protocol::PROT_NUMBER);
+    garp.packet = reply;
+    garp.src_pmac = new_pmac;
+    SendToPMAC(garp);
+    m_nGratuitousArps++;
   }
-  // else create src_ip - src_PMAC entry
-  else
+
+  if (!m_forwardMovedPackets)
   {
-    uint8_t src_pmac_buffer[6];
-    
-    // assigning src PMAC address
-    src_pmac_buffer[0] = 0;
-    src_pmac_buffer[1] = m_pod;
-    src_pmac_buffer[2] = m_position;
-    src_pmac_buffer[3] = in_port;
-    src_pmac_buffer[4] = 0;
-    src_pmac_buffer[5] = 1;
-    
-    src_pmac.CopyFrom(src_pmac_buffer);
-    
-    // adding entry to the table
-    m_table.Add(src_pmac, src_amac, src_ip, in_port);
-    
-    // register this entry with fabric manager
-    UpdateFabricManager(src_ip, src_pmac);
-  }
-  // NS_LOG_UNCOND("SourcePMAC" << src_pmac);
-  
-  return src_pmac;
+    PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 13);
+    return;
+  }
+  metadata.dst_pmac = new_pmac;
+  metadata.src_pmac = metadata.src_amac;
+  metadata.src_amac = Mac48Address();
+  metadata.packet = CopyPacket (packet);
+  SendToPMAC(metadata);
 }
 
 
-/*
- * Returns the Destination PMAC by either querying the local PMAC table or the global Fabric Manager.
- */
-Mac48Address
-PortlandSwitchNetDevice::GetDestinationPMAC (Ipv4Address dst_ip, Ipv4Address src_ip, Mac48Address src_pmac)
+void
+PortlandSwitchNetDevice::SendToPMAC (SwitchPacketMetadata& metadata)
 {
-  Mac48Address dst_pmac;
-  // check locally if dst is connected to same edge switch
-  // and has been assigned PMAC already
-  if (m_table.FindPort(dst_ip) != -1)
+  if (pld::PMAC::GetPod(metadata.dst_pmac) == m_pod && pld::PMAC::GetPosition(metadata.dst_pmac) == m_position)
   {
-    dst_pmac = m_table.FindPMAC(dst_ip);
+    Mac48Address dst_amac = m_table.FindAMAC(metadata.dst_pmac);
+    if (dst_amac == Mac48Address::GetBroadcast())
+    {
+      return;
+    }
+    uint32_t out_port = pld::PMAC::GetPort(metadata.dst_pmac);
+    metadata.dst_pmac = dst_amac;
+    OutputPacket(metadata, out_port, false);
   }
-  else
+  else if (!m_upper_ports.empty())
   {
-    dst_pmac = QueryFabricManager(dst_ip, src_ip, src_pmac);
+    OutputPacket(metadata, SelectUplink(metadata, GetExcludedUplinks(pld::PMAC::ToBits(metadata.dst_pmac))), true);
   }
-
-  return dst_pmac;
 }
 
 
-uint32_t
-PortlandSwitchNetDevice::GetNSwitchPorts (void) const
+uint64_t
+PortlandSwitchNetDevice::GetNTrappedPackets (void) const
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  return (m_lower_ports.size () + m_upper_ports.size());
+  return m_nTrappedPackets;
 }
 
 
-pld::Port
-PortlandSwitchNetDevice::GetSwitchPort (uint32_t n) const
+uint64_t
+PortlandSwitchNetDevice::GetNGratuitousArps (void) const
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  pld::Port port;
-  return port;
+  return m_nGratuitousArps;
 }
 
-int
-PortlandSwitchNetDevice::GetSwitchPortIndex (pld::Port p)
-{
-  /*for (size_t i = 0; i < m_ports.size (); i++)
-    {
-      if (m_ports[i].netdev == p.netdev)
-        {
-          return i;
-        }
-    }
-  */
-  return -1;
-}
 
 /*
- * Adds an entry of AMAC, IP, in-port <-> PMAC in the PMAC table.
+ * Function to forward a multicast packet along its group's tree. Copies go down the lower ports leading to
+ * members and, if the packet came from below, up towards the core switch at the root of the tree, but never
+ * back out of the port the packet came in on; every member gets one copy over each link. A switch without state
+ * for the group has no members below it and only sends the packet towards the root.
  */
 void
-PortlandSwitchNetDevice::PMACTable::Add(const Mac48Address& pmac, const Mac48Address& amac, const Ipv4Address ip_address, const uint32_t port)
+PortlandSwitchNetDevice::ReceiveMulticast (SwitchPacketMetadata& metadata, Ptr<const Packet> packet, uint32_t in_port, bool from_upper)
 {
-  PMACEntry entry;
-  entry.pmac = pmac;
-  entry.amac = amac;
-  entry.ip_address = ip_address;
-  entry.port = port;
-  mapping.insert(std::make_pair(pmac, entry));
+  if (m_device_type == EDGE && !from_upper)
+  {
+    metadata.src_pmac = GetSourcePMAC (metadata, in_port, from_upper);
+    if (metadata.src_pmac == Mac48Address("ff:ff:ff:ff:ff:ff"))
+    {
+      PLD_TRACE_EVENT (pld::EventTrace::DROP, this, metadata.dst_ip, 15);
+      return; // drop packet due to error in finding/allocating PMAC
+    }
+    if (metadata.ip_protocol == pld::IgmpHeader::PROT_NUMBER)
+    {
+      SnoopIgmp (metadata, packet, in_port);
+      return;
+    }
+  }
+  else
+  {
+    metadata.src_pmac = metadata.src_amac;
+  }
+  metadata.src_amac = Mac48Address();
+
+  uint64_t ports = 0;
+  bool up = (m_device_type != CORE);
+  Groups_t::const_iterator g = m_groups.find (metadata.dst_ip);
+  if (m_multicastFlood)
+  {
+    ports = ~(uint64_t) 0;
+  }
+  else if (g != m_groups.end ())
+  {
+    ports = g->second.ports;
+    up = up && g->second.up;
+  }
+  if (from_upper)
+  {
+    up = false;
+  }
+  else if (in_port < 64)
+  {
+    ports &= ~((uint64_t) 1 << in_port);
+  }
+
+  for (uint32_t i = 0; i < m_lower_ports.size () && i < 64; i++)
+  {
+    if (ports & ((uint64_t) 1 << i))
+    {
+      // every port needs its own packet as the port device adds its headers to it
+      metadata.packet = CopyPacket (packet);
+      OutputPacket (metadata, i, false);
+      m_nMulticastFrames++;
+    }
+  }
+
+  if (up && !m_upper_ports.empty ())
+  {
+    metadata.packet = CopyPacket (packet);
+    OutputPacket (metadata, GetGroupUplink (metadata.dst_ip), true);
+    m_nMulticastFrames++;
+  }
 }
 
 
 /*
- * Removes PMAC Entry from the table based on the given AMAC
+ * Function to snoop an IGMP message from a host: a Membership Report adds the host's port to the group, a Leave
+ * Group removes it once no other host on the port is a member.
  */
 void
-PortlandSwitchNetDevice::PMACTable::Remove(const Mac48Address& amac)
+PortlandSwitchNetDevice::SnoopIgmp (const SwitchPacketMetadata& metadata, Ptr<const Packet> packet, uint32_t in_port)
 {
-  std::map<Mac48Address, PMACEntry>::iterator it = mapping.begin();
-  bool found = false;
-  while(it != mapping.end())
+  Ptr<Packet> copy = packet->Copy ();
+  Ipv4Header ip_hd;
+  pld::IgmpHeader igmp;
+  copy->RemoveHeader (ip_hd);
+  if (copy->GetSize () < igmp.GetSerializedSize ())
+  {
+    return;
+  }
+  copy->RemoveHeader (igmp);
+  Ipv4Address group = igmp.GetGroup ();
+  if (!group.IsMulticast () || in_port >= 64)
+  {
+    return;
+  }
+
+  std::pair<uint32_t, Ipv4Address> member (in_port, metadata.src_ip);
+  Groups_t::iterator g = m_groups.find (group);
+  bool changed = false;
+  if (igmp.GetType () == pld::IgmpHeader::MEMBERSHIP_REPORT)
   {
-    if ((it->second).amac == amac)
+    if (g == m_groups.end ())
     {
-      found = true;
-      break;
+      GroupState state;
+      state.ports = 0;
+      state.up = true;          // until the Fabric Manager knows whether there are other members
+      state.uplink = NO_PORT;   // picked by HashGroup until the Fabric Manager chooses
+      g = m_groups.insert (std::make_pair (group, state)).first;
+      changed = true;
+    }
+    g->second.members.insert (member);
+    g->second.ports |= (uint64_t) 1 << in_port;
+  }
+  else if (igmp.GetType () == pld::IgmpHeader::LEAVE_GROUP && g != m_groups.end () && g->second.members.erase (member) > 0)
+  {
+    std::set<std::pair<uint32_t, Ipv4Address> >::const_iterator next =
+      g->second.members.lower_bound (std::make_pair (in_port, Ipv4Address ((uint32_t) 0)));
+    if (next == g->second.members.end () || next->first != in_port)
+    {
+      g->second.ports &= ~((uint64_t) 1 << in_port);
+    }
+    if (g->second.members.empty ())
+    {
+      m_groups.erase (g);
+      changed = true;
     }
   }
 
-  if (found == true)
+  if (changed)
   {
-    mapping.erase(it);
+    pld::GroupMembership* msg;
+    pld::BufferData buffer = pld::CreateMessage (msg);
+    msg->group = group;
+    msg->join = (igmp.GetType () == pld::IgmpHeader::MEMBERSHIP_REPORT);
+    SendBufferToFabricManager (buffer);
   }
 }
 
 
-/*
- * Finds the port of host based on given PMAC
- */
-int
-PortlandSwitchNetDevice::PMACTable::FindPort(const Mac48Address& pmac) const
+void
+PortlandSwitchNetDevice::SetGroupRoute (Ipv4Address group, uint64_t ports, bool up, uint16_t uplink)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.find(pmac);
-  if (it != mapping.end()) {
-    return (it->second).port;
+  Groups_t::iterator g = m_groups.find (group);
+  if (m_device_type == EDGE)
+  {
+    // the member ports of an EDGE switch come from snooping; the Fabric Manager only tells whether there are
+    // members behind other EDGE switches, and where the tree goes up
+    if (g != m_groups.end ())
+    {
+      g->second.up = up;
+      g->second.uplink = uplink;
+    }
+  }
+  else if (ports == 0 && !up)
+  {
+    if (g != m_groups.end ())
+    {
+      m_groups.erase (g);
+    }
+  }
+  else
+  {
+    GroupState& state = m_groups[group];
+    state.ports = ports;
+    state.up = up;
+    state.uplink = uplink;
   }
+}
 
-  return -1;
+
+uint32_t
+PortlandSwitchNetDevice::GetNGroups (void) const
+{
+  return m_groups.size ();
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNMulticastFrames (void) const
+{
+  return m_nMulticastFrames;
 }
 
 
 /*
- * Finds the port of host based on given PMAC
+ * Starts the Location Discovery Protocol; the first LDMs of the switches are spread over an LdmInterval.
  */
-int
-PortlandSwitchNetDevice::PMACTable::FindPort(const Ipv4Address& ip_address) const
+void
+PortlandSwitchNetDevice::StartLocationDiscovery (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_device_type = UNKNOWN_LEVEL;
+  m_pod = 0;
+  m_position = 0;
+  m_located = false;
+  m_locationRequested = false;
+  m_ldpStart = Simulator::Now ();
+
+  // until the level is known, every port is a lower port
+  m_lower_ports.insert (m_lower_ports.end (), m_upper_ports.begin (), m_upper_ports.end ());
+  m_upper_ports.clear ();
+  IndexPorts ();
+
+  UniformVariable jitter (0, m_ldmInterval.GetSeconds ());
+  m_ldmEvent.Cancel ();
+  m_ldmEvent = Simulator::Schedule (Seconds (jitter.GetValue ()), &PortlandSwitchNetDevice::LdmTick, this);
+}
+
+
+bool
+PortlandSwitchNetDevice::IsLocated (void) const
+{
+  return m_located;
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNLdmsSent (void) const
+{
+  return m_nLdmsSent;
+}
+
+
+void
+PortlandSwitchNetDevice::LdmTick (void)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.begin();
-  while(it != mapping.end())
+  SendLdms ();
+  // an EDGE switch only finds out what it is once LdmTimeout has passed
+  UpdateLocation ();
+  if (m_located)
   {
-    if ((it->second).ip_address == ip_address)
-    {
-      return (it->second).port;
-    }
-    it++;
+    CheckLinks ();
   }
+  m_ldmEvent = Simulator::Schedule (m_ldmInterval, &PortlandSwitchNetDevice::LdmTick, this);
+}
 
-  return -1;
+
+void
+PortlandSwitchNetDevice::SendLdms (void)
+{
+  pld::LdmHeader ldm;
+  ldm.SetSwitchId (m_address);
+  ldm.SetLevel (m_device_type);
+  if (m_located)
+  {
+    ldm.SetLocation (m_pod, m_position);
+  }
+
+  for (uint32_t i = 0; i < m_lower_ports.size () + m_upper_ports.size (); i++)
+  {
+    bool is_upper = (i >= m_lower_ports.size ());
+    pld::Port& p = (is_upper ? m_upper_ports[i - m_lower_ports.size ()] : m_lower_ports[i]);
+    ldm.SetUplink (is_upper ? i - m_lower_ports.size () : pld::LdmHeader::NO_UPLINK);
+    Ptr<Packet> packet = Create<Packet> ();
+    packet->AddHeader (ldm);
+    SendOnPort (p, packet, m_address, Mac48Address::GetBroadcast (), pld::LdmHeader::PROT_NUMBER);
+    m_nLdmsSent++;
+  }
 }
 
-/*
- * Finds an AMAC based on the given PMAC
- */
-Mac48Address
-PortlandSwitchNetDevice::PMACTable::FindAMAC(const Mac48Address& pmac) const
+
+void
+PortlandSwitchNetDevice::ReceiveLdm (uint32_t in_port, bool from_upper, Ptr<const Packet> packet)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.find(pmac);
-  if (it != mapping.end()) {
-    return (it->second).amac;
+  pld::Port& port = (from_upper ? m_upper_ports[in_port] : m_lower_ports[in_port]);
+  packet->PeekHeader (port.ldm);
+  port.ldm_rx++;
+  port.ldm_time = Simulator::Now ();
+  if (!m_located)
+  {
+    UpdateLocation ();
+  }
+  else if (!port.is_up)
+  {
+    SetPortUp (in_port, from_upper, true);
   }
+}
 
-    return Mac48Address("ff:ff:ff:ff:ff:ff");
+
+void
+PortlandSwitchNetDevice::StartLinkMonitoring (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  UniformVariable jitter (0, m_ldmInterval.GetSeconds ());
+  m_ldmEvent.Cancel ();
+  m_ldmEvent = Simulator::Schedule (Seconds (jitter.GetValue ()), &PortlandSwitchNetDevice::LdmTick, this);
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetNUpperPorts (void) const
+{
+  return m_upper_ports.size ();
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNLinkFailures (void) const
+{
+  return m_nLinkFailures;
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetNExcludedDestinations (void) const
+{
+  return m_excludedUplinks.size ();
 }
 
 
 /*
- * Finds an AMAC based on the given IP Address.
+ * Ports never heard from, such as host ports, are not monitored.
  */
-Mac48Address
-PortlandSwitchNetDevice::PMACTable::FindAMAC(const Ipv4Address& ip_address) const
+void
+PortlandSwitchNetDevice::CheckLinks (void)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.begin();
-  while(it != mapping.end())
+  Time now = Simulator::Now ();
+  for (uint32_t i = 0; i < m_lower_ports.size () + m_upper_ports.size (); i++)
   {
-    if ((it->second).ip_address == ip_address)
+    bool is_upper = (i >= m_lower_ports.size ());
+    uint32_t n = (is_upper ? i - m_lower_ports.size () : i);
+    const pld::Port& p = (is_upper ? m_upper_ports[n] : m_lower_ports[n]);
+    if (p.is_up && p.ldm_rx > 0 && now - p.ldm_time > m_ldmTimeout)
     {
-      return (it->second).amac;
+      m_nLinkFailures++;
+      SetPortUp (n, is_upper, false);
     }
-    it++;
   }
-
-  return Mac48Address("ff:ff:ff:ff:ff:ff");
 }
 
 
-/*
- * Finds a PMAC based on the given AMAC.
- */
-Mac48Address
-PortlandSwitchNetDevice::PMACTable::FindPMAC(const Mac48Address& amac) const
+void
+PortlandSwitchNetDevice::SetPortUp (uint32_t port, bool is_upper, bool up)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.begin();
-  while(it != mapping.end())
+  NS_LOG_INFO ("Switch " << m_address << (is_upper ? " upper" : " lower") << " port " << port
+               << (up ? " up" : " down"));
+  (is_upper ? m_upper_ports[port] : m_lower_ports[port]).is_up = up;
+  if (is_upper && port < 64)
   {
-    if ((it->second).amac == amac)
+    if (up)
     {
-      return it->first;
+      m_deadUplinks &= ~((uint64_t) 1 << port);
     }
-    it++;
+    else
+    {
+      m_deadUplinks |= (uint64_t) 1 << port;
+    }
+  }
+  m_linkChangeCallbacks ();
+
+  // the lower port i of an AGGREGATION switch leads to the EDGE switch in position i, which reaches it on its
+  // upper port given by the AGGREGATION switch's position; the lower port i of a CORE switch leads to pod i
+  pld::FaultReport* msg;
+  pld::BufferData buffer = pld::CreateMessage (msg);
+  msg->up = up;
+  if (is_upper)
+  {
+    msg->level = m_device_type;
+    msg->pod = m_pod;
+    msg->position = m_position;
+    msg->uplink = port;
+  }
+  else if (m_device_type == AGGREGATION)
+  {
+    msg->level = EDGE;
+    msg->pod = m_pod;
+    msg->position = port;
+    msg->uplink = m_position;
   }
+  else if (m_device_type == CORE)
+  {
+    msg->level = AGGREGATION;
+    msg->pod = port;
+    msg->position = m_pod;
+    msg->uplink = m_position;
+  }
+  else
+  {
+    pld::FreeMessage (buffer);
+    return;
+  }
+  SendBufferToFabricManager (buffer);
+}
+
+
+static bool
+CompareNeighborId (const pld::Port& a, const pld::Port& b)
+{
+  return a.ldm.GetSwitchId () < b.ldm.GetSwitchId ();
+}
+
+
+static bool
+CompareNeighborPosition (const pld::Port& a, const pld::Port& b)
+{
+  return a.ldm.GetPosition () < b.ldm.GetPosition ();
+}
 
-  return Mac48Address("ff:ff:ff:ff:ff:ff");
+
+static bool
+CompareNeighborPod (const pld::Port& a, const pld::Port& b)
+{
+  return a.ldm.GetPod () < b.ldm.GetPod ();
 }
 
 
 /*
- * Finds a PMAC based on the given IP Address.
+ * Function to move the Location Discovery Protocol on. Levels are inferred bottom-up: EDGE switches by the
+ * silence of their host ports, then AGGREGATION switches from the EDGE switches below them, then CORE switches.
+ * A change of level is announced with LDMs right away rather than at the next LdmInterval.
  */
-Mac48Address
-PortlandSwitchNetDevice::PMACTable::FindPMAC(const Ipv4Address& ip_address) const
+void
+PortlandSwitchNetDevice::UpdateLocation (void)
 {
-  std::map<Mac48Address, PMACEntry>::const_iterator it = mapping.begin();
-  while(it != mapping.end())
+  if (m_located)
+  {
+    return;
+  }
+
+  if (m_device_type == UNKNOWN_LEVEL)
+  {
+    uint32_t n_ports = m_lower_ports.size ();
+    uint32_t heard = 0;
+    uint32_t from_edges = 0;
+    uint32_t from_aggregations = 0;
+    for (uint32_t i = 0; i < n_ports; i++)
+    {
+      if (m_lower_ports[i].ldm_rx > 0)
+      {
+        heard++;
+        from_edges += (m_lower_ports[i].ldm.GetLevel () == EDGE);
+        from_aggregations += (m_lower_ports[i].ldm.GetLevel () == AGGREGATION);
+      }
+    }
+
+    if (from_edges > 0)
+    {
+      m_device_type = AGGREGATION;
+    }
+    else if (n_ports > 0 && from_aggregations == n_ports)
+    {
+      m_device_type = CORE;
+    }
+    else if (heard > 0 && heard < n_ports && Simulator::Now () - m_ldpStart >= m_ldmTimeout)
+    {
+      // silent ports lead to hosts; the others to the aggregation switches of the pod
+      m_device_type = EDGE;
+      Ports_t ports;
+      ports.swap (m_lower_ports);
+      for (uint32_t i = 0; i < ports.size (); i++)
+      {
+        (ports[i].ldm_rx > 0 ? m_upper_ports : m_lower_ports).push_back (ports[i]);
+      }
+      std::stable_sort (m_upper_ports.begin (), m_upper_ports.end (), CompareNeighborId);
+      IndexPorts ();
+    }
+    else
+    {
+      return;
+    }
+    NS_LOG_INFO ("Switch " << m_address << " is at level " << m_device_type);
+    SendLdms ();
+  }
+
+  if (m_device_type == EDGE)
   {
-    if ((it->second).ip_address == ip_address)
+    if (!m_locationRequested)
     {
-      return it->first;
+      // the pod is named after its lowest aggregation switch, which is upper port 0
+      m_locationRequested = true;
+      pld::LocationRequest* msg;
+      pld::BufferData buffer = pld::CreateMessage (msg);
+      msg->switchId = m_address;
+      msg->podId = m_upper_ports[0].ldm.GetSwitchId ();
+      SendBufferToFabricManager(buffer);
     }
-    it++;
   }
+  else if (m_device_type == AGGREGATION)
+  {
+    // every neighbour must know its level, so that EDGE switches can be told from CORE switches, and every EDGE
+    // switch below must be located; they put this switch at the same index of their sorted upper ports, which
+    // is its position
+    uint16_t pod = 0;
+    uint16_t position = 0;
+    for (uint32_t i = 0; i < m_lower_ports.size (); i++)
+    {
+      const pld::LdmHeader& ldm = m_lower_ports[i].ldm;
+      if (m_lower_ports[i].ldm_rx == 0 || ldm.GetLevel () == UNKNOWN_LEVEL)
+      {
+        return;
+      }
+      if (ldm.GetLevel () == EDGE)
+      {
+        if (!ldm.IsLocated () || ldm.GetUplink () == pld::LdmHeader::NO_UPLINK)
+        {
+          return;
+        }
+        pod = ldm.GetPod ();
+        position = ldm.GetUplink ();
+      }
+    }
 
-  return Mac48Address("ff:ff:ff:ff:ff:ff");
+    Ports_t ports;
+    ports.swap (m_lower_ports);
+    for (uint32_t i = 0; i < ports.size (); i++)
+    {
+      (ports[i].ldm.GetLevel () == EDGE ? m_lower_ports : m_upper_ports).push_back (ports[i]);
+    }
+    std::stable_sort (m_lower_ports.begin (), m_lower_ports.end (), CompareNeighborPosition);
+    std::stable_sort (m_upper_ports.begin (), m_upper_ports.end (), CompareNeighborId);
+    SetLocated (pod, position);
+  }
+  else if (m_device_type == CORE)
+  {
+    // the AGGREGATION switches below share their position, the group of this switch, and put this switch at
+    // the same index of their sorted upper ports
+    uint16_t group = 0;
+    uint16_t position = 0;
+    for (uint32_t i = 0; i < m_lower_ports.size (); i++)
+    {
+      const pld::LdmHeader& ldm = m_lower_ports[i].ldm;
+      if (!ldm.IsLocated () || ldm.GetUplink () == pld::LdmHeader::NO_UPLINK)
+      {
+        return;
+      }
+      group = ldm.GetPosition ();
+      position = ldm.GetUplink ();
+    }
+    std::stable_sort (m_lower_ports.begin (), m_lower_ports.end (), CompareNeighborPod);
+    SetLocated (group, position);
+  }
 }
 
 
-/*
- * Clears all entries in the PMAC table.
- */
 void
-PortlandSwitchNetDevice::PMACTable::clear(void)
+PortlandSwitchNetDevice::SetLocated (uint16_t pod, uint16_t position)
 {
-  mapping.clear();
+  m_pod = pod;
+  m_position = position;
+  m_located = true;
+  IndexPorts ();
+  NS_LOG_INFO ("Switch " << m_address << " located at level " << m_device_type << ", pod " << m_pod
+               << ", position " << m_position);
+
+  if (m_fabricManagerCluster != 0)
+  {
+    m_fabricManagerCluster->SwitchLocated (this);
+  }
+  else if (m_fabricManager != 0)
+  {
+    m_fabricManager->SwitchLocated (this);
+  }
+  SendLdms ();
+}
+
+
+static inline bool
+IsExcluded (uint64_t excluded, uint32_t port)
+{
+  return port < 64 && (excluded >> port & 1) != 0;
+}
+
+
+static uint32_t
+CountUplinks (uint64_t uplinks)
+{
+  uint32_t n = 0;
+  for (; uplinks != 0; uplinks &= uplinks - 1)
+    {
+      n++;
+    }
+  return n;
+}
+
+
+/*
+ * Maps the index of a port among the ports not in excluded to its index among all upper layer ports.
+ */
+static uint32_t
+GetLiveUplink (uint64_t excluded, uint32_t n)
+{
+  uint32_t port = 0;
+  for (; excluded != 0; excluded >>= 1, port++)
+    {
+      if ((excluded & 1) == 0)
+        {
+          if (n == 0)
+            {
+              return port;
+            }
+          n--;
+        }
+    }
+  return port + n;
+}
+
+
+/*
+ * Hashes the 5-tuple of a packet. The switch's type, pod and position are mixed in with the seed so that
+ * switches of different layers do not make correlated choices for the same flow (hash polarization).
+ */
+uint32_t
+PortlandSwitchNetDevice::HashFlow (const SwitchPacketMetadata& metadata) const
+{
+  uint64_t h = ((uint64_t) m_hashSeed << 32) | ((uint32_t) m_device_type << 30) | ((uint32_t) m_pod << 14) | (m_position & 0x3fff);
+  uint64_t words[3] = {
+    ((uint64_t) metadata.src_ip.Get () << 32) | metadata.dst_ip.Get (),
+    ((uint64_t) metadata.src_port << 16) | metadata.dst_port,
+    metadata.ip_protocol
+  };
+  for (int i = 0; i < 3; i++)
+    {
+      // MurmurHash3 64-bit finalizer over the running state
+      h ^= words[i];
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+    }
+  return (uint32_t) h;
+}
+
+
+/*
+ * Hashes a multicast group address with the same finalizer as HashFlow, but unsalted: every switch and the
+ * Fabric Manager must agree on the root of the group's tree.
+ */
+uint32_t
+PortlandSwitchNetDevice::HashGroup (Ipv4Address group)
+{
+  uint64_t h = group.Get ();
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t) h;
+}
+
+
+/*
+ * A switch keeps to the uplink the Fabric Manager chose for the tree of a group, which avoids the links reported
+ * down. Without state for the group, or while the chosen uplink is down here but not yet at the Fabric Manager,
+ * it picks one by the hash of the group among the uplinks that are up, as SelectUplink does for unicast.
+ */
+uint32_t
+PortlandSwitchNetDevice::GetGroupUplink (Ipv4Address group) const
+{
+  uint32_t n_ports = m_upper_ports.size ();
+  Groups_t::const_iterator g = m_groups.find (group);
+  if (g != m_groups.end () && g->second.uplink < n_ports && !IsExcluded (m_deadUplinks, g->second.uplink))
+    {
+      return g->second.uplink;
+    }
+  uint64_t excluded = (CountUplinks (m_deadUplinks) < n_ports ? m_deadUplinks : 0);
+  uint32_t h = HashGroup (group);
+  if (m_device_type != EDGE)
+    {
+      h /= std::max<size_t> (m_lower_ports.size (), 1);
+    }
+  return GetLiveUplink (excluded, h % (n_ports - CountUplinks (excluded)));
+}
+
+
+/*
+ * Picks the upper layer port of a packet going upstream according to the configured uplink policy.
+ */
+uint32_t
+PortlandSwitchNetDevice::SelectUplink (const SwitchPacketMetadata& metadata, uint64_t excluded)
+{
+  uint32_t n_ports = m_upper_ports.size ();
+  uint32_t n_live = n_ports - CountUplinks (excluded);
+  switch (m_uplinkPolicy)
+    {
+    case UPLINK_RANDOM:
+      return GetLiveUplink (excluded, m_uplinkRng.GetInteger (0, n_live - 1));
+
+    case UPLINK_HASH:
+      return GetLiveUplink (excluded, HashFlow (metadata) % n_live);
+
+    case UPLINK_FLOWLET:
+    case UPLINK_ADAPTIVE:
+      if (m_flowlets.empty ())
+        {
+          return GetLiveUplink (excluded, HashFlow (metadata) % n_live);
+        }
+      else
+        {
+          uint32_t flow_hash = HashFlow (metadata);
+          FlowletEntry& entry = m_flowlets[flow_hash % m_flowlets.size ()];
+          Time now = Simulator::Now ();
+          // a new flow in the slot, or the flow has been idle long enough for its packets in flight to drain
+          if (!entry.valid || entry.flow_hash != flow_hash || now - entry.last_seen > m_flowletGap
+              || entry.port >= n_ports || IsExcluded (excluded, entry.port))
+            {
+              entry.flow_hash = flow_hash;
+              entry.port = (m_uplinkPolicy == UPLINK_ADAPTIVE ? GetLeastLoadedUplink (excluded)
+                            : GetLiveUplink (excluded, m_uplinkRng.GetInteger (0, n_live - 1)));
+              entry.valid = true;
+            }
+          else if (m_uplinkPolicy == UPLINK_ADAPTIVE && m_upper_ports[entry.port].queue != 0
+                   && m_upper_ports[entry.port].queue->GetNBytes () > m_rebalanceThreshold)
+            {
+              // the flowlet's port is backing up; move the flow if another port has a shorter queue
+              uint32_t candidate = GetLeastLoadedUplink (excluded);
+              if (m_upper_ports[candidate].queue != 0
+                  && m_upper_ports[candidate].queue->GetNBytes () < m_upper_ports[entry.port].queue->GetNBytes ())
+                {
+                  entry.port = candidate;
+                }
+            }
+          entry.last_seen = now;
+          return entry.port;
+        }
+    }
+  return 0;
+}
+
+
+/*
+ * Scans the upper layer ports starting at a random one, so that equally loaded ports are picked evenly.
+ */
+uint32_t
+PortlandSwitchNetDevice::GetLeastLoadedUplink (uint64_t excluded)
+{
+  uint32_t n_ports = m_upper_ports.size ();
+  uint32_t start = GetLiveUplink (excluded, m_uplinkRng.GetInteger (0, n_ports - CountUplinks (excluded) - 1));
+  uint32_t best = start;
+  uint32_t best_queued = (m_upper_ports[best].queue != 0 ? m_upper_ports[best].queue->GetNBytes () : 0);
+  double best_load = GetPortLoad (m_upper_ports[best]);
+  for (uint32_t n = 1; n < n_ports; n++)
+    {
+      uint32_t i = (start + n) % n_ports;
+      if (IsExcluded (excluded, i))
+        {
+          continue;
+        }
+      const pld::Port& p = m_upper_ports[i];
+      uint32_t queued = (p.queue != 0 ? p.queue->GetNBytes () : 0);
+      double load = GetPortLoad (p);
+      if (queued < best_queued || (queued == best_queued && load < best_load))
+        {
+          best = i;
+          best_queued = queued;
+          best_load = load;
+        }
+    }
+  return best;
+}
+
+
+double
+PortlandSwitchNetDevice::GetPortLoad (const pld::Port& p) const
+{
+  if (m_loadTimeConstant.IsZero ())
+    {
+      return 0;
+    }
+  double age = (Simulator::Now () - p.tx_load_time).GetSeconds () / m_loadTimeConstant.GetSeconds ();
+  return p.tx_load * std::exp (-age);
+}
+
+
+void
+PortlandSwitchNetDevice::SetFlowletTableSize (uint32_t size)
+{
+  FlowletEntry empty;
+  empty.flow_hash = 0;
+  empty.port = 0;
+  empty.last_seen = Seconds (0);
+  empty.valid = false;
+  m_flowlets.assign (size, empty);
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetFlowletTableSize (void) const
+{
+  return m_flowlets.size ();
+}
+
+
+/*
+ * Function that gets the output port index based on destination PMAC address
+ * Each device has k ports; first half are south-bound, next half are north-bound
+ * Device type and position are assumed to be known
+ */
+int
+PortlandSwitchNetDevice::GetOutputPort(const SwitchPacketMetadata& metadata)
+{   
+  // the destination PMAC as a 48-bit integer; its fields are extracted with shifts and masks
+  uint64_t dst_pmac = pld::PMAC::ToBits (metadata.dst_pmac);
+  uint32_t dst_pod = pld::PMAC::GetPod (dst_pmac);
+
+  // if this device is core, downstream to dst_pod
+  if (m_device_type == CORE)
+  {
+    return dst_pod;
+  }
+  
+  // if this device is aggregate: same pod -- downstream, otherwise -- upstream on random port to core
+  else if (m_device_type == AGGREGATION)
+  {
+    // same pod -- downstream
+    if (m_pod == dst_pod)
+    {
+      // return the dst_position -- this is the port connected to edge
+      return pld::PMAC::GetPosition (dst_pmac);
+    }
+    // different pod -- upstream
+    else
+    {
+      if (m_upper_ports.empty ())
+      {
+        return -1;
+      }
+      // port connected to core layer, chosen by the uplink policy
+      return SelectUplink (metadata, GetExcludedUplinks (dst_pmac));
+    }
+  }
+  
+  // if this device is edge: same pod and position -- downstream, otherwise -- upstream on random port to aggregate
+  else if (m_device_type == EDGE)
+  { 
+    // same pod and position
+    if (m_pod == dst_pod && m_position == pld::PMAC::GetPosition (dst_pmac))
+    { 
+      // return the dst port -- this is the port connected to the dst host 
+      return pld::PMAC::GetPort (dst_pmac);
+    }
+    // upstream
+    else
+    {
+      if (m_upper_ports.empty ())
+      {
+        return -1;
+      }
+      // port connected to aggregation layer, chosen by the uplink policy
+      return SelectUplink (metadata, GetExcludedUplinks (dst_pmac));
+    }
+  }
+
+  return -1;
+}
+
+
+/*
+ * An EDGE switch looks up the exclusions for the destination EDGE switch, an AGGREGATION switch those for the
+ * destination pod.
+ */
+uint64_t
+PortlandSwitchNetDevice::GetExcludedUplinks (uint64_t dst_pmac) const
+{
+  uint64_t excluded = m_deadUplinks;
+  if (!m_excludedUplinks.empty ())
+  {
+    uint32_t destination = pld::PMAC::GetPod (dst_pmac) << 16;
+    destination |= (m_device_type == EDGE ? pld::PMAC::GetPosition (dst_pmac) : pld::PortExclusion::ANY_POSITION);
+    ExcludedUplinks_t::const_iterator it = m_excludedUplinks.find (destination);
+    if (it != m_excludedUplinks.end ())
+    {
+      excluded |= it->second;
+    }
+  }
+
+  uint32_t n_ports = m_upper_ports.size ();
+  if (excluded != 0 && CountUplinks (excluded) >= n_ports)
+  {
+    // no path avoids every failure; at least keep off the ports that are down
+    excluded = (CountUplinks (m_deadUplinks) < n_ports ? m_deadUplinks : 0);
+  }
+  return excluded;
+}
+
+
+/*
+ * Checks the PMAC table for the PMAC of the source host (VM). A host keeps its PMAC as long as it stays on the
+ * same port; a new host, or one that moved to another port, is given a PMAC with a free vmid of its port.
+ */
+Mac48Address
+PortlandSwitchNetDevice::GetSourcePMAC (const SwitchPacketMetadata& metadata, uint32_t in_port, bool from_upper)
+{
+  // port checking
+  if ((from_upper && !(in_port < m_upper_ports.size())) || (!from_upper && !(in_port < m_lower_ports.size())))
+  {
+    NS_LOG_INFO("Illegal in-port" << in_port);
+    return Mac48Address("ff:ff:ff:ff:ff:ff");
+  }
+  
+  Mac48Address src_amac = metadata.src_amac;
+  Ipv4Address src_ip = metadata.src_ip;
+  
+  // check for src_PMAC existence
+  Mac48Address src_pmac = m_table.FindPMAC(src_amac);
+  if (src_pmac != Mac48Address::GetBroadcast() && m_table.FindPort(src_pmac) == (int) in_port)
+  {
+    if (m_table.FindPMAC(src_ip) != src_pmac)
+    {
+      // the host changed its IP Address; it keeps its PMAC
+      Mac48Address stale = m_table.FindPMAC(src_ip);
+      if (stale != Mac48Address::GetBroadcast())
+      {
+        ReleasePMAC(stale);
+      }
+      m_table.Remove(src_amac);
+      m_table.Add(src_pmac, src_amac, src_ip, in_port);
+      UpdateFabricManager(src_ip, src_pmac);
+    }
+    return src_pmac;
+  }
+
+  // else create src_ip - src_PMAC entry; PMACs still bound to this host or its IP Address are stale
+  if (src_pmac != Mac48Address::GetBroadcast())
+  {
+    ReleasePMAC(src_pmac);
+  }
+  Mac48Address stale = m_table.FindPMAC(src_ip);
+  if (stale != Mac48Address::GetBroadcast())
+  {
+    ReleasePMAC(stale);
+  }
+
+  uint32_t vmid = m_lower_ports[in_port].vmids.Allocate();
+  if (vmid == 0)
+  {
+    NS_LOG_INFO("No free vmid on port " << in_port);
+    return Mac48Address("ff:ff:ff:ff:ff:ff");
+  }
+
+  // assigning src PMAC address: pod.position.port.vmid
+  src_pmac = pld::PMAC::Encode(m_pod, m_position, in_port, vmid);
+  m_movedPMACs.erase(src_pmac);
+
+  // adding entry to the table
+  m_table.Add(src_pmac, src_amac, src_ip, in_port);
+
+  // register this entry with fabric manager
+  UpdateFabricManager(src_ip, src_pmac);
+  
+  return src_pmac;
+}
+
+
+void
+PortlandSwitchNetDevice::ReleasePMAC (const Mac48Address& pmac)
+{
+  uint32_t port = pld::PMAC::GetPort(pmac);
+  NS_ASSERT(port < m_lower_ports.size());
+  m_lower_ports[port].vmids.Release(pld::PMAC::GetVmid(pmac));
+  m_table.Remove(m_table.FindAMAC(pmac));
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetNHosts (void) const
+{
+  return m_table.GetNEntries();
+}
+
+
+bool
+PortlandSwitchNetDevice::RemoveHost (Mac48Address amac)
+{
+  Mac48Address pmac = m_table.FindPMAC(amac);
+  if (pmac == Mac48Address::GetBroadcast())
+  {
+    return false;
+  }
+  ReleasePMAC(pmac);
+  return true;
+}
+
+
+Mac48Address
+PortlandSwitchNetDevice::PreloadHost (Mac48Address amac, Ipv4Address ip, uint32_t port, uint32_t vmid)
+{
+  NS_ASSERT(m_device_type == EDGE && port < m_lower_ports.size());
+  RemoveHost(amac);
+  pld::VmidAllocator& vmids = m_lower_ports[port].vmids;
+  if (vmid == 0)
+  {
+    vmid = vmids.Allocate();
+  }
+  else if (!vmids.Claim(vmid))
+  {
+    vmid = 0;
+  }
+  if (vmid == 0)
+  {
+    return Mac48Address::GetBroadcast();
+  }
+
+  Mac48Address pmac = pld::PMAC::Encode(m_pod, m_position, port, vmid);
+  m_table.Add(pmac, amac, ip, port);
+  return pmac;
+}
+
+
+Mac48Address
+PortlandSwitchNetDevice::GetHostPMAC (Ipv4Address ip) const
+{
+  return m_table.FindPMAC(ip);
+}
+
+
+/*
+ * Looks up the Destination PMAC in the local PMAC table, for hosts on this switch, and in the PMAC cache.
+ */
+bool
+PortlandSwitchNetDevice::GetDestinationPMAC (Ipv4Address dst_ip, Mac48Address& dst_pmac)
+{
+  // check locally if dst is connected to same edge switch
+  // and has been assigned PMAC already
+  if (m_table.FindPort(dst_ip) != -1)
+  {
+    dst_pmac = m_table.FindPMAC(dst_ip);
+    PLD_TRACE_EVENT (pld::EventTrace::LOCAL_HIT, this, dst_ip, 0);
+    return true;
+  }
+  if (m_pmacCache.Lookup(dst_ip, Simulator::Now (), dst_pmac))
+  {
+    m_pmacCacheHits++;
+    PLD_TRACE_EVENT (pld::EventTrace::CACHE_HIT, this, dst_ip, 0);
+    return true;
+  }
+  PLD_TRACE_EVENT (pld::EventTrace::CACHE_MISS, this, dst_ip, 0);
+  return false;
+}
+
+
+void
+PortlandSwitchNetDevice::SetPMACCacheSize (uint32_t size)
+{
+  m_pmacCache.SetMaxEntries (size);
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetPMACCacheSize (void) const
+{
+  return m_pmacCache.GetMaxEntries ();
+}
+
+
+void
+PortlandSwitchNetDevice::SetPMACCacheTimeout (Time timeout)
+{
+  m_pmacCache.SetTimeout (timeout);
+}
+
+
+Time
+PortlandSwitchNetDevice::GetPMACCacheTimeout (void) const
+{
+  return m_pmacCache.GetTimeout ();
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNPMACCacheHits (void) const
+{
+  return m_pmacCacheHits;
+}
+
+
+uint64_t
+PortlandSwitchNetDevice::GetNPMACCacheMisses (void) const
+{
+  return m_pmacCacheMisses;
+}
+
+
+uint32_t
+PortlandSwitchNetDevice::GetNSwitchPorts (void) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return (m_lower_ports.size () + m_upper_ports.size());
+}
+
+
+const pld::Port&
+PortlandSwitchNetDevice::GetSwitchPort (uint32_t n) const
+{
+  NS_ASSERT_MSG (n < GetNSwitchPorts (), "Switch has no port " << n);
+  return (n < m_lower_ports.size () ? m_lower_ports[n] : m_upper_ports[n - m_lower_ports.size ()]);
+}
+
+
+int
+PortlandSwitchNetDevice::GetSwitchPortIndex (const pld::Port& p) const
+{
+  if (p.netdev == 0)
+    {
+      return -1;
+    }
+  uint32_t if_index = p.netdev->GetIfIndex ();
+  if (if_index >= m_portIndex.size () || m_portIndex[if_index] == NO_PORT)
+    {
+      return -1;
+    }
+  uint32_t n = m_portIndex[if_index] >> 1;
+  if ((m_portIndex[if_index] & 1) != 0)
+    {
+      n += m_lower_ports.size ();
+    }
+  return (GetSwitchPort (n).netdev == p.netdev ? (int) n : -1);
+}
+
+
+/*
+ * Function to map the interface index of every port device to its port, so that a received frame finds its
+ * port without scanning them. The bits of the uplinks that are down follow the upper ports as well.
+ */
+void
+PortlandSwitchNetDevice::IndexPorts (void)
+{
+  m_portIndex.clear ();
+  m_deadUplinks = 0;
+  for (uint32_t i = 0; i < m_upper_ports.size () && i < 64; i++)
+    {
+      if (!m_upper_ports[i].is_up)
+        {
+          m_deadUplinks |= (uint64_t) 1 << i;
+        }
+    }
+  for (uint32_t i = 0; i < m_lower_ports.size () + m_upper_ports.size (); i++)
+    {
+      bool is_upper = (i >= m_lower_ports.size ());
+      uint32_t index = (is_upper ? i - m_lower_ports.size () : i);
+      uint32_t if_index = (is_upper ? m_upper_ports[index] : m_lower_ports[index]).netdev->GetIfIndex ();
+      if (if_index >= m_portIndex.size ())
+        {
+          m_portIndex.resize (if_index + 1, NO_PORT);
+        }
+      m_portIndex[if_index] = (index << 1) | (is_upper ? 1 : 0);
+    }
 }
 
 } // namespace ns3
@@ -38,12 +38,22 @@
 #include "ns3/string.h"
 #include "ns3/integer.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/random-variable.h"
+#include "ns3/queue.h"
+#include "ns3/traced-callback.h"
 
 #include <map>
 #include <set>
 
 #include "portland.h"
 #include "portland-fabric-manager.h"
+#include "portland-pmac.h"
+#include "portland-pmac-table.h"
+#include "portland-vmid-allocator.h"
+#include "portland-pmac-cache.h"
+#include "portland-ldm-header.h"
+#include "portland-igmp-header.h"
 
 namespace ns3 {
 
@@ -62,17 +72,33 @@ struct Port
             tx_packets (0),
             rx_bytes (0),
             tx_bytes (0),
-            tx_dropped (0)
+            tx_dropped (0),
+            queue (0),
+            tx_load (0),
+            tx_load_time (Seconds (0)),
+            vmids (PMAC::MAX_VMID),
+            ldm_rx (0),
+            ldm_time (Seconds (0)),
+            is_up (true)
   {
   }
 
   Ptr<NetDevice> netdev;
-  unsigned long long int rx_packets, tx_packets;
-  unsigned long long int rx_bytes, tx_bytes;
-  unsigned long long int tx_dropped;
+  unsigned long long int rx_packets, tx_packets;        ///< Frames received and sent, LDMs included
+  unsigned long long int rx_bytes, tx_bytes;            ///< Bytes of those frames, Ethernet header and trailer excluded
+  unsigned long long int tx_dropped;                    ///< Frames the port device refused, e.g. on a full queue
+  Ptr<Queue> queue;             ///< Transmit queue of netdev, if it exposes one as the "TxQueue" attribute
+  double tx_load;               ///< Exponentially weighted moving average of transmitted bytes
+  Time tx_load_time;            ///< Time tx_load was last updated
+  VmidAllocator vmids;          ///< Vmids of the hosts (VMs) given a PMAC on this port; EDGE lower ports only
+  LdmHeader ldm;                ///< Last Location Discovery Message heard on this port
+  uint32_t ldm_rx;              ///< Location Discovery Messages heard on this port; none on a host port
+  Time ldm_time;                ///< Time the last Location Discovery Message was heard on this port
+  bool is_up;                   ///< False once no LDM has been heard on the port for LdmTimeout
 };
 
 class FabricManager;
+class FabricManagerCluster;
 struct BufferData;
 
 }
@@ -91,6 +117,9 @@ typedef struct SwitchPacketMetadata
   Mac48Address dst_pmac;        ///< Destination MAC Address of the Packet when the Packet is received.
   Ipv4Address src_ip;           ///< Source IPv4 Address of the Packet when the Packet is received
   Ipv4Address dst_ip;           ///< Destination IPv4 Address of the Packet when the Packet is received.
+  uint8_t ip_protocol;          ///< IPv4 protocol of the Packet; 0 if it is not an IPv4 Packet
+  uint16_t src_port;            ///< TCP/UDP source port; 0 for other protocols
+  uint16_t dst_port;            ///< TCP/UDP destination port; 0 for other protocols
   bool is_arp_request;          ///< True if it is an ARP Request; False otherwise.
 } SwitchPacketMetadata;
 
@@ -139,6 +168,18 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /**
+   * \brief How an edge or aggregation switch picks the upper layer port for a packet
+   * that has to go upstream.
+   */
+  enum UplinkPolicy
+  {
+    UPLINK_RANDOM,      ///< Uniformly random port per packet
+    UPLINK_HASH,        ///< Port chosen by a hash of the flow's 5-tuple (ECMP)
+    UPLINK_FLOWLET,     ///< Random port per flowlet; a flow may move after an idle gap
+    UPLINK_ADAPTIVE     ///< Least loaded port per flowlet; a flowlet whose port backs up moves to a shorter queue
+  };
+
   /**
    * \name Descriptive Data
    * \brief OpenFlowSwitchNetDevice Description Data
@@ -172,6 +213,13 @@ public:
    */
   void SetFabricManager (Ptr<pld::FabricManager> c);
 
+  /**
+   * \brief Set up the Switch's connection to a sharded Fabric Manager; each message goes to the shard owning it.
+   *
+   * \param cluster Pointer to the cluster of Fabric Managers.
+   */
+  void SetFabricManagerCluster (Ptr<pld::FabricManagerCluster> cluster);
+
   /**
    * \brief Add a 'port' to a switch device
    *
@@ -217,15 +265,18 @@ public:
 
   /**
    * \param p The Port to get the index of.
-   * \return The index of the provided Port.
+   * \return The index of the provided Port, as given to GetSwitchPort, or -1 if it is not a port of this switch.
    */
-  int GetSwitchPortIndex (pld::Port p);
+  int GetSwitchPortIndex (const pld::Port& p) const;
 
   /**
+   * Ports are numbered lower layer ports first, then upper layer ports. The Location Discovery Protocol
+   * renumbers the ports once the switch is located.
+   *
    * \param n index of the Port.
-   * \return The Port.
+   * \return The Port, with its counters.
    */
-  pld::Port GetSwitchPort (uint32_t n) const;
+  const pld::Port& GetSwitchPort (uint32_t n) const;
 
   void SetDeviceType (const PortlandSwitchType device_type);
 
@@ -233,16 +284,170 @@ public:
   
   bool IsCore(void);
 
-  void SetPod (const uint8_t pod);
+  void SetPod (const uint16_t pod);
 
-  uint8_t GetPod (void) const;
+  uint16_t GetPod (void) const;
 
-  void SetPosition (const uint8_t position);
+  void SetPosition (const uint16_t position);
 
-  uint8_t GetPosition (void) const;
+  uint16_t GetPosition (void) const;
   
   void ReceiveBufferFromFabricManager(pld::BufferData);
 
+  /**
+   * \brief Starts the Location Discovery Protocol.
+   *
+   * The switch forgets its level, pod and position and sends a Location Discovery Message (LDM) on every
+   * port each LdmInterval. It infers its level from the LDMs it hears: a switch that hears nothing on some
+   * ports for LdmTimeout has hosts on them and is an EDGE switch; a switch that hears an EDGE switch is an
+   * AGGREGATION switch; a switch that hears only AGGREGATION switches is a CORE switch. EDGE switches are
+   * given their pod and position by the Fabric Manager; AGGREGATION and CORE switches take theirs from the
+   * LDMs of the switches below them. Once located, the switch orders its ports as the forwarding expects:
+   * the lower ports of an AGGREGATION switch by EDGE position, those of a CORE switch by pod, and upper
+   * ports by the identifier of the switch above. Frames other than LDMs are dropped until then.
+   *
+   * Call it once all the ports have been added, with any upper/lower split: LDP starts with every port as
+   * a lower port. It may also be called again on a located switch to rediscover its location.
+   */
+  void StartLocationDiscovery (void);
+
+  /**
+   * \return False while the Location Discovery Protocol has not yet found the switch's level, pod and position.
+   */
+  bool IsLocated (void) const;
+
+  /**
+   * \return Number of Location Discovery Messages sent.
+   */
+  uint64_t GetNLdmsSent (void) const;
+
+  /**
+   * \brief Starts monitoring the links of a switch that was given its location.
+   *
+   * The switch sends an LDM on every port each LdmInterval, as a switch running the Location Discovery
+   * Protocol keeps doing once located. A port that has been heard from and then stays silent for LdmTimeout
+   * is taken down: upstream packets are no longer sent on it and the Fabric Manager is told, which has the
+   * switches whose paths cross the link avoid it. The port comes back up with the next LDM heard on it.
+   */
+  void StartLinkMonitoring (void);
+
+  /**
+   * \return Number of upper layer ports.
+   */
+  uint32_t GetNUpperPorts (void) const;
+
+  /**
+   * \return Number of ports taken down because their LDMs stopped.
+   */
+  uint64_t GetNLinkFailures (void) const;
+
+  /**
+   * \return Number of destinations (EDGE switches, or pods on an AGGREGATION switch) the Fabric Manager
+   * currently has this switch avoid some upper layer ports for.
+   */
+  uint32_t GetNExcludedDestinations (void) const;
+
+  /**
+   * \return Number of packet copies made on the forwarding path.
+   */
+  uint64_t GetNPacketCopies (void) const;
+
+  /**
+   * \return Number of frames handed to a port device for transmission.
+   */
+  uint64_t GetNForwardedPackets (void) const;
+
+  /**
+   * \return Number of destination PMAC lookups answered by the PMAC cache.
+   */
+  uint64_t GetNPMACCacheHits (void) const;
+
+  /**
+   * \return Number of destination PMAC lookups that had to query the Fabric Manager.
+   */
+  uint64_t GetNPMACCacheMisses (void) const;
+
+  /**
+   * \return Number of packets from hosts held while the Fabric Manager resolved their destination.
+   */
+  uint64_t GetNHeldPackets (void) const;
+
+  /**
+   * \return Number of held packets dropped, because too many were held for the destination or the
+   * Fabric Manager did not know it.
+   */
+  uint64_t GetNHeldPacketDrops (void) const;
+
+  /**
+   * \return Number of broadcast ARP Request frames sent while flooding for the Fabric Manager.
+   */
+  uint64_t GetNFloodFrames (void) const;
+
+  /**
+   * \return True if an edge switch has a host port on which no host has been seen yet.
+   */
+  bool HasUnresolvedHosts (void) const;
+
+  /**
+   * \return Number of hosts (VMs) an edge switch has given a PMAC.
+   */
+  uint32_t GetNHosts (void) const;
+
+  /**
+   * Forgets a host (VM) that left an edge switch; its vmid is recycled.
+   *
+   * \param amac The actual MAC address of the host.
+   * \return True if the host was known.
+   */
+  bool RemoveHost (Mac48Address amac);
+
+  /**
+   * Gives a host on a lower port of an edge switch a PMAC before it sends anything, as if its first frame
+   * had been seen, but without registering it with the Fabric Manager; used to pre-warm a fabric.
+   *
+   * \param amac The actual MAC address of the host.
+   * \param ip The IP Address of the host.
+   * \param port Index of the lower port the host is on.
+   * \param vmid The vmid of the PMAC, e.g. from a snapshot of an earlier run, or 0 to allocate one.
+   * \return The PMAC, or the broadcast address if the vmid is in use or none is free.
+   */
+  Mac48Address PreloadHost (Mac48Address amac, Ipv4Address ip, uint32_t port, uint32_t vmid);
+
+  /**
+   * \return The PMAC an edge switch has given the host with an IP Address, or the broadcast address.
+   */
+  Mac48Address GetHostPMAC (Ipv4Address ip) const;
+
+  /**
+   * \return Number of packets for hosts that moved away that arrived at their old edge switch.
+   */
+  uint64_t GetNTrappedPackets (void) const;
+
+  /**
+   * \return Number of gratuitous ARP Replies sent to the senders of trapped packets.
+   */
+  uint64_t GetNGratuitousArps (void) const;
+
+  /**
+   * \return Number of multicast groups the switch has replication state for.
+   */
+  uint32_t GetNGroups (void) const;
+
+  /**
+   * \return Number of multicast frames handed to a port device for transmission.
+   */
+  uint64_t GetNMulticastFrames (void) const;
+
+  /**
+   * \brief Hash of a multicast group address.
+   *
+   * The Fabric Manager roots the tree of a group at the core switch (j, c) with j = hash % (k/2) and
+   * c = (hash / (k/2)) % (k/2), or at the next one whose links to the members are all up; switches without
+   * state for the group send its packets from below towards the first, on upper port j of an EDGE switch and
+   * upper port c of an AGGREGATION switch, or on the live upper port at that index among the live ones.
+   */
+  static uint32_t HashGroup (Ipv4Address group);
+
 
   // From NetDevice
   virtual void SetIfIndex (const uint32_t index);
@@ -272,29 +477,6 @@ public:
 
 protected:
 
-  class PMACTable
-  {
-    public:
-      void Add(const Mac48Address& pmac, const Mac48Address& amac, const Ipv4Address ip_address, const uint32_t port);
-      void Remove(const Mac48Address& amac);
-      int FindPort(const Mac48Address& pmac) const;
-      int FindPort(const Ipv4Address& ip_address) const;
-      Mac48Address FindAMAC(const Mac48Address& pmac) const;
-      Mac48Address FindAMAC(const Ipv4Address& ip_address) const;
-      Mac48Address FindPMAC(const Mac48Address& amac) const;
-      Mac48Address FindPMAC(const Ipv4Address& ip_address) const;
-      void clear();
-
-    private:
-      typedef struct PMACEntry {
-        Mac48Address pmac;
-        Mac48Address amac;
-        Ipv4Address ip_address;
-        uint8_t port;
-      } PMACEntry;
-      std::map<Mac48Address, PMACEntry> mapping; // PMAC -> <AMAC, IP, Port> mapping
-  };
-
   virtual void DoDispose (void);
 
   /**
@@ -318,33 +500,198 @@ protected:
    * \param protocol The protocol defining the packet.
    * \return The OpenFlow Buffer created from the packet.
    */
-  SwitchPacketMetadata MetadataFromPacket (Ptr<const Packet> packet, Address src, Address dst, uint16_t protocol);
+  SwitchPacketMetadata MetadataFromPacket (Ptr<const Packet> packet, const Address& src, const Address& dst, uint16_t protocol);
 
 private:
 
-  Mac48Address GetSourcePMAC (SwitchPacketMetadata metadata, uint8_t in_port, bool from_upper); 
+  Mac48Address GetSourcePMAC (const SwitchPacketMetadata& metadata, uint32_t in_port, bool from_upper);
+
+  /**
+   * Removes the PMAC table entry of a PMAC handed out by this switch and recycles its vmid.
+   */
+  void ReleasePMAC (const Mac48Address& pmac);
   
-  Mac48Address GetDestinationPMAC (Ipv4Address dst_ip, Ipv4Address src_ip, Mac48Address src_pmac);
+  /**
+   * Looks up the destination PMAC in the PMAC table and the PMAC cache.
+   *
+   * \return True if dst_pmac was found; false if the Fabric Manager has to be queried.
+   */
+  bool GetDestinationPMAC (Ipv4Address dst_ip, Mac48Address& dst_pmac);
+
+  /**
+   * Holds a packet from a host until the Fabric Manager answers the query for its destination PMAC;
+   * the first packet held for a destination sends the query, later ones wait for the same answer.
+   */
+  void HoldPacket (const SwitchPacketMetadata& metadata, Ptr<const Packet> packet);
+
+  /**
+   * Forwards, or drops if dst_pmac is the broadcast address, the packets held for dst_ip.
+   */
+  void ReleaseHeldPackets (Ipv4Address dst_ip, Mac48Address dst_pmac);
 
-  pld::BufferData SendBufferToFabricManager(pld::BufferData);
+  /**
+   * Sends a packet from a host, whose source and destination PMACs are known, towards the destination.
+   */
+  void ForwardFromHost (SwitchPacketMetadata& metadata, Ptr<const Packet> packet);
+
+  void SendBufferToFabricManager(pld::BufferData);
 
   void UpdateFabricManager(Ipv4Address, Mac48Address);
 
-  Mac48Address QueryFabricManager(Ipv4Address, Ipv4Address, Mac48Address);
+  void QueryFabricManager(Ipv4Address, Ipv4Address, Mac48Address);
+
+  /**
+   * \return Hash of the packet's 5-tuple, salted with HashSeed and the switch's location.
+   */
+  uint32_t HashFlow (const SwitchPacketMetadata& metadata) const;
+
+  /**
+   * \return Index of the upper layer port to send the packet on, chosen by m_uplinkPolicy among the ports
+   * not in excluded.
+   */
+  uint32_t SelectUplink (const SwitchPacketMetadata& metadata, uint64_t excluded);
+
+  /**
+   * \return Index of the upper layer port not in excluded with the fewest bytes queued for transmission; ties
+   * are broken by the recent transmit load of the ports and then at random.
+   */
+  uint32_t GetLeastLoadedUplink (uint64_t excluded);
+
+  /**
+   * \return Index of the upper layer port to send a multicast packet of a group up on: the one the Fabric
+   * Manager chose for the group's tree while it is up, or else one picked by HashGroup among the ports that are up.
+   */
+  uint32_t GetGroupUplink (Ipv4Address group) const;
+
+  /**
+   * \return Upper layer ports not to send a packet to the destination PMAC on: the ports that are down and
+   * those the Fabric Manager excluded for the destination. If that leaves no port, only the ports that are down.
+   */
+  uint64_t GetExcludedUplinks (uint64_t dst_pmac) const;
+
+  /**
+   * \return The transmit load of a port decayed to the current time.
+   */
+  double GetPortLoad (const pld::Port& p) const;
+
+  void SetFlowletTableSize (uint32_t size);
+  uint32_t GetFlowletTableSize (void) const;
+
+  void SetPMACCacheSize (uint32_t size);
+  uint32_t GetPMACCacheSize (void) const;
+  void SetPMACCacheTimeout (Time timeout);
+  Time GetPMACCacheTimeout (void) const;
 
   void ARPFloodFromFabricManager(Ipv4Address, Ipv4Address, Mac48Address);
 
   /**
-   * Sends a copy of the Packet over the provided output port
+   * Sends an LDM on every port and schedules the next round.
+   */
+  void LdmTick (void);
+
+  /**
+   * Sends an LDM describing this switch on every port; upper port i carries uplink index i.
+   */
+  void SendLdms (void);
+
+  /**
+   * Records the LDM heard on a port, brings the port back up if it was down, and moves the Location
+   * Discovery Protocol on.
+   */
+  void ReceiveLdm (uint32_t in_port, bool from_upper, Ptr<const Packet> packet);
+
+  /**
+   * Takes down the ports of a located switch that have been silent for LdmTimeout.
+   */
+  void CheckLinks (void);
+
+  /**
+   * Marks a port up or down and tells the Fabric Manager about the link, named by the lower switch of the link
+   * and its upper port: the links of a fat tree are known to both ends by the same name.
+   */
+  void SetPortUp (uint32_t port, bool is_upper, bool up);
+
+  /**
+   * Infers the level of the switch from the LDMs heard so far and, once the switches below are located,
+   * its pod and position.
+   */
+  void UpdateLocation (void);
+
+  /**
+   * Completes the Location Discovery Protocol: the switch takes its pod and position, tells the Fabric
+   * Manager and its neighbours.
+   */
+  void SetLocated (uint16_t pod, uint16_t position);
+
+  /**
+   * Handles the Fabric Manager's notice that old_pmac no longer locates host_ip: updates or drops the cached
+   * PMAC, and, on the edge switch that handed out old_pmac, forgets the host and starts trapping packets
+   * still sent to old_pmac.
+   */
+  void InvalidatePMAC (Ipv4Address host_ip, Mac48Address old_pmac, Mac48Address new_pmac);
+
+  /**
+   * Handles a packet that arrived for the old PMAC of a host that moved away: the sender is sent a
+   * gratuitous ARP Reply with the new PMAC and, if ForwardMovedPackets is set, the packet is forwarded
+   * to the new location; otherwise it is dropped.
+   */
+  void TrapMovedPacket (SwitchPacketMetadata& metadata, Ptr<const Packet> packet);
+
+  /**
+   * Replicates a multicast packet down the lower ports leading to members of its group and, for a packet
+   * from below, up the group's tree; never back out of the port it came in on. IGMP messages from hosts are
+   * snooped by their EDGE switch and not forwarded.
+   */
+  void ReceiveMulticast (SwitchPacketMetadata& metadata, Ptr<const Packet> packet, uint32_t in_port, bool from_upper);
+
+  /**
+   * Learns the members of a group on the host ports from an IGMP message, and tells the Fabric Manager when
+   * the switch gets its first member of the group or loses its last one.
+   */
+  void SnoopIgmp (const SwitchPacketMetadata& metadata, Ptr<const Packet> packet, uint32_t in_port);
+
+  /**
+   * Installs the replication state the Fabric Manager computed for a group; a route with no ports and no
+   * uplink removes it.
+   */
+  void SetGroupRoute (Ipv4Address group, uint64_t ports, bool up, uint16_t uplink);
+
+  /**
+   * Sends a packet whose destination PMAC is set to a lower port, if the destination is on this switch, or
+   * upstream otherwise.
+   */
+  void SendToPMAC (SwitchPacketMetadata& metadata);
+
+  /**
+   * Sends metadata.packet over the provided output port; the packet is handed to the port as is.
    *
-   * \param packet_uid Packet UID; used to fetch the packet and its metadata.
+   * \param metadata The packet and its (rewritten) addresses.
+   * \param out_port Index of the output port.
+   * \param is_upper True if out_port is an upper layer port.
+   */
+  void OutputPacket (const SwitchPacketMetadata& metadata, uint32_t out_port, bool is_upper);
+
+  /**
+   * Hands a frame to a port device and counts it on the port.
+   *
+   * \return True if the device took the frame.
+   */
+  bool SendOnPort (pld::Port& p, Ptr<Packet> packet, Mac48Address src, Mac48Address dst, uint16_t protocol);
+
+  /**
+   * Rebuilds m_portIndex after ports were added or reordered.
+   */
+  void IndexPorts (void);
+
+  /**
+   * \return A copy of the packet to be forwarded, counted in m_packetCopies.
    */
-  void OutputPacket (SwitchPacketMetadata metadata, uint8_t out_port, bool is_upper);
+  Ptr<Packet> CopyPacket (Ptr<const Packet> packet);
 
   /**
-   * Gets the output port index based on the destination PMAC address
+   * Gets the output port index based on the destination PMAC address; upstream ports are picked by SelectUplink
    */
-  int GetOutputPort(Mac48Address dst_pmac);
+  int GetOutputPort(const SwitchPacketMetadata& metadata);
   
   /// Callbacks
   NetDevice::ReceiveCallback m_rxCallback;
@@ -359,8 +706,24 @@ private:
   /// These are to be set during initialization of the device
   /// Used in PortlandSwitchNetDevice::GetOutputPort
   PortlandSwitchType m_device_type;                  ///< Device type: 3 - Core, 2 - Aggregate, 1 - Edge
-  uint8_t m_pod;                          ///< Pod in which the device is located -- valid for only device_type 1 or 2
-  uint8_t m_position;                     ///< Position of the device in the pod -- valid for only device_type 1 or 2
+  uint16_t m_pod;                         ///< Pod in which the device is located -- valid for only device_type 1 or 2
+  uint16_t m_position;                    ///< Position of the device in the pod -- valid for only device_type 1 or 2
+
+  /// Location Discovery Protocol
+  bool m_located;                       ///< False until device_type, pod and position are known
+  bool m_locationRequested;             ///< An EDGE switch asked the Fabric Manager for its pod and position
+  Time m_ldmInterval;                   ///< Time between two LDMs on a port
+  Time m_ldmTimeout;                    ///< Time without LDMs after which a port leads to hosts
+  Time m_ldpStart;                      ///< Time the protocol was started
+  EventId m_ldmEvent;
+  uint64_t m_nLdmsSent;
+
+  /// Link failures
+  uint64_t m_deadUplinks;               ///< Bit i set: upper port i is down
+  typedef std::map<uint32_t, uint64_t> ExcludedUplinks_t;
+  ExcludedUplinks_t m_excludedUplinks;  ///< Destination pod << 16 | position -> upper ports the Fabric Manager excluded
+  uint64_t m_nLinkFailures;
+  TracedCallback<> m_linkChangeCallbacks;
 
   typedef std::map<uint32_t,SwitchPacketMetadata> PacketData_t;
   PacketData_t m_packetData;            ///< Packet data
@@ -368,13 +731,77 @@ private:
   typedef std::vector<pld::Port> Ports_t;
   Ports_t m_upper_ports;                      ///< Switch's ports for upper layer connections
   Ports_t m_lower_ports;                      ///< Switch's ports for lower layer connections
+  std::vector<uint32_t> m_portIndex;          ///< Interface index of a port device -> index << 1 | is_upper
 
   Ptr<pld::FabricManager> m_fabricManager;    ///< Connection to fabric manager.
+  Ptr<pld::FabricManagerCluster> m_fabricManagerCluster;      ///< Connection to a sharded fabric manager, if any.
 
   uint64_t m_id;                        ///< Unique identifier for this switch, needed for OpenFlow
 
-  // TODO: replace this with PMAC table
-  PMACTable m_table;             ///< PMAC Table; AMAC-IP <-> inport.
+  pld::PMACTable m_table;        ///< PMAC Table; AMAC-IP <-> inport.
+
+  uint64_t m_packetCopies;              ///< Packet copies made on the forwarding path
+  uint64_t m_forwardedPackets;          ///< Frames handed to a port device for transmission
+
+  pld::PMACCache m_pmacCache;           ///< Destination IP -> PMAC cache; EDGE only
+  uint64_t m_pmacCacheHits;             ///< Destination PMAC lookups answered by m_pmacCache
+  uint64_t m_pmacCacheMisses;           ///< Destination PMAC lookups sent to the Fabric Manager
+
+  /// A packet from a host and its metadata, waiting for the PMAC of its destination
+  typedef struct HeldPacket {
+    SwitchPacketMetadata metadata;
+    Ptr<const Packet> packet;
+  } HeldPacket;
+
+  typedef std::map<Ipv4Address, std::vector<HeldPacket> > HeldPackets_t;
+  HeldPackets_t m_heldPackets;          ///< Destination IP being resolved -> packets waiting for it; EDGE only
+  uint32_t m_maxHeldPackets;            ///< Packets held at most per destination
+  uint64_t m_nHeldPackets;
+  uint64_t m_nHeldPacketDrops;
+  uint64_t m_nFloodFrames;              ///< Broadcast ARP Request frames sent for Fabric Manager floods
+
+  /// New location of a host that moved away from this edge switch
+  typedef struct MovedPMAC {
+    Mac48Address new_pmac;
+    Time expires;                       ///< Time after which packets to the old PMAC are no longer trapped
+    std::set<Ipv4Address> notified;     ///< Senders already sent a gratuitous ARP Reply
+  } MovedPMAC;
+
+  typedef std::map<Mac48Address, MovedPMAC> MovedPMACs_t;
+  MovedPMACs_t m_movedPMACs;            ///< Old PMAC -> new location of the hosts that moved away; EDGE only
+  Time m_migrationTrapTime;             ///< How long packets to the old PMAC of a moved host are trapped
+  bool m_forwardMovedPackets;           ///< Forward trapped packets to the new location instead of dropping them
+  uint64_t m_nTrappedPackets;
+  uint64_t m_nGratuitousArps;
+
+  /// Replication state of a multicast group
+  typedef struct GroupState {
+    uint64_t ports;                     ///< Bit i set: lower port i leads to members of the group
+    bool up;                            ///< Copies from below also go up the group's tree
+    uint32_t uplink;                    ///< Upper port of the group's tree
+    std::set<std::pair<uint32_t, Ipv4Address> > members;   ///< Lower port and address of the joined hosts; EDGE only
+  } GroupState;
+
+  typedef std::map<Ipv4Address, GroupState> Groups_t;
+  Groups_t m_groups;                    ///< Multicast group -> replication state
+  bool m_multicastFlood;                ///< Send multicast packets to every host instead of the members only
+  uint64_t m_nMulticastFrames;
+
+  /// Last uplink of the flows hashed to one flowlet table slot
+  typedef struct FlowletEntry {
+    uint32_t flow_hash;                 ///< Hash of the flow owning the slot
+    uint32_t port;                      ///< Upper layer port of the current flowlet
+    Time last_seen;                     ///< Time the flow last sent a packet
+    bool valid;
+  } FlowletEntry;
+
+  UplinkPolicy m_uplinkPolicy;          ///< Upstream port selection policy
+  uint32_t m_hashSeed;                  ///< Seed of the flow hash
+  Time m_flowletGap;                    ///< Idle time after which a flow starts a new flowlet
+  Time m_loadTimeConstant;              ///< Time constant of the per-port transmit load average
+  uint32_t m_rebalanceThreshold;        ///< Queue length (bytes) at which an adaptive flowlet may move
+  std::vector<FlowletEntry> m_flowlets; ///< Bounded, direct-mapped flowlet table
+  UniformVariable m_uplinkRng;          ///< Random port choice and tie breaking
 };
 
 } // namespace ns3
@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "portland-vmid-allocator.h"
+#include "ns3/assert.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+namespace pld {
+
+VmidAllocator::VmidAllocator (uint32_t max_vmid)
+  : m_maxVmid (max_vmid),
+    m_next (1)
+{
+}
+
+
+/*
+ * Hands out recycled vmids before fresh ones.
+ */
+uint32_t
+VmidAllocator::Allocate (void)
+{
+  if (!m_free.empty ())
+    {
+      uint32_t vmid = m_free.front ();
+      m_free.pop_front ();
+      return vmid;
+    }
+  if (m_next > m_maxVmid)
+    {
+      return 0;
+    }
+  return m_next++;
+}
+
+
+void
+VmidAllocator::Release (uint32_t vmid)
+{
+  NS_ASSERT_MSG (vmid != 0 && vmid < m_next, "Releasing a vmid that was never allocated");
+  m_free.push_back (vmid);
+}
+
+
+/*
+ * The vmids skipped over to reach a fresh one become free, as if handed out and released.
+ */
+bool
+VmidAllocator::Claim (uint32_t vmid)
+{
+  if (vmid == 0 || vmid > m_maxVmid)
+    {
+      return false;
+    }
+  if (vmid >= m_next)
+    {
+      for (; m_next < vmid; m_next++)
+        {
+          m_free.push_back (m_next);
+        }
+      m_next++;
+      return true;
+    }
+  std::deque<uint32_t>::iterator free = std::find (m_free.begin (), m_free.end (), vmid);
+  if (free == m_free.end ())
+    {
+      return false;
+    }
+  m_free.erase (free);
+  return true;
+}
+
+
+uint32_t
+VmidAllocator::GetNAllocated (void) const
+{
+  return (m_next - 1) - m_free.size ();
+}
+
+
+uint32_t
+VmidAllocator::GetMaxVmid (void) const
+{
+  return m_maxVmid;
+}
+
+} // namespace pld
+
+} // namespace ns3
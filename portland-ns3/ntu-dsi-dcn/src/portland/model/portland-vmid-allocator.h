@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PORTLAND_VMID_ALLOCATOR_H
+#define PORTLAND_VMID_ALLOCATOR_H 1
+
+#include <stdint.h>
+#include <deque>
+
+namespace ns3 {
+
+namespace pld {
+
+/**
+ * \brief Allocator of the vmid field of the PMACs handed out on one edge switch port.
+ *
+ * Vmids are allocated from 1 upwards. Released vmids are recycled in the
+ * order they were released, so that a PMAC is reused as late as possible
+ * and stale copies of it have time to be invalidated.
+ */
+class VmidAllocator
+{
+public:
+  /**
+   * \param max_vmid Largest vmid that may be handed out.
+   */
+  VmidAllocator (uint32_t max_vmid);
+
+  /**
+   * \return A free vmid, or 0 if all vmids up to the maximum are in use.
+   */
+  uint32_t Allocate (void);
+
+  /**
+   * Returns a vmid handed out by Allocate () to the pool.
+   */
+  void Release (uint32_t vmid);
+
+  /**
+   * Takes a given vmid out of the pool, e.g. to restore the PMAC a host had in an earlier run.
+   *
+   * \return False if the vmid is in use or larger than the maximum.
+   */
+  bool Claim (uint32_t vmid);
+
+  /**
+   * \return Number of vmids in use.
+   */
+  uint32_t GetNAllocated (void) const;
+
+  uint32_t GetMaxVmid (void) const;
+
+private:
+  uint32_t m_maxVmid;
+  uint32_t m_next;                      ///< Lowest vmid never handed out
+  std::deque<uint32_t> m_free;          ///< Released vmids, oldest first
+};
+
+} // namespace pld
+
+} // namespace ns3
+
+#endif /* PORTLAND_VMID_ALLOCATOR_H */
@@ -15,13 +15,21 @@ enum PACKET_TYPE {
 	PKT_MAC_REGISTER = 1,
 	PKT_ARP_REQUEST,
 	PKT_ARP_RESPONSE,
-	PKT_ARP_FLOOD
+	PKT_ARP_FLOOD,
+	PKT_PMAC_INVALIDATE,
+	PKT_LOCATION_REQUEST,
+	PKT_LOCATION_ASSIGN,
+	PKT_FAULT_REPORT,
+	PKT_PORT_EXCLUSION,
+	PKT_GROUP_MEMBERSHIP,
+	PKT_GROUP_ROUTE
 };
 
 /*
  * Portland switch type based on the topology layer it is present in
  */ 
 enum PortlandSwitchType {
+    UNKNOWN_LEVEL = 0,  // not yet found by the Location Discovery Protocol
     EDGE = 1,
     AGGREGATION,
     CORE
@@ -2,6 +2,40 @@
 
 // Include a header file from your module to test.
 #include "ns3/portland.h"
+#include "ns3/portland-pmac.h"
+#include "ns3/portland-pmac-table.h"
+#include "ns3/portland-pmac-cache.h"
+#include "ns3/portland-ip-pmac-store.h"
+#include "ns3/portland-fabric-manager.h"
+#include "ns3/portland-fabric-manager-cluster.h"
+#include "ns3/portland-switch-net-device.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/portland-switch-helper.h"
+#include "ns3/portland-vmid-allocator.h"
+#include "ns3/portland-port-stats-sampler.h"
+#include "ns3/portland-event-trace.h"
+#include "ns3/portland-shared-buffer.h"
+#include "ns3/csma-helper.h"
+#include "ns3/csma-net-device.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/ethernet-trailer.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/enum.h"
+#include "ns3/ipv4.h"
+#include "ns3/simulator.h"
+#include "ns3/node-list.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -46,6 +80,1853 @@ PortlandTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Exercises lookups in all three directions, removal and index growth of
+// the PMAC table.
+class PortlandPMACTableTestCase : public TestCase
+{
+public:
+  PortlandPMACTableTestCase ();
+  virtual ~PortlandPMACTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+  static Mac48Address MakeMac (uint8_t first, uint32_t n);
+  static Ipv4Address MakeIp (uint32_t n);
+};
+
+PortlandPMACTableTestCase::PortlandPMACTableTestCase ()
+  : TestCase ("Portland PMAC table lookup by PMAC, AMAC and IP")
+{
+}
+
+PortlandPMACTableTestCase::~PortlandPMACTableTestCase ()
+{
+}
+
+Mac48Address
+PortlandPMACTableTestCase::MakeMac (uint8_t first, uint32_t n)
+{
+  uint8_t buffer[6] = { first, 0, (uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t) n };
+  Mac48Address mac;
+  mac.CopyFrom (buffer);
+  return mac;
+}
+
+Ipv4Address
+PortlandPMACTableTestCase::MakeIp (uint32_t n)
+{
+  return Ipv4Address (0x0a000000 + n);
+}
+
+void
+PortlandPMACTableTestCase::DoRun (void)
+{
+  const uint32_t n = 1000;
+  pld::PMACTable table;
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      table.Add (MakeMac (0, i), MakeMac (2, i), MakeIp (i), i % 48);
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEntries (), n, "Wrong number of entries after Add");
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (table.FindPort (MakeMac (0, i)), (int)(i % 48), "FindPort by PMAC");
+      NS_TEST_ASSERT_MSG_EQ (table.FindPort (MakeIp (i)), (int)(i % 48), "FindPort by IP");
+      NS_TEST_ASSERT_MSG_EQ (table.FindAMAC (MakeMac (0, i)), MakeMac (2, i), "FindAMAC by PMAC");
+      NS_TEST_ASSERT_MSG_EQ (table.FindAMAC (MakeIp (i)), MakeMac (2, i), "FindAMAC by IP");
+      NS_TEST_ASSERT_MSG_EQ (table.FindPMAC (MakeMac (2, i)), MakeMac (0, i), "FindPMAC by AMAC");
+      NS_TEST_ASSERT_MSG_EQ (table.FindPMAC (MakeIp (i)), MakeMac (0, i), "FindPMAC by IP");
+    }
+
+  // Re-adding an allocated PMAC is a no-op
+  table.Add (MakeMac (0, 7), MakeMac (2, 9999), MakeIp (9999), 1);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEntries (), n, "Duplicate PMAC was added");
+  NS_TEST_ASSERT_MSG_EQ (table.FindPort (MakeIp (9999)), -1, "Duplicate PMAC was indexed");
+
+  // Remove every other host
+  for (uint32_t i = 0; i < n; i += 2)
+    {
+      table.Remove (MakeMac (2, i));
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEntries (), n / 2, "Wrong number of entries after Remove");
+  for (uint32_t i = 0; i < n; i++)
+    {
+      bool present = (i % 2 == 1);
+      NS_TEST_ASSERT_MSG_EQ ((table.FindPort (MakeIp (i)) != -1), present, "FindPort by IP after Remove");
+      NS_TEST_ASSERT_MSG_EQ ((table.FindPort (MakeMac (0, i)) != -1), present, "FindPort by PMAC after Remove");
+      NS_TEST_ASSERT_MSG_EQ ((table.FindPMAC (MakeMac (2, i)) != Mac48Address::GetBroadcast ()), present,
+                             "FindPMAC by AMAC after Remove");
+    }
+
+  // A host showing up with a new PMAC replaces its stale entry
+  table.Add (MakeMac (1, 1), MakeMac (2, 1), MakeIp (1), 5);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEntries (), n / 2, "Stale entry was not replaced");
+  NS_TEST_ASSERT_MSG_EQ (table.FindPMAC (MakeIp (1)), MakeMac (1, 1), "FindPMAC by IP after re-Add");
+  NS_TEST_ASSERT_MSG_EQ (table.FindPort (MakeMac (0, 1)), -1, "Stale PMAC still present");
+
+  table.clear ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEntries (), 0U, "Table not empty after clear");
+  NS_TEST_ASSERT_MSG_EQ (table.FindPort (MakeIp (3)), -1, "FindPort after clear");
+}
+
+// Checks the PMAC field layout, including pods and ports past 255 in a non-default layout.
+class PortlandPMACCodecTestCase : public TestCase
+{
+public:
+  PortlandPMACCodecTestCase ();
+  virtual ~PortlandPMACCodecTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandPMACCodecTestCase::PortlandPMACCodecTestCase ()
+  : TestCase ("Portland PMAC codec encodes and decodes pod.position.port.vmid")
+{
+}
+
+PortlandPMACCodecTestCase::~PortlandPMACCodecTestCase ()
+{
+}
+
+void
+PortlandPMACCodecTestCase::DoRun (void)
+{
+  // the default layout is pp:pp:ss:tt:vv:vv
+  Mac48Address pmac = pld::PMAC::Encode (0x0102, 3, 4, 5);
+  NS_TEST_ASSERT_MSG_EQ (pmac, Mac48Address ("01:02:03:04:00:05"), "Default layout changed");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPod (pmac), 0x0102U, "Pod");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPosition (pmac), 3U, "Position");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPort (pmac), 4U, "Port");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetVmid (pmac), 5U, "Vmid");
+
+  // pods past 255 keep their high bits
+  pmac = pld::PMAC::Encode (300, 255, 255, 0xffff);
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPod (pmac), 300U, "Pod past 255 truncated");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPosition (pmac), 255U, "Position");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPort (pmac), 255U, "Port");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetVmid (pmac), 0xffffU, "Vmid");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::FromBits (pld::PMAC::ToBits (pmac)), pmac, "Bits round trip");
+
+  // a 12-bit split gives switches of up to 4096 ports
+  typedef pld::PMACCodec<12, 12, 12, 12> WidePMAC;
+  for (uint32_t i = 0; i < 4096; i += 255)
+    {
+      Mac48Address wide = WidePMAC::Encode (i, 4095 - i, i / 2, 7);
+      NS_TEST_ASSERT_MSG_EQ (WidePMAC::GetPod (wide), i, "Wide pod");
+      NS_TEST_ASSERT_MSG_EQ (WidePMAC::GetPosition (wide), 4095 - i, "Wide position");
+      NS_TEST_ASSERT_MSG_EQ (WidePMAC::GetPort (wide), i / 2, "Wide port");
+      NS_TEST_ASSERT_MSG_EQ (WidePMAC::GetVmid (wide), 7U, "Wide vmid");
+    }
+}
+
+// Checks LRU eviction, expiry and invalidation of the edge switch PMAC cache.
+class PortlandPMACCacheTestCase : public TestCase
+{
+public:
+  PortlandPMACCacheTestCase ();
+  virtual ~PortlandPMACCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandPMACCacheTestCase::PortlandPMACCacheTestCase ()
+  : TestCase ("Portland PMAC cache LRU eviction, expiry and invalidation")
+{
+}
+
+PortlandPMACCacheTestCase::~PortlandPMACCacheTestCase ()
+{
+}
+
+void
+PortlandPMACCacheTestCase::DoRun (void)
+{
+  pld::PMACCache cache;
+  Mac48Address pmac;
+
+  // Disabled by default
+  cache.Insert (Ipv4Address ("10.1.0.1"), Mac48Address ("00:01:00:00:00:01"), Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.1"), Seconds (0), pmac), false, "Disabled cache hit");
+
+  cache.SetMaxEntries (2);
+  cache.SetTimeout (Seconds (10));
+  cache.Insert (Ipv4Address ("10.1.0.1"), Mac48Address ("00:01:00:00:00:01"), Seconds (0));
+  cache.Insert (Ipv4Address ("10.1.0.2"), Mac48Address ("00:01:00:01:00:01"), Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.1"), Seconds (1), pmac), true, "Miss on cached IP");
+  NS_TEST_ASSERT_MSG_EQ (pmac, Mac48Address ("00:01:00:00:00:01"), "Wrong cached PMAC");
+
+  // 10.1.0.2 is now least recently used and is evicted
+  cache.Insert (Ipv4Address ("10.1.0.3"), Mac48Address ("00:01:01:00:00:01"), Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (cache.GetNEntries (), 2U, "Cache exceeded its size");
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.2"), Seconds (2), pmac), false, "LRU entry not evicted");
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.1"), Seconds (2), pmac), true, "MRU entry evicted");
+
+  // Entries expire after the timeout
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.3"), Seconds (12), pmac), false, "Expired entry hit");
+  NS_TEST_ASSERT_MSG_EQ (cache.GetNEntries (), 1U, "Expired entry not dropped");
+
+  NS_TEST_ASSERT_MSG_EQ (cache.Invalidate (Ipv4Address ("10.1.0.1")), true, "Invalidate missed cached IP");
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.0.1"), Seconds (3), pmac), false, "Invalidated entry hit");
+  NS_TEST_ASSERT_MSG_EQ (cache.GetNEntries (), 0U, "Cache not empty");
+}
+
+// Checks the forward and reverse lookups of the Fabric Manager's IP <-> PMAC store.
+class PortlandIpPMACStoreTestCase : public TestCase
+{
+public:
+  PortlandIpPMACStoreTestCase ();
+  virtual ~PortlandIpPMACStoreTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandIpPMACStoreTestCase::PortlandIpPMACStoreTestCase ()
+  : TestCase ("Portland Fabric Manager IP <-> PMAC store")
+{
+}
+
+PortlandIpPMACStoreTestCase::~PortlandIpPMACStoreTestCase ()
+{
+}
+
+void
+PortlandIpPMACStoreTestCase::DoRun (void)
+{
+  pld::IpPMACStore store;
+  Mac48Address broadcast = Mac48Address::GetBroadcast ();
+
+  NS_TEST_ASSERT_MSG_EQ (store.Add (Ipv4Address ("10.1.0.1"), Mac48Address ("00:01:00:00:00:01")), broadcast, "New IP had a PMAC");
+  NS_TEST_ASSERT_MSG_EQ (store.FindPMAC (Ipv4Address ("10.1.0.1")), Mac48Address ("00:01:00:00:00:01"), "Wrong PMAC");
+  NS_TEST_ASSERT_MSG_EQ (store.FindIP (Mac48Address ("00:01:00:00:00:01")), Ipv4Address ("10.1.0.1"), "Wrong IP");
+  NS_TEST_ASSERT_MSG_EQ (store.FindPMAC (Ipv4Address ("10.1.0.2")), broadcast, "Unknown IP found");
+  NS_TEST_ASSERT_MSG_EQ (store.FindIP (Mac48Address ("00:01:00:00:00:02")), Ipv4Address ("255.255.255.255"), "Unknown PMAC found");
+
+  // a new PMAC for the IP replaces the old one, which no longer resolves
+  NS_TEST_ASSERT_MSG_EQ (store.Add (Ipv4Address ("10.1.0.1"), Mac48Address ("00:02:00:00:00:01")),
+                         Mac48Address ("00:01:00:00:00:01"), "Previous PMAC not returned");
+  NS_TEST_ASSERT_MSG_EQ (store.FindIP (Mac48Address ("00:01:00:00:00:01")), Ipv4Address ("255.255.255.255"), "Stale PMAC found");
+  NS_TEST_ASSERT_MSG_EQ (store.GetNEntries (), 1U, "Stale entry kept");
+
+  // a PMAC taken over by another IP drops the old binding
+  store.Add (Ipv4Address ("10.1.0.2"), Mac48Address ("00:02:00:00:00:01"));
+  NS_TEST_ASSERT_MSG_EQ (store.Contains (Ipv4Address ("10.1.0.1")), false, "Stale IP kept");
+  NS_TEST_ASSERT_MSG_EQ (store.FindIP (Mac48Address ("00:02:00:00:00:01")), Ipv4Address ("10.1.0.2"), "Wrong IP");
+
+  // grow through several rehashes, then remove every other host
+  store.Reserve (1000);
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      uint8_t buffer[6] = { 0, 0x10, (uint8_t)(i >> 8), (uint8_t) i, 0, 1 };
+      Mac48Address pmac;
+      pmac.CopyFrom (buffer);
+      store.Add (Ipv4Address (0x0a020000 + i), pmac);
+    }
+  for (uint32_t i = 0; i < 1000; i += 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ (store.Remove (Ipv4Address (0x0a020000 + i)), true, "Remove missed an IP");
+    }
+  NS_TEST_ASSERT_MSG_EQ (store.GetNEntries (), 501U, "Wrong number of entries");
+  for (uint32_t i = 1; i < 1000; i += 2)
+    {
+      uint8_t buffer[6] = { 0, 0x10, (uint8_t)(i >> 8), (uint8_t) i, 0, 1 };
+      Mac48Address pmac;
+      pmac.CopyFrom (buffer);
+      NS_TEST_ASSERT_MSG_EQ (store.FindIP (pmac), Ipv4Address (0x0a020000 + i), "Reverse lookup failed after removals");
+      NS_TEST_ASSERT_MSG_EQ (store.FindPMAC (Ipv4Address (0x0a020000 + i)), pmac, "Forward lookup failed after removals");
+    }
+}
+
+// Checks that the Fabric Manager serves messages one at a time after the channel latency and returns
+// them to the message pool.
+class PortlandControlChannelTestCase : public TestCase
+{
+public:
+  PortlandControlChannelTestCase ();
+  virtual ~PortlandControlChannelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandControlChannelTestCase::PortlandControlChannelTestCase ()
+  : TestCase ("Portland Fabric Manager control channel latency and queueing")
+{
+}
+
+PortlandControlChannelTestCase::~PortlandControlChannelTestCase ()
+{
+}
+
+void
+PortlandControlChannelTestCase::DoRun (void)
+{
+  uint32_t in_use = pld::GetNMessagesInUse ();
+
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  fm->SetAttribute ("Latency", TimeValue (MilliSeconds (1)));
+  fm->SetAttribute ("ServiceTime", TimeValue (MilliSeconds (1)));
+
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      pld::PMACRegister* msg;
+      pld::BufferData buffer = pld::CreateMessage (msg);
+      NS_TEST_ASSERT_MSG_EQ (buffer.pkt_type, PKT_MAC_REGISTER, "Wrong message type");
+      NS_TEST_ASSERT_MSG_EQ (buffer.Get<pld::PMACRegister> (), msg, "Wrong message");
+      msg->hostIP = Ipv4Address (0x0a010000 + i);
+      msg->PMACAddress = Mac48Address ("00:01:00:00:00:01");
+      fm->ReceiveFromSwitch (0, buffer);
+    }
+  NS_TEST_ASSERT_MSG_EQ (pld::GetNMessagesInUse (), in_use + 3, "Messages not taken from the pool");
+
+  // nothing arrives before the channel latency
+  Simulator::Stop (MicroSeconds (999));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNRequests (), 0U, "Message handled before crossing the channel");
+
+  // the three messages arrive together at 1ms and are served at 2, 3 and 4ms
+  Simulator::Stop (MicroSeconds (3001));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNRequests (), 2U, "Messages not served one at a time");
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNRequests (), 3U, "Message not served");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetMaxBacklog (), 3U, "Wrong backlog");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetMeanQueueingDelay (), MilliSeconds (1), "Wrong queueing delay");
+  NS_TEST_ASSERT_MSG_EQ (pld::GetNMessagesInUse (), in_use, "Messages not returned to the pool");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a Fabric Manager cluster keeps every host on its owning shard as shards come and go,
+// and that a message reaching a shard that no longer owns it is passed on.
+class PortlandFabricManagerClusterTestCase : public TestCase
+{
+public:
+  PortlandFabricManagerClusterTestCase ();
+  virtual ~PortlandFabricManagerClusterTestCase ();
+
+private:
+  virtual void DoRun (void);
+  bool HostsOnOwners (Ptr<pld::FabricManagerCluster> cluster);
+};
+
+PortlandFabricManagerClusterTestCase::PortlandFabricManagerClusterTestCase ()
+  : TestCase ("Portland Fabric Manager cluster sharding and rebalancing")
+{
+}
+
+PortlandFabricManagerClusterTestCase::~PortlandFabricManagerClusterTestCase ()
+{
+}
+
+bool
+PortlandFabricManagerClusterTestCase::HostsOnOwners (Ptr<pld::FabricManagerCluster> cluster)
+{
+  for (uint32_t s = 0; s < cluster->GetNShards (); s++)
+    {
+      std::vector<std::pair<Ipv4Address, Mac48Address> > hosts;
+      cluster->GetShard (s)->GetHosts (hosts);
+      for (uint32_t h = 0; h < hosts.size (); h++)
+        {
+          if (cluster->GetShard (hosts[h].first) != cluster->GetShard (s))
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+void
+PortlandFabricManagerClusterTestCase::DoRun (void)
+{
+  uint32_t in_use = pld::GetNMessagesInUse ();
+
+  Ptr<pld::FabricManagerCluster> cluster = CreateObject<pld::FabricManagerCluster> ();
+  Ptr<pld::FabricManager> first = cluster->AddShard ();
+  cluster->AddShard ();
+
+  std::vector<std::pair<Ipv4Address, Mac48Address> > hosts;
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      uint8_t buffer[6] = { 0, (uint8_t)(i >> 8), (uint8_t) i, 0, 0, 1 };
+      Mac48Address pmac;
+      pmac.CopyFrom (buffer);
+      hosts.push_back (std::make_pair (Ipv4Address (0x0a000000 + i), pmac));
+    }
+  cluster->RegisterHosts (hosts);
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetNHosts (), 1000U, "Hosts lost");
+  NS_TEST_ASSERT_MSG_EQ (HostsOnOwners (cluster), true, "Host registered with the wrong shard");
+  NS_TEST_ASSERT_MSG_GT (first->GetNHosts (), 250U, "Hosts not spread over the shards");
+  NS_TEST_ASSERT_MSG_LT (first->GetNHosts (), 750U, "Hosts not spread over the shards");
+
+  // a third shard takes over about a third of the hosts, and only those
+  Ptr<pld::FabricManager> third = cluster->AddShard ();
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetNHosts (), 1000U, "Hosts lost when adding a shard");
+  NS_TEST_ASSERT_MSG_EQ (HostsOnOwners (cluster), true, "Host not moved to its new shard");
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetNMovedHosts (), (uint64_t) third->GetNHosts (), "Hosts moved between old shards");
+
+  // a registration queued at the first shard is passed on once the shard has left
+  Ipv4Address moved;
+  for (uint32_t i = 0; i < hosts.size (); i++)
+    {
+      if (cluster->GetShard (hosts[i].first) == first)
+        {
+          moved = hosts[i].first;
+          break;
+        }
+    }
+  pld::PMACRegister* msg;
+  pld::BufferData buffer = pld::CreateMessage (msg);
+  msg->hostIP = moved;
+  msg->PMACAddress = Mac48Address ("00:01:00:00:00:01");
+  cluster->ReceiveFromSwitch (0, buffer);
+
+  cluster->RemoveShard (first);
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetNShards (), 2U, "Shard not removed");
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetNHosts (), 1000U, "Hosts lost when removing a shard");
+  NS_TEST_ASSERT_MSG_EQ (HostsOnOwners (cluster), true, "Host not moved off the removed shard");
+
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (first->GetNRedirects (), 1U, "Message not passed on");
+  NS_TEST_ASSERT_MSG_EQ (cluster->GetShard (moved)->GetNRequests (), 1U, "Message not handled by the owner");
+  NS_TEST_ASSERT_MSG_EQ (pld::GetNMessagesInUse (), in_use, "Messages not returned to the pool");
+
+  cluster->Dispose ();
+  Simulator::Destroy ();
+}
+
+// Checks how many switches the Fabric Manager asks to flood an ARP Request for an unknown host in each flood mode.
+class PortlandFloodModeTestCase : public TestCase
+{
+public:
+  PortlandFloodModeTestCase ();
+  virtual ~PortlandFloodModeTestCase ();
+
+private:
+  virtual void DoRun (void);
+  uint32_t CountFloodMessages (pld::FabricManager::FloodMode mode);
+};
+
+PortlandFloodModeTestCase::PortlandFloodModeTestCase ()
+  : TestCase ("Portland Fabric Manager ARP flood fan-out")
+{
+}
+
+PortlandFloodModeTestCase::~PortlandFloodModeTestCase ()
+{
+}
+
+/*
+ * Returns the number of messages the Fabric Manager has in flight after answering one query for an
+ * unknown host, not counting the answer itself.
+ */
+uint32_t
+PortlandFloodModeTestCase::CountFloodMessages (pld::FabricManager::FloodMode mode)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  fm->SetAttribute ("Latency", TimeValue (MilliSeconds (1)));
+  fm->SetAttribute ("ServiceTime", TimeValue (MilliSeconds (1)));
+  fm->SetAttribute ("FloodMode", EnumValue (mode));
+
+  // two core groups of two, and an edge switch without ports
+  for (uint8_t group = 0; group < 2; group++)
+    {
+      for (uint8_t position = 0; position < 2; position++)
+        {
+          Ptr<PortlandSwitchNetDevice> core = CreateObject<PortlandSwitchNetDevice> ();
+          core->SetDeviceType (CORE);
+          core->SetPod (group);
+          core->SetPosition (position);
+          core->SetFabricManager (fm);
+        }
+    }
+  Ptr<PortlandSwitchNetDevice> edge = CreateObject<PortlandSwitchNetDevice> ();
+  edge->SetDeviceType (EDGE);
+  edge->SetFabricManager (fm);
+
+  uint32_t in_use = pld::GetNMessagesInUse ();
+  pld::ARPRequest* msg;
+  pld::BufferData buffer = pld::CreateMessage (msg);
+  msg->destIPAddress = Ipv4Address ("10.0.0.2");
+  msg->srcIPAddress = Ipv4Address ("10.0.0.3");
+  msg->srcPMACAddress = Mac48Address ("00:00:00:00:00:01");
+  fm->ReceiveFromSwitch (edge, buffer);
+
+  // answered at 2ms; the answer and the flood requests reach the switches at 3ms
+  Simulator::Stop (MicroSeconds (2500));
+  Simulator::Run ();
+  uint32_t messages = pld::GetNMessagesInUse () - in_use - 1;
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return messages;
+}
+
+void
+PortlandFloodModeTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (CountFloodMessages (pld::FabricManager::FLOOD_ALL_CORES), 4U, "Not every core floods");
+  NS_TEST_ASSERT_MSG_EQ (CountFloodMessages (pld::FabricManager::FLOOD_CORE_TREE), 1U, "More than one core floods");
+  // the edge switch has no host ports left to discover
+  NS_TEST_ASSERT_MSG_EQ (CountFloodMessages (pld::FabricManager::FLOOD_EDGES), 0U, "Resolved edge switch floods");
+}
+
+// Checks that VMs sharing an edge switch port are given distinct PMACs and that vmids are recycled.
+class PortlandVmidTestCase : public TestCase
+{
+public:
+  PortlandVmidTestCase ();
+  virtual ~PortlandVmidTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandVmidTestCase::PortlandVmidTestCase ()
+  : TestCase ("Portland per-port vmid allocation for VMs")
+{
+}
+
+PortlandVmidTestCase::~PortlandVmidTestCase ()
+{
+}
+
+static void
+SendDatagram (Ptr<Node> node, Ipv4Address dst)
+{
+  Ptr<Socket> socket = Socket::CreateSocket (node, UdpSocketFactory::GetTypeId ());
+  socket->SendTo (Create<Packet> (100), 0, InetSocketAddress (dst, 9));
+  socket->Close ();
+}
+
+void
+PortlandVmidTestCase::DoRun (void)
+{
+  pld::VmidAllocator vmids (4);
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 1U, "Vmids start at 1");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 2U, "Vmid not allocated in order");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 3U, "Vmid not allocated in order");
+  vmids.Release (2);
+  vmids.Release (1);
+  NS_TEST_ASSERT_MSG_EQ (vmids.GetNAllocated (), 1U, "Released vmids still counted");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 2U, "Oldest released vmid not recycled first");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 1U, "Released vmid not recycled");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 4U, "Fresh vmid not allocated");
+  NS_TEST_ASSERT_MSG_EQ (vmids.Allocate (), 0U, "Allocated past the maximum vmid");
+
+  // restoring a PMAC claims its vmid; the vmids below it stay free
+  pld::VmidAllocator claimed (8);
+  NS_TEST_ASSERT_MSG_EQ (claimed.Claim (3), true, "Fresh vmid not claimed");
+  NS_TEST_ASSERT_MSG_EQ (claimed.Claim (3), false, "Vmid claimed twice");
+  NS_TEST_ASSERT_MSG_EQ (claimed.Allocate (), 1U, "Vmid skipped by a claim not free");
+  NS_TEST_ASSERT_MSG_EQ (claimed.Claim (2), true, "Free vmid not claimed");
+  NS_TEST_ASSERT_MSG_EQ (claimed.Allocate (), 4U, "Claimed vmid allocated");
+  NS_TEST_ASSERT_MSG_EQ (claimed.GetNAllocated (), 4U, "Claimed vmids not counted");
+  NS_TEST_ASSERT_MSG_EQ (claimed.Claim (9), false, "Claimed past the maximum vmid");
+
+  // three VMs share port 0 of an edge switch; one host is on port 1
+  NodeContainer vms, host, sw;
+  vms.Create (3);
+  host.Create (1);
+  sw.Create (1);
+  CsmaHelper csma;
+  NetDeviceContainer rack = csma.Install (NodeContainer (vms, sw));
+  NetDeviceContainer link = csma.Install (NodeContainer (host, sw));
+
+  NetDeviceContainer lower;
+  lower.Add (rack.Get (3));
+  lower.Add (link.Get (1));
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandSwitchHelper switchHelper;
+  Ptr<PortlandSwitchNetDevice> edge = DynamicCast<PortlandSwitchNetDevice> (
+      switchHelper.Install (sw.Get (0), lower, NetDeviceContainer (), fm, EDGE, 1, 1).Get (0));
+
+  InternetStackHelper internet;
+  internet.Install (vms);
+  internet.Install (host);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.0.0.0", "255.255.255.0");
+  NetDeviceContainer hostDevices;
+  hostDevices.Add (rack.Get (0));
+  hostDevices.Add (rack.Get (1));
+  hostDevices.Add (rack.Get (2));
+  hostDevices.Add (link.Get (0));
+  Ipv4InterfaceContainer addresses = ipv4.Assign (hostDevices);
+
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10 * (i + 1)), &SendDatagram, vms.Get (i), addresses.GetAddress (3));
+    }
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  std::vector<std::pair<Ipv4Address, Mac48Address> > registered;
+  fm->GetHosts (registered);
+  std::map<Ipv4Address, Mac48Address> pmacs (registered.begin (), registered.end ());
+  std::set<uint32_t> allocated;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (pmacs.count (addresses.GetAddress (i)), 1U, "VM not registered");
+      Mac48Address pmac = pmacs[addresses.GetAddress (i)];
+      NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPod (pmac), 1U, "Wrong pod");
+      NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPosition (pmac), 1U, "Wrong position");
+      NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPort (pmac), 0U, "Wrong port");
+      allocated.insert (pld::PMAC::GetVmid (pmac));
+    }
+  NS_TEST_ASSERT_MSG_EQ (allocated.size (), 3U, "VMs on one port share a PMAC");
+
+  uint32_t hosts = edge->GetNHosts ();
+  NS_TEST_ASSERT_MSG_EQ (edge->RemoveHost (Mac48Address::ConvertFrom (rack.Get (1)->GetAddress ())), true, "VM not known");
+  NS_TEST_ASSERT_MSG_EQ (edge->GetNHosts (), hosts - 1, "VM not removed");
+  NS_TEST_ASSERT_MSG_EQ (edge->RemoveHost (Mac48Address::ConvertFrom (rack.Get (1)->GetAddress ())), false, "VM removed twice");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a VM migrated to another pod is given a PMAC there and keeps receiving a stream sent to it.
+class PortlandMigrationTestCase : public TestCase
+{
+public:
+  PortlandMigrationTestCase ();
+  virtual ~PortlandMigrationTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+  uint32_t m_receivedAfterMigration;
+  Time m_migrationTime;
+};
+
+PortlandMigrationTestCase::PortlandMigrationTestCase ()
+  : TestCase ("Portland VM migration"),
+    m_received (0),
+    m_receivedAfterMigration (0)
+{
+}
+
+PortlandMigrationTestCase::~PortlandMigrationTestCase ()
+{
+}
+
+void
+PortlandMigrationTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+      if (Simulator::Now () > m_migrationTime)
+        {
+          m_receivedAfterMigration++;
+        }
+    }
+}
+
+void
+PortlandMigrationTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+
+  Ptr<Node> vm = fatTree.GetHost (1, 0, 0);
+  Ptr<Socket> sink = Socket::CreateSocket (vm, UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&PortlandMigrationTestCase::Receive, this));
+
+  // a datagram every 100us for 20ms, the VM moving to the last pod halfway through
+  Simulator::Schedule (Seconds (0), &PortlandFatTreeHelper::AnnounceHost, vm);
+  uint32_t sent = 200;
+  for (uint32_t i = 0; i < sent; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (0, 0, 0),
+                           fatTree.GetHostAddress (1, 0, 0));
+    }
+  m_migrationTime = MilliSeconds (20);
+  Simulator::Schedule (m_migrationTime, &PortlandFatTreeHelper::MigrateHost, vm, fatTree.GetHost (3, 1, 1));
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNMigrations (), 1U, "Migration not seen by the Fabric Manager");
+  std::vector<std::pair<Ipv4Address, Mac48Address> > registered;
+  fm->GetHosts (registered);
+  std::map<Ipv4Address, Mac48Address> pmacs (registered.begin (), registered.end ());
+  Mac48Address pmac = pmacs[fatTree.GetHostAddress (1, 0, 0)];
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPod (pmac), 3U, "PMAC not moved to the new pod");
+  NS_TEST_ASSERT_MSG_EQ (pld::PMAC::GetPosition (pmac), 1U, "PMAC not moved to the new edge switch");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetEdgeSwitch (1, 0)->GetNHosts (), 0U, "Old edge switch still holds the VM");
+  NS_TEST_ASSERT_MSG_GT (m_receivedAfterMigration, sent / 2 - 10, "Stream not restored after the migration");
+  NS_TEST_ASSERT_MSG_GT (m_received, sent - 10, "Too many datagrams lost in the migration");
+
+  Simulator::Destroy ();
+}
+
+// Checks that switches starting with no level, pod or position find them with the Location Discovery Protocol.
+class PortlandLocationDiscoveryTestCase : public TestCase
+{
+public:
+  PortlandLocationDiscoveryTestCase ();
+  virtual ~PortlandLocationDiscoveryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+PortlandLocationDiscoveryTestCase::PortlandLocationDiscoveryTestCase ()
+  : TestCase ("Portland location discovery"),
+    m_received (0)
+{
+}
+
+PortlandLocationDiscoveryTestCase::~PortlandLocationDiscoveryTestCase ()
+{
+}
+
+void
+PortlandLocationDiscoveryTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandLocationDiscoveryTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetLocationDiscovery (true);
+  fatTree.Install (fm);
+
+  Ptr<Socket> sink = Socket::CreateSocket (fatTree.GetHost (2, 1, 1), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&PortlandLocationDiscoveryTestCase::Receive, this));
+  // well after the switches have located themselves
+  Simulator::Schedule (MilliSeconds (200), &SendDatagram, fatTree.GetHost (0, 0, 0), fatTree.GetHostAddress (2, 1, 1));
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNDiscoveredSwitches (), 20U, "Not every switch located");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNPods (), 4U, "Wrong number of pods");
+  std::set<std::pair<uint16_t, uint16_t> > edges;
+  for (uint32_t pod = 0; pod < 4; pod++)
+    {
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          Ptr<PortlandSwitchNetDevice> edge = fatTree.GetEdgeSwitch (pod, i);
+          Ptr<PortlandSwitchNetDevice> aggregation = fatTree.GetAggregationSwitch (pod, i);
+          NS_TEST_ASSERT_MSG_EQ (edge->IsLocated (), true, "Edge switch not located");
+          NS_TEST_ASSERT_MSG_EQ (edge->GetDeviceType (), EDGE, "Wrong edge level");
+          NS_TEST_ASSERT_MSG_EQ (edges.insert (std::make_pair (edge->GetPod (), edge->GetPosition ())).second, true,
+                                 "Two edge switches share a location");
+          NS_TEST_ASSERT_MSG_EQ (edge->GetPod (), fatTree.GetEdgeSwitch (pod, 0)->GetPod (), "Pod split");
+          NS_TEST_ASSERT_MSG_EQ (aggregation->GetDeviceType (), AGGREGATION, "Wrong aggregation level");
+          NS_TEST_ASSERT_MSG_EQ (aggregation->GetPod (), edge->GetPod (), "Aggregation switch out of its pod");
+          NS_TEST_ASSERT_MSG_EQ ((uint32_t) aggregation->GetPosition (), i, "Wrong aggregation position");
+        }
+    }
+  for (uint32_t group = 0; group < 2; group++)
+    {
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          Ptr<PortlandSwitchNetDevice> core = fatTree.GetCoreSwitch (group, i);
+          NS_TEST_ASSERT_MSG_EQ (core->GetDeviceType (), CORE, "Wrong core level");
+          NS_TEST_ASSERT_MSG_EQ ((uint32_t) core->GetPod (), group, "Wrong core group");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_received, 1U, "Datagram not delivered across discovered pods");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a located switch that restarts the Location Discovery Protocol, and so turns its upper ports into lower
+// ports, finds its location again and forwards over its ports once more.
+class PortlandRediscoveryTestCase : public TestCase
+{
+public:
+  PortlandRediscoveryTestCase ();
+  virtual ~PortlandRediscoveryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+  void CheckRestarted (Ptr<PortlandSwitchNetDevice> aggregation);
+
+  uint32_t m_received;
+  uint64_t m_forwarded;
+};
+
+PortlandRediscoveryTestCase::PortlandRediscoveryTestCase ()
+  : TestCase ("Portland location rediscovery"),
+    m_received (0),
+    m_forwarded (0)
+{
+}
+
+PortlandRediscoveryTestCase::~PortlandRediscoveryTestCase ()
+{
+}
+
+void
+PortlandRediscoveryTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandRediscoveryTestCase::CheckRestarted (Ptr<PortlandSwitchNetDevice> aggregation)
+{
+  NS_TEST_ASSERT_MSG_EQ (aggregation->IsLocated (), true, "Switch not located again");
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetNUpperPorts (), 2U, "Upper ports not found again");
+  m_forwarded = aggregation->GetNForwardedPackets ();
+}
+
+void
+PortlandRediscoveryTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetLinkMonitoring (true);
+  fatTree.Install (fm);
+
+  // the aggregation switch has its upper ports to the core switches when it restarts
+  Ptr<PortlandSwitchNetDevice> aggregation = fatTree.GetAggregationSwitch (1, 0);
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetNUpperPorts (), 2U, "Aggregation switch without upper ports");
+  Simulator::Schedule (MilliSeconds (10), &PortlandSwitchNetDevice::StartLocationDiscovery, aggregation);
+  Simulator::Schedule (MilliSeconds (300), &PortlandRediscoveryTestCase::CheckRestarted, this, aggregation);
+
+  // from 300ms every host of pod 1 sends to the host at the same place in pod 3, and back
+  std::vector<Ptr<Socket> > sinks;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      for (uint32_t pod = 1; pod < 4; pod += 2)
+        {
+          Ptr<Socket> sink = Socket::CreateSocket (fatTree.GetHost (pod, i / 2, i % 2), UdpSocketFactory::GetTypeId ());
+          sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+          sink->SetRecvCallback (MakeCallback (&PortlandRediscoveryTestCase::Receive, this));
+          sinks.push_back (sink);
+          for (uint32_t n = 0; n < 20; n++)
+            {
+              Simulator::Schedule (MilliSeconds (300 + 5 * n) + MicroSeconds (10 * i), &SendDatagram,
+                                   fatTree.GetHost (pod, i / 2, i % 2), fatTree.GetHostAddress (4 - pod, i / 2, i % 2));
+            }
+        }
+    }
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetDeviceType (), AGGREGATION, "Wrong level after rediscovery");
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetPod (), 1, "Wrong pod after rediscovery");
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetPosition (), 0, "Wrong position after rediscovery");
+  NS_TEST_ASSERT_MSG_GT (aggregation->GetNForwardedPackets (), m_forwarded, "Nothing forwarded after rediscovery");
+  NS_TEST_ASSERT_MSG_EQ (m_received, 160U, "Datagrams lost after rediscovery");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a failed link is found by its missing LDMs and routed around, and that it is used again once it is back.
+class PortlandLinkFailureTestCase : public TestCase
+{
+public:
+  PortlandLinkFailureTestCase ();
+  virtual ~PortlandLinkFailureTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+  void CheckRerouted (Ptr<pld::FabricManager> fm, Ptr<PortlandSwitchNetDevice> source);
+
+  uint32_t m_receivedLate;
+  Time m_lateFrom;
+};
+
+PortlandLinkFailureTestCase::PortlandLinkFailureTestCase ()
+  : TestCase ("Portland link failure detection and rerouting"),
+    m_receivedLate (0)
+{
+}
+
+PortlandLinkFailureTestCase::~PortlandLinkFailureTestCase ()
+{
+}
+
+void
+PortlandLinkFailureTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      if (Simulator::Now () > m_lateFrom)
+        {
+          m_receivedLate++;
+        }
+    }
+}
+
+void
+PortlandLinkFailureTestCase::CheckRerouted (Ptr<pld::FabricManager> fm, Ptr<PortlandSwitchNetDevice> source)
+{
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNLinkFaults (), 1U, "Failed link not reported");
+  NS_TEST_ASSERT_MSG_EQ (source->GetNExcludedDestinations (), 1U, "Sender's edge switch not told to avoid the link");
+}
+
+void
+PortlandLinkFailureTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetLinkMonitoring (true);
+  fatTree.Install (fm);
+
+  Ptr<Socket> sink = Socket::CreateSocket (fatTree.GetHost (1, 0, 0), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&PortlandLinkFailureTestCase::Receive, this));
+
+  // a datagram every 100us from 10ms to 200ms; the link from the receiver's edge switch to the first
+  // aggregation switch of its pod is down from 50ms to 150ms
+  for (uint32_t i = 0; i < 1900; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (0, 0, 0),
+                           fatTree.GetHostAddress (1, 0, 0));
+    }
+  Ptr<PortlandSwitchNetDevice> edge = fatTree.GetEdgeSwitch (1, 0);
+  Ptr<PortlandSwitchNetDevice> aggregation = fatTree.GetAggregationSwitch (1, 0);
+  Simulator::Schedule (MilliSeconds (50), &PortlandFatTreeHelper::FailLink, edge, aggregation);
+  Simulator::Schedule (MilliSeconds (140), &PortlandLinkFailureTestCase::CheckRerouted, this, fm,
+                       fatTree.GetEdgeSwitch (0, 0));
+  Simulator::Schedule (MilliSeconds (150), &PortlandFatTreeHelper::RestoreLink, edge, aggregation);
+  m_lateFrom = MilliSeconds (120);
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (edge->GetNLinkFailures (), 1U, "Edge switch did not take its port down");
+  NS_TEST_ASSERT_MSG_EQ (aggregation->GetNLinkFailures (), 1U, "Aggregation switch did not take its port down");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNLinkFaults (), 0U, "Restored link still reported down");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetEdgeSwitch (0, 0)->GetNExcludedDestinations (), 0U, "Restored link still avoided");
+  NS_TEST_ASSERT_MSG_EQ (edge->IsLinkUp (), true, "Switch reported down");
+  // no datagram sent after the network converged is lost
+  NS_TEST_ASSERT_MSG_EQ (m_receivedLate, 800U, "Datagrams lost after rerouting");
+
+  Simulator::Destroy ();
+}
+
+// Checks that an ARP flood reaches a pod whose aggregation switches have lost the link to the core switch in
+// position 0, the root of the flood.
+class PortlandFloodFailureTestCase : public TestCase
+{
+public:
+  PortlandFloodFailureTestCase ();
+  virtual ~PortlandFloodFailureTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+PortlandFloodFailureTestCase::PortlandFloodFailureTestCase ()
+  : TestCase ("Portland ARP flood around a failed core link"),
+    m_received (0)
+{
+}
+
+PortlandFloodFailureTestCase::~PortlandFloodFailureTestCase ()
+{
+}
+
+void
+PortlandFloodFailureTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandFloodFailureTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetLinkMonitoring (true);
+  fatTree.Install (fm);
+
+  // at 50ms both aggregation switches of pod 2 lose upper port 0, whichever group the flood starts in
+  for (uint32_t group = 0; group < 2; group++)
+    {
+      Simulator::Schedule (MilliSeconds (50), &PortlandFatTreeHelper::FailLink, fatTree.GetAggregationSwitch (2, group),
+                           fatTree.GetCoreSwitch (group, 0));
+    }
+  Ptr<Socket> sink = Socket::CreateSocket (fatTree.GetHost (2, 1, 1), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&PortlandFloodFailureTestCase::Receive, this));
+  // the receiver has not been seen yet, so the Fabric Manager misses and floods for it once the links are down
+  Simulator::Schedule (MilliSeconds (200), &SendDatagram, fatTree.GetHost (0, 0, 0), fatTree.GetHostAddress (2, 1, 1));
+  Simulator::Stop (MilliSeconds (600));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNLinkFaults (), 2U, "Failed links not reported");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetAggregationSwitch (2, 0)->GetNFloodFrames () + fatTree.GetAggregationSwitch (2, 1)->GetNFloodFrames (),
+                         2U, "Pod 2 did not pass on exactly one flood");
+  NS_TEST_ASSERT_MSG_EQ (m_received, 1U, "Flood did not reach the host behind the failed links");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a multicast group's packets reach each member once, over a tree pruned to the members' edge
+// switches, and that the replication state goes away with the last member.
+class PortlandMulticastTestCase : public TestCase
+{
+public:
+  PortlandMulticastTestCase ();
+  virtual ~PortlandMulticastTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  std::map<uint32_t, uint32_t> m_received;      ///< Node id -> datagrams received
+};
+
+PortlandMulticastTestCase::PortlandMulticastTestCase ()
+  : TestCase ("Portland multicast groups and replication trees")
+{
+}
+
+PortlandMulticastTestCase::~PortlandMulticastTestCase ()
+{
+}
+
+void
+PortlandMulticastTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received[socket->GetNode ()->GetId ()]++;
+    }
+}
+
+void
+PortlandMulticastTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+  Ipv4Address group ("239.1.1.1");
+
+  NodeContainer hosts = fatTree.GetHosts ();
+  for (uint32_t h = 0; h < hosts.GetN (); h++)
+    {
+      Ptr<Socket> sink = Socket::CreateSocket (hosts.Get (h), UdpSocketFactory::GetTypeId ());
+      sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      sink->SetRecvCallback (MakeCallback (&PortlandMulticastTestCase::Receive, this));
+    }
+
+  // members in three pods, two of them on the same edge switch
+  Ptr<Node> members[5] = { fatTree.GetHost (0, 0, 0), fatTree.GetHost (0, 0, 1), fatTree.GetHost (0, 1, 0),
+                           fatTree.GetHost (2, 1, 1), fatTree.GetHost (3, 0, 0) };
+  for (uint32_t m = 0; m < 5; m++)
+    {
+      Simulator::Schedule (MilliSeconds (10), &PortlandFatTreeHelper::JoinGroup, members[m], group);
+    }
+  // ten datagrams from a host outside the group, ten from a member, then ten more from outside once two
+  // members left
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Simulator::Schedule (MilliSeconds (20) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (1, 0, 0), group);
+      Simulator::Schedule (MilliSeconds (30) + MicroSeconds (100 * i), &SendDatagram, members[3], group);
+      Simulator::Schedule (MilliSeconds (50) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (1, 0, 0), group);
+    }
+  Simulator::Schedule (MilliSeconds (40), &PortlandFatTreeHelper::LeaveGroup, members[1], group);
+  Simulator::Schedule (MilliSeconds (40), &PortlandFatTreeHelper::LeaveGroup, members[4], group);
+  for (uint32_t m = 0; m < 5; m++)
+    {
+      Simulator::Schedule (MilliSeconds (60), &PortlandFatTreeHelper::LeaveGroup, members[m], group);
+    }
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  uint32_t expected[5] = { 30, 20, 30, 20, 20 };
+  uint32_t received = 0;
+  for (uint32_t m = 0; m < 5; m++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_received[members[m]->GetId ()], expected[m], "Member " << m << " got a wrong number of copies");
+      received += m_received[members[m]->GetId ()];
+    }
+  uint32_t total = 0;
+  for (std::map<uint32_t, uint32_t>::const_iterator r = m_received.begin (); r != m_received.end (); r++)
+    {
+      total += r->second;
+    }
+  NS_TEST_ASSERT_MSG_EQ (total, received, "Hosts outside the group got copies");
+
+  // one frame per link of the tree: 14 for each datagram from outside to five members, 11 from a member, 10 to
+  // three members
+  uint64_t frames = 0;
+  uint32_t groups = 0;
+  for (NodeList::Iterator n = NodeList::Begin (); n != NodeList::End (); n++)
+    {
+      for (uint32_t d = 0; d < (*n)->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> ((*n)->GetDevice (d));
+          if (sw != 0)
+            {
+              frames += sw->GetNMulticastFrames ();
+              groups += sw->GetNGroups ();
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (frames, 350U, "Packets not replicated once per link of the tree");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNGroups (), 0U, "Group left by all members still known");
+  NS_TEST_ASSERT_MSG_EQ (groups, 0U, "Switches kept state for a group without members");
+
+  Simulator::Destroy ();
+}
+
+// Checks that a multicast group's tree moves off a failed link between an aggregation switch of the tree and its root.
+class PortlandMulticastFailureTestCase : public TestCase
+{
+public:
+  PortlandMulticastFailureTestCase ();
+  virtual ~PortlandMulticastFailureTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+PortlandMulticastFailureTestCase::PortlandMulticastFailureTestCase ()
+  : TestCase ("Portland multicast tree around a failed link"),
+    m_received (0)
+{
+}
+
+PortlandMulticastFailureTestCase::~PortlandMulticastFailureTestCase ()
+{
+}
+
+void
+PortlandMulticastFailureTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandMulticastFailureTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetLinkMonitoring (true);
+  fatTree.Install (fm);
+  Ipv4Address group ("239.1.1.1");
+  uint32_t h = PortlandSwitchNetDevice::HashGroup (group);
+  uint32_t j = h % 2;
+  uint32_t c = (h / 2) % 2;
+
+  Ptr<Socket> sink = Socket::CreateSocket (fatTree.GetHost (2, 1, 1), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&PortlandMulticastFailureTestCase::Receive, this));
+  Simulator::Schedule (MilliSeconds (10), &PortlandFatTreeHelper::JoinGroup, fatTree.GetHost (0, 0, 0), group);
+  Simulator::Schedule (MilliSeconds (10), &PortlandFatTreeHelper::JoinGroup, fatTree.GetHost (2, 1, 1), group);
+  // the sender's aggregation switch of the tree loses its link to the root
+  Simulator::Schedule (MilliSeconds (50), &PortlandFatTreeHelper::FailLink, fatTree.GetAggregationSwitch (0, j),
+                       fatTree.GetCoreSwitch (j, c));
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Simulator::Schedule (MilliSeconds (200) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (0, 0, 0), group);
+    }
+  Simulator::Stop (MilliSeconds (400));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNLinkFaults (), 1U, "Failed link not reported");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetCoreSwitch (j, c)->GetNMulticastFrames (), 0U, "Tree still rooted behind the failed link");
+  NS_TEST_ASSERT_MSG_EQ (m_received, 10U, "Datagrams lost on the failed link");
+
+  Simulator::Destroy ();
+}
+
+// Checks the per-port counters on all three layers against each other, and the samples written by the port
+// stats sampler against the counters.
+class PortlandPortStatsTestCase : public TestCase
+{
+public:
+  PortlandPortStatsTestCase ();
+  virtual ~PortlandPortStatsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandPortStatsTestCase::PortlandPortStatsTestCase ()
+  : TestCase ("Portland per-port counters and stats sampler")
+{
+}
+
+PortlandPortStatsTestCase::~PortlandPortStatsTestCase ()
+{
+}
+
+template <typename T>
+static T
+ReadValue (std::ifstream& file)
+{
+  T value = T ();
+  file.read (reinterpret_cast<char*> (&value), sizeof (value));
+  return value;
+}
+
+void
+PortlandPortStatsTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+  std::string file_name = CreateTempDirFilename ("portland-port-stats.bin");
+  Ptr<pld::PortStatsSampler> sampler = fatTree.EnablePortStats (file_name, MilliSeconds (1));
+
+  Simulator::Schedule (Seconds (0), &PortlandFatTreeHelper::AnnounceHost, fatTree.GetHost (3, 1, 1));
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10) + MicroSeconds (100 * i), &SendDatagram, fatTree.GetHost (0, 0, 0),
+                           fatTree.GetHostAddress (3, 1, 1));
+    }
+  Simulator::Stop (MilliSeconds (30));
+  Simulator::Run ();
+  sampler->Stop ();
+
+  // every frame sent up a link is received on a lower port of the switch above, and the other way round
+  std::vector<Ptr<PortlandSwitchNetDevice> > switches;
+  for (uint32_t pod = 0; pod < 4; pod++)
+    {
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          switches.push_back (fatTree.GetEdgeSwitch (pod, i));
+        }
+    }
+  for (uint32_t pod = 0; pod < 4; pod++)
+    {
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          switches.push_back (fatTree.GetAggregationSwitch (pod, i));
+        }
+    }
+  for (uint32_t group = 0; group < 2; group++)
+    {
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          switches.push_back (fatTree.GetCoreSwitch (group, i));
+        }
+    }
+  uint64_t up_tx = 0, up_rx = 0, down_tx = 0, down_rx = 0;
+  uint32_t n_ports = 0;
+  for (uint32_t s = 0; s < switches.size (); s++)
+    {
+      uint32_t n_lower = switches[s]->GetNSwitchPorts () - switches[s]->GetNUpperPorts ();
+      for (uint32_t n = 0; n < switches[s]->GetNSwitchPorts (); n++, n_ports++)
+        {
+          const pld::Port& p = switches[s]->GetSwitchPort (n);
+          NS_TEST_ASSERT_MSG_EQ (switches[s]->GetSwitchPortIndex (p), (int) n, "Port index does not match its port");
+          if (n >= n_lower)
+            {
+              up_tx += p.tx_packets;
+              down_rx += p.rx_packets;
+            }
+          else if (switches[s]->GetDeviceType () != EDGE)
+            {
+              up_rx += p.rx_packets;
+              down_tx += p.tx_packets;
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (up_tx, up_rx, "Frames sent up and received from below differ");
+  NS_TEST_ASSERT_MSG_EQ (down_tx, down_rx, "Frames sent down and received from above differ");
+  NS_TEST_ASSERT_MSG_GT (up_tx, 100U, "Upstream frames not counted");
+  const pld::Port& host_port = fatTree.GetEdgeSwitch (3, 1)->GetSwitchPort (1);
+  NS_TEST_ASSERT_MSG_GT (host_port.tx_packets, 99U, "Frames to the receiver not counted");
+  NS_TEST_ASSERT_MSG_GT (host_port.tx_bytes, 100U * (100 + 28) - 1, "Bytes to the receiver not counted");
+
+  // the deltas in the file add up to the counters
+  std::ifstream file (file_name.c_str (), std::ios::binary);
+  char magic[8];
+  file.read (magic, 8);
+  NS_TEST_ASSERT_MSG_EQ (std::string (magic, 8), "PLDSTAT1", "Not a port stats file");
+  NS_TEST_ASSERT_MSG_EQ (ReadValue<uint32_t> (file), n_ports, "Wrong number of ports");
+  uint32_t n_columns = ReadValue<uint32_t> (file);
+  NS_TEST_ASSERT_MSG_EQ (n_columns, (uint32_t) pld::PortStatsSampler::N_COLUMNS, "Wrong number of columns");
+  NS_TEST_ASSERT_MSG_EQ (ReadValue<int64_t> (file), 1000000, "Wrong interval");
+  ReadValue<uint32_t> (file);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) ReadValue<uint8_t> (file), (uint32_t) EDGE, "First port not on an edge switch");
+  file.seekg (12 * n_ports - 5, std::ios::cur);
+
+  std::vector<uint64_t> tx_packets (n_ports, 0);
+  uint64_t samples = 0;
+  int64_t time = 0;
+  while (file.peek () != EOF)
+    {
+      time = ReadValue<int64_t> (file);
+      std::vector<uint32_t> block (n_ports * n_columns);
+      file.read (reinterpret_cast<char*> (&block[0]), block.size () * sizeof (uint32_t));
+      for (uint32_t i = 0; i < n_ports; i++)
+        {
+          tx_packets[i] += block[pld::PortStatsSampler::TX_PACKETS * n_ports + i];
+        }
+      samples++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (samples, sampler->GetNSamples (), "Samples missing from the file");
+  NS_TEST_ASSERT_MSG_EQ (samples, 30U, "Wrong number of samples");
+  NS_TEST_ASSERT_MSG_EQ (time, MilliSeconds (30).GetNanoSeconds (), "Last sample not at the end of the run");
+  uint32_t i = 0;
+  for (uint32_t s = 0; s < switches.size (); s++)
+    {
+      for (uint32_t n = 0; n < switches[s]->GetNSwitchPorts (); n++, i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (tx_packets[i], switches[s]->GetSwitchPort (n).tx_packets, "Samples do not add up");
+        }
+    }
+
+  Simulator::Destroy ();
+}
+
+// Checks the control plane event trace: the events a cold lookup, a known destination and an unknown one give,
+// the ring buffer, and the file written when the simulation is destroyed.
+class PortlandEventTraceTestCase : public TestCase
+{
+public:
+  PortlandEventTraceTestCase ();
+  virtual ~PortlandEventTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandEventTraceTestCase::PortlandEventTraceTestCase ()
+  : TestCase ("Portland control plane event trace")
+{
+}
+
+PortlandEventTraceTestCase::~PortlandEventTraceTestCase ()
+{
+}
+
+void
+PortlandEventTraceTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+  std::string file_name = CreateTempDirFilename ("portland-events.bin");
+  std::ostringstream summary;
+  pld::EventTrace::Enable (8, file_name, &summary);
+
+  // (3,1,1) is known to the Fabric Manager, (2,0,0) is not
+  Simulator::Schedule (Seconds (0), &PortlandFatTreeHelper::AnnounceHost, fatTree.GetHost (3, 1, 1));
+  Simulator::Schedule (MilliSeconds (10), &SendDatagram, fatTree.GetHost (0, 0, 0), fatTree.GetHostAddress (3, 1, 1));
+  Simulator::Schedule (MilliSeconds (20), &SendDatagram, fatTree.GetHost (0, 0, 0), fatTree.GetHostAddress (3, 1, 1));
+  Simulator::Schedule (MilliSeconds (30), &SendDatagram, fatTree.GetHost (0, 0, 0), fatTree.GetHostAddress (2, 0, 0));
+  Simulator::Stop (MilliSeconds (50));
+  Simulator::Run ();
+
+  using pld::EventTrace;
+  if (!EventTrace::IsBuilt ())
+    {
+      // configured with --disable-portland-event-trace: PLD_TRACE_EVENT compiles to nothing
+      NS_TEST_ASSERT_MSG_EQ (EventTrace::GetNEvents (EventTrace::REGISTER), 0U, "Events recorded by a disabled trace");
+      Simulator::Destroy ();
+      return;
+    }
+  NS_TEST_ASSERT_MSG_EQ (EventTrace::GetNEvents (EventTrace::QUERY),
+                         EventTrace::GetNEvents (EventTrace::HIT) + EventTrace::GetNEvents (EventTrace::MISS),
+                         "A query neither hit nor missed");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::REGISTER), 2U, "Hosts not registered");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::HIT), 0U, "Query for a known host missed");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::MISS), 0U, "Query for an unknown host hit");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::FLOOD), 0U, "Miss not flooded");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::CACHE_MISS), 0U, "Cache misses not recorded");
+  NS_TEST_ASSERT_MSG_GT (EventTrace::GetNEvents (EventTrace::CACHE_HIT) + EventTrace::GetNEvents (EventTrace::LOCAL_HIT),
+                         0U, "Second datagram to a known host not served by the switch");
+  // the datagram held while the unknown host is flooded for is dropped
+  NS_TEST_ASSERT_MSG_EQ (EventTrace::GetNEvents (EventTrace::DROP), EventTrace::GetNEvents (EventTrace::MISS),
+                         "Frames dropped");
+
+  // the buffer keeps the last 8 events, oldest first
+  NS_TEST_ASSERT_MSG_EQ (EventTrace::GetNBuffered (), 8U, "Ring buffer not full");
+  for (uint32_t n = 1; n < EventTrace::GetNBuffered (); n++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((EventTrace::GetEvent (n).time >= EventTrace::GetEvent (n - 1).time), true,
+                             "Buffered events out of order");
+    }
+  EventTrace::Event last = EventTrace::GetEvent (7);
+  NS_TEST_ASSERT_MSG_GT (last.time, MilliSeconds (30).GetNanoSeconds () - 1, "Last event not buffered");
+
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (EventTrace::IsEnabled (), false, "Trace still enabled after the simulation");
+  NS_TEST_ASSERT_MSG_EQ ((summary.str ().find ("PortLand control plane events") != std::string::npos), true,
+                         "Summary not printed to the given stream");
+
+  std::ifstream file (file_name.c_str (), std::ios::binary);
+  char magic[8];
+  file.read (magic, 8);
+  NS_TEST_ASSERT_MSG_EQ (std::string (magic, 8), "PLDTRACE", "Not an event trace file");
+  NS_TEST_ASSERT_MSG_EQ (ReadValue<uint32_t> (file), sizeof (EventTrace::Event), "Wrong record size");
+  NS_TEST_ASSERT_MSG_EQ (ReadValue<uint32_t> (file), 8U, "Wrong number of records");
+  file.seekg (7 * sizeof (EventTrace::Event), std::ios::cur);
+  EventTrace::Event event = ReadValue<EventTrace::Event> (file);
+  NS_TEST_ASSERT_MSG_EQ (event.time, last.time, "Last record differs from the last buffered event");
+  NS_TEST_ASSERT_MSG_EQ (event.node, last.node, "Last record differs from the last buffered event");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) event.type, (uint32_t) last.type, "Last record differs from the last buffered event");
+  file.get ();
+  NS_TEST_ASSERT_MSG_EQ (file.eof (), true, "Trailing bytes in the event trace file");
+}
+
+// Checks that a fabric pre-warmed from a snapshot of an earlier run gives its hosts the same PMACs and carries
+// traffic without ARP floods or host registrations.
+class PortlandPrewarmTestCase : public TestCase
+{
+public:
+  PortlandPrewarmTestCase ();
+  virtual ~PortlandPrewarmTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+PortlandPrewarmTestCase::PortlandPrewarmTestCase ()
+  : TestCase ("Portland pre-warmed PMAC and ARP state"),
+    m_received (0)
+{
+}
+
+PortlandPrewarmTestCase::~PortlandPrewarmTestCase ()
+{
+}
+
+void
+PortlandPrewarmTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandPrewarmTestCase::DoRun (void)
+{
+  std::string snapshot = CreateTempDirFilename ("portland-snapshot.txt");
+  std::vector<Mac48Address> pmacs;
+
+  // a cold run, in which the hosts announce themselves in reverse order
+  {
+    Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+    PortlandFatTreeHelper fatTree (4);
+    fatTree.Install (fm);
+    NodeContainer hosts = fatTree.GetHosts ();
+    for (uint32_t h = 0; h < hosts.GetN (); h++)
+      {
+        Simulator::Schedule (MicroSeconds (10 * (hosts.GetN () - h)), &PortlandFatTreeHelper::AnnounceHost, hosts.Get (h));
+      }
+    Simulator::Stop (MilliSeconds (10));
+    Simulator::Run ();
+    for (uint32_t h = 0; h < hosts.GetN (); h++)
+      {
+        pmacs.push_back (fatTree.GetEdgeSwitch (h / 4, h / 2 % 2)->GetHostPMAC (fatTree.GetHostAddress (h / 4, h / 2 % 2, h % 2)));
+      }
+    NS_TEST_ASSERT_MSG_EQ (fm->GetNHosts (), 16U, "Cold run did not register every host");
+    NS_TEST_ASSERT_MSG_EQ (fatTree.SaveSnapshot (snapshot), true, "Snapshot not written");
+    Simulator::Destroy ();
+  }
+
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+
+  // a snapshot putting a host on another edge switch is refused as a whole
+  std::string wrong = CreateTempDirFilename ("portland-snapshot-wrong.txt");
+  {
+    std::ofstream file (wrong.c_str ());
+    file << fatTree.GetHostAddress (0, 0, 1) << " " << pmacs[1] << std::endl;
+    file << fatTree.GetHostAddress (0, 0, 0) << " " << pld::PMAC::Encode (1, 0, 0, 1) << std::endl;
+  }
+  NS_TEST_ASSERT_MSG_EQ (fatTree.Prewarm (wrong), false, "Snapshot of another tree accepted");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetEdgeSwitch (0, 0)->GetNHosts (), 0U, "Refused snapshot partly loaded");
+
+  NS_TEST_ASSERT_MSG_EQ (fatTree.Prewarm (snapshot), true, "Snapshot refused");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNHosts (), 16U, "Fabric Manager not pre-warmed");
+  NodeContainer hosts = fatTree.GetHosts ();
+  for (uint32_t h = 0; h < hosts.GetN (); h++)
+    {
+      Mac48Address pmac = fatTree.GetEdgeSwitch (h / 4, h / 2 % 2)->GetHostPMAC (fatTree.GetHostAddress (h / 4, h / 2 % 2, h % 2));
+      NS_TEST_ASSERT_MSG_EQ (pmac, pmacs[h], "PMAC not restored from the snapshot");
+
+      Ptr<Socket> sink = Socket::CreateSocket (hosts.Get (h), UdpSocketFactory::GetTypeId ());
+      sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      sink->SetRecvCallback (MakeCallback (&PortlandPrewarmTestCase::Receive, this));
+      // every host sends to a host of the next pod
+      uint32_t dst = (h + 4) % hosts.GetN ();
+      Simulator::Schedule (MicroSeconds (10 * h), &SendDatagram, hosts.Get (h),
+                           fatTree.GetHostAddress (dst / 4, dst / 2 % 2, dst % 2));
+    }
+  Simulator::Stop (MilliSeconds (10));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received, 16U, "Datagrams lost");
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNFloods (), 0U, "ARP Request flooded");
+  // the hosts send nothing but their datagram, and the Fabric Manager only answers the edge switches' PMAC
+  // cache misses
+  uint64_t misses = 0;
+  for (uint32_t pod = 0; pod < 4; pod++)
+    {
+      for (uint32_t e = 0; e < 2; e++)
+        {
+          Ptr<PortlandSwitchNetDevice> edge = fatTree.GetEdgeSwitch (pod, e);
+          misses += edge->GetNPMACCacheMisses ();
+          NS_TEST_ASSERT_MSG_EQ (edge->GetNFloodFrames (), 0U, "ARP Request flooded");
+          NS_TEST_ASSERT_MSG_EQ (edge->GetSwitchPort (0).rx_packets, 1U, "Host sent an ARP Request");
+          NS_TEST_ASSERT_MSG_EQ (edge->GetSwitchPort (1).rx_packets, 1U, "Host sent an ARP Request");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (fm->GetNRequests (), misses, "Hosts registered or ARP sent despite pre-warming");
+  NS_TEST_ASSERT_MSG_EQ (misses, 16U, "Wrong number of PMAC lookups");
+
+  Simulator::Destroy ();
+}
+
+// Checks the dynamic threshold admission, strict priorities and ECN marking of egress queues sharing a buffer,
+// and that a fat tree built with shared buffers gives all ports of a switch queues in one buffer.
+class PortlandSharedBufferTestCase : public TestCase
+{
+public:
+  PortlandSharedBufferTestCase ();
+  virtual ~PortlandSharedBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandSharedBufferTestCase::PortlandSharedBufferTestCase ()
+  : TestCase ("Portland shared buffer egress queues")
+{
+}
+
+PortlandSharedBufferTestCase::~PortlandSharedBufferTestCase ()
+{
+}
+
+/*
+ * An Ethernet frame as a CsmaNetDevice queues it, of 1038 bytes for IPv4 and 78 bytes otherwise, with checksums
+ * when they are enabled.
+ */
+static Ptr<Packet>
+MakeFrame (uint16_t type, uint8_t tos, Ipv4Header::EcnType ecn)
+{
+  Ptr<Packet> p;
+  if (type == Ipv4L3Protocol::PROT_NUMBER)
+    {
+      p = Create<Packet> (1000);
+      Ipv4Header ip;
+      ip.SetTos (tos);
+      ip.SetEcn (ecn);
+      ip.SetPayloadSize (1000);
+      if (Node::ChecksumEnabled ())
+        {
+          ip.EnableChecksum ();
+        }
+      p->AddHeader (ip);
+    }
+  else
+    {
+      p = Create<Packet> (60);
+    }
+  EthernetHeader eth (false);
+  eth.SetLengthType (type);
+  p->AddHeader (eth);
+  EthernetTrailer trailer;
+  trailer.EnableFcs (Node::ChecksumEnabled ());
+  trailer.CalcFcs (p);
+  p->AddTrailer (trailer);
+  return p;
+}
+
+/*
+ * \return Whether the FCS and the IPv4 checksum of a frame are right, as a receiving CsmaNetDevice and IPv4 check them.
+ */
+static bool
+IsFrameChecksumOk (Ptr<Packet> p)
+{
+  Ptr<Packet> copy = p->Copy ();
+  EthernetTrailer trailer;
+  copy->RemoveTrailer (trailer);
+  trailer.EnableFcs (true);
+  if (!trailer.CheckFcs (copy))
+    {
+      return false;
+    }
+  EthernetHeader eth (false);
+  copy->RemoveHeader (eth);
+  Ipv4Header ip;
+  ip.EnableChecksum ();
+  copy->RemoveHeader (ip);
+  return ip.IsChecksumOk ();
+}
+
+/*
+ * \return The TOS byte of an IPv4 frame.
+ */
+static uint8_t
+GetFrameTos (Ptr<Packet> p)
+{
+  Ptr<Packet> copy = p->Copy ();
+  EthernetHeader eth (false);
+  copy->RemoveHeader (eth);
+  Ipv4Header ip;
+  copy->RemoveHeader (ip);
+  return ip.GetTos ();
+}
+
+void
+PortlandSharedBufferTestCase::DoRun (void)
+{
+  Ptr<pld::SharedBuffer> buffer = CreateObject<pld::SharedBuffer> ();
+  buffer->SetAttribute ("Size", UintegerValue (10000));
+  buffer->SetAttribute ("Alpha", DoubleValue (1.0));
+  buffer->SetAttribute ("EcnThreshold", UintegerValue (3000));
+  buffer->SetAttribute ("Priorities", UintegerValue (2));
+  Ptr<pld::SharedBufferQueue> a = CreateObject<pld::SharedBufferQueue> ();
+  Ptr<pld::SharedBufferQueue> b = CreateObject<pld::SharedBufferQueue> ();
+  a->SetBuffer (buffer);
+  b->SetBuffer (buffer);
+
+  // a queue may grow to the free memory: 5 frames of 1038 bytes, with 4810 bytes still free, and no more
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (a->Enqueue (MakeFrame (0x0800, 0, Ipv4Header::ECT0)), true, "Frame refused");
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetNMarks (), 0U, "Frame marked below the threshold");
+  NS_TEST_ASSERT_MSG_EQ (a->Enqueue (MakeFrame (0x0800, 0, Ipv4Header::NotECT)), true, "Frame refused");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetNMarks (), 0U, "Frame not ECN-capable marked");
+  NS_TEST_ASSERT_MSG_EQ (a->Enqueue (MakeFrame (0x0800, 0, Ipv4Header::ECT0)), true, "Frame refused");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetNMarks (), 1U, "Frame not marked above the threshold");
+  NS_TEST_ASSERT_MSG_EQ (a->Enqueue (MakeFrame (0x0800, 0, Ipv4Header::ECT0)), false, "Queue over its threshold");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetNMarks (), 1U, "Dropped frame marked");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetNDrops (), 1U, "Drop not counted");
+  NS_TEST_ASSERT_MSG_EQ (a->GetNBytes (1), 5190U, "Precedence 0 not in the lowest priority");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetOccupancy (), 5190U, "Wrong buffer occupancy");
+
+  // the other queue gets its own share of what is left, each priority on its own
+  NS_TEST_ASSERT_MSG_EQ (b->Enqueue (MakeFrame (0x0800, 0, Ipv4Header::NotECT)), true, "Frame refused");
+  NS_TEST_ASSERT_MSG_EQ (b->Enqueue (MakeFrame (0x0806, 0, Ipv4Header::NotECT)), true, "Frame refused");
+  NS_TEST_ASSERT_MSG_EQ (b->Enqueue (MakeFrame (0x0800, 0xe0, Ipv4Header::NotECT)), true, "Frame refused");
+  NS_TEST_ASSERT_MSG_EQ (b->GetNBytes (0), 1116U, "Frame not IPv4 or of high precedence not in the highest priority");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetOccupancy (), 7344U, "Wrong buffer occupancy");
+
+  // strict priority, FIFO within a priority
+  Ptr<Packet> p = b->Dequeue ();
+  EthernetHeader eth (false);
+  p->PeekHeader (eth);
+  NS_TEST_ASSERT_MSG_EQ (eth.GetLengthType (), 0x0806, "Highest priority not served first");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) GetFrameTos (b->Dequeue ()), 0xe0U, "Highest priority not served first");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) GetFrameTos (b->Dequeue ()), 0U, "Lowest priority not served last");
+  NS_TEST_ASSERT_MSG_EQ (b->IsEmpty (), true, "Queue not emptied");
+
+  uint32_t ecn[] = { Ipv4Header::ECT0, Ipv4Header::ECT0, Ipv4Header::ECT0, Ipv4Header::NotECT, Ipv4Header::CE };
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) (GetFrameTos (a->Dequeue ()) & 3), ecn[i], "Wrong ECN field");
+    }
+  NS_TEST_ASSERT_MSG_EQ (a->GetNMarks (), 1U, "Marks not counted per queue");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetOccupancy (), 0U, "Buffer not released");
+  NS_TEST_ASSERT_MSG_EQ (buffer->GetMaxOccupancy (), 7344U, "Wrong maximum occupancy");
+
+  // with checksums enabled, frames left alone keep their bytes and marked frames get new checksums
+  GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Ptr<Packet> frame = MakeFrame (0x0800, i == 1 ? 0xe0 : 0, Ipv4Header::ECT0);
+      uint32_t size = frame->GetSize ();
+      std::vector<uint8_t> before (size);
+      frame->CopyData (&before[0], size);
+      NS_TEST_ASSERT_MSG_EQ (a->Enqueue (frame), true, "Frame refused");
+      std::vector<uint8_t> after (size);
+      frame->CopyData (&after[0], size);
+      NS_TEST_ASSERT_MSG_EQ ((after == before), (i < 4), "Frame rewritten or left unmarked");
+      NS_TEST_ASSERT_MSG_EQ (IsFrameChecksumOk (frame), true, "Checksums of a queued frame wrong");
+    }
+  NS_TEST_ASSERT_MSG_EQ (a->GetNMarks (), 2U, "Frame not marked above the threshold");
+  while (!a->IsEmpty ())
+    {
+      a->Dequeue ();
+    }
+  GlobalValue::Bind ("ChecksumEnabled", BooleanValue (false));
+
+  // every port of a switch of the fat tree queues in the buffer of the switch
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetSharedBuffers (true);
+  fatTree.SetSharedBufferAttribute ("Size", UintegerValue (20000));
+  fatTree.Install (fm);
+  Ptr<PortlandSwitchNetDevice> swtch = fatTree.GetAggregationSwitch (1, 1);
+  Ptr<pld::SharedBuffer> shared;
+  for (uint32_t n = 0; n < swtch->GetNSwitchPorts (); n++)
+    {
+      Ptr<pld::SharedBufferQueue> queue = DynamicCast<pld::SharedBufferQueue> (swtch->GetSwitchPort (n).queue);
+      NS_TEST_ASSERT_MSG_NE (queue, 0, "Switch port without a shared buffer queue");
+      shared = (n == 0 ? queue->GetBuffer () : shared);
+      NS_TEST_ASSERT_MSG_EQ (queue->GetBuffer (), shared, "Ports of a switch in different buffers");
+    }
+  NS_TEST_ASSERT_MSG_EQ (shared->GetSize (), 20000U, "Buffer attribute not set");
+  Ptr<pld::SharedBufferQueue> other = DynamicCast<pld::SharedBufferQueue> (fatTree.GetAggregationSwitch (1, 0)->GetSwitchPort (0).queue);
+  NS_TEST_ASSERT_MSG_NE (other->GetBuffer (), shared, "Switches sharing a buffer");
+  Ptr<CsmaNetDevice> nic = DynamicCast<CsmaNetDevice> (fatTree.GetHost (0, 0, 0)->GetDevice (0));
+  NS_TEST_ASSERT_MSG_EQ (DynamicCast<pld::SharedBufferQueue> (nic->GetQueue ()), 0, "Host NIC given a shared buffer queue");
+  Simulator::Destroy ();
+}
+
+// Checks the shape, switch coordinates and host addresses of a fat tree built by PortlandFatTreeHelper.
+class PortlandFatTreeHelperTestCase : public TestCase
+{
+public:
+  PortlandFatTreeHelperTestCase ();
+  virtual ~PortlandFatTreeHelperTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PortlandFatTreeHelperTestCase::PortlandFatTreeHelperTestCase ()
+  : TestCase ("Portland fat tree helper topology")
+{
+}
+
+PortlandFatTreeHelperTestCase::~PortlandFatTreeHelperTestCase ()
+{
+}
+
+void
+PortlandFatTreeHelperTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.Install (fm);
+
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetNHosts (), 16U, "Wrong number of hosts");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetHostAddress (0, 0, 0), Ipv4Address ("10.1.0.1"), "Wrong first address");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetHostAddress (3, 1, 1), Ipv4Address ("10.1.0.16"), "Wrong last address");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetHost (1, 0, 1)->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal (),
+                         fatTree.GetHostAddress (1, 0, 1), "Host and address out of step");
+
+  Ptr<PortlandSwitchNetDevice> edge = fatTree.GetEdgeSwitch (2, 1);
+  NS_TEST_ASSERT_MSG_EQ (edge->GetDeviceType (), EDGE, "Wrong switch type");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) edge->GetPod (), 2U, "Wrong pod");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) edge->GetPosition (), 1U, "Wrong position");
+  NS_TEST_ASSERT_MSG_EQ (edge->GetNSwitchPorts (), 4U, "Wrong number of edge ports");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetAggregationSwitch (3, 0)->GetDeviceType (), AGGREGATION, "Wrong switch type");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetAggregationSwitch (3, 0)->GetNSwitchPorts (), 4U, "Wrong number of aggregation ports");
+  Ptr<PortlandSwitchNetDevice> core = fatTree.GetCoreSwitch (1, 0);
+  NS_TEST_ASSERT_MSG_EQ (core->GetDeviceType (), CORE, "Wrong switch type");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) core->GetPod (), 1U, "Wrong core group");
+  NS_TEST_ASSERT_MSG_EQ (core->GetNSwitchPorts (), 4U, "Core does not reach every pod");
+
+  Simulator::Destroy ();
+}
+
+// Checks how the fat tree helper splits a tree over system ids, and that frames cross them on full-duplex links.
+class PortlandPartitionTestCase : public TestCase
+{
+public:
+  PortlandPartitionTestCase ();
+  virtual ~PortlandPartitionTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+PortlandPartitionTestCase::PortlandPartitionTestCase ()
+  : TestCase ("Portland fat tree partition"),
+    m_received (0)
+{
+}
+
+PortlandPartitionTestCase::~PortlandPartitionTestCase ()
+{
+}
+
+void
+PortlandPartitionTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+PortlandPartitionTestCase::DoRun (void)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (4);
+  fatTree.SetSystemCount (3);
+  fatTree.SetChannelAttribute ("Delay", TimeValue (MicroSeconds (1)));
+
+  // pods in contiguous blocks; the cores go to the lighter system ids
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetPodSystemId (1), 0U, "Pods not in contiguous blocks");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetPodSystemId (2), 1U, "Pods not in contiguous blocks");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetPodSystemId (3), 2U, "Pods not in contiguous blocks");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetCoreSystemId (0, 0), 1U, "Core not given to the lightest system id");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetCoreSystemId (0, 1), 2U, "Core not given to the lightest system id");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetCoreSystemId (1, 0), 1U, "Core not given to the lightest system id");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetNCutLinks (), 12U, "Wrong number of cut links");
+
+  fatTree.Install (fm);
+  fatTree.Prewarm ();
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetHost (3, 1, 1)->GetSystemId (), 2U, "Host not in the system id of its pod");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetEdgeSwitch (2, 0)->GetNode ()->GetSystemId (), 1U, "Switch not in the system id of its pod");
+  NS_TEST_ASSERT_MSG_EQ (fatTree.GetCoreSwitch (0, 1)->GetNode ()->GetSystemId (), 2U, "Core not in its system id");
+
+  // two hosts of different system ids send to each other at the same time, many times over
+  Ptr<Node> a = fatTree.GetHost (0, 0, 0);
+  Ptr<Node> b = fatTree.GetHost (3, 1, 1);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<Socket> sink = Socket::CreateSocket (i == 0 ? a : b, UdpSocketFactory::GetTypeId ());
+      sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      sink->SetRecvCallback (MakeCallback (&PortlandPartitionTestCase::Receive, this));
+    }
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Simulator::Schedule (MicroSeconds (100 * (i + 1)), &SendDatagram, a, fatTree.GetHostAddress (3, 1, 1));
+      Simulator::Schedule (MicroSeconds (100 * (i + 1)), &SendDatagram, b, fatTree.GetHostAddress (0, 0, 0));
+    }
+  Simulator::Stop (MilliSeconds (10));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received, 20U, "Datagrams lost between system ids");
+
+  Simulator::Destroy ();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -60,6 +1941,27 @@ PortlandTestSuite::PortlandTestSuite ()
   : TestSuite ("portland", UNIT)
 {
   AddTestCase (new PortlandTestCase1);
+  AddTestCase (new PortlandPMACTableTestCase);
+  AddTestCase (new PortlandPMACCodecTestCase);
+  AddTestCase (new PortlandPMACCacheTestCase);
+  AddTestCase (new PortlandIpPMACStoreTestCase);
+  AddTestCase (new PortlandControlChannelTestCase);
+  AddTestCase (new PortlandFabricManagerClusterTestCase);
+  AddTestCase (new PortlandFloodModeTestCase);
+  AddTestCase (new PortlandVmidTestCase);
+  AddTestCase (new PortlandMigrationTestCase);
+  AddTestCase (new PortlandLocationDiscoveryTestCase);
+  AddTestCase (new PortlandRediscoveryTestCase);
+  AddTestCase (new PortlandLinkFailureTestCase);
+  AddTestCase (new PortlandFloodFailureTestCase);
+  AddTestCase (new PortlandMulticastTestCase);
+  AddTestCase (new PortlandMulticastFailureTestCase);
+  AddTestCase (new PortlandPortStatsTestCase);
+  AddTestCase (new PortlandEventTraceTestCase);
+  AddTestCase (new PortlandPrewarmTestCase);
+  AddTestCase (new PortlandSharedBufferTestCase);
+  AddTestCase (new PortlandFatTreeHelperTestCase);
+  AddTestCase (new PortlandPartitionTestCase);
 }
 
 // Do not forget to allocate an instance of this TestSuite
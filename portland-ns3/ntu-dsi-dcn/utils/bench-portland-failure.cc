@@ -0,0 +1,263 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Fault-injection benchmark of PortLand's failure recovery, after the
+// failure experiment of the PortLand paper: every host of the first pod
+// streams UDP to a host of the last pod, and links of those two pods fail
+// while the streams run. The switches find the failed links by their
+// missing LDMs and the Fabric Manager has the other switches route around
+// them.
+//
+// Failures are either random links (edge-aggregation and aggregation-core
+// links of the two pods), all failing at the same time, or correlated: all
+// links of an aggregation switch or of a core switch. Reported per
+// scenario: the flows whose packets stopped, the convergence time (the
+// longest gap between packets of a flow across the failure), the packets
+// lost, and the port exclusion updates the Fabric Manager sent.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+static const Time g_interval = MicroSeconds (100);     // between two packets of a flow
+static const Time g_start = MilliSeconds (20);
+static const Time g_failAt = MilliSeconds (100);
+static const Time g_stop = MilliSeconds (300);
+
+struct Flow
+{
+  Ptr<Socket> socket;
+  Ipv4Address dst;
+  uint32_t sent;
+  uint32_t received;
+  Time lastRx;
+  Time maxGap;                  ///< Longest gap between arrivals ending after the failure
+};
+
+static std::vector<Flow> g_flows;
+
+static void
+SendPacket (uint32_t f)
+{
+  Flow& flow = g_flows[f];
+  flow.socket->SendTo (Create<Packet> (1024), 0, InetSocketAddress (flow.dst, 9));
+  flow.sent++;
+  if (Simulator::Now () + g_interval < g_stop)
+    {
+      Simulator::Schedule (g_interval, &SendPacket, f);
+    }
+}
+
+static void
+ReceivePacket (uint32_t f, Ptr<Socket> socket)
+{
+  Flow& flow = g_flows[f];
+  while (socket->Recv ())
+    {
+      Time now = Simulator::Now ();
+      if (now > g_failAt && flow.received > 0 && now - flow.lastRx > flow.maxGap)
+        {
+          flow.maxGap = now - flow.lastRx;
+        }
+      flow.received++;
+      flow.lastRx = now;
+    }
+}
+
+typedef std::pair<Ptr<PortlandSwitchNetDevice>, Ptr<PortlandSwitchNetDevice> > Link;
+
+static void
+FailLinks (std::vector<Link> links)
+{
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      PortlandFatTreeHelper::FailLink (links[i].first, links[i].second);
+    }
+}
+
+/*
+ * The links of a scenario: n random links of the first and last pods, or, for n = 0, all links of an
+ * aggregation switch of the first pod, or, for n = -1, all links of a core switch.
+ */
+static std::vector<Link>
+PickLinks (const PortlandFatTreeHelper& fatTree, int n)
+{
+  uint32_t k = fatTree.GetK ();
+  uint32_t half = k / 2;
+  std::vector<Link> candidates, links;
+  if (n == 0)
+    {
+      for (uint32_t i = 0; i < half; i++)
+        {
+          links.push_back (Link (fatTree.GetEdgeSwitch (0, i), fatTree.GetAggregationSwitch (0, 0)));
+          links.push_back (Link (fatTree.GetAggregationSwitch (0, 0), fatTree.GetCoreSwitch (0, i)));
+        }
+      return links;
+    }
+  if (n < 0)
+    {
+      for (uint32_t pod = 0; pod < k; pod++)
+        {
+          links.push_back (Link (fatTree.GetAggregationSwitch (pod, 0), fatTree.GetCoreSwitch (0, 0)));
+        }
+      return links;
+    }
+
+  uint32_t pods[2] = { 0, k - 1 };
+  for (uint32_t p = 0; p < 2; p++)
+    {
+      for (uint32_t i = 0; i < half; i++)
+        {
+          for (uint32_t j = 0; j < half; j++)
+            {
+              candidates.push_back (Link (fatTree.GetEdgeSwitch (pods[p], i), fatTree.GetAggregationSwitch (pods[p], j)));
+              candidates.push_back (Link (fatTree.GetAggregationSwitch (pods[p], i), fatTree.GetCoreSwitch (i, j)));
+            }
+        }
+    }
+  for (int i = 0; i < n && !candidates.empty (); i++)
+    {
+      uint32_t c = rand () % candidates.size ();
+      links.push_back (candidates[c]);
+      candidates.erase (candidates.begin () + c);
+    }
+  return links;
+}
+
+static void
+runBench (uint32_t k, int n)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetLinkMonitoring (true);
+  fatTree.Install (fm);
+
+  uint32_t half = k / 2;
+  g_flows.clear ();
+  for (uint32_t e = 0; e < half; e++)
+    {
+      for (uint32_t h = 0; h < half; h++)
+        {
+          Flow flow;
+          flow.socket = Socket::CreateSocket (fatTree.GetHost (0, e, h), UdpSocketFactory::GetTypeId ());
+          flow.dst = fatTree.GetHostAddress (k - 1, e, h);
+          flow.sent = 0;
+          flow.received = 0;
+          flow.lastRx = Seconds (0);
+          flow.maxGap = Seconds (0);
+          g_flows.push_back (flow);
+
+          Ptr<Node> dst = fatTree.GetHost (k - 1, e, h);
+          Ptr<Socket> sink = Socket::CreateSocket (dst, UdpSocketFactory::GetTypeId ());
+          sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+          sink->SetRecvCallback (MakeBoundCallback (&ReceivePacket, (uint32_t) g_flows.size () - 1));
+          Simulator::Schedule (Seconds (0), &PortlandFatTreeHelper::AnnounceHost, dst);
+          Simulator::Schedule (g_start + MicroSeconds (g_flows.size ()), &SendPacket, (uint32_t) g_flows.size () - 1);
+        }
+    }
+
+  std::vector<Link> links = PickLinks (fatTree, n);
+  Simulator::Schedule (g_failAt, &FailLinks, links);
+
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Stop (g_stop + MilliSeconds (10));
+  Simulator::Run ();
+  uint64_t deltaMs = time.End ();
+
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  uint32_t affected = 0;
+  Time convergence = Seconds (0);
+  for (uint32_t f = 0; f < g_flows.size (); f++)
+    {
+      sent += g_flows[f].sent;
+      received += g_flows[f].received;
+      // a gap of a few packet intervals is queueing, not a failure
+      if (g_flows[f].maxGap > MicroSeconds (5 * g_interval.GetMicroSeconds ()) || g_flows[f].lastRx < g_failAt)
+        {
+          affected++;
+          Time gap = (g_flows[f].lastRx < g_failAt ? g_stop - g_failAt : g_flows[f].maxGap);
+          convergence = Max (convergence, gap);
+        }
+    }
+
+  std::string scenario;
+  if (n == 0)
+    {
+      scenario = "aggregation";
+    }
+  else if (n < 0)
+    {
+      scenario = "core";
+    }
+  else
+    {
+      std::ostringstream oss;
+      oss << n << " random";
+      scenario = oss.str ();
+    }
+  std::cout << k << "\t" << scenario << "\t" << links.size () << "\t" << affected << "/" << g_flows.size ()
+            << "\t" << convergence.GetMicroSeconds () / 1000.0 << "\t" << sent - received
+            << "\t" << fm->GetNExclusionUpdates () << "\t" << deltaMs << std::endl;
+
+  g_flows.clear ();
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t seed = 1;
+  while (argc > 0) {
+      if (strncmp ("--seed=", argv[0],strlen ("--seed=")) == 0)
+        {
+          char const *seedAscii = argv[0] + strlen ("--seed=");
+          std::istringstream iss;
+          iss.str (seedAscii);
+          iss >> seed;
+        }
+      argc--;
+      argv++;
+  }
+  srand (seed);
+  SeedManager::SetSeed (seed);
+  // the streams outrun address resolution; hold their first packets instead of dropping them
+  Config::SetDefault ("ns3::ArpCache::PendingQueueSize", UintegerValue (1000));
+  std::cout << "Running bench-portland-failure with seed=" << seed << std::endl;
+  std::cout << "k\tfailure\tlinks\taffected-flows\tconvergence-ms\tlost\tFM-updates\twall-ms" << std::endl;
+
+  uint32_t ks[] = { 8, 16 };
+  int scenarios[] = { 1, 2, 4, 8, 0, -1 };
+  for (uint32_t i = 0; i < sizeof (ks) / sizeof (ks[0]); i++)
+    {
+      for (uint32_t s = 0; s < sizeof (scenarios) / sizeof (scenarios[0]); s++)
+        {
+          runBench (ks[i], scenarios[s]);
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Microbenchmark of the Fabric Manager's IP <-> PMAC store as the fat tree
+// grows to k=48 (27,648 hosts).
+//
+// The forward lookup (IP -> PMAC) answers proxy ARP requests and the
+// reverse lookup (PMAC -> IP) is used on registrations; both are compared
+// with a pair of std::maps, which is how the mappings were kept before.
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/portland-ip-pmac-store.h"
+#include "ns3/portland-pmac.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+// approximate per-node overhead of a std::map node (colour, parent, left, right)
+static const uint32_t MAP_NODE_OVERHEAD = 32;
+
+static void
+runBench (uint32_t k, uint32_t n)
+{
+  uint32_t hosts = k * k * k / 4;
+  std::vector<Ipv4Address> ips;
+  std::vector<Mac48Address> pmacs;
+  for (uint32_t pod = 0; pod < k; pod++)
+    {
+      for (uint32_t position = 0; position < k / 2; position++)
+        {
+          for (uint32_t port = 0; port < k / 2; port++)
+            {
+              pmacs.push_back (pld::PMAC::Encode (pod, position, port, 1));
+              ips.push_back (Ipv4Address (0x0a000000 | (pod << 16) | (position << 8) | (port + 2)));
+            }
+        }
+    }
+
+  std::vector<uint32_t> queries (n);
+  srand (1);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      queries[i] = rand () % hosts;
+    }
+
+  pld::IpPMACStore store;
+  SystemWallClockMs time;
+  time.Start ();
+  store.Reserve (hosts);
+  for (uint32_t i = 0; i < hosts; i++)
+    {
+      store.Add (ips[i], pmacs[i]);
+    }
+  uint64_t registerMs = time.End ();
+
+  uint32_t found = 0;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      found += (store.FindPMAC (ips[queries[i]]) == pmacs[queries[i]]);
+    }
+  uint64_t forwardMs = time.End ();
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      found += (store.FindIP (pmacs[queries[i]]) == ips[queries[i]]);
+    }
+  uint64_t reverseMs = time.End ();
+
+  std::map<Ipv4Address, Mac48Address> ipMap;
+  std::map<Mac48Address, Ipv4Address> pmacMap;
+  for (uint32_t i = 0; i < hosts; i++)
+    {
+      ipMap[ips[i]] = pmacs[i];
+      pmacMap[pmacs[i]] = ips[i];
+    }
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      found += (ipMap.find (ips[queries[i]])->second == pmacs[queries[i]]);
+    }
+  uint64_t mapForwardMs = time.End ();
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      found += (pmacMap.find (pmacs[queries[i]])->second == ips[queries[i]]);
+    }
+  uint64_t mapReverseMs = time.End ();
+
+  uint32_t mapBytes = 2 * (MAP_NODE_OVERHEAD + sizeof (Ipv4Address) + sizeof (Mac48Address));
+  std::cout << k << "\t" << hosts << "\t" << registerMs
+            << "\t" << (forwardMs ? n / (forwardMs * 1000.0) : 0)
+            << "\t" << (reverseMs ? n / (reverseMs * 1000.0) : 0)
+            << "\t" << (mapForwardMs ? n / (mapForwardMs * 1000.0) : 0)
+            << "\t" << (mapReverseMs ? n / (mapReverseMs * 1000.0) : 0)
+            << "\t" << (double) store.GetMemoryUsage () / hosts
+            << "\t" << mapBytes;
+  if (found != 4 * n)
+    {
+      std::cout << "\t(lookup errors: " << 4 * n - found << ")";
+    }
+  std::cout << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 4000000;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0],strlen ("--n=")) == 0)
+        {
+          char const *nAscii = argv[0] + strlen ("--n=");
+          std::istringstream iss;
+          iss.str (nAscii);
+          iss >> n;
+        }
+      argc--;
+      argv++;
+  }
+  std::cout << "Running bench-portland-fm with n=" << n << std::endl;
+  std::cout << "k\thosts\tregister-ms\tfwd-Mops/s\trev-Mops/s\tmap-fwd-Mops/s\tmap-rev-Mops/s\tbytes/host\tmap-bytes/host" << std::endl;
+
+  uint32_t ks[] = { 4, 8, 16, 24, 32, 48 };
+  for (uint32_t i = 0; i < sizeof (ks) / sizeof (ks[0]); i++)
+    {
+      runBench (ks[i], n);
+    }
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Benchmark of PortLand switch buffering under incast: the drops, ECN
+// marks and buffer occupancy when many hosts answer one host at once, with
+// a drop-tail queue per switch port against a buffer shared by all ports
+// of a switch.
+//
+// The hosts of a pre-warmed fat tree other than host 0 each send a burst of
+// ECN-capable datagrams to host 0 at the same instant, through raw sockets
+// writing their own IPv4 headers since the sockets of the stack cannot set
+// the ECN field. All bursts meet at the port of host 0's edge switch.
+// Reported per number of senders and buffer mode: the datagrams delivered,
+// those the switch queues refused, those lost in all (queue drops and
+// frames the CSMA devices gave up on after too many backoffs), those
+// delivered marked Congestion Experienced, the largest occupancy of host
+// 0's edge switch buffer (shared modes only) and the time the last datagram
+// arrived after the bursts started. The CSMA backoffs draw from the
+// simulator's random streams, which advance from one run to the next, so
+// the modes do not see exactly the same collisions.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/ipv4-raw-socket-factory.h"
+#include <iostream>
+#include <sstream>
+#include <string.h>
+
+using namespace ns3;
+
+static const uint32_t g_packetSize = 1000;                      // IPv4 payload
+static const uint8_t g_protocol = 253;                          // experimental, RFC 3692
+static const Time g_start = MilliSeconds (10);
+
+static uint32_t g_received;
+static uint32_t g_marked;
+static Time g_lastRx;
+
+static void
+ReceivePacket (Ptr<Socket> socket)
+{
+  Ptr<Packet> p;
+  while ((p = socket->Recv ()))
+    {
+      Ipv4Header ip;
+      p->RemoveHeader (ip);
+      g_received++;
+      g_marked += (ip.GetEcn () == Ipv4Header::CE);
+      g_lastRx = Simulator::Now ();
+    }
+}
+
+static void
+SendBurst (Ptr<Socket> socket, Ipv4Address src, Ipv4Address dst, uint32_t burst)
+{
+  for (uint32_t i = 0; i < burst; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (g_packetSize);
+      Ipv4Header ip;
+      ip.SetSource (src);
+      ip.SetDestination (dst);
+      ip.SetProtocol (g_protocol);
+      ip.SetPayloadSize (g_packetSize);
+      ip.SetTtl (64);
+      ip.SetEcn (Ipv4Header::ECT0);
+      p->AddHeader (ip);
+      socket->SendTo (p, 0, InetSocketAddress (dst, 0));
+    }
+}
+
+struct Result
+{
+  uint64_t drops;               ///< Frames the switch port queues refused
+  uint32_t maxOccupancy;        ///< Of the edge switch of host 0, in bytes
+  Time last;
+};
+
+/*
+ * Runs one incast of n senders; buffer is 0 for drop-tail queues, otherwise the shared buffer size.
+ */
+static Result
+runBench (uint32_t k, uint32_t n, uint32_t burst, uint32_t buffer, uint32_t ecn_threshold)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetChannelAttribute ("DataRate", StringValue ("1Gbps"));
+  if (buffer > 0)
+    {
+      fatTree.SetSharedBuffers (true);
+      fatTree.SetSharedBufferAttribute ("Size", UintegerValue (buffer));
+      fatTree.SetSharedBufferAttribute ("EcnThreshold", UintegerValue (ecn_threshold));
+    }
+  fatTree.Install (fm);
+  fatTree.Prewarm ();
+
+  NodeContainer hosts = fatTree.GetHosts ();
+  Ipv4Address dst = fatTree.GetHostAddress (0, 0, 0);
+  Ptr<Socket> sink = Socket::CreateSocket (hosts.Get (0), Ipv4RawSocketFactory::GetTypeId ());
+  sink->SetAttribute ("Protocol", UintegerValue (g_protocol));
+  sink->SetRecvCallback (MakeCallback (&ReceivePacket));
+  // senders are taken from the last host backwards, so that most are in other pods
+  for (uint32_t s = 0; s < n; s++)
+    {
+      uint32_t h = hosts.GetN () - 1 - s;
+      Ptr<Socket> socket = Socket::CreateSocket (hosts.Get (h), Ipv4RawSocketFactory::GetTypeId ());
+      socket->SetAttribute ("Protocol", UintegerValue (g_protocol));
+      socket->SetAttribute ("IpHeaderInclude", BooleanValue (true));
+      uint32_t half = k / 2;
+      Ipv4Address src = fatTree.GetHostAddress (h / half / half, h / half % half, h % half);
+      Simulator::Schedule (g_start, &SendBurst, socket, src, dst, burst);
+    }
+
+  g_received = 0;
+  g_marked = 0;
+  g_lastRx = g_start;
+  Simulator::Stop (g_start + Seconds (1));
+  Simulator::Run ();
+
+  Result r;
+  r.drops = 0;
+  r.maxOccupancy = 0;
+  r.last = g_lastRx - g_start;
+  for (NodeList::Iterator node = NodeList::Begin (); node != NodeList::End (); node++)
+    {
+      for (uint32_t d = 0; d < (*node)->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> ((*node)->GetDevice (d));
+          if (sw != 0)
+            {
+              for (uint32_t port = 0; port < sw->GetNSwitchPorts (); port++)
+                {
+                  r.drops += sw->GetSwitchPort (port).tx_dropped;
+                }
+            }
+        }
+    }
+  Ptr<pld::SharedBufferQueue> queue = DynamicCast<pld::SharedBufferQueue> (fatTree.GetEdgeSwitch (0, 0)->GetSwitchPort (0).queue);
+  if (queue != 0)
+    {
+      r.maxOccupancy = queue->GetBuffer ()->GetMaxOccupancy ();
+    }
+
+  Simulator::Destroy ();
+  return r;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t k = 8;
+  uint32_t burst = 32;
+  uint32_t buffer = 256 * 1024;
+  uint32_t ecn_threshold = 32 * 1024;
+  while (argc > 0) {
+      if (strncmp ("--k=", argv[0],strlen ("--k=")) == 0)
+        {
+          char const *kAscii = argv[0] + strlen ("--k=");
+          std::istringstream iss;
+          iss.str (kAscii);
+          iss >> k;
+        }
+      if (strncmp ("--burst=", argv[0],strlen ("--burst=")) == 0)
+        {
+          char const *burstAscii = argv[0] + strlen ("--burst=");
+          std::istringstream iss;
+          iss.str (burstAscii);
+          iss >> burst;
+        }
+      if (strncmp ("--buffer=", argv[0],strlen ("--buffer=")) == 0)
+        {
+          char const *bufferAscii = argv[0] + strlen ("--buffer=");
+          std::istringstream iss;
+          iss.str (bufferAscii);
+          iss >> buffer;
+        }
+      if (strncmp ("--ecnThreshold=", argv[0],strlen ("--ecnThreshold=")) == 0)
+        {
+          char const *thresholdAscii = argv[0] + strlen ("--ecnThreshold=");
+          std::istringstream iss;
+          iss.str (thresholdAscii);
+          iss >> ecn_threshold;
+        }
+      argc--;
+      argv++;
+  }
+  std::cout << "Running bench-portland-incast with k=" << k << " (" << k * k * k / 4 << " hosts), bursts of "
+            << burst << " datagrams of " << g_packetSize << " bytes, shared buffers of " << buffer
+            << " bytes marking from " << ecn_threshold << " bytes" << std::endl;
+  std::cout << "senders\tqueues\tsent\tdelivered\tqueue-drops\tlost\tmarked\tmax-occupancy\tlast-rx-ms" << std::endl;
+
+  uint32_t senders[] = { 4, 8, 16, 32, 64, 127 };
+  const char *modes[] = { "drop-tail", "shared", "shared+ECN" };
+  for (uint32_t i = 0; i < sizeof (senders) / sizeof (senders[0]) && senders[i] < k * k * k / 4; i++)
+    {
+      for (uint32_t mode = 0; mode < 3; mode++)
+        {
+          Result r = runBench (k, senders[i], burst, (mode == 0 ? 0 : buffer), (mode == 2 ? ecn_threshold : 0));
+          std::cout << senders[i] << "\t" << modes[mode] << "\t" << senders[i] * burst << "\t" << g_received
+                    << "\t" << r.drops << "\t" << senders[i] * burst - g_received << "\t" << g_marked << "\t" << r.maxOccupancy
+                    << "\t" << r.last.GetSeconds () * 1000 << std::endl;
+        }
+    }
+
+  return 0;
+}
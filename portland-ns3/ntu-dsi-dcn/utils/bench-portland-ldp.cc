@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Benchmark of the Location Discovery Protocol: how long a fat tree takes
+// to locate every switch from a cold start, and how many control frames
+// (LDMs on the links, messages to and from the Fabric Manager) it costs.
+//
+// Every switch starts knowing nothing of its level, pod or position; the
+// run stops once the Fabric Manager has heard from all of them. The
+// discovered locations are checked against the tree as it was built.
+
+#include "ns3/core-module.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <string.h>
+
+using namespace ns3;
+
+static void
+CheckConverged (Ptr<pld::FabricManager> fm, uint32_t n_switches)
+{
+  if (fm->GetNDiscoveredSwitches () == n_switches)
+    {
+      Simulator::Stop ();
+      return;
+    }
+  Simulator::Schedule (MicroSeconds (100), &CheckConverged, fm, n_switches);
+}
+
+/*
+ * Counts the switches whose discovered location does not fit the tree as built: the edge switches of a pod
+ * must share a pod and have distinct positions, aggregation switches must be in the pod of their edge
+ * switches, and lower port i of a core switch must lead to pod i.
+ */
+static uint32_t
+CountLocationErrors (const PortlandFatTreeHelper& fatTree)
+{
+  uint32_t k = fatTree.GetK ();
+  uint32_t errors = 0;
+  std::set<std::pair<uint16_t, uint16_t> > edges;
+  for (uint32_t pod = 0; pod < k; pod++)
+    {
+      uint16_t discovered = fatTree.GetEdgeSwitch (pod, 0)->GetPod ();
+      for (uint32_t i = 0; i < k / 2; i++)
+        {
+          Ptr<PortlandSwitchNetDevice> edge = fatTree.GetEdgeSwitch (pod, i);
+          Ptr<PortlandSwitchNetDevice> aggregation = fatTree.GetAggregationSwitch (pod, i);
+          errors += (edge->GetDeviceType () != EDGE || !edge->IsLocated () || edge->GetPod () != discovered);
+          errors += !edges.insert (std::make_pair (edge->GetPod (), edge->GetPosition ())).second;
+          errors += (aggregation->GetDeviceType () != AGGREGATION || !aggregation->IsLocated ()
+                     || aggregation->GetPod () != discovered || aggregation->GetPosition () != i);
+        }
+    }
+  for (uint32_t group = 0; group < k / 2; group++)
+    {
+      for (uint32_t i = 0; i < k / 2; i++)
+        {
+          Ptr<PortlandSwitchNetDevice> core = fatTree.GetCoreSwitch (group, i);
+          errors += (core->GetDeviceType () != CORE || !core->IsLocated () || core->GetPod () != group);
+        }
+    }
+  return errors;
+}
+
+static void
+runBench (uint32_t k)
+{
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.SetLocationDiscovery (true);
+  fatTree.Install (fm);
+  uint32_t n_switches = k * k + k * k / 4;
+
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Schedule (Seconds (0), &CheckConverged, fm, n_switches);
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  uint64_t deltaMs = time.End ();
+
+  uint64_t ldms = 0;
+  NodeContainer nodes = NodeContainer::GetGlobal ();
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      for (uint32_t d = 0; d < nodes.Get (n)->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> (nodes.Get (n)->GetDevice (d));
+          if (sw != 0)
+            {
+              ldms += sw->GetNLdmsSent ();
+            }
+        }
+    }
+
+  // every location request is answered
+  uint64_t fmMessages = 2 * fm->GetNRequests ();
+  std::cout << k << "\t" << n_switches << "\t" << fm->GetNDiscoveredSwitches ()
+            << "\t" << fm->GetLastDiscoveryTime ().GetMicroSeconds () / 1000.0
+            << "\t" << ldms << "\t" << (double) ldms / n_switches
+            << "\t" << fmMessages << "\t" << deltaMs;
+  uint32_t errors = CountLocationErrors (fatTree);
+  if (errors != 0)
+    {
+      std::cout << "\t(location errors: " << errors << ")";
+    }
+  std::cout << std::endl;
+
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t maxK = 24;
+  while (argc > 0) {
+      if (strncmp ("--k=", argv[0],strlen ("--k=")) == 0)
+        {
+          char const *kAscii = argv[0] + strlen ("--k=");
+          std::istringstream iss;
+          iss.str (kAscii);
+          iss >> maxK;
+        }
+      argc--;
+      argv++;
+  }
+  std::cout << "Running bench-portland-ldp up to k=" << maxK << std::endl;
+  std::cout << "k\tswitches\tlocated\tconverged-ms\tLDMs\tLDMs/switch\tFM-messages\twall-ms" << std::endl;
+
+  uint32_t ks[] = { 4, 8, 16, 24, 32, 48 };
+  for (uint32_t i = 0; i < sizeof (ks) / sizeof (ks[0]) && ks[i] <= maxK; i++)
+    {
+      runBench (ks[i]);
+    }
+
+  return 0;
+}
@@ -0,0 +1,210 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Benchmark of PortLand multicast: the link traffic of a group's packets
+// over the Fabric Manager's replication tree, pruned to the edge switches
+// with members, against naive flooding of the same packets to every host
+// over the unpruned tree.
+//
+// Random hosts of a fat tree join a group; a random host then sends a
+// stream of datagrams to it. Reported per group size: the edge switches
+// with members, the frames and bytes the switches sent for the stream in
+// either mode, the share of the flooding traffic the tree saves, and
+// whether every member got every datagram exactly once (copies missing or
+// duplicated) and no host outside the group got any (stray copies).
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/portland-fat-tree-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <map>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+static const uint32_t g_packets = 100;
+static const uint32_t g_packetSize = 1000;                      // UDP payload
+static const uint32_t g_ipSize = g_packetSize + 8 + 20;         // what the switches forward
+static const Time g_interval = MicroSeconds (100);
+static const Time g_start = MilliSeconds (50);
+
+static std::map<uint32_t, uint32_t> g_received;                 // node id -> datagrams received
+
+static void
+ReceivePacket (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      g_received[socket->GetNode ()->GetId ()]++;
+    }
+}
+
+static void
+SendPacket (Ptr<Socket> socket, Ipv4Address group)
+{
+  socket->SendTo (Create<Packet> (g_packetSize), 0, InetSocketAddress (group, 9));
+}
+
+struct Result
+{
+  uint64_t frames;              ///< Multicast frames sent by the switches
+  uint32_t memberEdges;
+  uint64_t missing;             ///< Copies members did not get
+  uint64_t duplicates;          ///< Copies members got more than once
+  uint64_t stray;               ///< Copies hosts outside the group got
+  uint64_t routeUpdates;        ///< Replication updates the Fabric Manager sent
+  uint64_t wallMs;
+};
+
+/*
+ * Runs one stream to a group of n random members; the sender is a random host, which may be a member.
+ */
+static Result
+runBench (uint32_t k, uint32_t n, bool flood, uint32_t seed)
+{
+  Config::SetDefault ("ns3::PortlandSwitchNetDevice::MulticastFlood", BooleanValue (flood));
+  Ptr<pld::FabricManager> fm = CreateObject<pld::FabricManager> ();
+  PortlandFatTreeHelper fatTree (k);
+  fatTree.Install (fm);
+  Ipv4Address group ("239.0.0.1");
+
+  // the same members and sender in both modes
+  srand (seed + n);
+  NodeContainer hosts = fatTree.GetHosts ();
+  std::vector<uint32_t> order (hosts.GetN ());
+  for (uint32_t h = 0; h < order.size (); h++)
+    {
+      order[h] = h;
+    }
+  for (uint32_t h = order.size () - 1; h > 0; h--)
+    {
+      std::swap (order[h], order[rand () % (h + 1)]);
+    }
+  std::set<uint32_t> members;
+  std::set<Ptr<PortlandSwitchNetDevice> > memberEdges;
+  for (uint32_t m = 0; m < n && m < order.size (); m++)
+    {
+      uint32_t h = order[m];
+      members.insert (hosts.Get (h)->GetId ());
+      memberEdges.insert (fatTree.GetEdgeSwitch (h / (k / 2) / (k / 2), h / (k / 2) % (k / 2)));
+      Simulator::Schedule (MicroSeconds (10 * m), &PortlandFatTreeHelper::JoinGroup, hosts.Get (h), group);
+    }
+  Ptr<Node> sender = hosts.Get (rand () % hosts.GetN ());
+
+  g_received.clear ();
+  for (uint32_t h = 0; h < hosts.GetN (); h++)
+    {
+      Ptr<Socket> sink = Socket::CreateSocket (hosts.Get (h), UdpSocketFactory::GetTypeId ());
+      sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      sink->SetRecvCallback (MakeCallback (&ReceivePacket));
+    }
+  Ptr<Socket> socket = Socket::CreateSocket (sender, UdpSocketFactory::GetTypeId ());
+  for (uint32_t i = 0; i < g_packets; i++)
+    {
+      Simulator::Schedule (g_start + MicroSeconds (i * g_interval.GetMicroSeconds ()), &SendPacket, socket, group);
+    }
+
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Stop (g_start + MilliSeconds (50));
+  Simulator::Run ();
+
+  Result r;
+  r.wallMs = time.End ();
+  r.frames = 0;
+  r.memberEdges = memberEdges.size ();
+  r.missing = 0;
+  r.duplicates = 0;
+  r.stray = 0;
+  r.routeUpdates = fm->GetNGroupRouteUpdates ();
+  for (NodeList::Iterator node = NodeList::Begin (); node != NodeList::End (); node++)
+    {
+      for (uint32_t d = 0; d < (*node)->GetNDevices (); d++)
+        {
+          Ptr<PortlandSwitchNetDevice> sw = DynamicCast<PortlandSwitchNetDevice> ((*node)->GetDevice (d));
+          if (sw != 0)
+            {
+              r.frames += sw->GetNMulticastFrames ();
+            }
+        }
+    }
+  for (uint32_t h = 0; h < hosts.GetN (); h++)
+    {
+      uint32_t id = hosts.Get (h)->GetId ();
+      uint32_t got = g_received[id];
+      if (members.find (id) == members.end ())
+        {
+          r.stray += got;
+        }
+      else if (hosts.Get (h) != sender)
+        {
+          // a sender does not get its own packets back
+          r.missing += (got < g_packets ? g_packets - got : 0);
+          r.duplicates += (got > g_packets ? got - g_packets : 0);
+        }
+    }
+
+  Simulator::Destroy ();
+  return r;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t seed = 1;
+  uint32_t k = 16;
+  while (argc > 0) {
+      if (strncmp ("--seed=", argv[0],strlen ("--seed=")) == 0)
+        {
+          char const *seedAscii = argv[0] + strlen ("--seed=");
+          std::istringstream iss;
+          iss.str (seedAscii);
+          iss >> seed;
+        }
+      if (strncmp ("--k=", argv[0],strlen ("--k=")) == 0)
+        {
+          char const *kAscii = argv[0] + strlen ("--k=");
+          std::istringstream iss;
+          iss.str (kAscii);
+          iss >> k;
+        }
+      argc--;
+      argv++;
+  }
+  std::cout << "Running bench-portland-multicast with k=" << k << " (" << k * k * k / 4 << " hosts), seed=" << seed
+            << ", " << g_packets << " datagrams of " << g_packetSize << " bytes" << std::endl;
+  std::cout << "members\tmember-edges\ttree-frames\tflood-frames\ttree-KB\tflood-KB\tsaved\tmissing\tduplicates\tstray"
+            << "\tFM-updates\twall-ms" << std::endl;
+
+  uint32_t sizes[] = { 10, 30, 100, 300, 1000 };
+  for (uint32_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]) && sizes[i] <= k * k * k / 4; i++)
+    {
+      Result tree = runBench (k, sizes[i], false, seed);
+      Result flood = runBench (k, sizes[i], true, seed);
+      std::cout << sizes[i] << "\t" << tree.memberEdges << "\t" << tree.frames << "\t" << flood.frames
+                << "\t" << tree.frames * g_ipSize / 1024 << "\t" << flood.frames * g_ipSize / 1024
+                << "\t" << 100 - 100 * tree.frames / flood.frames << "%"
+                << "\t" << tree.missing << "\t" << tree.duplicates << "\t" << tree.stray
+                << "\t" << tree.routeUpdates << "\t" << tree.wallMs + flood.wallMs << std::endl;
+    }
+
+  return 0;
+}
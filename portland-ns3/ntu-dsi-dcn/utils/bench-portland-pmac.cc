@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Microbenchmark of the PMAC table lookups done by an edge switch for
+// every packet it receives, as the number of hosts (and VMs per host)
+// behind the switch grows; with 256 VMs on each of 256 ports the switch
+// holds 65536 PMACs.
+//
+// Per simulated packet an edge switch resolves the source (FindPMAC by
+// AMAC, FindPort by PMAC, FindPMAC by IP), the destination (FindPort and
+// FindPMAC by IP) and, on the way down, the destination AMAC (FindAMAC by
+// PMAC).
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/portland-pmac-table.h"
+#include "ns3/portland-pmac.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+static Mac48Address
+MakeMac (uint8_t first, uint32_t n)
+{
+  uint8_t buffer[6] = { first, 0, (uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t) n };
+  Mac48Address mac;
+  mac.CopyFrom (buffer);
+  return mac;
+}
+
+static void
+runBench (uint32_t hosts, uint32_t vms, uint32_t n)
+{
+  uint32_t entries = hosts * vms;
+  pld::PMACTable table;
+  std::vector<Mac48Address> pmacs, amacs;
+  std::vector<Ipv4Address> ips;
+  for (uint32_t i = 0; i < entries; i++)
+    {
+      Mac48Address pmac = pld::PMAC::Encode (1, 2, i / vms, i % vms + 1);
+      pmacs.push_back (pmac);
+      amacs.push_back (MakeMac (2, i));
+      ips.push_back (Ipv4Address (0x0a000000 + i));
+      table.Add (pmac, amacs[i], ips[i], i / vms);
+    }
+
+  std::vector<uint32_t> src (n), dst (n);
+  srand (1);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      src[i] = rand () % entries;
+      dst[i] = rand () % entries;
+    }
+
+  uint32_t found = 0;
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      found += (table.FindPMAC (amacs[src[i]]) == pmacs[src[i]]);
+      found += (table.FindPort (pmacs[src[i]]) != -1);
+      found += (table.FindPMAC (ips[src[i]]) == pmacs[src[i]]);
+      found += (table.FindPort (ips[dst[i]]) != -1);
+      found += (table.FindPMAC (ips[dst[i]]) == pmacs[dst[i]]);
+      found += (table.FindAMAC (pmacs[dst[i]]) == amacs[dst[i]]);
+    }
+  uint64_t deltaMs = time.End ();
+
+  double nsPerPacket = deltaMs * 1e6 / n;
+  std::cout << hosts << "\t" << vms << "\t" << entries << "\t" << nsPerPacket;
+  if (found != 6 * n)
+    {
+      std::cout << "\t(lookup errors: " << 6 * n - found << ")";
+    }
+  std::cout << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0],strlen ("--n=")) == 0)
+        {
+          char const *nAscii = argv[0] + strlen ("--n=");
+          std::istringstream iss;
+          iss.str (nAscii);
+          iss >> n;
+        }
+      argc--;
+      argv++;
+  }
+  std::cout << "Running bench-portland-pmac with n=" << n << std::endl;
+  std::cout << "hosts\tvms\tentries\tns/packet" << std::endl;
+
+  uint32_t hosts[] = { 4, 16, 64, 256 };
+  uint32_t vms[] = { 1, 4, 16, 64, 256 };
+  for (uint32_t h = 0; h < sizeof (hosts) / sizeof (hosts[0]); h++)
+    {
+      for (uint32_t v = 0; v < sizeof (vms) / sizeof (vms[0]); v++)
+        {
+          runBench (hosts[h], vms[v], n);
+        }
+    }
+
+  return 0;
+}
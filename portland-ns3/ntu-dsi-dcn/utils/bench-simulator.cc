@@ -22,19 +22,49 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <string>
 #include <string.h>
+#include <stdlib.h>
+#include <new>
 
 using namespace ns3;
 
 
 bool g_debug = false;
 
+// every allocation of the process, the simulator libraries included, goes through these;
+// they are kept out of line so that the compiler does not pair a delete expression with free
+static uint64_t g_allocations = 0;
+
+void *operator new (size_t size) throw (std::bad_alloc) __attribute__ ((noinline));
+void operator delete (void *p) throw () __attribute__ ((noinline));
+
+void *
+operator new (size_t size) throw (std::bad_alloc)
+{
+  g_allocations++;
+  void *p = malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) throw ()
+{
+  free (p);
+}
+
 class Bench 
 {
 public:
   Bench ();
   void ReadDistribution (std::istream &istream);
   void SetTotal (uint32_t total);
+  void SetPopulation (uint32_t population);
+  uint32_t GetDistributionSize (void) const;
   void RunBench (void);
 private:
   void Cb (void);
@@ -42,11 +72,13 @@ private:
   std::vector<uint64_t>::const_iterator m_current;
   uint32_t m_n;
   uint32_t m_total;
+  uint32_t m_population;
 };
 
 Bench::Bench ()
   : m_n (0),
-    m_total (0)
+    m_total (0),
+    m_population (0)
 {}
 
 void 
@@ -55,6 +87,18 @@ Bench::SetTotal (uint32_t total)
   m_total = total;
 }
 
+void
+Bench::SetPopulation (uint32_t population)
+{
+  m_population = population;
+}
+
+uint32_t
+Bench::GetDistributionSize (void) const
+{
+  return m_distribution.size ();
+}
+
 void
 Bench::ReadDistribution (std::istream &input)
 {
@@ -80,29 +124,39 @@ Bench::RunBench (void)
 {
   SystemWallClockMs time;
   double init, simu;
+  // the events held at any time: the whole distribution unless told otherwise
+  std::vector<uint64_t>::const_iterator end = m_distribution.end ();
+  if (m_population != 0 && m_population < m_distribution.size ())
+    {
+      end = m_distribution.begin () + m_population;
+    }
+  m_n = 0;
   time.Start ();
   for (std::vector<uint64_t>::const_iterator i = m_distribution.begin ();
-       i != m_distribution.end (); i++) 
+       i != end; i++) 
     {
       Simulator::Schedule (NanoSeconds (*i), &Bench::Cb, this);
     }
   init = time.End ();
   init /= 1000;
 
-  m_current = m_distribution.begin ();
+  m_current = end;
 
+  uint64_t allocations = g_allocations;
   time.Start ();
   Simulator::Run ();
   simu = time.End ();
   simu /= 1000;
+  allocations = g_allocations - allocations;
 
   std::cout <<
-      "init n=" << m_distribution.size () << ", time=" << init << "s" << std::endl <<
+      "init n=" << end - m_distribution.begin () << ", time=" << init << "s" << std::endl <<
       "simu n=" << m_n << ", time=" <<simu << "s" << std::endl <<
-      "init " << ((double)m_distribution.size ()) / init << " insert/s, avg insert=" <<
-      init / ((double)m_distribution.size ())<< "s" << std::endl <<
+      "init " << ((double)(end - m_distribution.begin ())) / init << " insert/s, avg insert=" <<
+      init / ((double)(end - m_distribution.begin ()))<< "s" << std::endl <<
       "simu " << ((double)m_n) / simu<< " hold/s, avg hold=" << 
-      simu / ((double)m_n) << "s" << std::endl
+      simu / ((double)m_n) << "s" << std::endl <<
+      "simu " << ((double)allocations) / m_n << " allocations/event" << std::endl
       ;
 }
 
@@ -131,10 +185,19 @@ PrintHelp (void)
 {
   std::cout << "bench-simulator filename [options]"<<std::endl;
   std::cout << "  filename: a string which identifies the input distribution. \"-\" represents stdin." << std::endl;
+  std::cout << "            The distribution is a list of event delays in seconds, such as those written by" << std::endl;
+  std::cout << "            the --eventDelays option of scratch/Portland-Setup and scratch/Three-tier." << std::endl;
   std::cout << "  Options:"<<std::endl;
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --calendar: use Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ns2calendar: use ns-2 Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ladder: use Ladder Queue scheduler"<<std::endl;
+  std::cout << "      --all: run every scheduler in turn; std::list only for populations of up to 10000"<<std::endl;
+  std::cout << "      --total=N: number of events to run after the initial ones (20000)"<<std::endl;
+  std::cout << "      --population=N: number of events held, taken from the start of the distribution (all)"<<std::endl;
+  std::cout << "      --n=N: number of runs (1)"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -144,6 +207,8 @@ int main (int argc, char *argv[])
   std::istream *input;
   uint32_t n = 1;
   uint32_t total = 20000;
+  uint32_t population = 0;
+  std::vector<std::string> schedulers;
   if (argc == 1)
     {
       PrintHelp ();
@@ -161,26 +226,38 @@ int main (int argc, char *argv[])
     }
   while (argc > 0) 
     {
-      ObjectFactory factory;
       if (strcmp ("--list", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::ListScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::ListScheduler");
         } 
       else if (strcmp ("--heap", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::HeapScheduler");
         } 
       else if (strcmp ("--map", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::MapScheduler");
         } 
       else if (strcmp ("--calendar", argv[0]) == 0)
         {
-          factory.SetTypeId ("ns3::CalendarScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::CalendarScheduler");
+        }
+      else if (strcmp ("--ns2calendar", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::Ns2CalendarScheduler");
+        }
+      else if (strcmp ("--ladder", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::LadderScheduler");
+        }
+      else if (strcmp ("--all", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::ListScheduler");
+          schedulers.push_back ("ns3::MapScheduler");
+          schedulers.push_back ("ns3::HeapScheduler");
+          schedulers.push_back ("ns3::CalendarScheduler");
+          schedulers.push_back ("ns3::Ns2CalendarScheduler");
+          schedulers.push_back ("ns3::LadderScheduler");
         }
       else if (strcmp ("--debug", argv[0]) == 0) 
         {
@@ -194,6 +271,10 @@ int main (int argc, char *argv[])
         {
           n = atoi (argv[0]+strlen ("--n="));
         } 
+      else if (strncmp ("--population=", argv[0], strlen("--population=")) == 0) 
+        {
+          population = atoi (argv[0]+strlen ("--population="));
+        } 
 
       argc--;
       argv++;
@@ -201,9 +282,32 @@ int main (int argc, char *argv[])
   Bench *bench = new Bench ();
   bench->ReadDistribution (*input);
   bench->SetTotal (total);
-  for (uint32_t i = 0; i < n; i++)
+  bench->SetPopulation (population);
+  if (schedulers.empty ())
     {
-      bench->RunBench ();
+      // the default scheduler
+      schedulers.push_back ("");
+    }
+  for (std::vector<std::string>::const_iterator s = schedulers.begin (); s != schedulers.end (); s++)
+    {
+      if (!s->empty ())
+        {
+          uint32_t held = (population != 0 ? population : bench->GetDistributionSize ());
+          if (*s == "ns3::ListScheduler" && schedulers.size () > 1 && held > 10000)
+            {
+              std::cout << "skipping " << *s << ": " << held << " events held" << std::endl;
+              continue;
+            }
+          ObjectFactory factory;
+          factory.SetTypeId (*s);
+          Simulator::SetScheduler (factory);
+          std::cout << "scheduler " << *s << std::endl;
+        }
+      for (uint32_t i = 0; i < n; i++)
+        {
+          bench->RunBench ();
+        }
+      Simulator::Destroy ();
     }
 
   return 0;